@@ -63,6 +63,71 @@ struct nlbl_handle;
  */
 typedef struct nl_msg nlbl_msg;
 
+/**
+ * NetLabel batch of requests
+ *
+ * Opaque type used to queue multiple configuration requests so that they can
+ * be sent to the NetLabel subsystem without waiting for each response.
+ *
+ */
+struct nlbl_batch;
+
+/**
+ * NetLabel transport
+ *
+ * NetLabel type used to select how NetLabel handles communicate with the
+ * NetLabel subsystem: over generic netlink to the kernel, with an in-process
+ * emulation of the kernel's NetLabel subsystem which needs neither root nor
+ * kernel support and is intended for testing and benchmarking, by replaying
+ * the kernel's replies from a capture file, or through the netlabeld daemon.
+ *
+ */
+typedef uint32_t nlbl_transport;
+#define NLBL_TRANSPORT_NETLINK		0
+#define NLBL_TRANSPORT_FAKE		1
+#define NLBL_TRANSPORT_REPLAY		2
+#define NLBL_TRANSPORT_DAEMON		3
+
+/* default netlabeld socket */
+#define NLBL_DAEMON_PATH		"/run/netlabeld.sock"
+
+/* default Generic Netlink family ID cache */
+#define NLBL_FID_CACHE_PATH		"/run/netlabel.fid"
+
+/**
+ * NetLabel request statistics
+ * @param requests number of requests sent
+ * @param errors number of requests which failed
+ * @param timeouts number of requests which timed out
+ * @param bytes_sent number of bytes sent
+ * @param bytes_recv number of bytes received
+ * @param dump_msgs number of dump messages received
+ * @param lat_count number of requests with a latency measurement
+ * @param lat_total sum of the request latencies in nanoseconds
+ * @param lat_max highest request latency in nanoseconds
+ * @param lat_hist request latency histogram
+ *
+ * NetLabel type used to return the statistics of a single NetLabel command.
+ * The request latency is the time from sending a request to reading the
+ * last message of its reply; entry N of the latency histogram counts the
+ * requests with a latency of at least 2^N and less than 2^(N+1) nanoseconds,
+ * the last entry also counts all longer latencies.
+ *
+ */
+#define NLBL_STATS_HIST_SIZE		36
+struct nlbl_stats {
+	uint64_t requests;
+	uint64_t errors;
+	uint64_t timeouts;
+	uint64_t bytes_sent;
+	uint64_t bytes_recv;
+	uint64_t dump_msgs;
+	uint64_t lat_count;
+	uint64_t lat_total;
+	uint64_t lat_max;
+	uint64_t lat_hist[NLBL_STATS_HIST_SIZE];
+};
+
 /**
  * NetLabel labeling protocol
  *
@@ -195,6 +260,56 @@ struct nlbl_cv4_cat_a {
 	size_t size;
 };
 
+/**
+ * NetLabel CIPSOv4 MLS mapping range
+ * @param loc first local value
+ * @param rem first remote value
+ * @param count number of values
+ *
+ * NetLabel type used to represent a run of CIPSOv4 MLS level or category
+ * mappings, the local values @loc to @loc + @count - 1 map to the remote
+ * values @rem to @rem + @count - 1.
+ *
+ */
+struct nlbl_cv4_range {
+	uint32_t loc;
+	uint32_t rem;
+	uint32_t count;
+};
+
+/**
+ * NetLabel CIPSOv4 MLS mapping range array
+ * @param array array of mapping ranges
+ * @param size size of array
+ *
+ * NetLabel type used to represent an array of CIPSOv4 MLS level or category
+ * mapping ranges.
+ *
+ */
+struct nlbl_cv4_range_a {
+	struct nlbl_cv4_range *array;
+	size_t size;
+};
+
+/**
+ * NetLabel CIPSOv4 DOI definition
+ * @param doi DOI value
+ * @param mtype mapping type
+ * @param tags array of tags
+ * @param lvls array of MLS level mapping ranges
+ * @param cats array of MLS category mapping ranges
+ *
+ * NetLabel type used to represent the full definition of a CIPSOv4 DOI.
+ *
+ */
+struct nlbl_cv4_def {
+	nlbl_cv4_doi doi;
+	nlbl_cv4_mtype mtype;
+	struct nlbl_cv4_tag_a tags;
+	struct nlbl_cv4_range_a lvls;
+	struct nlbl_cv4_range_a cats;
+};
+
 /* NetLabel and LSM Mapping Types */
 
 /**
@@ -236,6 +351,26 @@ struct nlbl_dommap {
 	} proto;
 };
 
+/**
+ * NetLabel LSM/Domain mapping list
+ * @param count number of domain mappings
+ * @param domains array of domain mappings
+ * @param addr_count number of address selectors
+ * @param addrs array of address selectors
+ *
+ * NetLabel type used to return a list of domain mappings in a single block of
+ * memory.  The address selectors of each domain mapping are adjacent entries
+ * of @addrs, which are also linked through their next pointers, and the domain
+ * strings are stored after the selectors.
+ *
+ */
+struct nlbl_dommap_list {
+	size_t count;
+	struct nlbl_dommap *domains;
+	size_t addr_count;
+	struct nlbl_dommap_addr *addrs;
+};
+
 /**
  * NetLabel network address mapping structure
  * @param dev network device
@@ -252,6 +387,151 @@ struct nlbl_addrmap {
 	nlbl_secctx label;
 };
 
+/* Address Lookup Types */
+
+/**
+ * NetLabel static label table
+ *
+ * Opaque type used to find the static label which the kernel would assign to
+ * unlabeled network traffic without asking the kernel for each packet.
+ *
+ */
+struct nlbl_unlbl_table;
+
+/**
+ * NetLabel domain mapping table
+ *
+ * Opaque type used to find the labeling protocol which the kernel would use
+ * for outbound network traffic without asking the kernel for each packet.
+ *
+ */
+struct nlbl_mgmt_table;
+
+/* Interned String Types */
+
+/**
+ * NetLabel interned string table
+ *
+ * Opaque type used to share a single copy of each distinct interface name and
+ * security label among the results of a dump.
+ *
+ */
+struct nlbl_strtab;
+
+/* Dump Callback Types */
+
+/**
+ * NetLabel protocol dump callback
+ * @param protocol the protocol
+ * @param arg the callback argument
+ *
+ * Callback used to walk the supported protocols, returns zero to continue the
+ * walk, a positive value to stop it, or a negative value to abort it.
+ *
+ */
+typedef int (*nlbl_proto_cb)(nlbl_proto protocol, void *arg);
+
+/**
+ * NetLabel domain mapping dump callback
+ * @param domain the domain mapping
+ * @param arg the callback argument
+ *
+ * Callback used to walk the domain mappings, the mapping is only valid until
+ * the callback returns.  Returns zero to continue the walk, a positive value
+ * to stop it, or a negative value to abort it.
+ *
+ */
+typedef int (*nlbl_dommap_cb)(struct nlbl_dommap *domain, void *arg);
+
+/**
+ * NetLabel address mapping dump callback
+ * @param addr the address mapping
+ * @param arg the callback argument
+ *
+ * Callback used to walk the static label address mappings, the mapping is
+ * only valid until the callback returns.  Returns zero to continue the walk, a
+ * positive value to stop it, or a negative value to abort it.
+ *
+ */
+typedef int (*nlbl_addrmap_cb)(struct nlbl_addrmap *addr, void *arg);
+
+/**
+ * NetLabel CIPSOv4 DOI dump callback
+ * @param doi the DOI value
+ * @param mtype the DOI mapping type
+ * @param arg the callback argument
+ *
+ * Callback used to walk the CIPSOv4 DOI definitions, returns zero to continue
+ * the walk, a positive value to stop it, or a negative value to abort it.
+ *
+ */
+typedef int (*nlbl_cv4_doi_cb)(nlbl_cv4_doi doi,
+			       nlbl_cv4_mtype mtype, void *arg);
+
+/* Asynchronous Request Types */
+
+/**
+ * NetLabel asynchronous request context
+ *
+ * Opaque type used to track requests which have been submitted to the
+ * NetLabel subsystem but have not yet completed.
+ *
+ */
+struct nlbl_async;
+
+/**
+ * NetLabel asynchronous request result
+ * @param count number of entries in the array results
+ * @param data.version protocol version
+ * @param data.allow_flag unlabeled traffic accept flag
+ * @param data.protocols array of supported protocols
+ * @param data.domain default domain mapping
+ * @param data.domains array of domain mappings
+ * @param data.addrs array of static label address mappings
+ * @param data.cv4_all.dois array of CIPSOv4 DOI values
+ * @param data.cv4_all.mtypes array of CIPSOv4 DOI mapping types
+ * @param data.cv4_doi CIPSOv4 DOI definition
+ *
+ * NetLabel type used to return the results of a completed asynchronous
+ * request, only the member matching the request is valid.  The callback owns
+ * any memory referenced by the results and must free it just as it would the
+ * results of the equivalent synchronous call.
+ *
+ */
+struct nlbl_async_result {
+	size_t count;
+	union {
+		uint32_t version;
+		uint8_t allow_flag;
+		nlbl_proto *protocols;
+		struct nlbl_dommap domain;
+		struct nlbl_dommap *domains;
+		struct nlbl_addrmap *addrs;
+		struct {
+			nlbl_cv4_doi *dois;
+			nlbl_cv4_mtype *mtypes;
+		} cv4_all;
+		struct {
+			nlbl_cv4_mtype mtype;
+			struct nlbl_cv4_tag_a tags;
+			struct nlbl_cv4_lvl_a lvls;
+			struct nlbl_cv4_cat_a cats;
+		} cv4_doi;
+	} data;
+};
+
+/**
+ * NetLabel asynchronous request completion callback
+ * @param rc the return value of the equivalent synchronous call
+ * @param res the request results, NULL on failure
+ * @param arg the argument given when the request was submitted
+ *
+ * Callback invoked exactly once for each submitted request when the kernel
+ * has finished processing it.
+ *
+ */
+typedef void (*nlbl_async_cb)(int rc, struct nlbl_async_result *res, void *arg);
+
 /*
  * Functions
  */
@@ -265,6 +545,12 @@ void nlbl_exit(void);
 
 /* Communications Control */
 void nlbl_comm_timeout(uint32_t seconds);
+int nlbl_comm_pool_size(uint32_t size);
+int nlbl_comm_transport(nlbl_transport transport);
+int nlbl_comm_capture(const char *path);
+int nlbl_comm_replay(const char *path);
+int nlbl_comm_daemon(const char *path);
+int nlbl_comm_fid_cache(const char *path);
 
 /* Raw NetLabel I/O API */
 struct nlbl_handle *nlbl_comm_open(void);
@@ -273,6 +559,11 @@ int nlbl_comm_recv(struct nlbl_handle *hndl, nlbl_msg **msg);
 int nlbl_comm_recv_raw(struct nlbl_handle *hndl, unsigned char **data);
 int nlbl_comm_send(struct nlbl_handle *hndl, nlbl_msg *msg);
 
+/* Statistics */
+void nlbl_stats_enable(unsigned int enable);
+void nlbl_stats_reset(void);
+int nlbl_stats_get(nlbl_proto family, uint8_t cmd, struct nlbl_stats *stats);
+
 /* Message Handling */
 nlbl_msg *nlbl_msg_new(void);
 void nlbl_msg_free(nlbl_msg *msg);
@@ -289,6 +580,8 @@ struct nlattr *nlbl_attr_find(nlbl_msg *msg, int nla_type);
 /* Management */
 int nlbl_mgmt_version(struct nlbl_handle *hndl, uint32_t *version);
 int nlbl_mgmt_protocols(struct nlbl_handle *hndl, nlbl_proto **protocols);
+int nlbl_mgmt_protocols_walk(struct nlbl_handle *hndl,
+			     nlbl_proto_cb cb, void *arg);
 int nlbl_mgmt_add(struct nlbl_handle *hndl,
 		  struct nlbl_dommap *domain,
 		  struct nlbl_netaddr *addr);
@@ -298,6 +591,11 @@ int nlbl_mgmt_adddef(struct nlbl_handle *hndl,
 int nlbl_mgmt_del(struct nlbl_handle *hndl, char *domain);
 int nlbl_mgmt_deldef(struct nlbl_handle *hndl);
 int nlbl_mgmt_listall(struct nlbl_handle *hndl, struct nlbl_dommap **domains);
+int nlbl_mgmt_listall_walk(struct nlbl_handle *hndl,
+			   nlbl_dommap_cb cb, void *arg);
+int nlbl_mgmt_listall_list(struct nlbl_handle *hndl,
+			   struct nlbl_dommap_list **list);
+void nlbl_dommap_list_free(struct nlbl_dommap_list *list);
 int nlbl_mgmt_listdef(struct nlbl_handle *hndl, struct nlbl_dommap *domain);
 
 /* Unlabeled Traffic */
@@ -317,8 +615,44 @@ int nlbl_unlbl_staticdeldef(struct nlbl_handle *hndl,
 			    struct nlbl_netaddr *addr);
 int nlbl_unlbl_staticlist(struct nlbl_handle *hndl,
 			  struct nlbl_addrmap **addrs);
+int nlbl_unlbl_staticlist_walk(struct nlbl_handle *hndl,
+			       nlbl_addrmap_cb cb, void *arg);
 int nlbl_unlbl_staticlistdef(struct nlbl_handle *hndl,
 			     struct nlbl_addrmap **addrs);
+int nlbl_unlbl_staticlistdef_walk(struct nlbl_handle *hndl,
+				  nlbl_addrmap_cb cb, void *arg);
+int nlbl_unlbl_staticlist_strtab(struct nlbl_handle *hndl,
+				 struct nlbl_strtab *tab,
+				 struct nlbl_addrmap **addrs);
+int nlbl_unlbl_staticlistdef_strtab(struct nlbl_handle *hndl,
+				    struct nlbl_strtab *tab,
+				    struct nlbl_addrmap **addrs);
+
+/* Interned Strings */
+struct nlbl_strtab *nlbl_strtab_new(void);
+void nlbl_strtab_free(struct nlbl_strtab *tab);
+const char *nlbl_strtab_intern(struct nlbl_strtab *tab, const char *str);
+
+/* Address Lookups */
+struct nlbl_mgmt_table *nlbl_mgmt_table_new(void);
+void nlbl_mgmt_table_free(struct nlbl_mgmt_table *tbl);
+int nlbl_mgmt_table_add(struct nlbl_mgmt_table *tbl,
+			struct nlbl_dommap *domain);
+int nlbl_mgmt_table_load(struct nlbl_handle *hndl,
+			 struct nlbl_mgmt_table *tbl);
+struct nlbl_dommap_addr *nlbl_mgmt_table_lookup(struct nlbl_mgmt_table *tbl,
+						const char *domain,
+						struct nlbl_netaddr *addr,
+						uint8_t *def_flag);
+struct nlbl_unlbl_table *nlbl_unlbl_table_new(void);
+void nlbl_unlbl_table_free(struct nlbl_unlbl_table *tbl);
+int nlbl_unlbl_table_add(struct nlbl_unlbl_table *tbl,
+			 struct nlbl_addrmap *addr);
+int nlbl_unlbl_table_load(struct nlbl_handle *hndl,
+			  struct nlbl_unlbl_table *tbl);
+struct nlbl_addrmap *nlbl_unlbl_table_lookup(struct nlbl_unlbl_table *tbl,
+					     nlbl_netdev dev,
+					     struct nlbl_netaddr *addr);
 
 /* CIPSOv4 Protocol */
 int nlbl_cipsov4_add_trans(struct nlbl_handle *hndl,
@@ -326,6 +660,11 @@ int nlbl_cipsov4_add_trans(struct nlbl_handle *hndl,
 			   struct nlbl_cv4_tag_a *tags,
 			   struct nlbl_cv4_lvl_a *lvls,
 			   struct nlbl_cv4_cat_a *cats);
+int nlbl_cipsov4_add_trans_range(struct nlbl_handle *hndl,
+				 nlbl_cv4_doi doi,
+				 struct nlbl_cv4_tag_a *tags,
+				 struct nlbl_cv4_range_a *lvls,
+				 struct nlbl_cv4_range_a *cats);
 int nlbl_cipsov4_add_pass(struct nlbl_handle *hndl,
 			  nlbl_cv4_doi doi,
 			  struct nlbl_cv4_tag_a *tags);
@@ -337,8 +676,138 @@ int nlbl_cipsov4_list(struct nlbl_handle *hndl,
 		      struct nlbl_cv4_tag_a *tags,
 		      struct nlbl_cv4_lvl_a *lvls,
 		      struct nlbl_cv4_cat_a *cats);
+int nlbl_cipsov4_list_range(struct nlbl_handle *hndl,
+			    nlbl_cv4_doi doi,
+			    nlbl_cv4_mtype *mtype,
+			    struct nlbl_cv4_tag_a *tags,
+			    struct nlbl_cv4_range_a *lvls,
+			    struct nlbl_cv4_range_a *cats);
 int nlbl_cipsov4_listall(struct nlbl_handle *hndl,
 			 nlbl_cv4_doi **dois,
 			 nlbl_cv4_mtype **mtypes);
+int nlbl_cipsov4_listall_walk(struct nlbl_handle *hndl,
+			      nlbl_cv4_doi_cb cb, void *arg);
+int nlbl_cipsov4_listall_detail(struct nlbl_handle *hndl,
+				struct nlbl_cv4_def **defs);
+void nlbl_cipsov4_def_free(struct nlbl_cv4_def *defs, size_t count);
+
+/* Pipelined Requests */
+struct nlbl_batch *nlbl_batch_new(void);
+void nlbl_batch_free(struct nlbl_batch *batch);
+size_t nlbl_batch_count(struct nlbl_batch *batch);
+int nlbl_batch_exec(struct nlbl_handle *hndl,
+		    struct nlbl_batch *batch,
+		    int *status);
+int nlbl_batch_mgmt_add(struct nlbl_batch *batch,
+			struct nlbl_dommap *domain,
+			struct nlbl_netaddr *addr);
+int nlbl_batch_mgmt_adddef(struct nlbl_batch *batch,
+			   struct nlbl_dommap *domain,
+			   struct nlbl_netaddr *addr);
+int nlbl_batch_mgmt_del(struct nlbl_batch *batch, char *domain);
+int nlbl_batch_mgmt_deldef(struct nlbl_batch *batch);
+int nlbl_batch_unlbl_accept(struct nlbl_batch *batch, uint8_t allow_flag);
+int nlbl_batch_unlbl_staticadd(struct nlbl_batch *batch,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr,
+			       nlbl_secctx label);
+int nlbl_batch_unlbl_staticadddef(struct nlbl_batch *batch,
+				  struct nlbl_netaddr *addr,
+				  nlbl_secctx label);
+int nlbl_batch_unlbl_staticdel(struct nlbl_batch *batch,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr);
+int nlbl_batch_unlbl_staticdeldef(struct nlbl_batch *batch,
+				  struct nlbl_netaddr *addr);
+int nlbl_batch_cipsov4_add_trans(struct nlbl_batch *batch,
+				 nlbl_cv4_doi doi,
+				 struct nlbl_cv4_tag_a *tags,
+				 struct nlbl_cv4_lvl_a *lvls,
+				 struct nlbl_cv4_cat_a *cats);
+int nlbl_batch_cipsov4_add_trans_range(struct nlbl_batch *batch,
+				       nlbl_cv4_doi doi,
+				       struct nlbl_cv4_tag_a *tags,
+				       struct nlbl_cv4_range_a *lvls,
+				       struct nlbl_cv4_range_a *cats);
+int nlbl_batch_cipsov4_add_pass(struct nlbl_batch *batch,
+				nlbl_cv4_doi doi,
+				struct nlbl_cv4_tag_a *tags);
+int nlbl_batch_cipsov4_add_local(struct nlbl_batch *batch, nlbl_cv4_doi doi);
+int nlbl_batch_cipsov4_del(struct nlbl_batch *batch, nlbl_cv4_doi doi);
+
+/* Asynchronous Requests */
+struct nlbl_async *nlbl_async_new(struct nlbl_handle *hndl);
+void nlbl_async_free(struct nlbl_async *async);
+int nlbl_async_fd(struct nlbl_async *async);
+size_t nlbl_async_pending(struct nlbl_async *async);
+int nlbl_async_blocked(struct nlbl_async *async);
+int nlbl_async_process(struct nlbl_async *async);
+int nlbl_async_mgmt_version(struct nlbl_async *async,
+			    nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_protocols(struct nlbl_async *async,
+			      nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_add(struct nlbl_async *async,
+			struct nlbl_dommap *domain,
+			struct nlbl_netaddr *addr,
+			nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_adddef(struct nlbl_async *async,
+			   struct nlbl_dommap *domain,
+			   struct nlbl_netaddr *addr,
+			   nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_del(struct nlbl_async *async,
+			char *domain,
+			nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_deldef(struct nlbl_async *async,
+			   nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_listall(struct nlbl_async *async,
+			    nlbl_async_cb cb, void *arg);
+int nlbl_async_mgmt_listdef(struct nlbl_async *async,
+			    nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_accept(struct nlbl_async *async,
+			    uint8_t allow_flag,
+			    nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_list(struct nlbl_async *async,
+			  nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_staticadd(struct nlbl_async *async,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr,
+			       nlbl_secctx label,
+			       nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_staticadddef(struct nlbl_async *async,
+				  struct nlbl_netaddr *addr,
+				  nlbl_secctx label,
+				  nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_staticdel(struct nlbl_async *async,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr,
+			       nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_staticdeldef(struct nlbl_async *async,
+				  struct nlbl_netaddr *addr,
+				  nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_staticlist(struct nlbl_async *async,
+				nlbl_async_cb cb, void *arg);
+int nlbl_async_unlbl_staticlistdef(struct nlbl_async *async,
+				   nlbl_async_cb cb, void *arg);
+int nlbl_async_cipsov4_add_trans(struct nlbl_async *async,
+				 nlbl_cv4_doi doi,
+				 struct nlbl_cv4_tag_a *tags,
+				 struct nlbl_cv4_lvl_a *lvls,
+				 struct nlbl_cv4_cat_a *cats,
+				 nlbl_async_cb cb, void *arg);
+int nlbl_async_cipsov4_add_pass(struct nlbl_async *async,
+				nlbl_cv4_doi doi,
+				struct nlbl_cv4_tag_a *tags,
+				nlbl_async_cb cb, void *arg);
+int nlbl_async_cipsov4_add_local(struct nlbl_async *async,
+				 nlbl_cv4_doi doi,
+				 nlbl_async_cb cb, void *arg);
+int nlbl_async_cipsov4_del(struct nlbl_async *async,
+			   nlbl_cv4_doi doi,
+			   nlbl_async_cb cb, void *arg);
+int nlbl_async_cipsov4_list(struct nlbl_async *async,
+			    nlbl_cv4_doi doi,
+			    nlbl_async_cb cb, void *arg);
+int nlbl_async_cipsov4_listall(struct nlbl_async *async,
+			       nlbl_async_cb cb, void *arg);
 
 #endif
@@ -23,6 +23,8 @@
  */
 
 #include <stdlib.h>
+#include <limits.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -32,31 +34,82 @@
 
 #include "netlabel_internal.h"
 
-/* Generic Netlink family ID */
-static uint16_t nlbl_cipsov4_fid = 0;
+/* NetLabel CIPSOv4 attribute policy */
+static const struct nla_policy nlbl_cipsov4_policy[NLBL_CIPSOV4_A_MAX + 1] = {
+	[NLBL_CIPSOV4_A_DOI] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MTYPE] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_TAG] = { .type = NLA_U8 },
+	[NLBL_CIPSOV4_A_TAGLST] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSLVLLOC] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSLVLREM] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSLVL] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSLVLLST] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSCATLOC] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSCATREM] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSCAT] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSCATLST] = { .type = NLA_NESTED },
+};
+
+/* NetLabel CIPSOv4 dump state */
+struct nlbl_cipsov4_walk_arg {
+	nlbl_cv4_doi_cb cb;
+	void *cb_arg;
+	int count;
+};
+
+/* NetLabel CIPSOv4 result arrays */
+struct nlbl_cipsov4_doi_array {
+	nlbl_cv4_doi *dois;
+	nlbl_cv4_mtype *mtypes;
+	size_t count;
+};
+
+/* NetLabel CIPSOv4 DOI definitions being fetched */
+struct nlbl_cipsov4_detail {
+	uint16_t fid;
+	struct nlbl_cv4_def *defs;
+	int *rc;
+	int *status;
+};
 
 /*
  * Helper functions
  */
 
+/**
+ * Return the CIPSO/IPv4 Generic Netlink family ID
+ *
+ * Returns the family ID, which is resolved the first time it is needed, or
+ * zero if the family can not be resolved.
+ *
+ */
+static uint16_t nlbl_cipsov4_fid(void)
+{
+	int rc;
+
+	rc = nlbl_comm_family(NETLBL_NLTYPE_CIPSOV4);
+	return (rc > 0 ? rc : 0);
+}
+
 /**
  * Create a new NetLabel CIPSOv4 message
  * @param command the NetLabel management command
  * @param flags the message flags
+ * @param len the length of the attributes, zero for the default size
  *
  * This function creates a new NetLabel CIPSOv4 message using @command and
- * @flags.  Returns a pointer to the new message on success, or NULL on
- * failure.
+ * @flags, with room for exactly @len bytes of attributes if @len is not zero.
+ * Returns a pointer to the new message on success, or NULL on failure.
  *
  */
-static nlbl_msg *nlbl_cipsov4_msg_new(uint16_t command, int flags)
+static nlbl_msg *nlbl_cipsov4_msg_new(uint16_t command, int flags, size_t len)
 {
 	nlbl_msg *msg;
 	struct nlmsghdr *nl_hdr;
 	struct genlmsghdr *genl_hdr;
 
 	/* create a new message */
-	msg = nlbl_msg_new();
+	msg = nlbl_msg_new_size(len);
 	if (msg == NULL)
 		goto msg_new_failure;
 
@@ -64,7 +117,7 @@ static nlbl_msg *nlbl_cipsov4_msg_new(uint16_t command, int flags)
 	nl_hdr = nlbl_msg_nlhdr(msg);
 	if (nl_hdr == NULL)
 		goto msg_new_failure;
-	nl_hdr->nlmsg_type = nlbl_cipsov4_fid;
+	nl_hdr->nlmsg_type = nlbl_cipsov4_fid();
 	nl_hdr->nlmsg_flags = flags;
 
 	/* setup the generic netlink header */
@@ -81,840 +134,1970 @@ msg_new_failure:
 }
 
 /**
- * Read a NetLbel CIPSOv4 message
- * @param hndl the NetLabel handle
- * @param msg the message
+ * Append a mapping to an array of mapping ranges
+ * @param ranges the mapping ranges
+ * @param loc the local value
+ * @param rem the remote value
  *
- * Try to read a NetLabel CIPSOv4 message and return the message in @msg.
- * Returns the number of bytes read on success, zero on EOF, and negative
+ * Add the mapping of @loc to @rem to the end of @ranges, extending the last
+ * range if the mapping follows on from it.  Returns zero on success, negative
  * values on failure.
  *
  */
-static int nlbl_cipsov4_recv(struct nlbl_handle *hndl, nlbl_msg **msg)
+static int nlbl_cipsov4_range_append(struct nlbl_cv4_range_a *ranges,
+				     uint32_t loc, uint32_t rem)
 {
-	int rc;
-	struct nlmsghdr *nl_hdr;
+	struct nlbl_cv4_range *last;
+	void *array_new;
+
+	if (ranges->size > 0) {
+		last = &ranges->array[ranges->size - 1];
+		if (loc > last->loc && rem > last->rem &&
+		    loc - last->loc == last->count &&
+		    rem - last->rem == last->count) {
+			last->count++;
+			return 0;
+		}
+	}
 
-	/* try to get a message from the handle */
-	rc = nlbl_comm_recv(hndl, msg);
-	if (rc <= 0)
-		goto recv_failure;
+	array_new = nlbl_array_grow(ranges->array,
+				    ranges->size, sizeof(*ranges->array));
+	if (array_new == NULL)
+		return -ENOMEM;
+	ranges->array = array_new;
+	ranges->array[ranges->size].loc = loc;
+	ranges->array[ranges->size].rem = rem;
+	ranges->array[ranges->size].count = 1;
+	ranges->size++;
+
+	return 0;
+}
 
-	/* process the response */
-	nl_hdr = nlbl_msg_nlhdr(*msg);
-	if (nl_hdr == NULL || (nl_hdr->nlmsg_type != nlbl_cipsov4_fid &&
-			       nl_hdr->nlmsg_type != NLMSG_DONE &&
-			       nl_hdr->nlmsg_type != NLMSG_ERROR)) {
-		rc = -EBADMSG;
-		goto recv_failure;
+/**
+ * Convert an array of mappings into an array of mapping ranges
+ * @param array the mappings, local and remote value pairs
+ * @param size the number of mappings
+ * @param ranges the mapping ranges
+ *
+ * Build @ranges from the @size mappings in @array, the caller must free the
+ * array in @ranges.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_range_from_pairs(const uint32_t *array, size_t size,
+					 struct nlbl_cv4_range_a *ranges)
+{
+	int rc;
+	size_t iter;
+
+	ranges->array = NULL;
+	ranges->size = 0;
+	for (iter = 0; iter < size; iter++) {
+		rc = nlbl_cipsov4_range_append(ranges, array[iter * 2],
+					       array[iter * 2 + 1]);
+		if (rc < 0) {
+			free(ranges->array);
+			ranges->array = NULL;
+			ranges->size = 0;
+			return rc;
+		}
 	}
 
-	return rc;
-
-recv_failure:
-	nlbl_msg_free(*msg);
-	return rc;
+	return 0;
 }
 
 /**
- * Parse an ACK message
- * @param msg the message
+ * Convert an array of mapping ranges into an array of mappings
+ * @param ranges the mapping ranges
+ * @param array the mappings, local and remote value pairs
+ * @param size the number of mappings
  *
- * Parse the ACK message in @msg and return the error code specified in the
- * ACK.
+ * Expand every range in @ranges into individual mappings, allocating @array
+ * which the caller must free.  Returns zero on success, negative values on
+ * failure.
  *
  */
-static int nlbl_cipsov4_parse_ack(nlbl_msg *msg)
+static int nlbl_cipsov4_range_to_pairs(const struct nlbl_cv4_range_a *ranges,
+				       uint32_t **array, size_t *size)
 {
-	struct nlmsgerr *nl_err;
-
-	nl_err = nlbl_msg_err(msg);
-	if (nl_err == NULL)
-		return -ENOMSG;
+	size_t iter;
+	size_t count = 0;
+	uint32_t val;
+	uint32_t *pos;
+
+	for (iter = 0; iter < ranges->size; iter++)
+		count += ranges->array[iter].count;
+
+	*array = NULL;
+	*size = 0;
+	if (count == 0)
+		return 0;
+	*array = malloc(count * 2 * sizeof(**array));
+	if (*array == NULL)
+		return -ENOMEM;
+
+	pos = *array;
+	for (iter = 0; iter < ranges->size; iter++)
+		for (val = 0; val < ranges->array[iter].count; val++) {
+			*pos++ = ranges->array[iter].loc + val;
+			*pos++ = ranges->array[iter].rem + val;
+		}
+	*size = count;
 
-	return nl_err->error;
+	return 0;
 }
 
-/*
- * Init functions
+/**
+ * Check an array of mapping ranges
+ * @param ranges the mapping ranges
+ *
+ * Returns the number of mappings in @ranges on success, negative values if
+ * any of the ranges are empty or run past the largest value.
+ *
  */
+static ssize_t nlbl_cipsov4_range_count(const struct nlbl_cv4_range_a *ranges)
+{
+	size_t iter;
+	size_t count = 0;
+	const struct nlbl_cv4_range *range;
+
+	for (iter = 0; iter < ranges->size; iter++) {
+		range = &ranges->array[iter];
+		if (range->count == 0 ||
+		    range->loc > UINT32_MAX - (range->count - 1) ||
+		    range->rem > UINT32_MAX - (range->count - 1))
+			return -EINVAL;
+		count += range->count;
+	}
+
+	return count;
+}
 
 /**
- * Perform any setup needed
+ * Return the length of the attributes of a CIPSOv4 label mapping message
+ * @param tags array of tags
+ * @param lvls number of level mappings, negative if not translated
+ * @param cats number of category mappings, negative if not translated
  *
- * Do any setup needed for the CIPSOv4 component, including determining the
- * NetLabel CIPSOv4 Generic Netlink family ID.  Returns zero on success,
- * negative values on error.
+ * Returns the exact length of the attributes of the NLBL_CIPSOV4_C_ADD message
+ * built by nlbl_cipsov4_add_msg().
  *
  */
-int nlbl_cipsov4_init(void)
+static size_t nlbl_cipsov4_add_len(const struct nlbl_cv4_tag_a *tags,
+				   ssize_t lvls, ssize_t cats)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *hndl;
-
-	/* get a netlabel handle */
-	hndl = nlbl_comm_open();
-	if (hndl == NULL)
-		goto init_return;
+	size_t len;
+	size_t pair = nla_total_size(2 * nla_total_size(sizeof(uint32_t)));
 
-	/* resolve the family */
-	rc = genl_ctrl_resolve(hndl->nl_sock, NETLBL_NLTYPE_CIPSOV4_NAME);
-	if (rc < 0)
-		goto init_return;
-	nlbl_cipsov4_fid = rc;
+	/* doi, mapping type and tag list */
+	len = 2 * nla_total_size(sizeof(uint32_t));
+	len += nla_total_size(tags->size * nla_total_size(sizeof(uint8_t)));
 
-	rc = 0;
+	/* level and category lists */
+	if (lvls >= 0)
+		len += nla_total_size(lvls * pair);
+	if (cats >= 0)
+		len += nla_total_size(cats * pair);
 
-init_return:
-	nlbl_comm_close(hndl);
-	return rc;
+	return len;
 }
 
-/*
- * NetLabel operations
+/**
+ * Add a nested list of mappings to a CIPSOv4 message
+ * @param msg the message
+ * @param list_type the list attribute type
+ * @param item_type the mapping attribute type
+ * @param loc_type the local value attribute type
+ * @param rem_type the remote value attribute type
+ * @param ranges the mapping ranges
+ * @param count the number of mappings in @ranges
+ *
+ * Reserve room for the whole list at the end of @msg, which must have room for
+ * it, and expand the mapping ranges directly into it.  A list is limited to
+ * the 65535 bytes which fit in an attribute's length, or 3276 mappings.
+ * Returns zero on success, negative values on failure.
+ *
  */
+static int nlbl_cipsov4_put_ranges(nlbl_msg *msg, int list_type,
+				   int item_type, int loc_type, int rem_type,
+				   const struct nlbl_cv4_range_a *ranges,
+				   size_t count)
+{
+	size_t iter;
+	uint32_t val;
+	size_t val_len = nla_total_size(sizeof(uint32_t));
+	size_t pair_len = nla_total_size(2 * val_len);
+	const struct nlbl_cv4_range *range;
+	struct nlattr *list;
+	struct nlattr *nla;
+	unsigned char *pos;
+
+	if (count > (USHRT_MAX - NLA_HDRLEN) / pair_len)
+		return -EMSGSIZE;
+	list = nla_reserve(msg, list_type, count * pair_len);
+	if (list == NULL)
+		return -ENOMEM;
+
+	pos = nla_data(list);
+	for (iter = 0; iter < ranges->size; iter++) {
+		range = &ranges->array[iter];
+		for (val = 0; val < range->count; val++) {
+			nla = (struct nlattr *)pos;
+			nla->nla_len = pair_len;
+			nla->nla_type = item_type;
+			nla = (struct nlattr *)(pos + NLA_HDRLEN);
+			nla->nla_len = nla_attr_size(sizeof(uint32_t));
+			nla->nla_type = loc_type;
+			*(uint32_t *)nla_data(nla) = range->loc + val;
+			nla = (struct nlattr *)(pos + NLA_HDRLEN + val_len);
+			nla->nla_len = nla_attr_size(sizeof(uint32_t));
+			nla->nla_type = rem_type;
+			*(uint32_t *)nla_data(nla) = range->rem + val;
+			pos += pair_len;
+		}
+	}
+
+	return 0;
+}
 
 /**
- * Add a translated CIPSOv4 label mapping
- * @param hndl the NetLabel handle
+ * Create a CIPSOv4 label mapping message
  * @param doi the CIPSO DOI number
+ * @param mtype the mapping type
  * @param tags array of tags
- * @param lvls array of level mappings
- * @param cats array of category mappings, may be NULL
+ * @param lvls array of level mapping ranges, NULL if not translated
+ * @param cats array of category mapping ranges, NULL if not translated
+ * @param msg the new message
  *
- * Add the specified static CIPSO label mapping information to the NetLabel
- * system.  If @hndl is NULL then the function will handle opening and closing
- * it's own NetLabel handle.  Returns zero on success, negative values on
- * failure.
+ * Create a new NLBL_CIPSOV4_C_ADD message.  The size of the message is worked
+ * out first so that it is built in a single buffer, with the nested lists
+ * encoded in place, which keeps the cost linear even with the largest
+ * translation tables.  The mapping ranges are only expanded into individual
+ * mappings here, as the kernel expects.  Returns zero on success, negative
+ * values on failure.
  *
  */
-int nlbl_cipsov4_add_trans(struct nlbl_handle *hndl,
-			   nlbl_cv4_doi doi,
-			   struct nlbl_cv4_tag_a *tags,
-			   struct nlbl_cv4_lvl_a *lvls,
-			   struct nlbl_cv4_cat_a *cats)
+static int nlbl_cipsov4_add_msg(nlbl_cv4_doi doi, nlbl_cv4_mtype mtype,
+				const struct nlbl_cv4_tag_a *tags,
+				const struct nlbl_cv4_range_a *lvls,
+				const struct nlbl_cv4_range_a *cats,
+				nlbl_msg **msg)
 {
 	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	nlbl_msg *msg = NULL;
-	nlbl_msg *nest_msg_a = NULL;
-	nlbl_msg *nest_msg_b = NULL;
-	nlbl_msg *ans_msg = NULL;
+	nlbl_msg *new_msg = NULL;
+	struct nlattr *nest;
+	ssize_t lvls_cnt = -1;
+	ssize_t cats_cnt = -1;
 	uint32_t iter;
 
-	/* sanity checks */
-	if (doi == 0 ||
-	    tags == NULL || tags->size == 0 ||
-	    lvls == NULL || lvls->size == 0)
-		return -EINVAL;
-	if (nlbl_cipsov4_fid == 0)
-		return -ENOPROTOOPT;
-
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto add_std_return;
+	/* count the mappings */
+	if (lvls != NULL) {
+		lvls_cnt = nlbl_cipsov4_range_count(lvls);
+		if (lvls_cnt < 0)
+			return lvls_cnt;
+	}
+	if (cats != NULL) {
+		cats_cnt = nlbl_cipsov4_range_count(cats);
+		if (cats_cnt < 0)
+			return cats_cnt;
 	}
 
 	/* create a new message */
-	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_ADD, 0);
-	if (msg == NULL)
-		goto add_std_return;
+	new_msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_ADD, 0,
+				       nlbl_cipsov4_add_len(tags,
+							    lvls_cnt,
+							    cats_cnt));
+	if (new_msg == NULL)
+		goto add_msg_failure;
 
 	/* add the required attributes to the message */
 
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_DOI, doi);
+	rc = nla_put_u32(new_msg, NLBL_CIPSOV4_A_DOI, doi);
 	if (rc != 0)
-		goto add_std_return;
-
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_MTYPE, CIPSO_V4_MAP_TRANS);
+		goto add_msg_failure;
+	rc = nla_put_u32(new_msg, NLBL_CIPSOV4_A_MTYPE, mtype);
 	if (rc != 0)
-		goto add_std_return;
+		goto add_msg_failure;
 
-	nest_msg_a = nlmsg_inherit(NULL);
-	if (nest_msg_a == NULL) {
+	nest = nlbl_attr_nest_start(new_msg, NLBL_CIPSOV4_A_TAGLST);
+	if (nest == NULL) {
 		rc = -ENOMEM;
-		goto add_std_return;
+		goto add_msg_failure;
 	}
 	for (iter = 0; iter < tags->size; iter++) {
-		rc = nla_put_u8(nest_msg_a,
+		rc = nla_put_u8(new_msg,
 				NLBL_CIPSOV4_A_TAG, tags->array[iter]);
 		if (rc != 0)
-			goto add_std_return;
+			goto add_msg_failure;
 	}
-	rc = nla_put_nested(msg, NLBL_CIPSOV4_A_TAGLST, nest_msg_a);
+	rc = nlbl_attr_nest_end(new_msg, nest);
 	if (rc != 0)
-		goto add_std_return;
-	nlbl_msg_free(nest_msg_a);
-	nest_msg_a = NULL;
-
-	nest_msg_a = nlmsg_inherit(NULL);
-	if (nest_msg_a == NULL) {
-		rc = -ENOMEM;
-		goto add_std_return;
-	}
-	for (iter = 0; iter < lvls->size; iter++) {
-		nest_msg_b = nlmsg_inherit(NULL);
-		if (nest_msg_b == NULL) {
-			rc = -ENOMEM;
-			goto add_std_return;
-		}
-		rc = nla_put_u32(nest_msg_b,
-				 NLBL_CIPSOV4_A_MLSLVLLOC,
-				 lvls->array[iter * 2]);
-		if (rc != 0)
-			goto add_std_return;
-		rc = nla_put_u32(nest_msg_b,
-				 NLBL_CIPSOV4_A_MLSLVLREM,
-				 lvls->array[iter * 2 + 1]);
+		goto add_msg_failure;
+
+	if (lvls != NULL) {
+		rc = nlbl_cipsov4_put_ranges(new_msg, NLBL_CIPSOV4_A_MLSLVLLST,
+					     NLBL_CIPSOV4_A_MLSLVL,
+					     NLBL_CIPSOV4_A_MLSLVLLOC,
+					     NLBL_CIPSOV4_A_MLSLVLREM,
+					     lvls, lvls_cnt);
 		if (rc != 0)
-			goto add_std_return;
-		rc = nla_put_nested(nest_msg_a, NLBL_CIPSOV4_A_MLSLVL,
-				    nest_msg_b);
-		if (rc != 0)
-			goto add_std_return;
-		nlbl_msg_free(nest_msg_b);
-		nest_msg_b = NULL;
-	}
-	rc = nla_put_nested(msg, NLBL_CIPSOV4_A_MLSLVLLST, nest_msg_a);
-	if (rc != 0)
-		goto add_std_return;
-	nlbl_msg_free(nest_msg_a);
-	nest_msg_a = NULL;
-
-	nest_msg_a = nlmsg_inherit(NULL);
-	if (nest_msg_a == NULL) {
-		rc = -ENOMEM;
-		goto add_std_return;
+			goto add_msg_failure;
 	}
-	for (iter = 0; iter < cats->size; iter++) {
-		nest_msg_b = nlmsg_inherit(NULL);
-		if (nest_msg_b == NULL) {
-			rc = -ENOMEM;
-			goto add_std_return;
-		}
-		rc = nla_put_u32(nest_msg_b,
-				 NLBL_CIPSOV4_A_MLSCATLOC,
-				 cats->array[iter * 2]);
-		if (rc != 0)
-			goto add_std_return;
-		rc = nla_put_u32(nest_msg_b,
-				 NLBL_CIPSOV4_A_MLSCATREM,
-				 cats->array[iter * 2 + 1]);
-		if (rc != 0)
-			goto add_std_return;
-		rc = nla_put_nested(nest_msg_a, NLBL_CIPSOV4_A_MLSCAT,
-				    nest_msg_b);
+	if (cats != NULL) {
+		rc = nlbl_cipsov4_put_ranges(new_msg, NLBL_CIPSOV4_A_MLSCATLST,
+					     NLBL_CIPSOV4_A_MLSCAT,
+					     NLBL_CIPSOV4_A_MLSCATLOC,
+					     NLBL_CIPSOV4_A_MLSCATREM,
+					     cats, cats_cnt);
 		if (rc != 0)
-			goto add_std_return;
-		nlbl_msg_free(nest_msg_b);
-		nest_msg_b = NULL;
-	}
-	rc = nla_put_nested(msg, NLBL_CIPSOV4_A_MLSCATLST, nest_msg_a);
-	if (rc != 0)
-		goto add_std_return;
-	nlbl_msg_free(nest_msg_a);
-	nest_msg_a = NULL;
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto add_std_return;
-	}
-
-	/* read the response */
-	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto add_std_return;
+			goto add_msg_failure;
 	}
 
-	/* process the response */
-	rc = nlbl_cipsov4_parse_ack(ans_msg);
+	*msg = new_msg;
+	new_msg = NULL;
+	rc = 0;
 
-add_std_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	nlbl_msg_free(msg);
-	nlbl_msg_free(nest_msg_a);
-	nlbl_msg_free(nest_msg_b);
-	nlbl_msg_free(ans_msg);
+add_msg_failure:
+	nlbl_msg_free(new_msg);
 	return rc;
 }
 
 /**
- * Add a pass-through CIPSOv4 label mapping
- * @param hndl the NetLabel handle
+ * Create a translated CIPSOv4 label mapping message
  * @param doi the CIPSO DOI number
  * @param tags array of tags
+ * @param lvls array of level mappings
+ * @param cats array of category mappings, may be NULL
+ * @param msg the new message
  *
- * Add the specified static CIPSO label mapping information to the NetLabel
- * system.  If @hndl is NULL then the function will handle opening and closing
- * it's own NetLabel handle.  Returns zero on success, negative values on
- * failure.
+ * Create a new NLBL_CIPSOV4_C_ADD message for a translated mapping.  Returns
+ * zero on success, negative values on failure.
  *
  */
-int nlbl_cipsov4_add_pass(struct nlbl_handle *hndl,
-			  nlbl_cv4_doi doi,
-			  struct nlbl_cv4_tag_a *tags)
+static int nlbl_cipsov4_add_trans_msg(nlbl_cv4_doi doi,
+				      struct nlbl_cv4_tag_a *tags,
+				      struct nlbl_cv4_lvl_a *lvls,
+				      struct nlbl_cv4_cat_a *cats,
+				      nlbl_msg **msg)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	nlbl_msg *msg = NULL;
-	nlbl_msg *nest_msg = NULL;
-	nlbl_msg *ans_msg = NULL;
-	uint32_t iter;
-
-	/* sanity checks */
-	if (doi == 0 ||
-	    tags == NULL || tags->size == 0)
-		return -EINVAL;
-	if (nlbl_cipsov4_fid == 0)
-		return -ENOPROTOOPT;
-
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto add_pass_return;
-	}
-
-	/* create a new message */
-	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_ADD, 0);
-	if (msg == NULL)
-		goto add_pass_return;
-
-	/* add the required attributes to the message */
-
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_DOI, doi);
-	if (rc != 0)
-		goto add_pass_return;
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_MTYPE, CIPSO_V4_MAP_PASS);
-	if (rc != 0)
-		goto add_pass_return;
-
-	nest_msg = nlmsg_inherit(NULL);
-	if (nest_msg == NULL) {
-		rc = -ENOMEM;
-		goto add_pass_return;
-	}
-	for (iter = 0; iter < tags->size; iter++) {
-		rc = nla_put_u8(nest_msg,
-				NLBL_CIPSOV4_A_TAG, tags->array[iter]);
-		if (rc != 0)
-			goto add_pass_return;
-	}
-	rc = nla_put_nested(msg, NLBL_CIPSOV4_A_TAGLST, nest_msg);
-	if (rc != 0)
-		goto add_pass_return;
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto add_pass_return;
-	}
+	int rc;
+	struct nlbl_cv4_range_a lvls_r = { .array = NULL, .size = 0 };
+	struct nlbl_cv4_range_a cats_r = { .array = NULL, .size = 0 };
 
-	/* read the response */
-	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto add_pass_return;
+	rc = nlbl_cipsov4_range_from_pairs(lvls->array, lvls->size, &lvls_r);
+	if (rc < 0)
+		goto add_trans_msg_return;
+	if (cats != NULL) {
+		rc = nlbl_cipsov4_range_from_pairs(cats->array, cats->size,
+						   &cats_r);
+		if (rc < 0)
+			goto add_trans_msg_return;
 	}
 
-	/* process the response */
-	rc = nlbl_cipsov4_parse_ack(ans_msg);
+	rc = nlbl_cipsov4_add_msg(doi, CIPSO_V4_MAP_TRANS, tags,
+				  &lvls_r, (cats != NULL ? &cats_r : NULL), msg);
 
-add_pass_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	nlbl_msg_free(msg);
-	nlbl_msg_free(nest_msg);
-	nlbl_msg_free(ans_msg);
+add_trans_msg_return:
+	free(lvls_r.array);
+	free(cats_r.array);
 	return rc;
 }
 
 /**
- * Add a local CIPSOv4 label mapping
- * @param hndl the NetLabel handle
+ * Create a pass-through CIPSOv4 label mapping message
  * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param msg the new message
  *
- * Add the specified static CIPSO label mapping information to the NetLabel
- * system.  If @hndl is NULL then the function will handle opening and closing
- * it's own NetLabel handle.  Returns zero on success, negative values on
- * failure.
+ * Create a new NLBL_CIPSOV4_C_ADD message for a pass-through mapping.
+ * Returns zero on success, negative values on failure.
  *
  */
-int nlbl_cipsov4_add_local(struct nlbl_handle *hndl, nlbl_cv4_doi doi)
+static int nlbl_cipsov4_add_pass_msg(nlbl_cv4_doi doi,
+				     struct nlbl_cv4_tag_a *tags,
+				     nlbl_msg **msg)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	nlbl_msg *msg = NULL;
-	nlbl_msg *nest_msg = NULL;
-	nlbl_msg *ans_msg = NULL;
+	return nlbl_cipsov4_add_msg(doi, CIPSO_V4_MAP_PASS,
+				    tags, NULL, NULL, msg);
+}
 
-	/* sanity checks */
-	if (doi == 0)
-		return -EINVAL;
-	if (nlbl_cipsov4_fid == 0)
-		return -ENOPROTOOPT;
+/**
+ * Create a local CIPSOv4 label mapping message
+ * @param doi the CIPSO DOI number
+ * @param msg the new message
+ *
+ * Create a new NLBL_CIPSOV4_C_ADD message for a local mapping.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_add_local_msg(nlbl_cv4_doi doi, nlbl_msg **msg)
+{
+	nlbl_cv4_tag tag = 128;
+	struct nlbl_cv4_tag_a tags = { .array = &tag, .size = 1 };
 
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto add_local_return;
-	}
+	return nlbl_cipsov4_add_msg(doi, CIPSO_V4_MAP_LOCAL,
+				    &tags, NULL, NULL, msg);
+}
+
+/**
+ * Create a CIPSOv4 single DOI message
+ * @param command the NetLabel CIPSOv4 command
+ * @param doi the CIPSO DOI number
+ * @param msg the new message
+ *
+ * Create a new NLBL_CIPSOV4_C_REMOVE or NLBL_CIPSOV4_C_LIST message for @doi.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_doi_msg(uint16_t command,
+				nlbl_cv4_doi doi, nlbl_msg **msg)
+{
+	int rc = -ENOMEM;
+	nlbl_msg *new_msg;
 
 	/* create a new message */
-	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_ADD, 0);
-	if (msg == NULL)
-		goto add_local_return;
+	new_msg = nlbl_cipsov4_msg_new(command, 0, 0);
+	if (new_msg == NULL)
+		goto doi_msg_failure;
 
 	/* add the required attributes to the message */
-
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_DOI, doi);
-	if (rc != 0)
-		goto add_local_return;
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_MTYPE, CIPSO_V4_MAP_LOCAL);
-	if (rc != 0)
-		goto add_local_return;
-
-	nest_msg = nlmsg_inherit(NULL);
-	if (nest_msg == NULL) {
-		rc = -ENOMEM;
-		goto add_local_return;
-	}
-	rc = nla_put_u8(nest_msg, NLBL_CIPSOV4_A_TAG, 128);
-	if (rc != 0)
-		goto add_local_return;
-	rc = nla_put_nested(msg, NLBL_CIPSOV4_A_TAGLST, nest_msg);
+	rc = nla_put_u32(new_msg, NLBL_CIPSOV4_A_DOI, doi);
 	if (rc != 0)
-		goto add_local_return;
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto add_local_return;
-	}
-
-	/* read the response */
-	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto add_local_return;
-	}
+		goto doi_msg_failure;
 
-	/* process the response */
-	rc = nlbl_cipsov4_parse_ack(ans_msg);
+	*msg = new_msg;
+	new_msg = NULL;
+	rc = 0;
 
-add_local_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	nlbl_msg_free(msg);
-	nlbl_msg_free(nest_msg);
-	nlbl_msg_free(ans_msg);
+doi_msg_failure:
+	nlbl_msg_free(new_msg);
 	return rc;
 }
 
 /**
- * Delete a CIPSOv4 label mapping
+ * Read a NetLbel CIPSOv4 message
  * @param hndl the NetLabel handle
- * @param doi the CIPSO DOI number
+ * @param msg the message
  *
- * Remove the CIPSO label mapping with the DOI value matching @doi.  If @hndl
- * is NULL then the function will handle opening and closing it's own NetLabel
- * handle.  Returns zero on success, negative values on failure.
+ * Try to read a NetLabel CIPSOv4 message and return the message in @msg.
+ * Returns the number of bytes read on success, zero on EOF, and negative
+ * values on failure.
  *
  */
-int nlbl_cipsov4_del(struct nlbl_handle *hndl, nlbl_cv4_doi doi)
+static int nlbl_cipsov4_recv(struct nlbl_handle *hndl, nlbl_msg **msg)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	nlbl_msg *msg = NULL;
-	nlbl_msg *ans_msg = NULL;
+	int rc;
+	struct nlmsghdr *nl_hdr;
 
-	/* sanity checks */
-	if (doi == 0)
-		return -EINVAL;
-	if (nlbl_cipsov4_fid == 0)
-		return -ENOPROTOOPT;
+	/* try to get a message from the handle */
+	rc = nlbl_comm_recv(hndl, msg);
+	if (rc <= 0)
+		goto recv_failure;
 
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto del_return;
+	/* process the response */
+	nl_hdr = nlbl_msg_nlhdr(*msg);
+	if (nl_hdr == NULL || (nl_hdr->nlmsg_type != nlbl_cipsov4_fid() &&
+			       nl_hdr->nlmsg_type != NLMSG_DONE &&
+			       nl_hdr->nlmsg_type != NLMSG_ERROR)) {
+		rc = -EBADMSG;
+		goto recv_failure;
 	}
 
-	/* create a new message */
-	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_REMOVE, 0);
-	if (msg == NULL)
-		goto del_return;
-
-	/* add the required attributes to the message */
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_DOI, doi);
-	if (rc != 0)
-		goto del_return;
+	return rc;
 
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto del_return;
-	}
+recv_failure:
+	nlbl_msg_free(*msg);
+	return rc;
+}
 
-	/* read the response */
-	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto del_return;
-	}
+/**
+ * Parse an ACK message
+ * @param msg the message
+ *
+ * Parse the ACK message in @msg and return the error code specified in the
+ * ACK.
+ *
+ */
+static int nlbl_cipsov4_parse_ack(nlbl_msg *msg)
+{
+	struct nlmsgerr *nl_err;
 
-	/* process the response */
-	rc = nlbl_cipsov4_parse_ack(ans_msg);
+	nl_err = nlbl_msg_err(msg);
+	if (nl_err == NULL)
+		return -ENOMSG;
 
-del_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	nlbl_msg_free(msg);
-	nlbl_msg_free(ans_msg);
-	return rc;
+	return nl_err->error;
 }
 
 /**
- * List the details of a specific CIPSOv4 label mapping
- * @param hndl the NetLabel handle
- * @param doi the CIPSO DOI number
- * @param mtype the DOI mapping type
+ * Free the contents of a CIPSOv4 DOI definition
  * @param tags array of tag numbers
  * @param lvls array of level mappings
  * @param cats array of category mappings
  *
- * Query the kernel for the specified CIPSOv4 mapping specified by @doi and
- * return the details of the mapping to the caller.  If @hndl is NULL then the
- * function will handle opening and closing it's own NetLabel handle.  Returns
- * zero on success, negative values on failure.
+ * Free the tag, level, and category arrays of a CIPSOv4 DOI definition and
+ * reset them to empty arrays.
  *
  */
-int nlbl_cipsov4_list(struct nlbl_handle *hndl,
-		      nlbl_cv4_doi doi,
-		      nlbl_cv4_mtype *mtype,
-		      struct nlbl_cv4_tag_a *tags,
-		      struct nlbl_cv4_lvl_a *lvls,
-		      struct nlbl_cv4_cat_a *cats)
+static void nlbl_cipsov4_doi_release(struct nlbl_cv4_tag_a *tags,
+				     struct nlbl_cv4_lvl_a *lvls,
+				     struct nlbl_cv4_cat_a *cats)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	nlbl_msg *msg = NULL;
-	nlbl_msg *ans_msg = NULL;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla_a;
-	struct nlattr *nla_b;
-	struct nlattr *nla_c;
-	struct nlattr *nla_d;
-	int nla_b_rem;
-
-	/* sanity checks */
-	if (doi == 0 ||
-	    mtype == NULL || tags == NULL || lvls == NULL || cats == NULL)
-		return -EINVAL;
-	if (nlbl_cipsov4_fid == 0)
-		return -ENOPROTOOPT;
-
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto list_return;
-	}
-
-	/* create a new message */
-	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_LIST, 0);
-	if (msg == NULL)
-		goto list_return;
+	if (tags->array != NULL)
+		free(tags->array);
+	tags->array = NULL;
+	tags->size = 0;
+	if (lvls->array != NULL)
+		free(lvls->array);
+	lvls->array = NULL;
+	lvls->size = 0;
+	if (cats->array != NULL)
+		free(cats->array);
+	cats->array = NULL;
+	cats->size = 0;
+}
 
-	/* add the required attributes to the message */
-	rc = nla_put_u32(msg, NLBL_CIPSOV4_A_DOI, doi);
-	if (rc != 0)
-		goto list_return;
+/**
+ * Free the contents of a CIPSOv4 DOI definition with mapping ranges
+ * @param tags array of tag numbers
+ * @param lvls array of level mapping ranges
+ * @param cats array of category mapping ranges
+ *
+ * Free the tag, level, and category arrays of a CIPSOv4 DOI definition and
+ * reset them to empty arrays.
+ *
+ */
+static void nlbl_cipsov4_range_release(struct nlbl_cv4_tag_a *tags,
+				       struct nlbl_cv4_range_a *lvls,
+				       struct nlbl_cv4_range_a *cats)
+{
+	free(tags->array);
+	tags->array = NULL;
+	tags->size = 0;
+	free(lvls->array);
+	lvls->array = NULL;
+	lvls->size = 0;
+	free(cats->array);
+	cats->array = NULL;
+	cats->size = 0;
+}
 
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto list_return;
+/**
+ * Decode a list of mappings
+ * @param list the list attribute
+ * @param item_type the mapping attribute type
+ * @param loc_type the local value attribute type
+ * @param rem_type the remote value attribute type
+ * @param ranges the mapping ranges
+ *
+ * Decode the mappings in @list, joining consecutive mappings into ranges.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_list_decode_map(struct nlattr *list, int item_type,
+					int loc_type, int rem_type,
+					struct nlbl_cv4_range_a *ranges)
+{
+	int rc;
+	struct nlattr *tb_map[NLBL_CIPSOV4_A_MAX + 1];
+	struct nlattr *nla;
+	int nla_rem;
+
+	nla_for_each_attr(nla, nla_data(list), nla_len(list), nla_rem)
+	if (nla->nla_type == item_type) {
+		if (nlbl_attr_parse_nested(nla, tb_map, NLBL_CIPSOV4_A_MAX,
+					   nlbl_cipsov4_policy) < 0 ||
+		    tb_map[loc_type] == NULL || tb_map[rem_type] == NULL)
+			return -EBADMSG;
+		rc = nlbl_cipsov4_range_append(ranges,
+					       nla_get_u32(tb_map[loc_type]),
+					       nla_get_u32(tb_map[rem_type]));
+		if (rc < 0)
+			return rc;
 	}
 
-	/* read the response */
-	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto list_return;
-	}
+	return 0;
+}
 
-	/* check the response */
-	rc = nlbl_cipsov4_parse_ack(ans_msg);
-	if (rc < 0 && rc != -ENOMSG)
-		goto list_return;
-	genl_hdr = nlbl_msg_genlhdr(ans_msg);
-	if (genl_hdr == NULL || genl_hdr->cmd != NLBL_CIPSOV4_C_LIST) {
-		rc = -EBADMSG;
-		goto list_return;
-	}
+/**
+ * Decode a LIST message
+ * @param nl_hdr the netlink message
+ * @param mtype the DOI mapping type
+ * @param tags array of tag numbers
+ * @param lvls array of level mapping ranges
+ * @param cats array of category mapping ranges
+ *
+ * Decode the NLBL_CIPSOV4_C_LIST message in @nl_hdr and return the details of
+ * the DOI definition, allocating the arrays as needed.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_list_decode_range(struct nlmsghdr *nl_hdr,
+					  nlbl_cv4_mtype *mtype,
+					  struct nlbl_cv4_tag_a *tags,
+					  struct nlbl_cv4_range_a *lvls,
+					  struct nlbl_cv4_range_a *cats)
+{
+	int rc;
+	struct nlattr *tb[NLBL_CIPSOV4_A_MAX + 1];
+	struct nlattr *nla_a;
+	struct nlattr *nla_b;
+	int nla_b_rem;
+	void *array_new;
 
-	/* process the response */
+	rc = nlbl_attr_parse(nl_hdr, NLBL_CIPSOV4_C_LIST,
+			     tb, NLBL_CIPSOV4_A_MAX, nlbl_cipsov4_policy);
+	if (rc < 0)
+		return rc;
+	rc = -EBADMSG;
 
+	tags->size = 0;
+	tags->array = NULL;
 	lvls->size = 0;
 	lvls->array = NULL;
 	cats->size = 0;
 	cats->array = NULL;
 
-	nla_a = nlbl_attr_find(ans_msg, NLBL_CIPSOV4_A_MTYPE);
-	if (nla_a == NULL)
-		goto list_return;
-	*mtype = nla_get_u32(nla_a);
+	if (tb[NLBL_CIPSOV4_A_MTYPE] == NULL)
+		goto decode_failure;
+	*mtype = nla_get_u32(tb[NLBL_CIPSOV4_A_MTYPE]);
 
-	nla_a = nlbl_attr_find(ans_msg, NLBL_CIPSOV4_A_TAGLST);
+	nla_a = tb[NLBL_CIPSOV4_A_TAGLST];
 	if (nla_a == NULL)
-		goto list_return;
-	tags->size = 0;
-	tags->array = NULL;
+		goto decode_failure;
+	if (nla_validate(nla_data(nla_a), nla_len(nla_a),
+			 NLBL_CIPSOV4_A_MAX, nlbl_cipsov4_policy) < 0)
+		goto decode_failure;
 	nla_for_each_attr(nla_b, nla_data(nla_a), nla_len(nla_a), nla_b_rem)
 	if (nla_b->nla_type == NLBL_CIPSOV4_A_TAG) {
-		tags->array = realloc(tags->array, tags->size + 1);
-		if (tags->array == NULL) {
+		array_new = nlbl_array_grow(tags->array,
+					    tags->size, sizeof(nlbl_cv4_tag));
+		if (array_new == NULL) {
 			rc = -ENOMEM;
-			goto list_return;
+			goto decode_failure;
 		}
+		tags->array = array_new;
 		tags->array[tags->size++] = nla_get_u8(nla_b);
 	}
 
-	if (*mtype == CIPSO_V4_MAP_TRANS) {
-		nla_a = nlbl_attr_find(ans_msg, NLBL_CIPSOV4_A_MLSLVLLST);
-		if (nla_a == NULL)
-			goto list_return;
-		nla_for_each_attr(nla_b,
-				  nla_data(nla_a), nla_len(nla_a), nla_b_rem)
-		if (nla_b->nla_type == NLBL_CIPSOV4_A_MLSLVL) {
-			lvls->array = realloc(lvls->array,
-					      ((lvls->size + 1) * 2) *
-					      sizeof(nlbl_cv4_lvl));
-			if (lvls->array == NULL) {
-				rc = -ENOMEM;
-				goto list_return;
-			}
-			nla_c = nla_find(nla_data(nla_b),
-					 nla_len(nla_b),
-					 NLBL_CIPSOV4_A_MLSLVLLOC);
-			if (nla_c == NULL)
-				goto list_return;
-			nla_d = nla_find(nla_data(nla_b),
-					 nla_len(nla_b),
-					 NLBL_CIPSOV4_A_MLSLVLREM);
-			if (nla_d == NULL)
-				goto list_return;
-			lvls->array[lvls->size * 2] = nla_get_u32(nla_c);
-			lvls->array[lvls->size * 2 + 1] = nla_get_u32(nla_d);
-			lvls->size++;
-		}
+	if (*mtype != CIPSO_V4_MAP_TRANS)
+		return 0;
 
-		nla_a = nlbl_attr_find(ans_msg, NLBL_CIPSOV4_A_MLSCATLST);
-		if (nla_a == NULL)
-			goto list_return;
-		nla_for_each_attr(nla_b,
-				  nla_data(nla_a), nla_len(nla_a), nla_b_rem)
-		if (nla_b->nla_type == NLBL_CIPSOV4_A_MLSCAT) {
-			cats->array = realloc(cats->array,
-					      ((cats->size + 1) * 2) *
-					      sizeof(nlbl_cv4_cat));
-			if (cats->array == NULL) {
-				rc = -ENOMEM;
-				goto list_return;
-			}
-			nla_c = nla_find(nla_data(nla_b),
-					 nla_len(nla_b),
-					 NLBL_CIPSOV4_A_MLSCATLOC);
-			if (nla_c == NULL)
-				goto list_return;
-			nla_d = nla_find(nla_data(nla_b),
-					 nla_len(nla_b),
-					 NLBL_CIPSOV4_A_MLSCATREM);
-			if (nla_d == NULL)
-				goto list_return;
-			cats->array[cats->size * 2] = nla_get_u32(nla_c);
-			cats->array[cats->size * 2 + 1] = nla_get_u32(nla_d);
-			cats->size++;
-		}
-	}
+	if (tb[NLBL_CIPSOV4_A_MLSLVLLST] == NULL ||
+	    tb[NLBL_CIPSOV4_A_MLSCATLST] == NULL)
+		goto decode_failure;
+	rc = nlbl_cipsov4_list_decode_map(tb[NLBL_CIPSOV4_A_MLSLVLLST],
+					  NLBL_CIPSOV4_A_MLSLVL,
+					  NLBL_CIPSOV4_A_MLSLVLLOC,
+					  NLBL_CIPSOV4_A_MLSLVLREM, lvls);
+	if (rc < 0)
+		goto decode_failure;
+	rc = nlbl_cipsov4_list_decode_map(tb[NLBL_CIPSOV4_A_MLSCATLST],
+					  NLBL_CIPSOV4_A_MLSCAT,
+					  NLBL_CIPSOV4_A_MLSCATLOC,
+					  NLBL_CIPSOV4_A_MLSCATREM, cats);
+	if (rc < 0)
+		goto decode_failure;
 
-	rc = 0;
+	return 0;
 
-list_return:
+decode_failure:
+	nlbl_cipsov4_range_release(tags, lvls, cats);
+	return rc;
+}
+
+/**
+ * Decode a LIST message into individual mappings
+ * @param nl_hdr the netlink message
+ * @param mtype the DOI mapping type
+ * @param tags array of tag numbers
+ * @param lvls array of level mappings
+ * @param cats array of category mappings
+ *
+ * Decode the NLBL_CIPSOV4_C_LIST message in @nl_hdr like
+ * nlbl_cipsov4_list_decode_range() but return each mapping as a local and
+ * remote value pair.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_list_decode(struct nlmsghdr *nl_hdr,
+				    nlbl_cv4_mtype *mtype,
+				    struct nlbl_cv4_tag_a *tags,
+				    struct nlbl_cv4_lvl_a *lvls,
+				    struct nlbl_cv4_cat_a *cats)
+{
+	int rc;
+	struct nlbl_cv4_range_a lvls_r;
+	struct nlbl_cv4_range_a cats_r;
+
+	lvls->size = 0;
+	lvls->array = NULL;
+	cats->size = 0;
+	cats->array = NULL;
+
+	rc = nlbl_cipsov4_list_decode_range(nl_hdr, mtype,
+					    tags, &lvls_r, &cats_r);
+	if (rc < 0)
+		return rc;
+
+	rc = nlbl_cipsov4_range_to_pairs(&lvls_r, &lvls->array, &lvls->size);
+	if (rc == 0)
+		rc = nlbl_cipsov4_range_to_pairs(&cats_r,
+						 &cats->array, &cats->size);
+	free(lvls_r.array);
+	free(cats_r.array);
+	if (rc < 0)
+		nlbl_cipsov4_doi_release(tags, lvls, cats);
+
+	return rc;
+}
+
+/**
+ * Decode a LISTALL message
+ * @param nl_hdr the netlink message
+ * @param doi the DOI value
+ * @param mtype the DOI mapping type
+ *
+ * Decode the NLBL_CIPSOV4_C_LISTALL message in @nl_hdr and return the DOI and
+ * mapping type in @doi and @mtype.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+static int nlbl_cipsov4_listall_decode(struct nlmsghdr *nl_hdr,
+				       nlbl_cv4_doi *doi,
+				       nlbl_cv4_mtype *mtype)
+{
+	int rc;
+	struct nlattr *tb[NLBL_CIPSOV4_A_MAX + 1];
+
+	rc = nlbl_attr_parse(nl_hdr, NLBL_CIPSOV4_C_LISTALL,
+			     tb, NLBL_CIPSOV4_A_MAX, nlbl_cipsov4_policy);
+	if (rc < 0)
+		return rc;
+
+	if (tb[NLBL_CIPSOV4_A_DOI] == NULL || tb[NLBL_CIPSOV4_A_MTYPE] == NULL)
+		return -EBADMSG;
+	*doi = nla_get_u32(tb[NLBL_CIPSOV4_A_DOI]);
+	*mtype = nla_get_u32(tb[NLBL_CIPSOV4_A_MTYPE]);
+
+	return 0;
+}
+
+/**
+ * Call a DOI dump callback for a LISTALL message
+ * @param nl_hdr the netlink message
+ * @param arg the dump state
+ *
+ * Decode the DOI and mapping type in @nl_hdr and pass them to the caller's
+ * callback.  Returns the value returned by the callback on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_cipsov4_listall_walk_msg(struct nlmsghdr *nl_hdr, void *arg)
+{
+	int rc;
+	struct nlbl_cipsov4_walk_arg *walk = arg;
+	nlbl_cv4_doi doi;
+	nlbl_cv4_mtype mtype;
+
+	rc = nlbl_cipsov4_listall_decode(nl_hdr, &doi, &mtype);
+	if (rc < 0)
+		return rc;
+	walk->count++;
+
+	return walk->cb(doi, mtype, walk->cb_arg);
+}
+
+/**
+ * Append a DOI to the DOI and mapping type arrays
+ * @param doi the DOI value
+ * @param mtype the DOI mapping type
+ * @param arg the DOI arrays
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_listall_append(nlbl_cv4_doi doi,
+				       nlbl_cv4_mtype mtype, void *arg)
+{
+	struct nlbl_cipsov4_doi_array *list = arg;
+	nlbl_cv4_doi *doi_a_new;
+	nlbl_cv4_mtype *mtype_a_new;
+
+	doi_a_new = nlbl_array_grow(list->dois,
+				    list->count, sizeof(*doi_a_new));
+	if (doi_a_new == NULL)
+		return -ENOMEM;
+	list->dois = doi_a_new;
+	mtype_a_new = nlbl_array_grow(list->mtypes,
+				      list->count, sizeof(*mtype_a_new));
+	if (mtype_a_new == NULL)
+		return -ENOMEM;
+	list->mtypes = mtype_a_new;
+
+	list->dois[list->count] = doi;
+	list->mtypes[list->count] = mtype;
+	list->count++;
+
+	return 0;
+}
+
+/**
+ * Decode a LIST reply for nlbl_cipsov4_listall_detail()
+ * @param idx the index of the request
+ * @param nl_hdr the netlink message
+ * @param arg the DOI definitions
+ *
+ * Decode the DOI definition in @nl_hdr into the matching entry of the DOI
+ * definitions, recording the result for the request.
+ *
+ */
+static void nlbl_cipsov4_detail_reply(uint32_t idx,
+				      struct nlmsghdr *nl_hdr, void *arg)
+{
+	struct nlbl_cipsov4_detail *detail = arg;
+	struct nlbl_cv4_def *def = &detail->defs[idx];
+
+	if (nl_hdr->nlmsg_type != detail->fid)
+		return;
+	if (detail->rc[idx] == 0)
+		nlbl_cipsov4_range_release(&def->tags,
+					   &def->lvls, &def->cats);
+	detail->rc[idx] = nlbl_cipsov4_list_decode_range(nl_hdr, &def->mtype,
+							 &def->tags,
+							 &def->lvls,
+							 &def->cats);
+}
+
+/*
+ * NetLabel operations
+ */
+
+/**
+ * Add a translated CIPSOv4 label mapping
+ * @param hndl the NetLabel handle
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param lvls array of level mapping ranges
+ * @param cats array of category mapping ranges, may be NULL
+ *
+ * Add the specified static CIPSO label mapping information to the NetLabel
+ * system, expanding each range into the individual mappings the kernel
+ * expects.  If @hndl is NULL then the function will handle opening and closing
+ * it's own NetLabel handle.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_cipsov4_add_trans_range(struct nlbl_handle *hndl,
+				 nlbl_cv4_doi doi,
+				 struct nlbl_cv4_tag_a *tags,
+				 struct nlbl_cv4_range_a *lvls,
+				 struct nlbl_cv4_range_a *cats)
+{
+	int rc = -ENOMEM;
+	struct nlbl_handle *p_hndl = hndl;
+	nlbl_msg *msg = NULL;
+	nlbl_msg *ans_msg = NULL;
+
+	/* sanity checks */
+	if (doi == 0 ||
+	    tags == NULL || tags->size == 0 ||
+	    lvls == NULL || lvls->size == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto add_std_return;
+	}
+
+	/* create a new message */
+	rc = nlbl_cipsov4_add_msg(doi, CIPSO_V4_MAP_TRANS,
+				  tags, lvls, cats, &msg);
+	if (rc < 0)
+		goto add_std_return;
+
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto add_std_return;
+	}
+
+	/* read the response */
+	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto add_std_return;
+	}
+
+	/* process the response */
+	rc = nlbl_cipsov4_parse_ack(ans_msg);
+
+add_std_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
 }
 
 /**
- * List the CIPSOv4 label mappings
+ * Add a translated CIPSOv4 label mapping
  * @param hndl the NetLabel handle
- * @param dois an array of DOI values
- * @param mtypes an array of the mapping types
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param lvls array of level mappings
+ * @param cats array of category mappings, may be NULL
  *
- * Query the kernel for the configured CIPSOv4 mappings and return two arrays;
- * @dois which contains the DOI values and @mtypes which contains the
- * type of mapping.  If @hndl is NULL then the function will handle opening
- * and closing it's own NetLabel handle.  Returns the number of mappings on
- * success, zero if no mappings exist, and negative values on failure.
+ * Add the specified static CIPSO label mapping information to the NetLabel
+ * system.  If @hndl is NULL then the function will handle opening and closing
+ * it's own NetLabel handle.  Returns zero on success, negative values on
+ * failure.
  *
  */
-int nlbl_cipsov4_listall(struct nlbl_handle *hndl,
-			 nlbl_cv4_doi **dois,
-			 nlbl_cv4_mtype **mtypes)
+int nlbl_cipsov4_add_trans(struct nlbl_handle *hndl,
+			   nlbl_cv4_doi doi,
+			   struct nlbl_cv4_tag_a *tags,
+			   struct nlbl_cv4_lvl_a *lvls,
+			   struct nlbl_cv4_cat_a *cats)
+{
+	int rc;
+	struct nlbl_cv4_range_a lvls_r = { .array = NULL, .size = 0 };
+	struct nlbl_cv4_range_a cats_r = { .array = NULL, .size = 0 };
+
+	/* sanity checks */
+	if (lvls == NULL)
+		return -EINVAL;
+
+	rc = nlbl_cipsov4_range_from_pairs(lvls->array, lvls->size, &lvls_r);
+	if (rc < 0)
+		goto add_trans_return;
+	if (cats != NULL) {
+		rc = nlbl_cipsov4_range_from_pairs(cats->array, cats->size,
+						   &cats_r);
+		if (rc < 0)
+			goto add_trans_return;
+	}
+
+	rc = nlbl_cipsov4_add_trans_range(hndl, doi, tags, &lvls_r,
+					  (cats != NULL ? &cats_r : NULL));
+
+add_trans_return:
+	free(lvls_r.array);
+	free(cats_r.array);
+	return rc;
+}
+
+/**
+ * Add a pass-through CIPSOv4 label mapping
+ * @param hndl the NetLabel handle
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ *
+ * Add the specified static CIPSO label mapping information to the NetLabel
+ * system.  If @hndl is NULL then the function will handle opening and closing
+ * it's own NetLabel handle.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_cipsov4_add_pass(struct nlbl_handle *hndl,
+			  nlbl_cv4_doi doi,
+			  struct nlbl_cv4_tag_a *tags)
 {
 	int rc = -ENOMEM;
 	struct nlbl_handle *p_hndl = hndl;
-	unsigned char *data = NULL;
 	nlbl_msg *msg = NULL;
-	struct nlmsghdr *nl_hdr;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla_head;
-	struct nlattr *nla;
-	int data_len;
-	int data_attrlen;
-	nlbl_cv4_doi *doi_a = NULL, *doi_a_new;
-	nlbl_cv4_mtype *mtype_a = NULL, *mtype_a_new;
-	uint32_t count = 0;
+	nlbl_msg *ans_msg = NULL;
 
 	/* sanity checks */
-	if (dois == NULL || mtypes == NULL)
+	if (doi == 0 ||
+	    tags == NULL || tags->size == 0)
 		return -EINVAL;
-	if (nlbl_cipsov4_fid == 0)
+	if (nlbl_cipsov4_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
-			goto listall_return;
+			goto add_pass_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_LISTALL, NLM_F_DUMP);
-	if (msg == NULL) {
-		rc = -ENOMEM;
-		goto listall_return;
-	}
+	rc = nlbl_cipsov4_add_pass_msg(doi, tags, &msg);
+	if (rc < 0)
+		goto add_pass_return;
 
 	/* send the request */
 	rc = nlbl_comm_send(p_hndl, msg);
 	if (rc <= 0) {
 		if (rc == 0)
 			rc = -ENODATA;
-		goto listall_return;
+		goto add_pass_return;
+	}
+
+	/* read the response */
+	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto add_pass_return;
 	}
 
-	/* read all of the messages (multi-message response) */
-	do {
-		if (data) {
-			free(data);
-			data = NULL;
-		}
+	/* process the response */
+	rc = nlbl_cipsov4_parse_ack(ans_msg);
 
-		/* get the next set of messages */
-		rc = nlbl_comm_recv_raw(p_hndl, &data);
-		if (rc <= 0) {
-			if (rc == 0)
-				rc = -ENODATA;
-			goto listall_return;
-		}
-		data_len = rc;
-		nl_hdr = (struct nlmsghdr *)data;
-
-		/* check to see if this is a netlink control message we don't
-		 * care about */
-		if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
-		    nl_hdr->nlmsg_type == NLMSG_ERROR ||
-		    nl_hdr->nlmsg_type == NLMSG_OVERRUN) {
-			rc = -EBADMSG;
-			goto listall_return;
-		}
+add_pass_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	nlbl_msg_free(msg);
+	nlbl_msg_free(ans_msg);
+	return rc;
+}
 
-		/* loop through the messages */
-		while (nlmsg_ok(nl_hdr, data_len) &&
-		       nl_hdr->nlmsg_type != NLMSG_DONE) {
-			/* get the header pointers */
-			genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
-			if (genl_hdr == NULL ||
-			    genl_hdr->cmd != NLBL_CIPSOV4_C_LISTALL) {
-				rc = -EBADMSG;
-				goto listall_return;
-			}
-			nla_head = (struct nlattr *)(&genl_hdr[1]);
-			data_attrlen = genlmsg_attrlen(genl_hdr, 0);
-
-			/* resize the arrays */
-			doi_a_new = realloc(doi_a,
-					    sizeof(nlbl_cv4_doi) * (count + 1));
-			if (doi_a_new == NULL)
-				goto listall_return;
-			doi_a = doi_a_new;
-			mtype_a_new = realloc(mtype_a,
-					      sizeof(nlbl_cv4_mtype) * (count + 1));
-			if (mtype_a_new == NULL)
-				goto listall_return;
-			mtype_a = mtype_a_new;
-
-			/* get the attribute information */
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_CIPSOV4_A_DOI);
-			if (nla == NULL)
-				goto listall_return;
-			doi_a[count] = nla_get_u32(nla);
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_CIPSOV4_A_MTYPE);
-			if (nla == NULL)
-				goto listall_return;
-			mtype_a[count] = nla_get_u32(nla);
-
-			count++;
-
-			/* next message */
-			nl_hdr = nlmsg_next(nl_hdr, &data_len);
-		}
-	} while (NL_MULTI_CONTINUE(nl_hdr));
+/**
+ * Add a local CIPSOv4 label mapping
+ * @param hndl the NetLabel handle
+ * @param doi the CIPSO DOI number
+ *
+ * Add the specified static CIPSO label mapping information to the NetLabel
+ * system.  If @hndl is NULL then the function will handle opening and closing
+ * it's own NetLabel handle.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_cipsov4_add_local(struct nlbl_handle *hndl, nlbl_cv4_doi doi)
+{
+	int rc = -ENOMEM;
+	struct nlbl_handle *p_hndl = hndl;
+	nlbl_msg *msg = NULL;
+	nlbl_msg *ans_msg = NULL;
 
-	*dois = doi_a;
-	*mtypes = mtype_a;
-	rc = count;
+	/* sanity checks */
+	if (doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
 
-listall_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	if (rc < 0) {
-		if (doi_a != NULL)
-			free(doi_a);
-		if (mtype_a != NULL)
-			free(mtype_a);
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto add_local_return;
 	}
-	if (data != NULL)
-		free(data);
-	nlbl_msg_free(msg);
-	return rc;
+
+	/* create a new message */
+	rc = nlbl_cipsov4_add_local_msg(doi, &msg);
+	if (rc < 0)
+		goto add_local_return;
+
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto add_local_return;
+	}
+
+	/* read the response */
+	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto add_local_return;
+	}
+
+	/* process the response */
+	rc = nlbl_cipsov4_parse_ack(ans_msg);
+
+add_local_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	nlbl_msg_free(msg);
+	nlbl_msg_free(ans_msg);
+	return rc;
+}
+
+/**
+ * Delete a CIPSOv4 label mapping
+ * @param hndl the NetLabel handle
+ * @param doi the CIPSO DOI number
+ *
+ * Remove the CIPSO label mapping with the DOI value matching @doi.  If @hndl
+ * is NULL then the function will handle opening and closing it's own NetLabel
+ * handle.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_cipsov4_del(struct nlbl_handle *hndl, nlbl_cv4_doi doi)
+{
+	int rc = -ENOMEM;
+	struct nlbl_handle *p_hndl = hndl;
+	nlbl_msg *msg = NULL;
+	nlbl_msg *ans_msg = NULL;
+
+	/* sanity checks */
+	if (doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto del_return;
+	}
+
+	/* create a new message */
+	rc = nlbl_cipsov4_doi_msg(NLBL_CIPSOV4_C_REMOVE, doi, &msg);
+	if (rc < 0)
+		goto del_return;
+
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto del_return;
+	}
+
+	/* read the response */
+	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto del_return;
+	}
+
+	/* process the response */
+	rc = nlbl_cipsov4_parse_ack(ans_msg);
+
+del_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	nlbl_msg_free(msg);
+	nlbl_msg_free(ans_msg);
+	return rc;
+}
+
+/**
+ * List the details of a specific CIPSOv4 label mapping
+ * @param hndl the NetLabel handle
+ * @param doi the CIPSO DOI number
+ * @param mtype the DOI mapping type
+ * @param tags array of tag numbers
+ * @param lvls array of level mapping ranges
+ * @param cats array of category mapping ranges
+ *
+ * Query the kernel for the specified CIPSOv4 mapping specified by @doi and
+ * return the details of the mapping to the caller, with consecutive level and
+ * category mappings joined into ranges.  If @hndl is NULL then the
+ * function will handle opening and closing it's own NetLabel handle.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int nlbl_cipsov4_list_range(struct nlbl_handle *hndl,
+			    nlbl_cv4_doi doi,
+			    nlbl_cv4_mtype *mtype,
+			    struct nlbl_cv4_tag_a *tags,
+			    struct nlbl_cv4_range_a *lvls,
+			    struct nlbl_cv4_range_a *cats)
+{
+	int rc = -ENOMEM;
+	struct nlbl_handle *p_hndl = hndl;
+	nlbl_msg *msg = NULL;
+	nlbl_msg *ans_msg = NULL;
+
+	/* sanity checks */
+	if (doi == 0 ||
+	    mtype == NULL || tags == NULL || lvls == NULL || cats == NULL)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto list_return;
+	}
+
+	/* create a new message */
+	rc = nlbl_cipsov4_doi_msg(NLBL_CIPSOV4_C_LIST, doi, &msg);
+	if (rc < 0)
+		goto list_return;
+
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto list_return;
+	}
+
+	/* read the response */
+	rc = nlbl_cipsov4_recv(p_hndl, &ans_msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto list_return;
+	}
+
+	/* check the response */
+	rc = nlbl_cipsov4_parse_ack(ans_msg);
+	if (rc < 0 && rc != -ENOMSG)
+		goto list_return;
+
+	/* process the response */
+	rc = nlbl_cipsov4_list_decode_range(nlbl_msg_nlhdr(ans_msg),
+					    mtype, tags, lvls, cats);
+
+list_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	nlbl_msg_free(msg);
+	nlbl_msg_free(ans_msg);
+	return rc;
+}
+
+/**
+ * List the details of a specific CIPSOv4 label mapping
+ * @param hndl the NetLabel handle
+ * @param doi the CIPSO DOI number
+ * @param mtype the DOI mapping type
+ * @param tags array of tag numbers
+ * @param lvls array of level mappings
+ * @param cats array of category mappings
+ *
+ * Query the kernel for the specified CIPSOv4 mapping specified by @doi and
+ * return the details of the mapping to the caller.  If @hndl is NULL then the
+ * function will handle opening and closing it's own NetLabel handle.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int nlbl_cipsov4_list(struct nlbl_handle *hndl,
+		      nlbl_cv4_doi doi,
+		      nlbl_cv4_mtype *mtype,
+		      struct nlbl_cv4_tag_a *tags,
+		      struct nlbl_cv4_lvl_a *lvls,
+		      struct nlbl_cv4_cat_a *cats)
+{
+	int rc;
+	struct nlbl_cv4_range_a lvls_r;
+	struct nlbl_cv4_range_a cats_r;
+
+	/* sanity checks */
+	if (lvls == NULL || cats == NULL)
+		return -EINVAL;
+
+	rc = nlbl_cipsov4_list_range(hndl, doi, mtype, tags, &lvls_r, &cats_r);
+	if (rc < 0)
+		return rc;
+
+	rc = nlbl_cipsov4_range_to_pairs(&lvls_r, &lvls->array, &lvls->size);
+	if (rc == 0)
+		rc = nlbl_cipsov4_range_to_pairs(&cats_r,
+						 &cats->array, &cats->size);
+	if (rc < 0)
+		nlbl_cipsov4_doi_release(tags, lvls, cats);
+	free(lvls_r.array);
+	free(cats_r.array);
+
+	return rc;
+}
+
+/**
+ * List the CIPSOv4 label mappings
+ * @param hndl the NetLabel handle
+ * @param dois an array of DOI values
+ * @param mtypes an array of the mapping types
+ *
+ * Query the kernel for the configured CIPSOv4 mappings and return two arrays;
+ * @dois which contains the DOI values and @mtypes which contains the
+ * type of mapping.  If @hndl is NULL then the function will handle opening
+ * and closing it's own NetLabel handle.  Returns the number of mappings on
+ * success, zero if no mappings exist, and negative values on failure.
+ *
+ */
+int nlbl_cipsov4_listall(struct nlbl_handle *hndl,
+			 nlbl_cv4_doi **dois,
+			 nlbl_cv4_mtype **mtypes)
+{
+	int rc;
+	struct nlbl_cipsov4_doi_array list;
+
+	/* sanity checks */
+	if (dois == NULL || mtypes == NULL)
+		return -EINVAL;
+
+	memset(&list, 0, sizeof(list));
+	rc = nlbl_cipsov4_listall_walk(hndl,
+				       nlbl_cipsov4_listall_append, &list);
+	if (rc < 0) {
+		if (list.dois != NULL)
+			free(list.dois);
+		if (list.mtypes != NULL)
+			free(list.mtypes);
+		return rc;
+	}
+
+	*dois = list.dois;
+	*mtypes = list.mtypes;
+	return list.count;
+}
+
+/**
+ * Walk the CIPSOv4 label mappings
+ * @param hndl the NetLabel handle
+ * @param cb the per-mapping callback
+ * @param arg the callback argument
+ *
+ * Query the kernel for the configured CIPSOv4 mappings and call @cb with the
+ * DOI value and mapping type of each as it is received.  If @cb returns a
+ * positive value the walk stops early, if it returns a negative value the
+ * walk is aborted and the value is returned.  If @hndl is NULL then the
+ * function will handle opening and closing it's own NetLabel handle.  Returns
+ * the number of mappings passed to @cb on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_cipsov4_listall_walk(struct nlbl_handle *hndl,
+			      nlbl_cv4_doi_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg;
+	struct nlbl_cipsov4_walk_arg walk;
+
+	/* sanity checks */
+	if (cb == NULL)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* create a new message */
+	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_LISTALL, NLM_F_DUMP, 0);
+	if (msg == NULL)
+		return -ENOMEM;
+
+	/* perform the dump */
+	walk.cb = cb;
+	walk.cb_arg = arg;
+	walk.count = 0;
+	rc = nlbl_comm_dump(hndl, msg, nlbl_cipsov4_listall_walk_msg, &walk);
+	nlbl_msg_free(msg);
+	if (rc < 0)
+		return rc;
+
+	return walk.count;
+}
+
+/**
+ * List the details of all of the CIPSOv4 label mappings
+ * @param hndl the NetLabel handle
+ * @param defs an array of DOI definitions
+ *
+ * Query the kernel for the configured CIPSOv4 mappings and the full definition
+ * of each, returning them in @defs which the caller must free with
+ * nlbl_cipsov4_def_free().  The definitions are requested on a single handle
+ * with many requests in flight at once, rather than one round trip per DOI.
+ * If the kernel drops replies because they do not fit in the socket's receive
+ * buffer, which can happen with very large translation tables, the remaining
+ * definitions are requested one at a time.  DOIs which are removed while the
+ * definitions are being fetched are left out.  If @hndl is NULL then the
+ * function will borrow a handle from the handle pool.  Returns the number of
+ * mappings on success, zero if no mappings exist, and negative values on
+ * failure.
+ *
+ */
+int nlbl_cipsov4_listall_detail(struct nlbl_handle *hndl,
+				struct nlbl_cv4_def **defs)
+{
+	int rc;
+	struct nlbl_handle *p_hndl = hndl;
+	nlbl_cv4_doi *dois = NULL;
+	nlbl_cv4_mtype *mtypes = NULL;
+	struct nlbl_cipsov4_detail detail;
+	struct nlbl_batch *batch = NULL;
+	nlbl_msg *msg = NULL;
+	struct nlbl_cv4_def *def;
+	size_t count = 0;
+	size_t iter;
+	size_t found;
+
+	/* sanity checks */
+	if (defs == NULL)
+		return -EINVAL;
+	memset(&detail, 0, sizeof(detail));
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL) {
+			rc = -ENOMEM;
+			goto detail_return;
+		}
+	}
+
+	rc = nlbl_cipsov4_listall(p_hndl, &dois, &mtypes);
+	if (rc <= 0)
+		goto detail_return;
+	count = rc;
+
+	rc = -ENOMEM;
+	detail.fid = nlbl_cipsov4_fid();
+	detail.defs = calloc(count, sizeof(*detail.defs));
+	detail.rc = calloc(count, sizeof(*detail.rc));
+	detail.status = calloc(count, sizeof(*detail.status));
+	batch = nlbl_batch_new();
+	if (detail.defs == NULL || detail.rc == NULL ||
+	    detail.status == NULL || batch == NULL)
+		goto detail_return;
+	for (iter = 0; iter < count; iter++) {
+		detail.defs[iter].doi = dois[iter];
+		detail.defs[iter].mtype = mtypes[iter];
+		detail.rc[iter] = -EBADMSG;
+		rc = nlbl_cipsov4_doi_msg(NLBL_CIPSOV4_C_LIST,
+					  dois[iter], &msg);
+		if (rc < 0)
+			goto detail_return;
+		rc = nlbl_batch_queue(batch, msg);
+		if (rc < 0)
+			goto detail_return;
+	}
+
+	/* send the requests, falling back to one request at a time if the
+	 * kernel could not queue all of the replies, the trailing ACK of each
+	 * request is discarded before the next one is sent */
+	rc = nlbl_batch_exec_reply(p_hndl, batch, detail.status,
+				   nlbl_cipsov4_detail_reply, &detail);
+	if (rc == -ENOBUFS) {
+		for (iter = 0; iter < count; iter++) {
+			if (detail.rc[iter] == 0)
+				continue;
+			p_hndl->ops->drain(p_hndl);
+			def = &detail.defs[iter];
+			detail.status[iter] = nlbl_cipsov4_list_range(p_hndl,
+								      def->doi,
+								      &def->mtype,
+								      &def->tags,
+								      &def->lvls,
+								      &def->cats);
+			if (detail.status[iter] < 0)
+				continue;
+			detail.status[iter] = 0;
+			detail.rc[iter] = 0;
+		}
+	} else if (rc < 0)
+		goto detail_return;
+
+	/* check the results, skipping any DOIs removed since the LISTALL */
+	for (iter = 0, found = 0; iter < count; iter++) {
+		rc = (detail.status[iter] < 0 ?
+		      detail.status[iter] : detail.rc[iter]);
+		if (rc == -ENOENT)
+			continue;
+		if (rc < 0)
+			goto detail_return;
+		if (found != iter) {
+			detail.defs[found] = detail.defs[iter];
+			memset(&detail.defs[iter], 0,
+			       sizeof(detail.defs[iter]));
+		}
+		found++;
+	}
+
+	*defs = detail.defs;
+	detail.defs = NULL;
+	rc = found;
+
+detail_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	nlbl_batch_free(batch);
+	nlbl_cipsov4_def_free(detail.defs, count);
+	free(detail.rc);
+	free(detail.status);
+	free(dois);
+	free(mtypes);
+	return rc;
+}
+
+/**
+ * Free an array of CIPSOv4 DOI definitions
+ * @param defs the DOI definitions
+ * @param count the number of DOI definitions
+ *
+ * Free the DOI definitions returned by nlbl_cipsov4_listall_detail().
+ *
+ */
+void nlbl_cipsov4_def_free(struct nlbl_cv4_def *defs, size_t count)
+{
+	size_t iter;
+
+	if (defs == NULL)
+		return;
+
+	for (iter = 0; iter < count; iter++)
+		nlbl_cipsov4_range_release(&defs[iter].tags,
+					   &defs[iter].lvls,
+					   &defs[iter].cats);
+	free(defs);
+}
+
+/*
+ * NetLabel batch operations
+ */
+
+/**
+ * Queue a CIPSOv4 translated DOI addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param lvls array of level mappings
+ * @param cats array of category mappings, may be NULL
+ *
+ * Queue a request to add a CIPSOv4 translated DOI definition, see
+ * nlbl_cipsov4_add_trans().  Returns the index of the request within the batch
+ * on success, negative values on failure.
+ *
+ */
+int nlbl_batch_cipsov4_add_trans(struct nlbl_batch *batch,
+				 nlbl_cv4_doi doi,
+				 struct nlbl_cv4_tag_a *tags,
+				 struct nlbl_cv4_lvl_a *lvls,
+				 struct nlbl_cv4_cat_a *cats)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || doi == 0 ||
+	    tags == NULL || tags->size == 0 ||
+	    lvls == NULL || lvls->size == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_trans_msg(doi, tags, lvls, cats, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a CIPSOv4 translated DOI addition with mapping ranges in a batch
+ * @param batch the NetLabel batch
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param lvls array of level mapping ranges
+ * @param cats array of category mapping ranges, may be NULL
+ *
+ * Queue a request to add a CIPSOv4 translated DOI definition, see
+ * nlbl_cipsov4_add_trans_range().  Returns the index of the request within the
+ * batch on success, negative values on failure.
+ *
+ */
+int nlbl_batch_cipsov4_add_trans_range(struct nlbl_batch *batch,
+				       nlbl_cv4_doi doi,
+				       struct nlbl_cv4_tag_a *tags,
+				       struct nlbl_cv4_range_a *lvls,
+				       struct nlbl_cv4_range_a *cats)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || doi == 0 ||
+	    tags == NULL || tags->size == 0 ||
+	    lvls == NULL || lvls->size == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_msg(doi, CIPSO_V4_MAP_TRANS,
+				  tags, lvls, cats, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a CIPSOv4 pass through DOI addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ *
+ * Queue a request to add a CIPSOv4 pass through DOI definition, see
+ * nlbl_cipsov4_add_pass().  Returns the index of the request within the batch
+ * on success, negative values on failure.
+ *
+ */
+int nlbl_batch_cipsov4_add_pass(struct nlbl_batch *batch,
+				nlbl_cv4_doi doi,
+				struct nlbl_cv4_tag_a *tags)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || doi == 0 ||
+	    tags == NULL || tags->size == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_pass_msg(doi, tags, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a CIPSOv4 local DOI addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param doi the CIPSO DOI number
+ *
+ * Queue a request to add a CIPSOv4 local DOI definition, see
+ * nlbl_cipsov4_add_local().  Returns the index of the request within the batch
+ * on success, negative values on failure.
+ *
+ */
+int nlbl_batch_cipsov4_add_local(struct nlbl_batch *batch, nlbl_cv4_doi doi)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_local_msg(doi, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a CIPSOv4 DOI removal in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param doi the CIPSO DOI number
+ *
+ * Queue a request to remove the CIPSOv4 DOI definition, see
+ * nlbl_cipsov4_del().  Returns the index of the request within the batch on
+ * success, negative values on failure.
+ *
+ */
+int nlbl_batch_cipsov4_del(struct nlbl_batch *batch, nlbl_cv4_doi doi)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_doi_msg(NLBL_CIPSOV4_C_REMOVE, doi, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/*
+ * NetLabel asynchronous operations
+ */
+
+/**
+ * Decode a LIST message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Decode the DOI definition in @nl_hdr into @res.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_async_list_decode(struct nlmsghdr *nl_hdr,
+					  struct nlbl_async_result *res)
+{
+	return nlbl_cipsov4_list_decode(nl_hdr,
+					&res->data.cv4_doi.mtype,
+					&res->data.cv4_doi.tags,
+					&res->data.cv4_doi.lvls,
+					&res->data.cv4_doi.cats);
+}
+
+/**
+ * Free a LIST asynchronous result
+ * @param res the asynchronous result
+ *
+ * Free the DOI definition arrays in @res.
+ *
+ */
+static void nlbl_cipsov4_async_list_release(struct nlbl_async_result *res)
+{
+	nlbl_cipsov4_doi_release(&res->data.cv4_doi.tags,
+				 &res->data.cv4_doi.lvls,
+				 &res->data.cv4_doi.cats);
+}
+
+/**
+ * Decode a LISTALL message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Append the DOI and mapping type in @nl_hdr to the arrays in @res.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cipsov4_async_listall_decode(struct nlmsghdr *nl_hdr,
+					     struct nlbl_async_result *res)
+{
+	nlbl_cv4_doi *doi_a_new;
+	nlbl_cv4_mtype *mtype_a_new;
+
+	doi_a_new = nlbl_array_grow(res->data.cv4_all.dois,
+				    res->count, sizeof(*doi_a_new));
+	if (doi_a_new == NULL)
+		return -ENOMEM;
+	res->data.cv4_all.dois = doi_a_new;
+	mtype_a_new = nlbl_array_grow(res->data.cv4_all.mtypes,
+				      res->count, sizeof(*mtype_a_new));
+	if (mtype_a_new == NULL)
+		return -ENOMEM;
+	res->data.cv4_all.mtypes = mtype_a_new;
+
+	if (nlbl_cipsov4_listall_decode(nl_hdr,
+					&doi_a_new[res->count],
+					&mtype_a_new[res->count]) < 0)
+		return -EBADMSG;
+	res->count++;
+
+	return 0;
+}
+
+/**
+ * Free a LISTALL asynchronous result
+ * @param res the asynchronous result
+ *
+ * Free the DOI and mapping type arrays in @res.
+ *
+ */
+static void nlbl_cipsov4_async_listall_release(struct nlbl_async_result *res)
+{
+	if (res->data.cv4_all.dois != NULL)
+		free(res->data.cv4_all.dois);
+	if (res->data.cv4_all.mtypes != NULL)
+		free(res->data.cv4_all.mtypes);
+}
+
+static const struct nlbl_async_ops nlbl_cipsov4_async_list_ops = {
+	.decode = nlbl_cipsov4_async_list_decode,
+	.release = nlbl_cipsov4_async_list_release,
+};
+
+static const struct nlbl_async_ops nlbl_cipsov4_async_listall_ops = {
+	.decode = nlbl_cipsov4_async_listall_decode,
+	.release = nlbl_cipsov4_async_listall_release,
+};
+
+/**
+ * Add a translated CIPSOv4 label mapping asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param lvls array of level mappings
+ * @param cats array of category mappings, may be NULL
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add a CIPSOv4 translated DOI definition, see
+ * nlbl_cipsov4_add_trans().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_cipsov4_add_trans(struct nlbl_async *async,
+				 nlbl_cv4_doi doi,
+				 struct nlbl_cv4_tag_a *tags,
+				 struct nlbl_cv4_lvl_a *lvls,
+				 struct nlbl_cv4_cat_a *cats,
+				 nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || doi == 0 ||
+	    tags == NULL || tags->size == 0 ||
+	    lvls == NULL || lvls->size == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_trans_msg(doi, tags, lvls, cats, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Add a pass-through CIPSOv4 label mapping asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param doi the CIPSO DOI number
+ * @param tags array of tags
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add a CIPSOv4 pass through DOI definition, see
+ * nlbl_cipsov4_add_pass().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_cipsov4_add_pass(struct nlbl_async *async,
+				nlbl_cv4_doi doi,
+				struct nlbl_cv4_tag_a *tags,
+				nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || doi == 0 ||
+	    tags == NULL || tags->size == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_pass_msg(doi, tags, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Add a local CIPSOv4 label mapping asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param doi the CIPSO DOI number
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add a CIPSOv4 local DOI definition, see
+ * nlbl_cipsov4_add_local().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_cipsov4_add_local(struct nlbl_async *async,
+				 nlbl_cv4_doi doi,
+				 nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_add_local_msg(doi, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Remove a CIPSOv4 label mapping asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param doi the CIPSO DOI number
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to remove the CIPSOv4 DOI definition, see
+ * nlbl_cipsov4_del().  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_cipsov4_del(struct nlbl_async *async,
+			   nlbl_cv4_doi doi,
+			   nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_doi_msg(NLBL_CIPSOV4_C_REMOVE, doi, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Query a CIPSOv4 label mapping asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param doi the CIPSO DOI number
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the CIPSOv4 DOI definition of @doi, see
+ * nlbl_cipsov4_list().  The definition is returned in the data.cv4_doi field
+ * of the results.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_cipsov4_list(struct nlbl_async *async,
+			    nlbl_cv4_doi doi,
+			    nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || doi == 0)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_cipsov4_doi_msg(NLBL_CIPSOV4_C_LIST, doi, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_cipsov4_async_list_ops, cb, arg);
+}
+
+/**
+ * List the CIPSOv4 label mappings asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the configured CIPSOv4 DOI definitions, see
+ * nlbl_cipsov4_listall().  The definitions are returned in the data.cv4_all
+ * field of the results.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_cipsov4_listall(struct nlbl_async *async,
+			       nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_cipsov4_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_cipsov4_msg_new(NLBL_CIPSOV4_C_LISTALL, NLM_F_DUMP, 0);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_cipsov4_async_listall_ops, cb, arg);
 }
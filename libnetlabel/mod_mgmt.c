@@ -23,6 +23,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -32,13 +33,82 @@
 
 #include "netlabel_internal.h"
 
-/* Generic Netlink family ID */
-static uint16_t nlbl_mgmt_fid = 0;
+/* NetLabel management attribute policy */
+static const struct nla_policy nlbl_mgmt_policy[NLBL_MGMT_A_MAX + 1] = {
+	[NLBL_MGMT_A_DOMAIN] = { .type = NLA_STRING },
+	[NLBL_MGMT_A_PROTOCOL] = { .type = NLA_U32 },
+	[NLBL_MGMT_A_VERSION] = { .type = NLA_U32 },
+	[NLBL_MGMT_A_CV4DOI] = { .type = NLA_U32 },
+	[NLBL_MGMT_A_IPV6ADDR] = { .minlen = sizeof(struct in6_addr),
+				   .maxlen = sizeof(struct in6_addr) },
+	[NLBL_MGMT_A_IPV6MASK] = { .minlen = sizeof(struct in6_addr),
+				   .maxlen = sizeof(struct in6_addr) },
+	[NLBL_MGMT_A_IPV4ADDR] = { .minlen = sizeof(struct in_addr),
+				   .maxlen = sizeof(struct in_addr) },
+	[NLBL_MGMT_A_IPV4MASK] = { .minlen = sizeof(struct in_addr),
+				   .maxlen = sizeof(struct in_addr) },
+	[NLBL_MGMT_A_ADDRSELECTOR] = { .type = NLA_NESTED },
+	[NLBL_MGMT_A_SELECTORLIST] = { .type = NLA_NESTED },
+};
+
+/* NetLabel management dump state */
+struct nlbl_mgmt_walk_arg {
+	union {
+		nlbl_proto_cb proto;
+		nlbl_dommap_cb dommap;
+	} cb;
+	void *cb_arg;
+	int count;
+};
+
+/* NetLabel management result arrays */
+struct nlbl_mgmt_protocols_array {
+	nlbl_proto *array;
+	size_t count;
+};
+struct nlbl_mgmt_dommap_array {
+	struct nlbl_dommap *array;
+	size_t count;
+};
+
+/* NetLabel domain mapping list under construction, the arrays move as they
+ * grow so the domains refer to their strings and selectors by index */
+struct nlbl_mgmt_list_dom {
+	size_t domain;
+	nlbl_proto proto_type;
+	nlbl_cv4_doi cv4_doi;
+	size_t addr_first;
+	size_t addr_count;
+};
+struct nlbl_mgmt_list_build {
+	struct nlbl_mgmt_list_dom *doms;
+	size_t dom_count;
+	struct nlbl_dommap_addr *addrs;
+	size_t addr_count;
+	char *strs;
+	size_t strs_len;
+	size_t strs_size;
+};
 
 /*
  * Helper functions
  */
 
+/**
+ * Return the NetLabel management Generic Netlink family ID
+ *
+ * Returns the family ID, which is resolved the first time it is needed, or
+ * zero if the family can not be resolved.
+ *
+ */
+static uint16_t nlbl_mgmt_fid(void)
+{
+	int rc;
+
+	rc = nlbl_comm_family(NETLBL_NLTYPE_MGMT);
+	return (rc > 0 ? rc : 0);
+}
+
 /**
  * Create a new NetLabel management message
  * @param command the NetLabel management command
@@ -64,7 +134,7 @@ static nlbl_msg *nlbl_mgmt_msg_new(uint16_t command, int flags)
 	nl_hdr = nlbl_msg_nlhdr(msg);
 	if (nl_hdr == NULL)
 		goto msg_new_failure;
-	nl_hdr->nlmsg_type = nlbl_mgmt_fid;
+	nl_hdr->nlmsg_type = nlbl_mgmt_fid();
 	nl_hdr->nlmsg_flags = flags;
 
 	/* setup the generic netlink header */
@@ -80,6 +150,133 @@ msg_new_failure:
 	return NULL;
 }
 
+/**
+ * Create a NetLabel management domain mapping message
+ * @param command the NetLabel management command
+ * @param domain the NetLabel domain map
+ * @param addr the network IP address
+ * @param msg the new message
+ *
+ * Create a new NLBL_MGMT_C_ADD or NLBL_MGMT_C_ADDDEF message for the domain
+ * mapping in @domain and @addr, the domain string is only included for
+ * NLBL_MGMT_C_ADD.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_add_msg(uint16_t command,
+			     struct nlbl_dommap *domain,
+			     struct nlbl_netaddr *addr,
+			     nlbl_msg **msg)
+{
+	int rc = -ENOMEM;
+	nlbl_msg *new_msg;
+
+	/* create a new message */
+	new_msg = nlbl_mgmt_msg_new(command, 0);
+	if (new_msg == NULL)
+		goto add_msg_failure;
+
+	/* add the required attributes to the message */
+	if (command == NLBL_MGMT_C_ADD) {
+		rc = nla_put_string(new_msg, NLBL_MGMT_A_DOMAIN,
+				    domain->domain);
+		if (rc != 0)
+			goto add_msg_failure;
+	}
+	rc = nla_put_u32(new_msg, NLBL_MGMT_A_PROTOCOL, domain->proto_type);
+	if (rc != 0)
+		goto add_msg_failure;
+	switch (domain->proto_type) {
+	case NETLBL_NLTYPE_CIPSOV4:
+		rc = nla_put_u32(new_msg,
+				 NLBL_MGMT_A_CV4DOI,
+				 domain->proto.cv4_doi);
+		if (rc != 0)
+			goto add_msg_failure;
+		break;
+	}
+
+	/* optional attributes */
+	switch (addr->type) {
+	case AF_INET:
+		rc = nla_put(new_msg,
+			     NLBL_MGMT_A_IPV4ADDR,
+			     sizeof(struct in_addr),
+			     &addr->addr.v4);
+		if (rc != 0)
+			goto add_msg_failure;
+		rc = nla_put(new_msg,
+			     NLBL_MGMT_A_IPV4MASK,
+			     sizeof(struct in_addr),
+			     &addr->mask.v4);
+		if (rc != 0)
+			goto add_msg_failure;
+		break;
+	case AF_INET6:
+		rc = nla_put(new_msg,
+			     NLBL_MGMT_A_IPV6ADDR,
+			     sizeof(struct in6_addr),
+			     &addr->addr.v6);
+		if (rc != 0)
+			goto add_msg_failure;
+		rc = nla_put(new_msg,
+			     NLBL_MGMT_A_IPV6MASK,
+			     sizeof(struct in6_addr),
+			     &addr->mask.v6);
+		if (rc != 0)
+			goto add_msg_failure;
+		break;
+	case 0:
+		break;
+	default:
+		rc = -EINVAL;
+		goto add_msg_failure;
+	}
+
+	*msg = new_msg;
+	return 0;
+
+add_msg_failure:
+	nlbl_msg_free(new_msg);
+	return rc;
+}
+
+/**
+ * Create a NetLabel management domain removal message
+ * @param domain the domain, NULL for the default mapping
+ * @param msg the new message
+ *
+ * Create a new NLBL_MGMT_C_REMOVE message for @domain, or a
+ * NLBL_MGMT_C_REMOVEDEF message if @domain is NULL.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_del_msg(char *domain, nlbl_msg **msg)
+{
+	int rc = -ENOMEM;
+	nlbl_msg *new_msg;
+
+	/* create a new message */
+	new_msg = nlbl_mgmt_msg_new((domain != NULL ?
+				     NLBL_MGMT_C_REMOVE :
+				     NLBL_MGMT_C_REMOVEDEF), 0);
+	if (new_msg == NULL)
+		goto del_msg_failure;
+
+	/* add the required attributes to the message */
+	if (domain != NULL) {
+		rc = nla_put_string(new_msg, NLBL_MGMT_A_DOMAIN, domain);
+		if (rc != 0)
+			goto del_msg_failure;
+	}
+
+	*msg = new_msg;
+	return 0;
+
+del_msg_failure:
+	nlbl_msg_free(new_msg);
+	return rc;
+}
+
 /**
  * Read a NetLabel management message
  * @param hndl the NetLabel handle
@@ -102,7 +299,7 @@ static int nlbl_mgmt_recv(struct nlbl_handle *hndl, nlbl_msg **msg)
 
 	/* process the response */
 	nl_hdr = nlbl_msg_nlhdr(*msg);
-	if (nl_hdr == NULL || (nl_hdr->nlmsg_type != nlbl_mgmt_fid &&
+	if (nl_hdr == NULL || (nl_hdr->nlmsg_type != nlbl_mgmt_fid() &&
 			       nl_hdr->nlmsg_type != NLMSG_DONE &&
 			       nl_hdr->nlmsg_type != NLMSG_ERROR)) {
 		rc = -EBADMSG;
@@ -135,6 +332,64 @@ static int nlbl_mgmt_parse_ack(nlbl_msg *msg)
 	return nl_err->error;
 }
 
+/**
+ * Parse an address selector
+ * @param nla_a the NLBL_MGMT_A_ADDRSELECTOR attribute
+ * @param addr the address selector
+ *
+ * Parse the NLBL_MGMT_A_ADDRSELECTOR attribute and populate @addr with the
+ * information, @addr->next is left untouched.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int nlbl_mgmt_addr_decode(struct nlattr *nla_a,
+				 struct nlbl_dommap_addr *addr)
+{
+	int rc;
+	struct nlattr *tb[NLBL_MGMT_A_MAX + 1];
+
+	rc = nlbl_attr_parse_nested(nla_a, tb, NLBL_MGMT_A_MAX,
+				    nlbl_mgmt_policy);
+	if (rc < 0)
+		return rc;
+
+	if (tb[NLBL_MGMT_A_IPV4ADDR] != NULL) {
+		if (tb[NLBL_MGMT_A_IPV4MASK] == NULL)
+			return -EINVAL;
+		memcpy(&addr->addr.addr.v4,
+		       nla_data(tb[NLBL_MGMT_A_IPV4ADDR]),
+		       sizeof(struct in_addr));
+		memcpy(&addr->addr.mask.v4,
+		       nla_data(tb[NLBL_MGMT_A_IPV4MASK]),
+		       sizeof(struct in_addr));
+		addr->addr.type = AF_INET;
+	} else if (tb[NLBL_MGMT_A_IPV6ADDR] != NULL) {
+		if (tb[NLBL_MGMT_A_IPV6MASK] == NULL)
+			return -EINVAL;
+		memcpy(&addr->addr.addr.v6,
+		       nla_data(tb[NLBL_MGMT_A_IPV6ADDR]),
+		       sizeof(struct in6_addr));
+		memcpy(&addr->addr.mask.v6,
+		       nla_data(tb[NLBL_MGMT_A_IPV6MASK]),
+		       sizeof(struct in6_addr));
+		addr->addr.type = AF_INET6;
+	} else
+		return -EINVAL;
+
+	if (tb[NLBL_MGMT_A_PROTOCOL] == NULL)
+		return -EINVAL;
+	addr->proto_type = nla_get_u32(tb[NLBL_MGMT_A_PROTOCOL]);
+	switch (addr->proto_type) {
+	case NETLBL_NLTYPE_CIPSOV4:
+		if (tb[NLBL_MGMT_A_CV4DOI] == NULL)
+			return -EINVAL;
+		addr->proto.cv4_doi = nla_get_u32(tb[NLBL_MGMT_A_CV4DOI]);
+		break;
+	}
+
+	return 0;
+}
+
 /**
  * Parse a LIST message with address selectors
  * @param nla_head the NLBL_MGMT_A_SELECTORLIST attribute
@@ -144,15 +399,17 @@ static int nlbl_mgmt_parse_ack(nlbl_msg *msg)
  * the information.  Returns zero on success, negative values on failure.
  *
  */
-static int nlbl_mgmt_list_addr(const struct nlattr *nla_head,
+static int nlbl_mgmt_list_addr(struct nlattr *nla_head,
 			       struct nlbl_dommap *domain)
 {
+	int rc;
 	struct nlbl_dommap_addr *addr_iter;
+	struct nlbl_dommap_addr **addr_tail;
 	struct nlattr *nla_a;
-	struct nlattr *nla_b;
 	int nla_a_rem;
 
 	domain->proto_type = NETLBL_NLTYPE_ADDRSELECT;
+	addr_tail = &domain->proto.addrsel;
 
 	/* parse the attributes */
 	nla_for_each_attr(nla_a,
@@ -163,331 +420,566 @@ static int nlbl_mgmt_list_addr(const struct nlattr *nla_head,
 		if (addr_iter == NULL)
 			return -ENOMEM;
 		memset(addr_iter, 0, sizeof(*addr_iter));
-		if (domain->proto.addrsel != NULL) {
-			struct nlbl_dommap_addr *iter;
-			iter = domain->proto.addrsel;
-			while (iter->next != NULL)
-				iter = iter->next;
-			iter->next = addr_iter;
-		} else
-			domain->proto.addrsel = addr_iter;
-
-		nla_b = nla_find(nla_data(nla_a), nla_len(nla_a),
-				 NLBL_MGMT_A_IPV4ADDR);
-		if (nla_b != NULL) {
-			if (nla_len(nla_b) != sizeof(struct in_addr))
-				return -EINVAL;
-			memcpy(&addr_iter->addr.addr.v4,
-			       nla_data(nla_b), nla_len(nla_b));
-			nla_b = nla_find(nla_data(nla_a),
-					 nla_len(nla_a),
-					 NLBL_MGMT_A_IPV4MASK);
-			if (nla_b == NULL ||
-			    nla_len(nla_b) != sizeof(struct in_addr))
-				return -EINVAL;
-			memcpy(&addr_iter->addr.mask.v4,
-			       nla_data(nla_b), nla_len(nla_b));
-			addr_iter->addr.type = AF_INET;
-			nla_b = nla_find(nla_data(nla_a),
-					 nla_len(nla_a),
-					 NLBL_MGMT_A_PROTOCOL);
-			if (nla_b == NULL)
-				return -EINVAL;
-			addr_iter->proto_type = nla_get_u32(nla_b);
-			switch (addr_iter->proto_type) {
-			case NETLBL_NLTYPE_CIPSOV4:
-				nla_b = nla_find(nla_data(nla_a),
-						 nla_len(nla_a),
-						 NLBL_MGMT_A_CV4DOI);
-				if (nla_b == NULL)
-					return -EINVAL;
-				addr_iter->proto.cv4_doi =
-					nla_get_u32(nla_b);
-				break;
-			}
-		} else if ((nla_b = nla_find(nla_data(nla_a),
-					     nla_len(nla_a),
-					     NLBL_MGMT_A_IPV6ADDR))) {
-			if (nla_len(nla_b) != sizeof(struct in6_addr))
-				return -EINVAL;
-			memcpy(&addr_iter->addr.addr.v6,
-			       nla_data(nla_b), nla_len(nla_b));
-			nla_b = nla_find(nla_data(nla_a),
-					 nla_len(nla_a),
-					 NLBL_MGMT_A_IPV6MASK);
-			if (nla_b == NULL ||
-			    nla_len(nla_b) != sizeof(struct in6_addr))
-				return -EINVAL;
-			memcpy(&addr_iter->addr.mask.v6,
-			       nla_data(nla_b), nla_len(nla_b));
-			addr_iter->addr.type = AF_INET6;
-			nla_b = nla_find(nla_data(nla_a),
-					 nla_len(nla_a),
-					 NLBL_MGMT_A_PROTOCOL);
-			if (nla_b == NULL)
-				return -EINVAL;
-			addr_iter->proto_type = nla_get_u32(nla_b);
-		} else
-			return -EINVAL;
+		*addr_tail = addr_iter;
+		addr_tail = &addr_iter->next;
+
+		rc = nlbl_mgmt_addr_decode(nla_a, addr_iter);
+		if (rc < 0)
+			return rc;
 	}
 
 	return 0;
 }
 
-/*
- * Init functions
+/**
+ * Free the contents of a domain mapping
+ * @param domain the domain mapping entry
+ *
+ * Free the domain string and any address selectors in @domain and reset the
+ * entry so that it can be safely reused.
+ *
  */
+static void nlbl_mgmt_dommap_release(struct nlbl_dommap *domain)
+{
+	struct nlbl_dommap_addr *iter, *prev;
+
+	if (domain->domain != NULL)
+		free(domain->domain);
+	if (domain->proto_type == NETLBL_NLTYPE_ADDRSELECT) {
+		iter = domain->proto.addrsel;
+		while (iter != NULL) {
+			prev = iter;
+			iter = iter->next;
+			free(prev);
+		}
+	}
+	memset(domain, 0, sizeof(*domain));
+}
 
 /**
- * Perform any setup needed
+ * Decode a PROTOCOLS message
+ * @param nl_hdr the netlink message
+ * @param protocol the protocol
  *
- * Do any setup needed for the management component, including determining the
- * NetLabel Mangement Generic Netlink family ID.  Returns zero on success,
- * negative values on error.
+ * Decode the NLBL_MGMT_C_PROTOCOLS message in @nl_hdr and return the protocol
+ * in @protocol.  Returns zero on success, negative values on failure.
  *
  */
-int nlbl_mgmt_init(void)
+static int nlbl_mgmt_protocols_decode(struct nlmsghdr *nl_hdr,
+				      nlbl_proto *protocol)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *hndl;
-
-	/* get a netlabel handle */
-	hndl = nlbl_comm_open();
-	if (hndl == NULL)
-		goto init_return;
+	int rc;
+	struct nlattr *tb[NLBL_MGMT_A_MAX + 1];
 
-	/* resolve the family */
-	rc = genl_ctrl_resolve(hndl->nl_sock, NETLBL_NLTYPE_MGMT_NAME);
+	rc = nlbl_attr_parse(nl_hdr, NLBL_MGMT_C_PROTOCOLS,
+			     tb, NLBL_MGMT_A_MAX, nlbl_mgmt_policy);
 	if (rc < 0)
-		goto init_return;
-	nlbl_mgmt_fid = rc;
+		return rc;
 
-	rc = 0;
+	if (tb[NLBL_MGMT_A_PROTOCOL] == NULL)
+		return -EBADMSG;
+	*protocol = nla_get_u32(tb[NLBL_MGMT_A_PROTOCOL]);
 
-init_return:
-	nlbl_comm_close(hndl);
-	return rc;
+	return 0;
 }
 
-/*
- * NetLabel operations
- */
-
 /**
- * Determine the supported list of NetLabel protocols
- * @param hndl the NetLabel handle
- * @param protocols protocol array
+ * Decode a VERSION message
+ * @param nl_hdr the netlink message
+ * @param version the protocol version
  *
- * Query the NetLabel subsystem and return the supported protocols in
- * @protocols.  If @hndl is NULL then the function will handle opening and
- * closing it's own NetLabel handle.  Returns the number of protocols on
- * success, zero if no protocols are supported, and negative values on failure.
+ * Decode the NLBL_MGMT_C_VERSION message in @nl_hdr and return the protocol
+ * version in @version.  Returns zero on success, negative values on failure.
  *
  */
-int nlbl_mgmt_protocols(struct nlbl_handle *hndl, nlbl_proto **protocols)
+static int nlbl_mgmt_version_decode(struct nlmsghdr *nl_hdr, uint32_t *version)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	unsigned char *data = NULL;
-	nlbl_msg *msg = NULL;
-	struct nlmsghdr *nl_hdr;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla_head;
-	struct nlattr *nla;
-	int data_len;
-	int data_attrlen;
-	nlbl_proto *protos = NULL, *protos_new;
-	uint32_t protos_count = 0;
-
-	/* sanity checks */
-	if (protocols == NULL)
-		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
-		return -ENOPROTOOPT;
+	int rc;
+	struct nlattr *tb[NLBL_MGMT_A_MAX + 1];
 
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto protocols_return;
-	}
+	rc = nlbl_attr_parse(nl_hdr, NLBL_MGMT_C_VERSION,
+			     tb, NLBL_MGMT_A_MAX, nlbl_mgmt_policy);
+	if (rc < 0)
+		return rc;
 
-	/* create a new message */
-	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_PROTOCOLS, NLM_F_DUMP);
-	if (msg == NULL) {
-		rc = -ENOMEM;
-		goto protocols_return;
-	}
+	if (tb[NLBL_MGMT_A_VERSION] == NULL)
+		return -EBADMSG;
+	*version = nla_get_u32(tb[NLBL_MGMT_A_VERSION]);
 
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto protocols_return;
-	}
+	return 0;
+}
 
-	/* read all of the messages (multi-message response) */
-	do {
-		if (data != NULL) {
-			free(data);
-			data = NULL;
-		}
+/**
+ * Decode a LISTALL or LISTDEF message
+ * @param nl_hdr the netlink message
+ * @param command the NetLabel management command
+ * @param domain the domain mapping entry
+ *
+ * Decode the NLBL_MGMT_C_LISTALL or NLBL_MGMT_C_LISTDEF message in @nl_hdr
+ * and populate @domain with the information, the domain string is only
+ * present in NLBL_MGMT_C_LISTALL messages.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_mgmt_dommap_decode(struct nlmsghdr *nl_hdr,
+				   uint8_t command,
+				   struct nlbl_dommap *domain)
+{
+	int rc;
+	struct nlattr *tb[NLBL_MGMT_A_MAX + 1];
 
-		/* get the next set of messages */
-		rc = nlbl_comm_recv_raw(p_hndl, &data);
-		if (rc <= 0) {
-			if (rc == 0)
-				rc = -ENODATA;
-			goto protocols_return;
-		}
-		data_len = rc;
-		nl_hdr = (struct nlmsghdr *)data;
-
-		/* check to see if this is a netlink control message we don't
-		 * care about */
-		if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
-		    nl_hdr->nlmsg_type == NLMSG_ERROR ||
-		    nl_hdr->nlmsg_type == NLMSG_OVERRUN) {
-			rc = -EBADMSG;
-			goto protocols_return;
+	rc = nlbl_attr_parse(nl_hdr, command,
+			     tb, NLBL_MGMT_A_MAX, nlbl_mgmt_policy);
+	if (rc < 0)
+		return rc;
+	rc = -EBADMSG;
+
+	memset(domain, 0, sizeof(*domain));
+
+	if (command == NLBL_MGMT_C_LISTALL) {
+		if (tb[NLBL_MGMT_A_DOMAIN] == NULL)
+			goto decode_failure;
+		domain->domain = strdup(nla_data(tb[NLBL_MGMT_A_DOMAIN]));
+		if (domain->domain == NULL) {
+			rc = -ENOMEM;
+			goto decode_failure;
 		}
+	}
 
-		/* loop through the messages */
-		while (nlmsg_ok(nl_hdr, data_len) &&
-		       nl_hdr->nlmsg_type != NLMSG_DONE) {
-			/* get the header pointers */
-			genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
-			if (genl_hdr == NULL ||
-			    genl_hdr->cmd != NLBL_MGMT_C_PROTOCOLS) {
-				rc = -EBADMSG;
-				goto protocols_return;
-			}
-			nla_head = (struct nlattr *)(&genl_hdr[1]);
-			data_attrlen = genlmsg_attrlen(genl_hdr, 0);
-
-			/* resize the array */
-			protos_new = realloc(protos,
-					     sizeof(nlbl_proto) *
-					     (protos_count + 1));
-			if (protos_new == NULL)
-				goto protocols_return;
-			protos = protos_new;
-
-			/* get the attribute information */
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_MGMT_A_PROTOCOL);
-			if (nla == NULL)
-				goto protocols_return;
-			protos[protos_count] = nla_get_u32(nla);
-			protos_count++;
-
-			/* next message */
-			nl_hdr = nlmsg_next(nl_hdr, &data_len);
+	if (tb[NLBL_MGMT_A_PROTOCOL] != NULL) {
+		domain->proto_type = nla_get_u32(tb[NLBL_MGMT_A_PROTOCOL]);
+		switch (domain->proto_type) {
+		case NETLBL_NLTYPE_CIPSOV4:
+			if (tb[NLBL_MGMT_A_CV4DOI] == NULL)
+				goto decode_failure;
+			domain->proto.cv4_doi =
+				nla_get_u32(tb[NLBL_MGMT_A_CV4DOI]);
+			break;
 		}
-	} while (NL_MULTI_CONTINUE(nl_hdr));
+	} else if (tb[NLBL_MGMT_A_SELECTORLIST] != NULL) {
+		rc = nlbl_mgmt_list_addr(tb[NLBL_MGMT_A_SELECTORLIST], domain);
+		if (rc < 0)
+			goto decode_failure;
+	} else
+		goto decode_failure;
 
-	*protocols = protos;
-	rc = protos_count;
+	return 0;
 
-protocols_return:
-	if (rc < 0 && protos)
-		free(protos);
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	if (data != NULL)
-		free(data);
-	nlbl_msg_free(msg);
+decode_failure:
+	nlbl_mgmt_dommap_release(domain);
 	return rc;
 }
 
 /**
- * Determine the kernel's NetLabel protocol version
- * @param hndl the NetLabel handle
- * @param version the protocol version
+ * Call a protocol dump callback for a PROTOCOLS message
+ * @param nl_hdr the netlink message
+ * @param arg the dump state
  *
- * Request the NetLabel protocol version from the kernel and return the result
- * to the caller.  If @hndl is NULL then the function will handle opening and
- * closing it's own NetLabel handle.  Returns zero on success, negative values
- * on failure.
+ * Decode the protocol in @nl_hdr and pass it to the caller's callback.
+ * Returns the value returned by the callback on success, negative values on
+ * failure.
  *
  */
-int nlbl_mgmt_version(struct nlbl_handle *hndl, uint32_t *version)
+static int nlbl_mgmt_protocols_walk_msg(struct nlmsghdr *nl_hdr, void *arg)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	nlbl_msg *msg = NULL;
-	nlbl_msg *ans_msg = NULL;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla;
-
-	/* sanity checks */
-	if (version == NULL)
-		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
-		return -ENOPROTOOPT;
-
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto version_return;
-	}
-
-	/* create a new message */
-	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_VERSION, 0);
-	if (msg == NULL)
-		goto version_return;
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc == 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto version_return;
-	}
+	int rc;
+	struct nlbl_mgmt_walk_arg *walk = arg;
+	nlbl_proto protocol;
 
-	/* read the response */
-	rc = nlbl_mgmt_recv(p_hndl, &ans_msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto version_return;
-	}
+	rc = nlbl_mgmt_protocols_decode(nl_hdr, &protocol);
+	if (rc < 0)
+		return rc;
+	walk->count++;
 
-	/* check the response */
-	rc = nlbl_mgmt_parse_ack(ans_msg);
-	if (rc < 0 && rc != -ENOMSG)
-		goto version_return;
-	genl_hdr = nlbl_msg_genlhdr(ans_msg);
-	if (genl_hdr == NULL || genl_hdr->cmd != NLBL_MGMT_C_VERSION) {
-		rc = -EBADMSG;
-		goto version_return;
-	}
+	return walk->cb.proto(protocol, walk->cb_arg);
+}
 
-	/* process the response */
-	nla = nlbl_attr_find(ans_msg, NLBL_MGMT_A_VERSION);
-	if (nla == NULL) {
-		rc = -EBADMSG;
-		goto version_return;
-	}
-	*version = nla_get_u32(nla);
+/**
+ * Call a domain mapping dump callback for a LISTALL message
+ * @param nl_hdr the netlink message
+ * @param arg the dump state
+ *
+ * Decode the domain mapping in @nl_hdr and pass it to the caller's callback,
+ * freeing it once the callback returns.  Returns the value returned by the
+ * callback on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_listall_walk_msg(struct nlmsghdr *nl_hdr, void *arg)
+{
+	int rc;
+	struct nlbl_mgmt_walk_arg *walk = arg;
+	struct nlbl_dommap domain;
 
-	rc = 0;
+	rc = nlbl_mgmt_dommap_decode(nl_hdr, NLBL_MGMT_C_LISTALL, &domain);
+	if (rc < 0)
+		return rc;
+	walk->count++;
 
-version_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	nlbl_msg_free(msg);
-	nlbl_msg_free(ans_msg);
+	rc = walk->cb.dommap(&domain, walk->cb_arg);
+	nlbl_mgmt_dommap_release(&domain);
 	return rc;
 }
 
 /**
- * Add a domain mapping to the NetLabel system
- * @param hndl the NetLabel handle
- * @param domain the NetLabel domain map
- * @param addr the network IP address
+ * Append a protocol to a protocol array
+ * @param protocol the protocol
+ * @param arg the protocol array
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_protocols_append(nlbl_proto protocol, void *arg)
+{
+	struct nlbl_mgmt_protocols_array *protos = arg;
+	nlbl_proto *array_new;
+
+	array_new = nlbl_array_grow(protos->array,
+				    protos->count, sizeof(*array_new));
+	if (array_new == NULL)
+		return -ENOMEM;
+	protos->array = array_new;
+	protos->array[protos->count++] = protocol;
+
+	return 0;
+}
+
+/**
+ * Append a domain mapping to a domain mapping array
+ * @param domain the domain mapping
+ * @param arg the domain mapping array
+ *
+ * Move the domain mapping in @domain to the end of the array, leaving @domain
+ * empty.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_listall_append(struct nlbl_dommap *domain, void *arg)
+{
+	struct nlbl_mgmt_dommap_array *dmns = arg;
+	struct nlbl_dommap *array_new;
+
+	array_new = nlbl_array_grow(dmns->array,
+				    dmns->count, sizeof(*array_new));
+	if (array_new == NULL)
+		return -ENOMEM;
+	dmns->array = array_new;
+	dmns->array[dmns->count++] = *domain;
+	memset(domain, 0, sizeof(*domain));
+
+	return 0;
+}
+
+/**
+ * Add a domain mapping from a LISTALL message to a list under construction
+ * @param nl_hdr the netlink message
+ * @param arg the list under construction
+ *
+ * Decode the domain mapping in @nl_hdr straight into the arrays of the list
+ * under construction, without allocating anything for the mapping itself.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_list_build_msg(struct nlmsghdr *nl_hdr, void *arg)
+{
+	int rc;
+	struct nlbl_mgmt_list_build *bld = arg;
+	struct nlbl_mgmt_list_dom *dom;
+	struct nlbl_dommap_addr *addr;
+	struct nlattr *tb[NLBL_MGMT_A_MAX + 1];
+	struct nlattr *nla_a;
+	int nla_a_rem;
+	const char *name;
+	size_t name_len;
+	char *strs_new;
+
+	rc = nlbl_attr_parse(nl_hdr, NLBL_MGMT_C_LISTALL,
+			     tb, NLBL_MGMT_A_MAX, nlbl_mgmt_policy);
+	if (rc < 0)
+		return rc;
+	if (tb[NLBL_MGMT_A_DOMAIN] == NULL)
+		return -EBADMSG;
+
+	dom = nlbl_array_grow(bld->doms, bld->dom_count, sizeof(*dom));
+	if (dom == NULL)
+		return -ENOMEM;
+	bld->doms = dom;
+	dom = &bld->doms[bld->dom_count];
+	memset(dom, 0, sizeof(*dom));
+
+	/* domain string */
+	name = nla_data(tb[NLBL_MGMT_A_DOMAIN]);
+	name_len = strlen(name) + 1;
+	if (bld->strs_len + name_len > bld->strs_size) {
+		size_t size = (bld->strs_size > 0 ? bld->strs_size : 256);
+
+		while (bld->strs_len + name_len > size)
+			size *= 2;
+		strs_new = realloc(bld->strs, size);
+		if (strs_new == NULL)
+			return -ENOMEM;
+		bld->strs = strs_new;
+		bld->strs_size = size;
+	}
+	memcpy(&bld->strs[bld->strs_len], name, name_len);
+	dom->domain = bld->strs_len;
+
+	if (tb[NLBL_MGMT_A_PROTOCOL] != NULL) {
+		dom->proto_type = nla_get_u32(tb[NLBL_MGMT_A_PROTOCOL]);
+		if (dom->proto_type == NETLBL_NLTYPE_CIPSOV4) {
+			if (tb[NLBL_MGMT_A_CV4DOI] == NULL)
+				return -EBADMSG;
+			dom->cv4_doi = nla_get_u32(tb[NLBL_MGMT_A_CV4DOI]);
+		}
+	} else if (tb[NLBL_MGMT_A_SELECTORLIST] != NULL) {
+		dom->proto_type = NETLBL_NLTYPE_ADDRSELECT;
+		dom->addr_first = bld->addr_count;
+		nla_for_each_attr(nla_a,
+				  nla_data(tb[NLBL_MGMT_A_SELECTORLIST]),
+				  nla_len(tb[NLBL_MGMT_A_SELECTORLIST]),
+				  nla_a_rem)
+		if (nla_a->nla_type == NLBL_MGMT_A_ADDRSELECTOR) {
+			addr = nlbl_array_grow(bld->addrs, bld->addr_count,
+					       sizeof(*addr));
+			if (addr == NULL)
+				return -ENOMEM;
+			bld->addrs = addr;
+			addr = &bld->addrs[bld->addr_count];
+			memset(addr, 0, sizeof(*addr));
+			rc = nlbl_mgmt_addr_decode(nla_a, addr);
+			if (rc < 0)
+				return rc;
+			bld->addr_count++;
+			dom->addr_count++;
+		}
+	} else
+		return -EBADMSG;
+
+	bld->strs_len += name_len;
+	bld->dom_count++;
+	return 0;
+}
+
+/**
+ * Finish a domain mapping list
+ * @param bld the list under construction
+ *
+ * Copy the list under construction into a single block of memory, turning the
+ * indices into pointers, and free the construction arrays.  Returns a pointer
+ * to the list on success, NULL on failure.
+ *
+ */
+static struct nlbl_dommap_list *nlbl_mgmt_list_finish(
+					struct nlbl_mgmt_list_build *bld)
+{
+	size_t iter_a;
+	size_t iter_b;
+	struct nlbl_dommap_list *list;
+	struct nlbl_dommap *domain;
+	struct nlbl_dommap_addr *addr;
+	struct nlbl_mgmt_list_dom *dom;
+	char *strs;
+
+	list = malloc(sizeof(*list) +
+		      bld->dom_count * sizeof(*list->domains) +
+		      bld->addr_count * sizeof(*list->addrs) +
+		      bld->strs_len);
+	if (list == NULL)
+		goto finish_return;
+	list->count = bld->dom_count;
+	list->domains = (struct nlbl_dommap *)(list + 1);
+	list->addr_count = bld->addr_count;
+	list->addrs = (struct nlbl_dommap_addr *)
+		&list->domains[list->count];
+	strs = (char *)&list->addrs[list->addr_count];
+	if (bld->strs_len > 0)
+		memcpy(strs, bld->strs, bld->strs_len);
+	if (bld->addr_count > 0)
+		memcpy(list->addrs, bld->addrs,
+		       bld->addr_count * sizeof(*list->addrs));
+
+	for (iter_a = 0; iter_a < list->count; iter_a++) {
+		dom = &bld->doms[iter_a];
+		domain = &list->domains[iter_a];
+		memset(domain, 0, sizeof(*domain));
+		domain->domain = &strs[dom->domain];
+		domain->proto_type = dom->proto_type;
+		switch (dom->proto_type) {
+		case NETLBL_NLTYPE_CIPSOV4:
+			domain->proto.cv4_doi = dom->cv4_doi;
+			break;
+		case NETLBL_NLTYPE_ADDRSELECT:
+			addr = &list->addrs[dom->addr_first];
+			domain->proto.addrsel = (dom->addr_count > 0 ?
+						 addr : NULL);
+			for (iter_b = 0; iter_b < dom->addr_count; iter_b++)
+				addr[iter_b].next = (iter_b + 1 <
+						     dom->addr_count ?
+						     &addr[iter_b + 1] : NULL);
+			break;
+		}
+	}
+
+finish_return:
+	free(bld->doms);
+	free(bld->addrs);
+	free(bld->strs);
+	memset(bld, 0, sizeof(*bld));
+	return list;
+}
+
+/*
+ * NetLabel operations
+ */
+
+/**
+ * Determine the supported list of NetLabel protocols
+ * @param hndl the NetLabel handle
+ * @param protocols protocol array
+ *
+ * Query the NetLabel subsystem and return the supported protocols in
+ * @protocols.  If @hndl is NULL then the function will handle opening and
+ * closing it's own NetLabel handle.  Returns the number of protocols on
+ * success, zero if no protocols are supported, and negative values on failure.
+ *
+ */
+int nlbl_mgmt_protocols(struct nlbl_handle *hndl, nlbl_proto **protocols)
+{
+	int rc;
+	struct nlbl_mgmt_protocols_array protos;
+
+	/* sanity checks */
+	if (protocols == NULL)
+		return -EINVAL;
+
+	memset(&protos, 0, sizeof(protos));
+	rc = nlbl_mgmt_protocols_walk(hndl,
+				      nlbl_mgmt_protocols_append, &protos);
+	if (rc < 0) {
+		if (protos.array != NULL)
+			free(protos.array);
+		return rc;
+	}
+
+	*protocols = protos.array;
+	return protos.count;
+}
+
+/**
+ * Walk the supported list of NetLabel protocols
+ * @param hndl the NetLabel handle
+ * @param cb the per-protocol callback
+ * @param arg the callback argument
+ *
+ * Query the NetLabel subsystem and call @cb for each supported protocol as it
+ * is received.  If @cb returns a positive value the walk stops early, if it
+ * returns a negative value the walk is aborted and the value is returned.  If
+ * @hndl is NULL then the function will handle opening and closing it's own
+ * NetLabel handle.  Returns the number of protocols passed to @cb on success,
+ * negative values on failure.
+ *
+ */
+int nlbl_mgmt_protocols_walk(struct nlbl_handle *hndl,
+			     nlbl_proto_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg;
+	struct nlbl_mgmt_walk_arg walk;
+
+	/* sanity checks */
+	if (cb == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* create a new message */
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_PROTOCOLS, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+
+	/* perform the dump */
+	walk.cb.proto = cb;
+	walk.cb_arg = arg;
+	walk.count = 0;
+	rc = nlbl_comm_dump(hndl, msg, nlbl_mgmt_protocols_walk_msg, &walk);
+	nlbl_msg_free(msg);
+	if (rc < 0)
+		return rc;
+
+	return walk.count;
+}
+
+/**
+ * Determine the kernel's NetLabel protocol version
+ * @param hndl the NetLabel handle
+ * @param version the protocol version
+ *
+ * Request the NetLabel protocol version from the kernel and return the result
+ * to the caller.  If @hndl is NULL then the function will handle opening and
+ * closing it's own NetLabel handle.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+int nlbl_mgmt_version(struct nlbl_handle *hndl, uint32_t *version)
+{
+	int rc = -ENOMEM;
+	struct nlbl_handle *p_hndl = hndl;
+	nlbl_msg *msg = NULL;
+	nlbl_msg *ans_msg = NULL;
+
+	/* sanity checks */
+	if (version == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto version_return;
+	}
+
+	/* create a new message */
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_VERSION, 0);
+	if (msg == NULL)
+		goto version_return;
+
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto version_return;
+	}
+
+	/* read the response */
+	rc = nlbl_mgmt_recv(p_hndl, &ans_msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto version_return;
+	}
+
+	/* check the response */
+	rc = nlbl_mgmt_parse_ack(ans_msg);
+	if (rc < 0 && rc != -ENOMSG)
+		goto version_return;
+
+	/* process the response */
+	rc = nlbl_mgmt_version_decode(nlbl_msg_nlhdr(ans_msg), version);
+
+version_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	nlbl_msg_free(msg);
+	nlbl_msg_free(ans_msg);
+	return rc;
+}
+
+/**
+ * Add a domain mapping to the NetLabel system
+ * @param hndl the NetLabel handle
+ * @param domain the NetLabel domain map
+ * @param addr the network IP address
  *
  * Add the domain mapping in @domain to the NetLabel system.  If @hndl is NULL
  * then the function will handle opening and closing it's own NetLabel handle.
@@ -506,75 +998,20 @@ int nlbl_mgmt_add(struct nlbl_handle *hndl,
 	/* sanity checks */
 	if (domain == NULL || domain->domain == NULL)
 		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
+	if (nlbl_mgmt_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto add_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_ADD, 0);
-	if (msg == NULL)
-		goto add_return;
-
-	/* add the required attributes to the message */
-	rc = nla_put_string(msg, NLBL_MGMT_A_DOMAIN, domain->domain);
-	if (rc != 0)
-		goto add_return;
-	rc = nla_put_u32(msg, NLBL_MGMT_A_PROTOCOL, domain->proto_type);
-	if (rc != 0)
-		goto add_return;
-	switch (domain->proto_type) {
-	case NETLBL_NLTYPE_CIPSOV4:
-		rc = nla_put_u32(msg,
-				 NLBL_MGMT_A_CV4DOI,
-				 domain->proto.cv4_doi);
-		if (rc != 0)
-			goto add_return;
-		break;
-	}
-
-	/* optional attributes */
-	switch (addr->type) {
-	case AF_INET:
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV4ADDR,
-			     sizeof(struct in_addr),
-			     &addr->addr.v4);
-		if (rc != 0)
-			goto add_return;
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV4MASK,
-			     sizeof(struct in_addr),
-			     &addr->mask.v4);
-		if (rc != 0)
-			goto add_return;
-		break;
-	case AF_INET6:
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV6ADDR,
-			     sizeof(struct in6_addr),
-			     &addr->addr.v6);
-		if (rc != 0)
-			goto add_return;
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV6MASK,
-			     sizeof(struct in6_addr),
-			     &addr->mask.v6);
-		if (rc != 0)
-			goto add_return;
-		break;
-	case 0:
-		rc = 0;
-		break;
-	default:
-		rc = -EINVAL;
+	rc = nlbl_mgmt_add_msg(NLBL_MGMT_C_ADD, domain, addr, &msg);
+	if (rc < 0)
 		goto add_return;
-	}
 
 	/* send the request */
 	rc = nlbl_comm_send(p_hndl, msg);
@@ -597,7 +1034,7 @@ int nlbl_mgmt_add(struct nlbl_handle *hndl,
 
 add_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -627,78 +1064,26 @@ int nlbl_mgmt_adddef(struct nlbl_handle *hndl,
 	/* sanity checks */
 	if (domain == NULL)
 		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
+	if (nlbl_mgmt_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto adddef_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_ADDDEF, 0);
-	if (msg == NULL)
+	rc = nlbl_mgmt_add_msg(NLBL_MGMT_C_ADDDEF, domain, addr, &msg);
+	if (rc < 0)
 		goto adddef_return;
 
-	/* add the required attributes to the message */
-	rc = nla_put_u32(msg, NLBL_MGMT_A_PROTOCOL, domain->proto_type);
-	if (rc != 0)
-		goto adddef_return;
-	switch (domain->proto_type) {
-	case NETLBL_NLTYPE_CIPSOV4:
-		rc = nla_put_u32(msg,
-				 NLBL_MGMT_A_CV4DOI,
-				 domain->proto.cv4_doi);
-		if (rc != 0)
-			goto adddef_return;
-		break;
-	}
-
-	/* optional attributes */
-	switch (addr->type) {
-	case AF_INET:
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV4ADDR,
-			     sizeof(struct in_addr),
-			     &addr->addr.v4);
-		if (rc != 0)
-			goto adddef_return;
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV4MASK,
-			     sizeof(struct in_addr),
-			     &addr->mask.v4);
-		if (rc != 0)
-			goto adddef_return;
-		break;
-	case AF_INET6:
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV6ADDR,
-			     sizeof(struct in6_addr),
-			     &addr->addr.v6);
-		if (rc != 0)
-			goto adddef_return;
-		rc = nla_put(msg,
-			     NLBL_MGMT_A_IPV6MASK,
-			     sizeof(struct in6_addr),
-			     &addr->mask.v6);
-		if (rc != 0)
-			goto adddef_return;
-		break;
-	case 0:
-		rc = 0;
-		break;
-	default:
-		rc = -EINVAL;
-		goto adddef_return;
-	}
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
 		goto adddef_return;
 	}
 
@@ -715,7 +1100,7 @@ int nlbl_mgmt_adddef(struct nlbl_handle *hndl,
 
 adddef_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -741,24 +1126,19 @@ int nlbl_mgmt_del(struct nlbl_handle *hndl, char *domain)
 	/* sanity checks */
 	if (domain == NULL)
 		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
+	if (nlbl_mgmt_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto del_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_REMOVE, 0);
-	if (msg == NULL)
-		goto del_return;
-
-	/* add the required attributes to the message */
-	rc = nla_put_string(msg, NLBL_MGMT_A_DOMAIN, domain);
-	if (rc != 0)
+	rc = nlbl_mgmt_del_msg(domain, &msg);
+	if (rc < 0)
 		goto del_return;
 
 	/* send the request */
@@ -782,7 +1162,7 @@ int nlbl_mgmt_del(struct nlbl_handle *hndl, char *domain)
 
 del_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -805,19 +1185,19 @@ int nlbl_mgmt_deldef(struct nlbl_handle *hndl)
 	nlbl_msg *ans_msg = NULL;
 
 	/* sanity checks */
-	if (nlbl_mgmt_fid == 0)
+	if (nlbl_mgmt_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto deldef_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_REMOVEDEF, 0);
-	if (msg == NULL)
+	rc = nlbl_mgmt_del_msg(NULL, &msg);
+	if (rc < 0)
 		goto deldef_return;
 
 	/* send the request */
@@ -841,7 +1221,7 @@ int nlbl_mgmt_deldef(struct nlbl_handle *hndl)
 
 deldef_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -864,18 +1244,16 @@ int nlbl_mgmt_listdef(struct nlbl_handle *hndl, struct nlbl_dommap *domain)
 	struct nlbl_handle *p_hndl = hndl;
 	nlbl_msg *msg = NULL;
 	nlbl_msg *ans_msg = NULL;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla;
 
 	/* sanity checks */
 	if (domain == NULL)
 		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
+	if (nlbl_mgmt_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto listdef_return;
 	}
@@ -905,38 +1283,14 @@ int nlbl_mgmt_listdef(struct nlbl_handle *hndl, struct nlbl_dommap *domain)
 	rc = nlbl_mgmt_parse_ack(ans_msg);
 	if (rc < 0 && rc != -ENOMSG)
 		goto listdef_return;
-	genl_hdr = nlbl_msg_genlhdr(ans_msg);
-	if (genl_hdr == NULL || genl_hdr->cmd != NLBL_MGMT_C_LISTDEF) {
-		rc = -EBADMSG;
-		goto listdef_return;
-	}
 
 	/* process the response */
-	genl_hdr = nlbl_msg_genlhdr(ans_msg);
-	if (genl_hdr == NULL || genl_hdr->cmd != NLBL_MGMT_C_LISTDEF)
-		goto listdef_return;
-	nla = nlbl_attr_find(ans_msg, NLBL_MGMT_A_PROTOCOL);
-	if (nla != NULL) {
-		domain->proto_type = nla_get_u32(nla);
-		switch (domain->proto_type) {
-		case NETLBL_NLTYPE_CIPSOV4:
-			nla = nlbl_attr_find(ans_msg, NLBL_MGMT_A_CV4DOI);
-			if (nla == NULL)
-				goto listdef_return;
-			domain->proto.cv4_doi = nla_get_u32(nla);
-			break;
-		}
-	} else if ((nla = nlbl_attr_find(ans_msg, NLBL_MGMT_A_SELECTORLIST))) {
-		if (nlbl_mgmt_list_addr(nla, domain) != 0)
-			goto listdef_return;
-	} else
-		goto listdef_return;
-
-	rc = 0;
+	rc = nlbl_mgmt_dommap_decode(nlbl_msg_nlhdr(ans_msg),
+				     NLBL_MGMT_C_LISTDEF, domain);
 
 listdef_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -955,160 +1309,641 @@ listdef_return:
  */
 int nlbl_mgmt_listall(struct nlbl_handle *hndl, struct nlbl_dommap **domains)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	unsigned char *data = NULL;
-	nlbl_msg *msg = NULL;
-	struct nlmsghdr *nl_hdr;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla_head;
-	struct nlattr *nla;
-	int data_len;
-	int data_attrlen;
-	struct nlbl_dommap *dmns = NULL, *dmns_new;
-	uint32_t dmns_count = 0;
+	int rc;
+	struct nlbl_mgmt_dommap_array dmns;
 
 	/* sanity checks */
 	if (domains == NULL)
 		return -EINVAL;
-	if (nlbl_mgmt_fid == 0)
-		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto listall_return;
+	memset(&dmns, 0, sizeof(dmns));
+	rc = nlbl_mgmt_listall_walk(hndl, nlbl_mgmt_listall_append, &dmns);
+	if (rc < 0) {
+		while (dmns.count > 0)
+			nlbl_mgmt_dommap_release(&dmns.array[--dmns.count]);
+		if (dmns.array != NULL)
+			free(dmns.array);
+		return rc;
 	}
 
+	*domains = dmns.array;
+	return dmns.count;
+}
+
+/**
+ * Walk all of the configured NetLabel domain mappings
+ * @param hndl the NetLabel handle
+ * @param cb the per-mapping callback
+ * @param arg the callback argument
+ *
+ * Query the NetLabel subsystem and call @cb for each configured domain mapping
+ * as it is received, the mapping is only valid until @cb returns.  If @cb
+ * returns a positive value the walk stops early, if it returns a negative
+ * value the walk is aborted and the value is returned.  If @hndl is NULL then
+ * the function will handle opening and closing it's own NetLabel handle.
+ * Returns the number of mappings passed to @cb on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_mgmt_listall_walk(struct nlbl_handle *hndl,
+			   nlbl_dommap_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg;
+	struct nlbl_mgmt_walk_arg walk;
+
+	/* sanity checks */
+	if (cb == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
 	/* create a new message */
 	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_LISTALL, NLM_F_DUMP);
-	if (msg == NULL) {
-		rc = -ENOMEM;
-		goto listall_return;
-	}
+	if (msg == NULL)
+		return -ENOMEM;
 
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto listall_return;
-	}
+	/* perform the dump */
+	walk.cb.dommap = cb;
+	walk.cb_arg = arg;
+	walk.count = 0;
+	rc = nlbl_comm_dump(hndl, msg, nlbl_mgmt_listall_walk_msg, &walk);
+	nlbl_msg_free(msg);
+	if (rc < 0)
+		return rc;
 
-	/* read all of the messages (multi-message response) */
-	do {
-		if (data != NULL) {
-			free(data);
-			data = NULL;
-		}
+	return walk.count;
+}
 
-		/* get the next set of messages */
-		rc = nlbl_comm_recv_raw(p_hndl, &data);
-		if (rc <= 0) {
-			if (rc == 0)
-				rc = -ENODATA;
-			goto listall_return;
-		}
-		data_len = rc;
-		nl_hdr = (struct nlmsghdr *)data;
-
-		/* check to see if this is a netlink control message we don't
-		 * care about */
-		if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
-		    nl_hdr->nlmsg_type == NLMSG_ERROR ||
-		    nl_hdr->nlmsg_type == NLMSG_OVERRUN) {
-			rc = -EBADMSG;
-			goto listall_return;
-		}
+/**
+ * List all of the configured NetLabel domain mappings in a single block
+ * @param hndl the NetLabel handle
+ * @param list the domain mapping list
+ *
+ * Query the NetLabel subsystem and return the configured domain mappings in
+ * @list, which holds the mappings, their address selectors and their domain
+ * strings in one block of memory that is freed with nlbl_dommap_list_free().
+ * Each mapping's address selectors are adjacent in @list->addrs.  If @hndl is
+ * NULL then the function will handle opening and closing it's own NetLabel
+ * handle.  Returns the number of domains on success, zero if no domains are
+ * specified, and negative values on failure.
+ *
+ */
+int nlbl_mgmt_listall_list(struct nlbl_handle *hndl,
+			   struct nlbl_dommap_list **list)
+{
+	int rc;
+	nlbl_msg *msg;
+	struct nlbl_mgmt_list_build bld;
 
-		/* loop through the messages */
-		while (nlmsg_ok(nl_hdr, data_len) &&
-		       nl_hdr->nlmsg_type != NLMSG_DONE) {
-			/* get the header pointers */
-			genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
-			if (genl_hdr == NULL ||
-			    genl_hdr->cmd != NLBL_MGMT_C_LISTALL) {
-				rc = -EBADMSG;
-				goto listall_return;
-			}
-			nla_head = (struct nlattr *)(&genl_hdr[1]);
-			data_attrlen = genlmsg_attrlen(genl_hdr, 0);
-
-			/* resize the array */
-			dmns_new = realloc(dmns,
-					   sizeof(*dmns) * (dmns_count + 1));
-			if (dmns_new == NULL)
-				goto listall_return;
-			dmns = dmns_new;
-			memset(&dmns[dmns_count], 0, sizeof(*dmns));
-
-			/* get the attribute information */
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_MGMT_A_DOMAIN);
-			if (nla == NULL)
-				goto listall_return;
-			dmns[dmns_count].domain = malloc(nla_len(nla));
-			if (dmns[dmns_count].domain == NULL)
-				goto listall_return;
-			strncpy(dmns[dmns_count].domain, nla_data(nla),
-				nla_len(nla));
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_MGMT_A_PROTOCOL);
-			if (nla != NULL) {
-				dmns[dmns_count].proto_type = nla_get_u32(nla);
-				switch (dmns[dmns_count].proto_type) {
-				case NETLBL_NLTYPE_CIPSOV4:
-					nla = nla_find(nla_head,
-						       data_attrlen,
-						       NLBL_MGMT_A_CV4DOI);
-					if (nla == NULL)
-						goto listall_return;
-					dmns[dmns_count].proto.cv4_doi =
-						nla_get_u32(nla);
-					break;
-				}
-			} else if ((nla = nla_find(nla_head, data_attrlen,
-						   NLBL_MGMT_A_SELECTORLIST))) {
-				if (nlbl_mgmt_list_addr(nla,
-							&dmns[dmns_count]) != 0)
-					goto listall_return;
-			} else
-				goto listall_return;
-
-			dmns_count++;
-
-			/* next message */
-			nl_hdr = nlmsg_next(nl_hdr, &data_len);
-		}
-	} while (NL_MULTI_CONTINUE(nl_hdr));
-
-	*domains = dmns;
-	rc = dmns_count;
-
-listall_return:
-	if (rc < 0 && dmns) {
-		do {
-			if (dmns[dmns_count].domain) {
-				free(dmns[dmns_count].domain);
-				if (dmns[dmns_count].proto_type ==
-				    NETLBL_NLTYPE_ADDRSELECT) {
-					struct nlbl_dommap_addr *iter, *prev;
-					iter = dmns[dmns_count].proto.addrsel;
-					while (iter) {
-						prev = iter;
-						iter = iter->next;
-						free(prev);
-					}
-				}
-			}
-		} while (dmns_count-- > 0);
-		free(dmns);
-	}
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	if (data)
-		free(data);
+	/* sanity checks */
+	if (list == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	/* create a new message */
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_LISTALL, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+
+	/* perform the dump */
+	memset(&bld, 0, sizeof(bld));
+	rc = nlbl_comm_dump(hndl, msg, nlbl_mgmt_list_build_msg, &bld);
 	nlbl_msg_free(msg);
-	return rc;
+	if (rc < 0) {
+		free(bld.doms);
+		free(bld.addrs);
+		free(bld.strs);
+		return rc;
+	}
+
+	*list = nlbl_mgmt_list_finish(&bld);
+	if (*list == NULL)
+		return -ENOMEM;
+	return (*list)->count;
+}
+
+/**
+ * Free a domain mapping list
+ * @param list the domain mapping list
+ *
+ * Free the domain mapping list returned by nlbl_mgmt_listall_list(), along
+ * with all of its mappings, address selectors and domain strings.
+ *
+ */
+void nlbl_dommap_list_free(struct nlbl_dommap_list *list)
+{
+	free(list);
+}
+
+/*
+ * NetLabel batch operations
+ */
+
+/**
+ * Queue a domain mapping addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param domain the NetLabel domain map
+ * @param addr the network IP address
+ *
+ * Queue a request to add the domain mapping in @domain to the NetLabel
+ * system, see nlbl_mgmt_add().  Returns the index of the request within the
+ * batch on success, negative values on failure.
+ *
+ */
+int nlbl_batch_mgmt_add(struct nlbl_batch *batch,
+			struct nlbl_dommap *domain,
+			struct nlbl_netaddr *addr)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || domain == NULL || domain->domain == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_add_msg(NLBL_MGMT_C_ADD, domain, addr, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a default domain mapping addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param domain the NetLabel domain map
+ * @param addr the network IP address
+ *
+ * Queue a request to add the domain mapping in @domain to the NetLabel
+ * system as the default mapping, see nlbl_mgmt_adddef().  Returns the index of
+ * the request within the batch on success, negative values on failure.
+ *
+ */
+int nlbl_batch_mgmt_adddef(struct nlbl_batch *batch,
+			   struct nlbl_dommap *domain,
+			   struct nlbl_netaddr *addr)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || domain == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_add_msg(NLBL_MGMT_C_ADDDEF, domain, addr, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a domain mapping removal in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param domain the domain
+ *
+ * Queue a request to remove the domain mapping specified by @domain, see
+ * nlbl_mgmt_del().  Returns the index of the request within the batch on
+ * success, negative values on failure.
+ *
+ */
+int nlbl_batch_mgmt_del(struct nlbl_batch *batch, char *domain)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || domain == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_del_msg(domain, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a default domain mapping removal in a NetLabel batch
+ * @param batch the NetLabel batch
+ *
+ * Queue a request to remove the default domain mapping, see
+ * nlbl_mgmt_deldef().  Returns the index of the request within the batch on
+ * success, negative values on failure.
+ *
+ */
+int nlbl_batch_mgmt_deldef(struct nlbl_batch *batch)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_del_msg(NULL, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/*
+ * NetLabel asynchronous operations
+ */
+
+/**
+ * Decode a PROTOCOLS message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Append the protocol in @nl_hdr to the protocol array in @res.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_async_protocols_decode(struct nlmsghdr *nl_hdr,
+					    struct nlbl_async_result *res)
+{
+	nlbl_proto *protos_new;
+
+	protos_new = nlbl_array_grow(res->data.protocols,
+				     res->count, sizeof(*protos_new));
+	if (protos_new == NULL)
+		return -ENOMEM;
+	res->data.protocols = protos_new;
+
+	if (nlbl_mgmt_protocols_decode(nl_hdr, &protos_new[res->count]) < 0)
+		return -EBADMSG;
+	res->count++;
+
+	return 0;
+}
+
+/**
+ * Free a PROTOCOLS asynchronous result
+ * @param res the asynchronous result
+ *
+ * Free the protocol array in @res.
+ *
+ */
+static void nlbl_mgmt_async_protocols_release(struct nlbl_async_result *res)
+{
+	if (res->data.protocols != NULL)
+		free(res->data.protocols);
+}
+
+/**
+ * Decode a VERSION message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Decode the protocol version in @nl_hdr into @res.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int nlbl_mgmt_async_version_decode(struct nlmsghdr *nl_hdr,
+					  struct nlbl_async_result *res)
+{
+	return nlbl_mgmt_version_decode(nl_hdr, &res->data.version);
+}
+
+/**
+ * Decode a LISTALL message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Append the domain mapping in @nl_hdr to the domain mapping array in @res.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_async_listall_decode(struct nlmsghdr *nl_hdr,
+					  struct nlbl_async_result *res)
+{
+	int rc;
+	struct nlbl_dommap *dmns_new;
+
+	dmns_new = nlbl_array_grow(res->data.domains,
+				   res->count, sizeof(*dmns_new));
+	if (dmns_new == NULL)
+		return -ENOMEM;
+	res->data.domains = dmns_new;
+
+	rc = nlbl_mgmt_dommap_decode(nl_hdr, NLBL_MGMT_C_LISTALL,
+				     &dmns_new[res->count]);
+	if (rc < 0)
+		return rc;
+	res->count++;
+
+	return 0;
+}
+
+/**
+ * Free a LISTALL asynchronous result
+ * @param res the asynchronous result
+ *
+ * Free the domain mapping array in @res.
+ *
+ */
+static void nlbl_mgmt_async_listall_release(struct nlbl_async_result *res)
+{
+	size_t iter;
+
+	if (res->data.domains == NULL)
+		return;
+	for (iter = 0; iter < res->count; iter++)
+		nlbl_mgmt_dommap_release(&res->data.domains[iter]);
+	free(res->data.domains);
+}
+
+/**
+ * Decode a LISTDEF message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Decode the default domain mapping in @nl_hdr into @res.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_async_listdef_decode(struct nlmsghdr *nl_hdr,
+					  struct nlbl_async_result *res)
+{
+	return nlbl_mgmt_dommap_decode(nl_hdr,
+				       NLBL_MGMT_C_LISTDEF, &res->data.domain);
+}
+
+/**
+ * Free a LISTDEF asynchronous result
+ * @param res the asynchronous result
+ *
+ * Free the default domain mapping in @res.
+ *
+ */
+static void nlbl_mgmt_async_listdef_release(struct nlbl_async_result *res)
+{
+	nlbl_mgmt_dommap_release(&res->data.domain);
+}
+
+static const struct nlbl_async_ops nlbl_mgmt_async_protocols_ops = {
+	.decode = nlbl_mgmt_async_protocols_decode,
+	.release = nlbl_mgmt_async_protocols_release,
+};
+
+static const struct nlbl_async_ops nlbl_mgmt_async_version_ops = {
+	.decode = nlbl_mgmt_async_version_decode,
+	.release = NULL,
+};
+
+static const struct nlbl_async_ops nlbl_mgmt_async_listall_ops = {
+	.decode = nlbl_mgmt_async_listall_decode,
+	.release = nlbl_mgmt_async_listall_release,
+};
+
+static const struct nlbl_async_ops nlbl_mgmt_async_listdef_ops = {
+	.decode = nlbl_mgmt_async_listdef_decode,
+	.release = nlbl_mgmt_async_listdef_release,
+};
+
+/**
+ * Determine the kernel's NetLabel protocol version asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the NetLabel protocol version, see nlbl_mgmt_version().
+ * The version is returned in the data.version field of the results.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_version(struct nlbl_async *async,
+			    nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_VERSION, 0);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_mgmt_async_version_ops, cb, arg);
+}
+
+/**
+ * Determine the supported list of NetLabel protocols asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the supported protocols, see nlbl_mgmt_protocols().
+ * The protocols are returned in the data.protocols field of the results.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_protocols(struct nlbl_async *async,
+			      nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_PROTOCOLS, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_mgmt_async_protocols_ops, cb, arg);
+}
+
+/**
+ * Add a domain mapping to the NetLabel system asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param domain the NetLabel domain map
+ * @param addr the network IP address
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add the domain mapping in @domain, see nlbl_mgmt_add().
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_add(struct nlbl_async *async,
+			struct nlbl_dommap *domain,
+			struct nlbl_netaddr *addr,
+			nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || domain == NULL || domain->domain == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_add_msg(NLBL_MGMT_C_ADD, domain, addr, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Add the default domain mapping to the NetLabel system asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param domain the NetLabel domain map
+ * @param addr the network IP address
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add the domain mapping in @domain as the default
+ * mapping, see nlbl_mgmt_adddef().  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+int nlbl_async_mgmt_adddef(struct nlbl_async *async,
+			   struct nlbl_dommap *domain,
+			   struct nlbl_netaddr *addr,
+			   nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || domain == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_add_msg(NLBL_MGMT_C_ADDDEF, domain, addr, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Remove a domain mapping from the NetLabel system asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param domain the domain
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to remove the domain mapping specified by @domain, see
+ * nlbl_mgmt_del().  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_del(struct nlbl_async *async,
+			char *domain,
+			nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || domain == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_del_msg(domain, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Remove the default domain mapping from the NetLabel system asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to remove the default domain mapping, see
+ * nlbl_mgmt_deldef().  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_deldef(struct nlbl_async *async,
+			   nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_mgmt_del_msg(NULL, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * List all of the configured NetLabel domain mappings asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the configured domain mappings, see
+ * nlbl_mgmt_listall().  The mappings are returned in the data.domains field
+ * of the results.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_listall(struct nlbl_async *async,
+			    nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_LISTALL, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_mgmt_async_listall_ops, cb, arg);
+}
+
+/**
+ * List the default NetLabel domain mapping asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the default domain mapping, see nlbl_mgmt_listdef().
+ * The mapping is returned in the data.domain field of the results.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_mgmt_listdef(struct nlbl_async *async,
+			    nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_mgmt_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_mgmt_msg_new(NLBL_MGMT_C_LISTDEF, 0);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_mgmt_async_listdef_ops, cb, arg);
 }
@@ -23,6 +23,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -32,13 +33,55 @@
 
 #include "netlabel_internal.h"
 
-/* Generic Netlink family ID */
-static uint16_t nlbl_unlbl_fid = 0;
+/* NetLabel unlabeled attribute policy */
+static const struct nla_policy nlbl_unlbl_policy[NLBL_UNLABEL_A_MAX + 1] = {
+	[NLBL_UNLABEL_A_ACPTFLG] = { .type = NLA_U8 },
+	[NLBL_UNLABEL_A_IPV6ADDR] = { .minlen = sizeof(struct in6_addr),
+				      .maxlen = sizeof(struct in6_addr) },
+	[NLBL_UNLABEL_A_IPV6MASK] = { .minlen = sizeof(struct in6_addr),
+				      .maxlen = sizeof(struct in6_addr) },
+	[NLBL_UNLABEL_A_IPV4ADDR] = { .minlen = sizeof(struct in_addr),
+				      .maxlen = sizeof(struct in_addr) },
+	[NLBL_UNLABEL_A_IPV4MASK] = { .minlen = sizeof(struct in_addr),
+				      .maxlen = sizeof(struct in_addr) },
+	[NLBL_UNLABEL_A_IFACE] = { .type = NLA_STRING },
+	[NLBL_UNLABEL_A_SECCTX] = { .type = NLA_STRING },
+};
+
+/* NetLabel unlabeled dump state */
+struct nlbl_unlbl_walk_arg {
+	uint8_t command;
+	struct nlbl_strtab *tab;
+	nlbl_addrmap_cb cb;
+	void *cb_arg;
+	int count;
+};
+
+/* NetLabel unlabeled result arrays */
+struct nlbl_unlbl_addrmap_array {
+	struct nlbl_addrmap *array;
+	size_t count;
+};
 
 /*
  * Helper functions
  */
 
+/**
+ * Return the NetLabel unlabeled Generic Netlink family ID
+ *
+ * Returns the family ID, which is resolved the first time it is needed, or
+ * zero if the family can not be resolved.
+ *
+ */
+static uint16_t nlbl_unlbl_fid(void)
+{
+	int rc;
+
+	rc = nlbl_comm_family(NETLBL_NLTYPE_UNLABELED);
+	return (rc > 0 ? rc : 0);
+}
+
 /**
  * Create a new NetLabel unlbl message
  * @param command the NetLabel unlbl command
@@ -64,7 +107,7 @@ static nlbl_msg *nlbl_unlbl_msg_new(uint16_t command, int flags)
 	nl_hdr = nlbl_msg_nlhdr(msg);
 	if (nl_hdr == NULL)
 		goto msg_new_failure;
-	nl_hdr->nlmsg_type = nlbl_unlbl_fid;
+	nl_hdr->nlmsg_type = nlbl_unlbl_fid();
 	nl_hdr->nlmsg_flags = flags;
 
 	/* setup the generic netlink header */
@@ -80,6 +123,118 @@ msg_new_failure:
 	return NULL;
 }
 
+/**
+ * Create a NetLabel unlbl accept message
+ * @param allow_flag the desired accept flag setting
+ * @param msg the new message
+ *
+ * Create a new NLBL_UNLABEL_C_ACCEPT message using @allow_flag.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_accept_msg(uint8_t allow_flag, nlbl_msg **msg)
+{
+	int rc = -ENOMEM;
+	nlbl_msg *new_msg;
+
+	/* create a new message */
+	new_msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_ACCEPT, 0);
+	if (new_msg == NULL)
+		goto accept_msg_failure;
+
+	/* add the required attributes to the message */
+	rc = nla_put_u8(new_msg, NLBL_UNLABEL_A_ACPTFLG, (allow_flag ? 1 : 0));
+	if (rc != 0)
+		goto accept_msg_failure;
+
+	*msg = new_msg;
+	return 0;
+
+accept_msg_failure:
+	nlbl_msg_free(new_msg);
+	return rc;
+}
+
+/**
+ * Create a NetLabel unlbl static label message
+ * @param command the NetLabel unlbl command
+ * @param dev the network interface, NULL for the default
+ * @param addr the network IP address
+ * @param label the security label, NULL for removals
+ * @param msg the new message
+ *
+ * Create a new static label add or remove message using @command; the
+ * interface and label attributes are only included if @dev and @label are
+ * not NULL.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_static_msg(uint16_t command,
+				 nlbl_netdev dev,
+				 struct nlbl_netaddr *addr,
+				 nlbl_secctx label,
+				 nlbl_msg **msg)
+{
+	int rc = -ENOMEM;
+	nlbl_msg *new_msg;
+
+	/* create a new message */
+	new_msg = nlbl_unlbl_msg_new(command, 0);
+	if (new_msg == NULL)
+		goto static_msg_failure;
+
+	/* add the required attributes to the message */
+	if (dev != NULL) {
+		rc = nla_put_string(new_msg, NLBL_UNLABEL_A_IFACE, dev);
+		if (rc != 0)
+			goto static_msg_failure;
+	}
+	if (label != NULL) {
+		rc = nla_put_string(new_msg, NLBL_UNLABEL_A_SECCTX, label);
+		if (rc != 0)
+			goto static_msg_failure;
+	}
+	switch (addr->type) {
+	case AF_INET:
+		rc = nla_put(new_msg,
+			     NLBL_UNLABEL_A_IPV4ADDR,
+			     sizeof(struct in_addr),
+			     &addr->addr.v4);
+		if (rc != 0)
+			goto static_msg_failure;
+		rc = nla_put(new_msg,
+			     NLBL_UNLABEL_A_IPV4MASK,
+			     sizeof(struct in_addr),
+			     &addr->mask.v4);
+		if (rc != 0)
+			goto static_msg_failure;
+		break;
+	case AF_INET6:
+		rc = nla_put(new_msg,
+			     NLBL_UNLABEL_A_IPV6ADDR,
+			     sizeof(struct in6_addr),
+			     &addr->addr.v6);
+		if (rc != 0)
+			goto static_msg_failure;
+		rc = nla_put(new_msg,
+			     NLBL_UNLABEL_A_IPV6MASK,
+			     sizeof(struct in6_addr),
+			     &addr->mask.v6);
+		if (rc != 0)
+			goto static_msg_failure;
+		break;
+	default:
+		rc = -EINVAL;
+		goto static_msg_failure;
+	}
+
+	*msg = new_msg;
+	return 0;
+
+static_msg_failure:
+	nlbl_msg_free(new_msg);
+	return rc;
+}
+
 /**
  * Read a NetLbel unlbl message
  * @param hndl the NetLabel handle
@@ -102,7 +257,7 @@ static int nlbl_unlbl_recv(struct nlbl_handle *hndl, nlbl_msg **msg)
 
 	/* process the response */
 	nl_hdr = nlbl_msg_nlhdr(*msg);
-	if (nl_hdr == NULL || (nl_hdr->nlmsg_type != nlbl_unlbl_fid &&
+	if (nl_hdr == NULL || (nl_hdr->nlmsg_type != nlbl_unlbl_fid() &&
 			       nl_hdr->nlmsg_type != NLMSG_DONE &&
 			       nl_hdr->nlmsg_type != NLMSG_ERROR)) {
 		rc = -EBADMSG;
@@ -135,41 +290,283 @@ static int nlbl_unlbl_parse_ack(nlbl_msg *msg)
 	return nl_err->error;
 }
 
-/*
- * Init functions
+/**
+ * Copy a string from a static label dump
+ * @param tab the interned string table, NULL if the strings are not interned
+ * @param str the string
+ *
+ * Returns the interned copy of @str if @tab is not NULL, otherwise a copy
+ * which must be freed by the caller.  Returns NULL on failure.
+ *
  */
+static char *nlbl_unlbl_strdup(struct nlbl_strtab *tab, const char *str)
+{
+	if (tab != NULL)
+		return (char *)nlbl_strtab_intern(tab, str);
+	return strdup(str);
+}
 
 /**
- * Perform any setup needed
+ * Free the contents of a static label address mapping
+ * @param addr the address mapping entry
+ * @param tab the interned string table, NULL if the strings are not interned
  *
- * Do any setup needed for the unlbl component, including determining the
- * NetLabel unlbl Generic Netlink family ID.  Returns zero on success,
- * negative values on error.
+ * Free the interface and label strings in @addr, unless they belong to @tab,
+ * and reset the entry so that it can be safely reused.
  *
  */
-int nlbl_unlbl_init(void)
+static void nlbl_unlbl_addrmap_release(struct nlbl_addrmap *addr,
+				       struct nlbl_strtab *tab)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *hndl;
+	if (tab == NULL) {
+		if (addr->dev != NULL)
+			free(addr->dev);
+		if (addr->label != NULL)
+			free(addr->label);
+	}
+	memset(addr, 0, sizeof(*addr));
+}
 
-	/* get a netlabel handle */
-	hndl = nlbl_comm_open();
-	if (hndl == NULL)
-		goto init_return;
+/**
+ * Decode a LIST message
+ * @param nl_hdr the netlink message
+ * @param allow_flag the accept flag setting
+ *
+ * Decode the NLBL_UNLABEL_C_LIST message in @nl_hdr and return the accept
+ * flag in @allow_flag.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_list_decode(struct nlmsghdr *nl_hdr, uint8_t *allow_flag)
+{
+	int rc;
+	struct nlattr *tb[NLBL_UNLABEL_A_MAX + 1];
+
+	rc = nlbl_attr_parse(nl_hdr, NLBL_UNLABEL_C_LIST,
+			     tb, NLBL_UNLABEL_A_MAX, nlbl_unlbl_policy);
+	if (rc < 0)
+		return rc;
+
+	if (tb[NLBL_UNLABEL_A_ACPTFLG] == NULL)
+		return -EBADMSG;
+	*allow_flag = nla_get_u8(tb[NLBL_UNLABEL_A_ACPTFLG]);
+
+	return 0;
+}
+
+/**
+ * Decode a STATICLIST or STATICLISTDEF message
+ * @param nl_hdr the netlink message
+ * @param command the NetLabel unlabeled command
+ * @param tab the interned string table, NULL to copy the strings
+ * @param addr the address mapping entry
+ *
+ * Decode the NLBL_UNLABEL_C_STATICLIST or NLBL_UNLABEL_C_STATICLISTDEF message
+ * in @nl_hdr and populate @addr with the information, the interface is only
+ * present in NLBL_UNLABEL_C_STATICLIST messages.  The strings are interned in
+ * @tab if it is not NULL.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int nlbl_unlbl_addrmap_decode(struct nlmsghdr *nl_hdr,
+				     uint8_t command,
+				     struct nlbl_strtab *tab,
+				     struct nlbl_addrmap *addr)
+{
+	int rc;
+	struct nlattr *tb[NLBL_UNLABEL_A_MAX + 1];
 
-	/* resolve the family */
-	rc = genl_ctrl_resolve(hndl->nl_sock,
-			       NETLBL_NLTYPE_UNLABELED_NAME);
+	rc = nlbl_attr_parse(nl_hdr, command,
+			     tb, NLBL_UNLABEL_A_MAX, nlbl_unlbl_policy);
 	if (rc < 0)
-		goto init_return;
-	nlbl_unlbl_fid = rc;
+		return rc;
+	rc = -EBADMSG;
+
+	memset(addr, 0, sizeof(*addr));
+
+	if (command == NLBL_UNLABEL_C_STATICLIST) {
+		if (tb[NLBL_UNLABEL_A_IFACE] == NULL)
+			goto decode_failure;
+		addr->dev = nlbl_unlbl_strdup(tab,
+				nla_data(tb[NLBL_UNLABEL_A_IFACE]));
+		if (addr->dev == NULL) {
+			rc = -ENOMEM;
+			goto decode_failure;
+		}
+	}
+
+	if (tb[NLBL_UNLABEL_A_SECCTX] == NULL)
+		goto decode_failure;
+	addr->label = nlbl_unlbl_strdup(tab,
+					nla_data(tb[NLBL_UNLABEL_A_SECCTX]));
+	if (addr->label == NULL) {
+		rc = -ENOMEM;
+		goto decode_failure;
+	}
+
+	if (tb[NLBL_UNLABEL_A_IPV4ADDR] != NULL) {
+		if (tb[NLBL_UNLABEL_A_IPV4MASK] == NULL)
+			goto decode_failure;
+		memcpy(&addr->addr.addr.v4,
+		       nla_data(tb[NLBL_UNLABEL_A_IPV4ADDR]),
+		       sizeof(struct in_addr));
+		memcpy(&addr->addr.mask.v4,
+		       nla_data(tb[NLBL_UNLABEL_A_IPV4MASK]),
+		       sizeof(struct in_addr));
+		addr->addr.type = AF_INET;
+	} else if (tb[NLBL_UNLABEL_A_IPV6ADDR] != NULL) {
+		if (tb[NLBL_UNLABEL_A_IPV6MASK] == NULL)
+			goto decode_failure;
+		memcpy(&addr->addr.addr.v6,
+		       nla_data(tb[NLBL_UNLABEL_A_IPV6ADDR]),
+		       sizeof(struct in6_addr));
+		memcpy(&addr->addr.mask.v6,
+		       nla_data(tb[NLBL_UNLABEL_A_IPV6MASK]),
+		       sizeof(struct in6_addr));
+		addr->addr.type = AF_INET6;
+	}
+
+	return 0;
+
+decode_failure:
+	nlbl_unlbl_addrmap_release(addr, tab);
+	return rc;
+}
+
+/**
+ * Call an address mapping dump callback for a STATICLIST message
+ * @param nl_hdr the netlink message
+ * @param arg the dump state
+ *
+ * Decode the address mapping in @nl_hdr and pass it to the caller's callback,
+ * freeing it once the callback returns.  Returns the value returned by the
+ * callback on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_staticlist_walk_msg(struct nlmsghdr *nl_hdr, void *arg)
+{
+	int rc;
+	struct nlbl_unlbl_walk_arg *walk = arg;
+	struct nlbl_addrmap addr;
 
-	rc = 0;
+	rc = nlbl_unlbl_addrmap_decode(nl_hdr, walk->command, walk->tab, &addr);
+	if (rc < 0)
+		return rc;
+	walk->count++;
 
-init_return:
-	nlbl_comm_close(hndl);
+	rc = walk->cb(&addr, walk->cb_arg);
+	nlbl_unlbl_addrmap_release(&addr, walk->tab);
 	return rc;
+}
+
+/**
+ * Append an address mapping to an address mapping array
+ * @param addr the address mapping
+ * @param arg the address mapping array
+ *
+ * Move the address mapping in @addr to the end of the array, leaving @addr
+ * empty.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_staticlist_append(struct nlbl_addrmap *addr, void *arg)
+{
+	struct nlbl_unlbl_addrmap_array *addrs = arg;
+	struct nlbl_addrmap *array_new;
+
+	array_new = nlbl_array_grow(addrs->array,
+				    addrs->count, sizeof(*array_new));
+	if (array_new == NULL)
+		return -ENOMEM;
+	addrs->array = array_new;
+	addrs->array[addrs->count++] = *addr;
+	memset(addr, 0, sizeof(*addr));
+
+	return 0;
+}
+
+/**
+ * Dump a static label configuration
+ * @param hndl the NetLabel handle
+ * @param command the NetLabel unlabeled command
+ * @param tab the interned string table, NULL to copy the strings
+ * @param cb the per-mapping callback
+ * @param arg the callback argument
+ *
+ * Perform the NLBL_UNLABEL_C_STATICLIST or NLBL_UNLABEL_C_STATICLISTDEF dump
+ * and call @cb for each address mapping.  Returns the number of mappings
+ * passed to @cb on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_staticlist_dump(struct nlbl_handle *hndl,
+				      uint8_t command,
+				      struct nlbl_strtab *tab,
+				      nlbl_addrmap_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg;
+	struct nlbl_unlbl_walk_arg walk;
+
+	/* create a new message */
+	msg = nlbl_unlbl_msg_new(command, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+
+	/* perform the dump */
+	walk.command = command;
+	walk.tab = tab;
+	walk.cb = cb;
+	walk.cb_arg = arg;
+	walk.count = 0;
+	rc = nlbl_comm_dump(hndl, msg, nlbl_unlbl_staticlist_walk_msg, &walk);
+	nlbl_msg_free(msg);
+	if (rc < 0)
+		return rc;
+
+	return walk.count;
+}
+
+/**
+ * Dump a static label configuration into an array
+ * @param hndl the NetLabel handle
+ * @param command the NetLabel unlabeled command
+ * @param tab the interned string table, NULL to copy the strings
+ * @param addrs the static label address mappings
+ *
+ * Perform the NLBL_UNLABEL_C_STATICLIST or NLBL_UNLABEL_C_STATICLISTDEF dump
+ * and return the address mappings in @addrs.  Returns the number of mappings
+ * on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_staticlist_array(struct nlbl_handle *hndl,
+				       uint8_t command,
+				       struct nlbl_strtab *tab,
+				       struct nlbl_addrmap **addrs)
+{
+	int rc;
+	struct nlbl_unlbl_addrmap_array list;
+	struct nlbl_addrmap *array_new;
+
+	memset(&list, 0, sizeof(list));
+	rc = nlbl_unlbl_staticlist_dump(hndl, command, tab,
+					nlbl_unlbl_staticlist_append, &list);
+	if (rc < 0) {
+		while (list.count > 0)
+			nlbl_unlbl_addrmap_release(&list.array[--list.count],
+						   tab);
+		if (list.array != NULL)
+			free(list.array);
+		return rc;
+	}
 
+	/* the array doubles as it grows, give back the unused half */
+	if (list.count > 0) {
+		array_new = realloc(list.array,
+				    sizeof(*list.array) * list.count);
+		if (array_new != NULL)
+			list.array = array_new;
+	}
+
+	*addrs = list.array;
+	return list.count;
 }
 
 /*
@@ -195,27 +592,19 @@ int nlbl_unlbl_accept(struct nlbl_handle *hndl, uint8_t allow_flag)
 	nlbl_msg *ans_msg = NULL;
 
 	/* sanity checks */
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto accept_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_ACCEPT, 0);
-	if (msg == NULL)
-		goto accept_return;
-
-	/* add the required attributes to the message */
-	if (allow_flag)
-		rc = nla_put_u8(msg, NLBL_UNLABEL_A_ACPTFLG, 1);
-	else
-		rc = nla_put_u8(msg, NLBL_UNLABEL_A_ACPTFLG, 0);
-	if (rc != 0)
+	rc = nlbl_unlbl_accept_msg(allow_flag, &msg);
+	if (rc < 0)
 		goto accept_return;
 
 	/* send the request */
@@ -239,7 +628,7 @@ int nlbl_unlbl_accept(struct nlbl_handle *hndl, uint8_t allow_flag)
 
 accept_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -261,18 +650,16 @@ int nlbl_unlbl_list(struct nlbl_handle *hndl, uint8_t *allow_flag)
 	struct nlbl_handle *p_hndl = hndl;
 	nlbl_msg *msg = NULL;
 	nlbl_msg *ans_msg = NULL;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla;
 
 	/* sanity checks */
 	if (allow_flag == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto list_return;
 	}
@@ -302,23 +689,13 @@ int nlbl_unlbl_list(struct nlbl_handle *hndl, uint8_t *allow_flag)
 	rc = nlbl_unlbl_parse_ack(ans_msg);
 	if (rc < 0 && rc != -ENOMSG)
 		goto list_return;
-	genl_hdr = nlbl_msg_genlhdr(ans_msg);
-	if (genl_hdr == NULL || genl_hdr->cmd != NLBL_UNLABEL_C_LIST) {
-		rc = -EBADMSG;
-		goto list_return;
-	}
 
 	/* process the response */
-	nla = nlbl_attr_find(ans_msg, NLBL_UNLABEL_A_ACPTFLG);
-	if (nla == NULL)
-		goto list_return;
-	*allow_flag = nla_get_u8(nla);
-
-	rc = 0;
+	rc = nlbl_unlbl_list_decode(nlbl_msg_nlhdr(ans_msg), allow_flag);
 
 list_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -349,61 +726,21 @@ int nlbl_unlbl_staticadd(struct nlbl_handle *hndl,
 	/* sanity checks */
 	if (dev == NULL || addr == NULL || label == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto staticadd_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICADD, 0);
-	if (msg == NULL)
-		goto staticadd_return;
-
-	/* add the required attributes to the message */
-	rc = nla_put_string(msg, NLBL_UNLABEL_A_IFACE, dev);
-	if (rc != 0)
-		goto staticadd_return;
-	rc = nla_put_string(msg, NLBL_UNLABEL_A_SECCTX, label);
-	if (rc != 0)
-		goto staticadd_return;
-	switch (addr->type) {
-	case AF_INET:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4ADDR,
-			     sizeof(struct in_addr),
-			     &addr->addr.v4);
-		if (rc != 0)
-			goto staticadd_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4MASK,
-			     sizeof(struct in_addr),
-			     &addr->mask.v4);
-		if (rc != 0)
-			goto staticadd_return;
-		break;
-	case AF_INET6:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6ADDR,
-			     sizeof(struct in6_addr),
-			     &addr->addr.v6);
-		if (rc != 0)
-			goto staticadd_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6MASK,
-			     sizeof(struct in6_addr),
-			     &addr->mask.v6);
-		if (rc != 0)
-			goto staticadd_return;
-		break;
-	default:
-		rc = -EINVAL;
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICADD,
+				   dev, addr, label, &msg);
+	if (rc < 0)
 		goto staticadd_return;
-	}
 
 	/* send the request */
 	rc = nlbl_comm_send(p_hndl, msg);
@@ -426,7 +763,7 @@ int nlbl_unlbl_staticadd(struct nlbl_handle *hndl,
 
 staticadd_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -455,58 +792,21 @@ int nlbl_unlbl_staticadddef(struct nlbl_handle *hndl,
 	/* sanity checks */
 	if (addr == NULL || label == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto staticadddef_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICADDDEF, 0);
-	if (msg == NULL)
-		goto staticadddef_return;
-
-	/* add the required attributes to the message */
-	rc = nla_put_string(msg, NLBL_UNLABEL_A_SECCTX, label);
-	if (rc != 0)
-		goto staticadddef_return;
-	switch (addr->type) {
-	case AF_INET:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4ADDR,
-			     sizeof(struct in_addr),
-			     &addr->addr.v4);
-		if (rc != 0)
-			goto staticadddef_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4MASK,
-			     sizeof(struct in_addr),
-			     &addr->mask.v4);
-		if (rc != 0)
-			goto staticadddef_return;
-		break;
-	case AF_INET6:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6ADDR,
-			     sizeof(struct in6_addr),
-			     &addr->addr.v6);
-		if (rc != 0)
-			goto staticadddef_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6MASK,
-			     sizeof(struct in6_addr),
-			     &addr->mask.v6);
-		if (rc != 0)
-			goto staticadddef_return;
-		break;
-	default:
-		rc = -EINVAL;
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICADDDEF,
+				   NULL, addr, label, &msg);
+	if (rc < 0)
 		goto staticadddef_return;
-	}
 
 	/* send the request */
 	rc = nlbl_comm_send(p_hndl, msg);
@@ -529,7 +829,7 @@ int nlbl_unlbl_staticadddef(struct nlbl_handle *hndl,
 
 staticadddef_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -558,64 +858,27 @@ int nlbl_unlbl_staticdel(struct nlbl_handle *hndl,
 	/* sanity checks */
 	if (dev == NULL || addr == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto staticdel_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICREMOVE, 0);
-	if (msg == NULL)
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICREMOVE,
+				   dev, addr, NULL, &msg);
+	if (rc < 0)
 		goto staticdel_return;
 
-	/* add the required attributes to the message */
-	rc = nla_put_string(msg, NLBL_UNLABEL_A_IFACE, dev);
-	if (rc != 0)
-		goto staticdel_return;
-	switch (addr->type) {
-	case AF_INET:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4ADDR,
-			     sizeof(struct in_addr),
-			     &addr->addr.v4);
-		if (rc != 0)
-			goto staticdel_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4MASK,
-			     sizeof(struct in_addr),
-			     &addr->mask.v4);
-		if (rc != 0)
-			goto staticdel_return;
-		break;
-	case AF_INET6:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6ADDR,
-			     sizeof(struct in6_addr),
-			     &addr->addr.v6);
-		if (rc != 0)
-			goto staticdel_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6MASK,
-			     sizeof(struct in6_addr),
-			     &addr->mask.v6);
-		if (rc != 0)
-			goto staticdel_return;
-		break;
-	default:
-		rc = -EINVAL;
-		goto staticdel_return;
-	}
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
 		goto staticdel_return;
 	}
 
@@ -632,7 +895,7 @@ int nlbl_unlbl_staticdel(struct nlbl_handle *hndl,
 
 staticdel_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -659,55 +922,21 @@ int nlbl_unlbl_staticdeldef(struct nlbl_handle *hndl,
 	/* sanity checks */
 	if (addr == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
+	/* borrow a handle from the pool if we need one */
 	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
+		p_hndl = nlbl_comm_pool_get();
 		if (p_hndl == NULL)
 			goto staticdeldef_return;
 	}
 
 	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICREMOVEDEF, 0);
-	if (msg == NULL)
-		goto staticdeldef_return;
-
-	/* add the required attributes to the message */
-	switch (addr->type) {
-	case AF_INET:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4ADDR,
-			     sizeof(struct in_addr),
-			     &addr->addr.v4);
-		if (rc != 0)
-			goto staticdeldef_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV4MASK,
-			     sizeof(struct in_addr),
-			     &addr->mask.v4);
-		if (rc != 0)
-			goto staticdeldef_return;
-		break;
-	case AF_INET6:
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6ADDR,
-			     sizeof(struct in6_addr),
-			     &addr->addr.v6);
-		if (rc != 0)
-			goto staticdeldef_return;
-		rc = nla_put(msg,
-			     NLBL_UNLABEL_A_IPV6MASK,
-			     sizeof(struct in6_addr),
-			     &addr->mask.v6);
-		if (rc != 0)
-			goto staticdeldef_return;
-		break;
-	default:
-		rc = -EINVAL;
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICREMOVEDEF,
+				   NULL, addr, NULL, &msg);
+	if (rc < 0)
 		goto staticdeldef_return;
-	}
 
 	/* send the request */
 	rc = nlbl_comm_send(p_hndl, msg);
@@ -730,7 +959,7 @@ int nlbl_unlbl_staticdeldef(struct nlbl_handle *hndl,
 
 staticdeldef_return:
 	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
+		nlbl_comm_pool_put(p_hndl);
 	nlbl_msg_free(msg);
 	nlbl_msg_free(ans_msg);
 	return rc;
@@ -749,184 +978,42 @@ staticdeldef_return:
 int nlbl_unlbl_staticlist(struct nlbl_handle *hndl,
 			  struct nlbl_addrmap **addrs)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	unsigned char *data = NULL;
-	nlbl_msg *msg = NULL;
-	struct nlmsghdr *nl_hdr;
-	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla_head;
-	struct nlattr *nla;
-	int data_len;
-	int data_attrlen;
-	struct nlbl_addrmap *addr_array = NULL, *addr_array_new;
-	uint32_t addr_count = 0;
-
 	/* sanity checks */
 	if (addrs == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto staticlist_return;
-	}
-
-	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICLIST, NLM_F_DUMP);
-	if (msg == NULL)
-		goto staticlist_return;
-
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto staticlist_return;
-	}
-
-	/* read all of the messages (multi-message response) */
-	do {
-		if (data) {
-			free(data);
-			data = NULL;
-		}
-
-		/* get the next set of messages */
-		rc = nlbl_comm_recv_raw(p_hndl, &data);
-		if (rc <= 0) {
-			if (rc == 0)
-				rc = -ENODATA;
-			goto staticlist_return;
-		}
-		data_len = rc;
-		nl_hdr = (struct nlmsghdr *)data;
-
-		/* check to see if this is a netlink control message we don't
-		 * care about */
-		if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
-		    nl_hdr->nlmsg_type == NLMSG_ERROR ||
-		    nl_hdr->nlmsg_type == NLMSG_OVERRUN) {
-			rc = -EBADMSG;
-			goto staticlist_return;
-		}
-
-		/* loop through the messages */
-		while (nlmsg_ok(nl_hdr, data_len) &&
-		       nl_hdr->nlmsg_type != NLMSG_DONE) {
-			/* get the header pointers */
-			genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
-			if (genl_hdr == NULL ||
-			    genl_hdr->cmd != NLBL_UNLABEL_C_STATICLIST) {
-				rc = -EBADMSG;
-				goto staticlist_return;
-			}
-			nla_head = (struct nlattr *)(&genl_hdr[1]);
-			data_attrlen = genlmsg_attrlen(genl_hdr, 0);
-
-			/* resize the array */
-			addr_array_new = realloc(addr_array,
-						 sizeof(*addr_array) *
-						 (addr_count + 1));
-			if (addr_array_new == NULL)
-				goto staticlist_return;
-			addr_array = addr_array_new;
-			memset(&addr_array[addr_count], 0, sizeof(*addr_array));
-
-			/* get the attribute information */
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_UNLABEL_A_IFACE);
-			if (nla == NULL)
-				goto staticlist_return;
-			addr_array[addr_count].dev = malloc(nla_len(nla));
-			if (addr_array[addr_count].dev == NULL)
-				goto staticlist_return;
-			strncpy(addr_array[addr_count].dev,
-				nla_data(nla), nla_len(nla));
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_UNLABEL_A_SECCTX);
-			if (nla == NULL)
-				goto staticlist_return;
-			addr_array[addr_count].label = malloc(nla_len(nla));
-			if (addr_array[addr_count].label == NULL)
-				goto staticlist_return;
-			strncpy(addr_array[addr_count].label,
-				nla_data(nla), nla_len(nla));
-			if (nla_find(nla_head,
-				     data_attrlen, NLBL_UNLABEL_A_IPV4ADDR)) {
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV4ADDR);
-				if (nla == NULL)
-					goto staticlist_return;
-				if (nla_len(nla) != sizeof(struct in_addr))
-					goto staticlist_return;
-				memcpy(&addr_array[addr_count].addr.addr.v4,
-				       nla_data(nla),
-				       nla_len(nla));
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV4MASK);
-				if (nla == NULL)
-					goto staticlist_return;
-				if (nla_len(nla) != sizeof(struct in_addr))
-					goto staticlist_return;
-				memcpy(&addr_array[addr_count].addr.mask.v4,
-				       nla_data(nla),
-				       nla_len(nla));
-				addr_array[addr_count].addr.type = AF_INET;
-			} else if (nla_find(nla_head,
-					    data_attrlen,
-					    NLBL_UNLABEL_A_IPV6ADDR)) {
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV6ADDR);
-				if (nla == NULL)
-					goto staticlist_return;
-				if (nla_len(nla) != sizeof(struct in6_addr))
-					goto staticlist_return;
-				memcpy(&addr_array[addr_count].addr.addr.v6,
-				       nla_data(nla),
-				       nla_len(nla));
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV6MASK);
-				if (nla == NULL)
-					goto staticlist_return;
-				if (nla_len(nla) != sizeof(struct in6_addr))
-					goto staticlist_return;
-				memcpy(&addr_array[addr_count].addr.mask.v6,
-				       nla_data(nla),
-				       nla_len(nla));
-				addr_array[addr_count].addr.type = AF_INET6;
-			}
-			addr_count++;
-
-			/* next message */
-			nl_hdr = nlmsg_next(nl_hdr, &data_len);
-		}
-	} while (NL_MULTI_CONTINUE(nl_hdr));
+	return nlbl_unlbl_staticlist_array(hndl, NLBL_UNLABEL_C_STATICLIST,
+					   NULL, addrs);
+}
 
-	*addrs = addr_array;
-	rc = addr_count;
+/**
+ * Walk the static label configuration
+ * @param hndl the NetLabel handle
+ * @param cb the per-mapping callback
+ * @param arg the callback argument
+ *
+ * Dump the NetLabel static label configuration and call @cb for each address
+ * mapping as it is received, the mapping is only valid until @cb returns.  If
+ * @cb returns a positive value the walk stops early, if it returns a negative
+ * value the walk is aborted and the value is returned.  If @hndl is NULL then
+ * the function will handle opening and closing it's own NetLabel handle.
+ * Returns the number of mappings passed to @cb on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_unlbl_staticlist_walk(struct nlbl_handle *hndl,
+			       nlbl_addrmap_cb cb, void *arg)
+{
+	/* sanity checks */
+	if (cb == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
 
-staticlist_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	if (rc < 0 && addr_array) {
-		do {
-			if (addr_array[addr_count].dev)
-				free(addr_array[addr_count].dev);
-			if (addr_array[addr_count].label)
-				free(addr_array[addr_count].label);
-		} while (addr_count-- > 0);
-		free(addr_array);
-	}
-	nlbl_msg_free(msg);
-	return rc;
+	return nlbl_unlbl_staticlist_dump(hndl, NLBL_UNLABEL_C_STATICLIST,
+					  NULL, cb, arg);
 }
 
 /**
@@ -942,171 +1029,587 @@ staticlist_return:
 int nlbl_unlbl_staticlistdef(struct nlbl_handle *hndl,
 			     struct nlbl_addrmap **addrs)
 {
-	int rc = -ENOMEM;
-	struct nlbl_handle *p_hndl = hndl;
-	unsigned char *data = NULL;
+	/* sanity checks */
+	if (addrs == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	return nlbl_unlbl_staticlist_array(hndl, NLBL_UNLABEL_C_STATICLISTDEF,
+					   NULL, addrs);
+}
+
+/**
+ * Walk the default static label configuration
+ * @param hndl the NetLabel handle
+ * @param cb the per-mapping callback
+ * @param arg the callback argument
+ *
+ * Dump the NetLabel default static label configuration and call @cb for each
+ * address mapping as it is received, the mapping is only valid until @cb
+ * returns.  If @cb returns a positive value the walk stops early, if it
+ * returns a negative value the walk is aborted and the value is returned.  If
+ * @hndl is NULL then the function will handle opening and closing it's own
+ * NetLabel handle.  Returns the number of mappings passed to @cb on success,
+ * negative values on failure.
+ *
+ */
+int nlbl_unlbl_staticlistdef_walk(struct nlbl_handle *hndl,
+				  nlbl_addrmap_cb cb, void *arg)
+{
+	/* sanity checks */
+	if (cb == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	return nlbl_unlbl_staticlist_dump(hndl, NLBL_UNLABEL_C_STATICLISTDEF,
+					  NULL, cb, arg);
+}
+
+/**
+ * Dump the static label configuration with interned strings
+ * @param hndl the NetLabel handle
+ * @param tab the interned string table
+ * @param addrs the static label address mappings
+ *
+ * Dump the NetLabel static label configuration as nlbl_unlbl_staticlist()
+ * does, except that the interface and label strings are interned in @tab, so
+ * equal strings are the same pointer.  The strings belong to @tab and must
+ * not be freed, only the @addrs array is freed by the caller.  If @hndl is
+ * NULL then the function will handle opening and closing it's own NetLabel
+ * handle.  Returns the number of mappings on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_unlbl_staticlist_strtab(struct nlbl_handle *hndl,
+				 struct nlbl_strtab *tab,
+				 struct nlbl_addrmap **addrs)
+{
+	/* sanity checks */
+	if (tab == NULL || addrs == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	return nlbl_unlbl_staticlist_array(hndl, NLBL_UNLABEL_C_STATICLIST,
+					   tab, addrs);
+}
+
+/**
+ * Dump the default static label configuration with interned strings
+ * @param hndl the NetLabel handle
+ * @param tab the interned string table
+ * @param addrs the static label address mappings
+ *
+ * Dump the NetLabel default static label configuration with the labels
+ * interned in @tab, see nlbl_unlbl_staticlist_strtab().  If @hndl is NULL
+ * then the function will handle opening and closing it's own NetLabel handle.
+ * Returns the number of mappings on success, negative values on failure.
+ *
+ */
+int nlbl_unlbl_staticlistdef_strtab(struct nlbl_handle *hndl,
+				    struct nlbl_strtab *tab,
+				    struct nlbl_addrmap **addrs)
+{
+	/* sanity checks */
+	if (tab == NULL || addrs == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	return nlbl_unlbl_staticlist_array(hndl, NLBL_UNLABEL_C_STATICLISTDEF,
+					   tab, addrs);
+}
+
+/*
+ * NetLabel batch operations
+ */
+
+/**
+ * Queue an unlabeled accept flag change in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param allow_flag the desired accept flag setting
+ *
+ * Queue a request to set the unlbl accept flag, see nlbl_unlbl_accept().
+ * Returns the index of the request within the batch on success, negative
+ * values on failure.
+ *
+ */
+int nlbl_batch_unlbl_accept(struct nlbl_batch *batch, uint8_t allow_flag)
+{
+	int rc;
 	nlbl_msg *msg = NULL;
-	struct nlmsghdr *nl_hdr;
+
+	/* sanity checks */
+	if (batch == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_accept_msg(allow_flag, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a static label addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param dev the network interface
+ * @param addr the network IP address
+ * @param label the security label
+ *
+ * Queue a request to add a new static label configuration, see
+ * nlbl_unlbl_staticadd().  Returns the index of the request within the batch
+ * on success, negative values on failure.
+ *
+ */
+int nlbl_batch_unlbl_staticadd(struct nlbl_batch *batch,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr,
+			       nlbl_secctx label)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || dev == NULL || addr == NULL || label == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICADD,
+				   dev, addr, label, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a default static label addition in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param addr the network IP address
+ * @param label the security label
+ *
+ * Queue a request to add a new default static label configuration, see
+ * nlbl_unlbl_staticadddef().  Returns the index of the request within the
+ * batch on success, negative values on failure.
+ *
+ */
+int nlbl_batch_unlbl_staticadddef(struct nlbl_batch *batch,
+				  struct nlbl_netaddr *addr,
+				  nlbl_secctx label)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || addr == NULL || label == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICADDDEF,
+				   NULL, addr, label, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a static label removal in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param dev the network interface
+ * @param addr the network IP address
+ *
+ * Queue a request to delete a static label configuration, see
+ * nlbl_unlbl_staticdel().  Returns the index of the request within the batch
+ * on success, negative values on failure.
+ *
+ */
+int nlbl_batch_unlbl_staticdel(struct nlbl_batch *batch,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || dev == NULL || addr == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICREMOVE,
+				   dev, addr, NULL, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/**
+ * Queue a default static label removal in a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param addr the network IP address
+ *
+ * Queue a request to delete a default static label configuration, see
+ * nlbl_unlbl_staticdeldef().  Returns the index of the request within the
+ * batch on success, negative values on failure.
+ *
+ */
+int nlbl_batch_unlbl_staticdeldef(struct nlbl_batch *batch,
+				  struct nlbl_netaddr *addr)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (batch == NULL || addr == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICREMOVEDEF,
+				   NULL, addr, NULL, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_batch_queue(batch, msg);
+}
+
+/*
+ * NetLabel asynchronous operations
+ */
+
+/**
+ * Decode a LIST message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Decode the accept flag in @nl_hdr into @res.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int nlbl_unlbl_async_list_decode(struct nlmsghdr *nl_hdr,
+					struct nlbl_async_result *res)
+{
+	return nlbl_unlbl_list_decode(nl_hdr, &res->data.allow_flag);
+}
+
+/**
+ * Decode a STATICLIST or STATICLISTDEF message into an asynchronous result
+ * @param nl_hdr the netlink message
+ * @param res the asynchronous result
+ *
+ * Append the address mapping in @nl_hdr to the address mapping array in @res.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_async_staticlist_decode(struct nlmsghdr *nl_hdr,
+					      struct nlbl_async_result *res)
+{
+	int rc;
+	struct nlbl_addrmap *addrs_new;
 	struct genlmsghdr *genl_hdr;
-	struct nlattr *nla_head;
-	struct nlattr *nla;
-	int data_len;
-	int data_attrlen;
-	struct nlbl_addrmap *addr_array = NULL, *addr_array_new;
-	uint32_t addr_count = 0;
+
+	addrs_new = nlbl_array_grow(res->data.addrs,
+				    res->count, sizeof(*addrs_new));
+	if (addrs_new == NULL)
+		return -ENOMEM;
+	res->data.addrs = addrs_new;
+
+	/* both dumps share the same message format */
+	genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
+	if (genl_hdr == NULL ||
+	    (genl_hdr->cmd != NLBL_UNLABEL_C_STATICLIST &&
+	     genl_hdr->cmd != NLBL_UNLABEL_C_STATICLISTDEF))
+		return -EBADMSG;
+	rc = nlbl_unlbl_addrmap_decode(nl_hdr, genl_hdr->cmd,
+				       NULL, &addrs_new[res->count]);
+	if (rc < 0)
+		return rc;
+	res->count++;
+
+	return 0;
+}
+
+/**
+ * Free a STATICLIST or STATICLISTDEF asynchronous result
+ * @param res the asynchronous result
+ *
+ * Free the address mapping array in @res.
+ *
+ */
+static void nlbl_unlbl_async_staticlist_release(struct nlbl_async_result *res)
+{
+	size_t iter;
+
+	if (res->data.addrs == NULL)
+		return;
+	for (iter = 0; iter < res->count; iter++)
+		nlbl_unlbl_addrmap_release(&res->data.addrs[iter], NULL);
+	free(res->data.addrs);
+}
+
+static const struct nlbl_async_ops nlbl_unlbl_async_list_ops = {
+	.decode = nlbl_unlbl_async_list_decode,
+	.release = NULL,
+};
+
+static const struct nlbl_async_ops nlbl_unlbl_async_staticlist_ops = {
+	.decode = nlbl_unlbl_async_staticlist_decode,
+	.release = nlbl_unlbl_async_staticlist_release,
+};
+
+/**
+ * Set the unlbl accept flag asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param allow_flag the desired accept flag setting
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to set the unlbl accept flag, see nlbl_unlbl_accept().
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_unlbl_accept(struct nlbl_async *async,
+			    uint8_t allow_flag,
+			    nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
 
 	/* sanity checks */
-	if (addrs == NULL)
+	if (async == NULL)
 		return -EINVAL;
-	if (nlbl_unlbl_fid == 0)
+	if (nlbl_unlbl_fid() == 0)
 		return -ENOPROTOOPT;
 
-	/* open a handle if we need one */
-	if (p_hndl == NULL) {
-		p_hndl = nlbl_comm_open();
-		if (p_hndl == NULL)
-			goto staticlistdef_return;
-	}
+	rc = nlbl_unlbl_accept_msg(allow_flag, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
 
-	/* create a new message */
-	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICLISTDEF, NLM_F_DUMP);
+/**
+ * Query the unlbl accept flag asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the unlbl accept flag, see nlbl_unlbl_list().  The
+ * flag is returned in the data.allow_flag field of the results.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+int nlbl_async_unlbl_list(struct nlbl_async *async,
+			  nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_LIST, 0);
 	if (msg == NULL)
-		goto staticlistdef_return;
+		return -ENOMEM;
+	return nlbl_async_submit(async,
+				 msg, &nlbl_unlbl_async_list_ops, cb, arg);
+}
 
-	/* send the request */
-	rc = nlbl_comm_send(p_hndl, msg);
-	if (rc <= 0) {
-		if (rc == 0)
-			rc = -ENODATA;
-		goto staticlistdef_return;
-	}
+/**
+ * Add a static label configuration asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param dev the network interface
+ * @param addr the network IP address
+ * @param label the security label
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add a new static label configuration, see
+ * nlbl_unlbl_staticadd().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_unlbl_staticadd(struct nlbl_async *async,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr,
+			       nlbl_secctx label,
+			       nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
 
-	/* read all of the messages (multi-message response) */
-	do {
-		if (data) {
-			free(data);
-			data = NULL;
-		}
+	/* sanity checks */
+	if (async == NULL || dev == NULL || addr == NULL || label == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
 
-		/* get the next set of messages */
-		rc = nlbl_comm_recv_raw(p_hndl, &data);
-		if (rc <= 0) {
-			if (rc == 0)
-				rc = -ENODATA;
-			goto staticlistdef_return;
-		}
-		data_len = rc;
-		nl_hdr = (struct nlmsghdr *)data;
-
-		/* check to see if this is a netlink control message we don't
-		 * care about */
-		if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
-		    nl_hdr->nlmsg_type == NLMSG_ERROR ||
-		    nl_hdr->nlmsg_type == NLMSG_OVERRUN) {
-			rc = -EBADMSG;
-			goto staticlistdef_return;
-		}
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICADD,
+				   dev, addr, label, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
 
-		/* loop through the messages */
-		while (nlmsg_ok(nl_hdr, data_len) &&
-		       nl_hdr->nlmsg_type != NLMSG_DONE) {
-			/* get the header pointers */
-			genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
-			if (genl_hdr == NULL ||
-			    genl_hdr->cmd != NLBL_UNLABEL_C_STATICLISTDEF) {
-				rc = -EBADMSG;
-				goto staticlistdef_return;
-			}
-			nla_head = (struct nlattr *)(&genl_hdr[1]);
-			data_attrlen = genlmsg_attrlen(genl_hdr, 0);
-
-			/* resize the array */
-			addr_array_new = realloc(addr_array,
-						 sizeof(*addr_array) *
-						 (addr_count + 1));
-			if (addr_array_new == NULL)
-				goto staticlistdef_return;
-			addr_array = addr_array_new;
-			memset(&addr_array[addr_count], 0, sizeof(*addr_array));
-
-			/* get the attribute information */
-			nla = nla_find(nla_head,
-				       data_attrlen, NLBL_UNLABEL_A_SECCTX);
-			if (nla == NULL)
-				goto staticlistdef_return;
-			addr_array[addr_count].label = malloc(nla_len(nla));
-			if (addr_array[addr_count].label == NULL)
-				goto staticlistdef_return;
-			strncpy(addr_array[addr_count].label,
-				nla_data(nla), nla_len(nla));
-			if (nla_find(nla_head,
-				     data_attrlen, NLBL_UNLABEL_A_IPV4ADDR)) {
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV4ADDR);
-				if (nla == NULL)
-					goto staticlistdef_return;
-				if (nla_len(nla) != sizeof(struct in_addr))
-					goto staticlistdef_return;
-				memcpy(&addr_array[addr_count].addr.addr.v4,
-				       nla_data(nla),
-				       nla_len(nla));
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV4MASK);
-				if (nla == NULL)
-					goto staticlistdef_return;
-				if (nla_len(nla) != sizeof(struct in_addr))
-					goto staticlistdef_return;
-				memcpy(&addr_array[addr_count].addr.mask.v4,
-				       nla_data(nla),
-				       nla_len(nla));
-				addr_array[addr_count].addr.type = AF_INET;
-			} else if (nla_find(nla_head,
-					    data_attrlen,
-					    NLBL_UNLABEL_A_IPV6ADDR)) {
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV6ADDR);
-				if (nla == NULL)
-					goto staticlistdef_return;
-				if (nla_len(nla) != sizeof(struct in6_addr))
-					goto staticlistdef_return;
-				memcpy(&addr_array[addr_count].addr.addr.v6,
-				       nla_data(nla),
-				       nla_len(nla));
-				nla = nla_find(nla_head,
-					       data_attrlen,
-					       NLBL_UNLABEL_A_IPV6MASK);
-				if (nla == NULL)
-					goto staticlistdef_return;
-				if (nla_len(nla) != sizeof(struct in6_addr))
-					goto staticlistdef_return;
-				memcpy(&addr_array[addr_count].addr.mask.v6,
-				       nla_data(nla),
-				       nla_len(nla));
-				addr_array[addr_count].addr.type = AF_INET6;
-			}
-			addr_count++;
-
-			/* next message */
-			nl_hdr = nlmsg_next(nl_hdr, &data_len);
-		}
-	} while (NL_MULTI_CONTINUE(nl_hdr));
+/**
+ * Add a default static label configuration asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param addr the network IP address
+ * @param label the security label
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to add a new default static label configuration, see
+ * nlbl_unlbl_staticadddef().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_unlbl_staticadddef(struct nlbl_async *async,
+				  struct nlbl_netaddr *addr,
+				  nlbl_secctx label,
+				  nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
 
-	*addrs = addr_array;
-	rc = addr_count;
+	/* sanity checks */
+	if (async == NULL || addr == NULL || label == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
 
-staticlistdef_return:
-	if (hndl == NULL)
-		nlbl_comm_close(p_hndl);
-	if (rc < 0 && addr_array) {
-		do {
-			if (addr_array[addr_count].label)
-				free(addr_array[addr_count].label);
-		} while (addr_count-- > 0);
-		free(addr_array);
-	}
-	nlbl_msg_free(msg);
-	return rc;
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICADDDEF,
+				   NULL, addr, label, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Delete a static label configuration asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param dev the network interface
+ * @param addr the network IP address
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to delete a static label configuration, see
+ * nlbl_unlbl_staticdel().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_unlbl_staticdel(struct nlbl_async *async,
+			       nlbl_netdev dev,
+			       struct nlbl_netaddr *addr,
+			       nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || dev == NULL || addr == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICREMOVE,
+				   dev, addr, NULL, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Delete a default static label configuration asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param addr the network IP address
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request to delete a default static label configuration, see
+ * nlbl_unlbl_staticdeldef().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_async_unlbl_staticdeldef(struct nlbl_async *async,
+				  struct nlbl_netaddr *addr,
+				  nlbl_async_cb cb, void *arg)
+{
+	int rc;
+	nlbl_msg *msg = NULL;
+
+	/* sanity checks */
+	if (async == NULL || addr == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	rc = nlbl_unlbl_static_msg(NLBL_UNLABEL_C_STATICREMOVEDEF,
+				   NULL, addr, NULL, &msg);
+	if (rc < 0)
+		return rc;
+	return nlbl_async_submit(async, msg, NULL, cb, arg);
+}
+
+/**
+ * Dump the static label configuration asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the static label configuration, see
+ * nlbl_unlbl_staticlist().  The mappings are returned in the data.addrs field
+ * of the results.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_unlbl_staticlist(struct nlbl_async *async,
+				nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICLIST, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async, msg,
+				 &nlbl_unlbl_async_staticlist_ops, cb, arg);
+}
+
+/**
+ * Dump the default static label configuration asynchronously
+ * @param async the NetLabel asynchronous request context
+ * @param cb the completion callback
+ * @param arg the completion callback argument
+ *
+ * Submit a request for the default static label configuration, see
+ * nlbl_unlbl_staticlistdef().  The mappings are returned in the data.addrs
+ * field of the results.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_unlbl_staticlistdef(struct nlbl_async *async,
+				   nlbl_async_cb cb, void *arg)
+{
+	nlbl_msg *msg;
+
+	/* sanity checks */
+	if (async == NULL)
+		return -EINVAL;
+	if (nlbl_unlbl_fid() == 0)
+		return -ENOPROTOOPT;
+
+	msg = nlbl_unlbl_msg_new(NLBL_UNLABEL_C_STATICLISTDEF, NLM_F_DUMP);
+	if (msg == NULL)
+		return -ENOMEM;
+	return nlbl_async_submit(async, msg,
+				 &nlbl_unlbl_async_staticlist_ops, cb, arg);
 }
@@ -0,0 +1,523 @@
+/** @file
+ * NetLabel Asynchronous Request Functions
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* maximum number of requests outstanding in the kernel */
+#define NLBL_ASYNC_WINDOW	64
+
+/* NetLabel asynchronous request */
+struct nlbl_async_req {
+	nlbl_msg *msg;
+	uint32_t seq;
+	unsigned int dump;
+	unsigned int replies;
+	int err;
+
+	const struct nlbl_async_ops *ops;
+	nlbl_async_cb cb;
+	void *cb_arg;
+	struct nlbl_async_result res;
+
+	struct nlbl_async_req *next;
+};
+
+/* NetLabel asynchronous request context */
+struct nlbl_async {
+	struct nlbl_handle *hndl;
+	unsigned int hndl_owned;
+	int fd_flags;
+
+	/* requests waiting to be sent, oldest first */
+	struct nlbl_async_req *queue_head;
+	struct nlbl_async_req *queue_tail;
+	uint32_t queue_count;
+	unsigned int blocked;
+
+	/* requests sent to the kernel, oldest first */
+	struct nlbl_async_req *sent_head;
+	struct nlbl_async_req *sent_tail;
+	uint32_t sent_count;
+};
+
+/*
+ * Helper Functions
+ */
+
+/**
+ * Complete an asynchronous request
+ * @param req the request
+ * @param rc the request's return value
+ *
+ * Invoke the request's callback with the result in @rc and free the request,
+ * the request must already be removed from any lists.  If the request failed,
+ * or there is no callback to take ownership of them, any results are freed.
+ *
+ */
+static void nlbl_async_complete(struct nlbl_async_req *req, int rc)
+{
+	if ((rc < 0 || req->cb == NULL) &&
+	    req->ops != NULL && req->ops->release != NULL)
+		req->ops->release(&req->res);
+	if (req->cb != NULL)
+		req->cb(rc, (rc < 0 ? NULL : &req->res), req->cb_arg);
+
+	nlbl_msg_free(req->msg);
+	free(req);
+}
+
+/**
+ * Remove a sent request matching a sequence number
+ * @param async the NetLabel asynchronous request context
+ * @param seq the sequence number
+ * @param unlink remove the request from the sent list if true
+ *
+ * Find the request which was sent with the sequence number @seq and, if
+ * @unlink is true, remove it from the list of sent requests.  Returns a
+ * pointer to the request on success, NULL if no request matches.
+ *
+ */
+static struct nlbl_async_req *nlbl_async_sent_find(struct nlbl_async *async,
+						   uint32_t seq,
+						   unsigned int unlink)
+{
+	struct nlbl_async_req *iter;
+	struct nlbl_async_req *prev = NULL;
+
+	/* replies almost always arrive in order so this is quick */
+	for (iter = async->sent_head; iter != NULL; iter = iter->next) {
+		if (iter->seq == seq)
+			break;
+		prev = iter;
+	}
+	if (iter == NULL || !unlink)
+		return iter;
+
+	if (prev != NULL)
+		prev->next = iter->next;
+	else
+		async->sent_head = iter->next;
+	if (async->sent_tail == iter)
+		async->sent_tail = prev;
+	async->sent_count--;
+	iter->next = NULL;
+
+	return iter;
+}
+
+/**
+ * Send queued requests to the kernel
+ * @param async the NetLabel asynchronous request context
+ *
+ * Send queued requests to the kernel until either the queue is empty, the
+ * maximum number of requests are outstanding, or the handle can not be written
+ * without waiting, in which case the remaining requests stay queued and the
+ * context is marked as blocked until the next attempt.  Requests which can not
+ * be sent are completed with an error.  Returns the number of requests
+ * completed with an error.
+ *
+ */
+static int nlbl_async_send(struct nlbl_async *async)
+{
+	int rc;
+	int failed = 0;
+	struct nlbl_async_req *req;
+	struct nlmsghdr *nl_hdr;
+
+	async->blocked = 0;
+	while (async->queue_head != NULL &&
+	       async->sent_count < NLBL_ASYNC_WINDOW) {
+		req = async->queue_head;
+
+		rc = nlbl_comm_msg_complete(async->hndl, req->msg);
+		if (rc == 0) {
+			nl_hdr = nlbl_msg_nlhdr(req->msg);
+			req->seq = nl_hdr->nlmsg_seq;
+			rc = nlbl_comm_send_raw(async->hndl,
+						nl_hdr, nl_hdr->nlmsg_len);
+			if (rc == -EAGAIN) {
+				async->blocked = 1;
+				break;
+			}
+		}
+
+		/* remove the request from the queue */
+		async->queue_head = req->next;
+		if (async->queue_head == NULL)
+			async->queue_tail = NULL;
+		async->queue_count--;
+		req->next = NULL;
+
+		if (rc < 0) {
+			nlbl_async_complete(req, rc);
+			failed++;
+			continue;
+		}
+
+		/* the request is now waiting on the kernel */
+		if (async->sent_tail != NULL)
+			async->sent_tail->next = req;
+		else
+			async->sent_head = req;
+		async->sent_tail = req;
+		async->sent_count++;
+
+		/* the message is no longer needed */
+		nlbl_msg_free(req->msg);
+		req->msg = NULL;
+	}
+
+	return failed;
+}
+
+/**
+ * Fail all of the requests sent to the kernel
+ * @param async the NetLabel asynchronous request context
+ * @param rc the error code
+ *
+ * Complete all of the requests which have been sent to the kernel with the
+ * error in @rc, this is used when replies have been lost.  Returns the number
+ * of requests completed.
+ *
+ */
+static int nlbl_async_sent_fail(struct nlbl_async *async, int rc)
+{
+	int count = 0;
+	struct nlbl_async_req *req;
+
+	while (async->sent_head != NULL) {
+		req = nlbl_async_sent_find(async, async->sent_head->seq, 1);
+		nlbl_async_complete(req, rc);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Process a single netlink message
+ * @param async the NetLabel asynchronous request context
+ * @param nl_hdr the netlink message
+ *
+ * Match the netlink message in @nl_hdr to an outstanding request, decoding
+ * any results and completing the request once the kernel has finished with
+ * it.  Returns one if a request was completed, zero otherwise.
+ *
+ */
+static int nlbl_async_msg(struct nlbl_async *async, struct nlmsghdr *nl_hdr)
+{
+	int rc;
+	struct nlbl_async_req *req;
+	struct nlmsgerr *nl_err;
+
+	/* ignore anything which isn't a reply to one of our requests */
+	if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
+	    nl_hdr->nlmsg_type == NLMSG_OVERRUN)
+		return 0;
+	req = nlbl_async_sent_find(async, nl_hdr->nlmsg_seq, 0);
+	if (req == NULL)
+		return 0;
+
+	switch (nl_hdr->nlmsg_type) {
+	case NLMSG_ERROR:
+		nl_err = nlmsg_data(nl_hdr);
+		if (nl_err->error == 0 && req->dump)
+			return 0;
+		if (nl_err->error < 0)
+			rc = nl_err->error;
+		else if (req->err < 0)
+			rc = req->err;
+		else if (req->ops != NULL && req->replies == 0)
+			rc = -ENOMSG;
+		else
+			rc = 0;
+		break;
+	case NLMSG_DONE:
+		if (!req->dump)
+			return 0;
+		/* the kernel reports dump errors in the DONE message */
+		if (nlmsg_datalen(nl_hdr) >= (int)sizeof(int) &&
+		    *(int *)nlmsg_data(nl_hdr) < 0)
+			rc = *(int *)nlmsg_data(nl_hdr);
+		else if (req->err < 0)
+			rc = req->err;
+		else
+			rc = req->res.count;
+		break;
+	default:
+		req->replies++;
+		if (req->err == 0 && req->ops != NULL) {
+			rc = req->ops->decode(nl_hdr, &req->res);
+			if (rc < 0)
+				req->err = rc;
+		}
+		return 0;
+	}
+
+	req = nlbl_async_sent_find(async, nl_hdr->nlmsg_seq, 1);
+	nlbl_async_complete(req, rc);
+	return 1;
+}
+
+/*
+ * Internal Functions
+ */
+
+/**
+ * Submit a request to a NetLabel asynchronous request context
+ * @param async the NetLabel asynchronous request context
+ * @param msg the request message
+ * @param ops the result decoding operations, NULL if there are no results
+ * @param cb the completion callback
+ * @param cb_arg the completion callback argument
+ *
+ * Queue the request in @msg and send it to the kernel if the number of
+ * outstanding requests allows it, the request takes ownership of @msg and
+ * frees it on failure.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_async_submit(struct nlbl_async *async,
+		      nlbl_msg *msg,
+		      const struct nlbl_async_ops *ops,
+		      nlbl_async_cb cb, void *cb_arg)
+{
+	struct nlbl_async_req *req;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		nlbl_msg_free(msg);
+		return -ENOMEM;
+	}
+	req->msg = msg;
+	req->dump = (nlbl_msg_nlhdr(msg)->nlmsg_flags & NLM_F_DUMP ? 1 : 0);
+	req->ops = ops;
+	req->cb = cb;
+	req->cb_arg = cb_arg;
+
+	if (async->queue_tail != NULL)
+		async->queue_tail->next = req;
+	else
+		async->queue_head = req;
+	async->queue_tail = req;
+	async->queue_count++;
+
+	nlbl_async_send(async);
+
+	return 0;
+}
+
+/*
+ * Asynchronous Request Functions
+ */
+
+/**
+ * Create a new NetLabel asynchronous request context
+ * @param hndl the NetLabel handle
+ *
+ * Create a new asynchronous request context using the NetLabel handle @hndl,
+ * which is placed into non-blocking mode until the context is freed.  If
+ * @hndl is NULL then the context will open, and later close, it's own
+ * NetLabel handle.  The handle must not be used for other requests while the
+ * context exists.  Returns a pointer to the context on success, NULL on
+ * failure.
+ *
+ */
+struct nlbl_async *nlbl_async_new(struct nlbl_handle *hndl)
+{
+	struct nlbl_async *async;
+	int fd;
+
+	async = calloc(1, sizeof(*async));
+	if (async == NULL)
+		return NULL;
+
+	if (hndl == NULL) {
+		async->hndl = nlbl_comm_open();
+		if (async->hndl == NULL)
+			goto new_failure;
+		async->hndl_owned = 1;
+	} else
+		async->hndl = hndl;
+
+	/* we never want to wait on the handle */
+	fd = nlbl_comm_fd(async->hndl);
+	if (fd < 0)
+		goto new_failure;
+	async->fd_flags = fcntl(fd, F_GETFL);
+	if (async->fd_flags < 0 ||
+	    fcntl(fd, F_SETFL, async->fd_flags | O_NONBLOCK) < 0)
+		goto new_failure;
+
+	return async;
+
+new_failure:
+	if (async->hndl_owned)
+		nlbl_comm_close(async->hndl);
+	free(async);
+	return NULL;
+}
+
+/**
+ * Free a NetLabel asynchronous request context
+ * @param async the NetLabel asynchronous request context
+ *
+ * Free the asynchronous request context, any requests which have not yet
+ * completed are completed with -ECANCELED.  The callbacks must not submit
+ * new requests.
+ *
+ */
+void nlbl_async_free(struct nlbl_async *async)
+{
+	struct nlbl_async_req *req;
+	int fd;
+
+	if (async == NULL)
+		return;
+
+	nlbl_async_sent_fail(async, -ECANCELED);
+	while (async->queue_head != NULL) {
+		req = async->queue_head;
+		async->queue_head = req->next;
+		nlbl_async_complete(req, -ECANCELED);
+	}
+
+	if (async->hndl_owned)
+		nlbl_comm_close(async->hndl);
+	else {
+		fd = nlbl_comm_fd(async->hndl);
+		if (fd >= 0)
+			fcntl(fd, F_SETFL, async->fd_flags);
+	}
+	free(async);
+}
+
+/**
+ * Return the file descriptor to poll
+ * @param async the NetLabel asynchronous request context
+ *
+ * Return the file descriptor which should be polled for readability, and for
+ * writability while nlbl_async_blocked() is true, the caller should call
+ * nlbl_async_process() whenever it is ready.  Returns
+ * the file descriptor on success, negative values on failure.
+ *
+ */
+int nlbl_async_fd(struct nlbl_async *async)
+{
+	if (async == NULL)
+		return -EINVAL;
+	return nlbl_comm_fd(async->hndl);
+}
+
+/**
+ * Return the number of outstanding requests
+ * @param async the NetLabel asynchronous request context
+ *
+ * Returns the number of requests which have been submitted but have not yet
+ * completed.
+ *
+ */
+size_t nlbl_async_pending(struct nlbl_async *async)
+{
+	if (async == NULL)
+		return 0;
+	return async->queue_count + async->sent_count;
+}
+
+/**
+ * Check if an asynchronous request context is waiting to send
+ * @param async the NetLabel asynchronous request context
+ *
+ * Returns true if queued requests could not be sent because the handle could
+ * not be written without waiting, in which case the caller should also poll
+ * the file descriptor returned by nlbl_async_fd() for writability and call
+ * nlbl_async_process() once it is writable, false otherwise.
+ *
+ */
+int nlbl_async_blocked(struct nlbl_async *async)
+{
+	if (async == NULL)
+		return 0;
+	return async->blocked;
+}
+
+/**
+ * Process any replies waiting on a NetLabel asynchronous request context
+ * @param async the NetLabel asynchronous request context
+ *
+ * Send any queued requests, then read all of the replies currently waiting on
+ * the context's handle without blocking, invoking the callbacks of any
+ * requests which complete and sending queued requests as room is made for
+ * them.  If replies were lost, or the handle was closed by the other end, the
+ * outstanding requests are completed with the error, -ECONNRESET for a closed
+ * handle.  Returns the number of requests completed on success, negative
+ * values on failure.
+ *
+ */
+int nlbl_async_process(struct nlbl_async *async)
+{
+	int rc;
+	int count = 0;
+	unsigned char *data;
+	int data_len;
+	struct nlmsghdr *nl_hdr;
+
+	if (async == NULL)
+		return -EINVAL;
+
+	/* retry any requests which were left queued by a full handle */
+	count += nlbl_async_send(async);
+
+	for (;;) {
+		rc = nlbl_comm_recv_nowait(async->hndl, &data);
+		if (rc == -EAGAIN)
+			break;
+		if (rc == 0)
+			/* the other end, e.g. netlabeld, has gone away */
+			rc = -ECONNRESET;
+		if (rc < 0) {
+			/* the kernel drops replies when we fall behind */
+			count += nlbl_async_sent_fail(async, rc);
+			count += nlbl_async_send(async);
+			return rc;
+		}
+		data_len = rc;
+
+		nl_hdr = (struct nlmsghdr *)data;
+		while (nlmsg_ok(nl_hdr, data_len)) {
+			count += nlbl_async_msg(async, nl_hdr);
+			nl_hdr = nlmsg_next(nl_hdr, &data_len);
+		}
+		free(data);
+
+		count += nlbl_async_send(async);
+	}
+
+	return count;
+}
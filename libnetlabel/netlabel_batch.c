@@ -0,0 +1,301 @@
+/** @file
+ * NetLabel Pipelined Request Functions
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* maximum number of requests waiting for an ACK */
+#define NLBL_BATCH_WINDOW	64
+
+/* preferred size of a single write to the kernel */
+#define NLBL_BATCH_BUFLEN	32768
+
+/* NetLabel batch of queued requests */
+struct nlbl_batch {
+	nlbl_msg **msgs;
+	uint32_t count;
+	uint32_t size;
+};
+
+/*
+ * Internal Functions
+ */
+
+/**
+ * Add a request to a NetLabel batch
+ * @param batch the NetLabel batch
+ * @param msg the request message
+ *
+ * Append @msg to the end of @batch, the batch takes ownership of @msg and
+ * frees it on failure.  Returns the index of the request within the batch on
+ * success, negative values on failure.
+ *
+ */
+int nlbl_batch_queue(struct nlbl_batch *batch, nlbl_msg *msg)
+{
+	nlbl_msg **msgs_new;
+	uint32_t size_new;
+
+	if (batch->count == batch->size) {
+		size_new = (batch->size > 0 ? batch->size * 2 : 16);
+		msgs_new = realloc(batch->msgs, sizeof(*msgs_new) * size_new);
+		if (msgs_new == NULL) {
+			nlbl_msg_free(msg);
+			return -ENOMEM;
+		}
+		batch->msgs = msgs_new;
+		batch->size = size_new;
+	}
+	batch->msgs[batch->count] = msg;
+
+	return batch->count++;
+}
+
+/*
+ * Batch Functions
+ */
+
+/**
+ * Create a new NetLabel batch
+ *
+ * Create a new, empty, NetLabel batch which can be used to queue multiple
+ * configuration requests and send them to the kernel back to back.  Returns a
+ * pointer to the batch on success, NULL on failure.
+ *
+ */
+struct nlbl_batch *nlbl_batch_new(void)
+{
+	return calloc(1, sizeof(struct nlbl_batch));
+}
+
+/**
+ * Free a NetLabel batch
+ * @param batch the NetLabel batch
+ *
+ * Free the NetLabel batch and any requests queued within it.
+ *
+ */
+void nlbl_batch_free(struct nlbl_batch *batch)
+{
+	uint32_t iter;
+
+	if (batch == NULL)
+		return;
+
+	for (iter = 0; iter < batch->count; iter++)
+		nlbl_msg_free(batch->msgs[iter]);
+	if (batch->msgs != NULL)
+		free(batch->msgs);
+	free(batch);
+}
+
+/**
+ * Return the number of requests in a NetLabel batch
+ * @param batch the NetLabel batch
+ *
+ * Returns the number of requests queued in @batch.
+ *
+ */
+size_t nlbl_batch_count(struct nlbl_batch *batch)
+{
+	if (batch == NULL)
+		return 0;
+	return batch->count;
+}
+
+/**
+ * Send the requests in a NetLabel batch and collect the results and replies
+ * @param hndl the NetLabel handle
+ * @param batch the NetLabel batch
+ * @param status the per-request status array, may be NULL
+ * @param cb the reply callback, may be NULL
+ * @param cb_arg the reply callback argument
+ *
+ * See nlbl_batch_exec(), in addition any messages other than the ACKs which
+ * the kernel sends in reply to a request, e.g. the results of a LIST request,
+ * are passed to @cb along with the index of the request before the request's
+ * ACK is processed.  Returns the number of failed requests on success,
+ * negative values if the batch could not be completed.
+ *
+ */
+int nlbl_batch_exec_reply(struct nlbl_handle *hndl,
+			  struct nlbl_batch *batch,
+			  int *status,
+			  nlbl_batch_reply_cb cb, void *cb_arg)
+{
+	int rc = -ENOMEM;
+	struct nlbl_handle *p_hndl = hndl;
+	int *res = NULL;
+	unsigned char *buf = NULL;
+	size_t buf_size = NLBL_BATCH_BUFLEN;
+	size_t buf_len;
+	size_t msg_len;
+	unsigned char *data = NULL;
+	int data_len;
+	struct nlmsghdr *nl_hdr;
+	struct nlmsgerr *nl_err;
+	uint32_t seq_first = 0;
+	uint32_t seq_idx;
+	uint32_t sent = 0;
+	uint32_t acked = 0;
+	uint32_t iter;
+	int failed = 0;
+
+	/* sanity checks */
+	if (batch == NULL)
+		return -EINVAL;
+	if (batch->count == 0)
+		return 0;
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto exec_return;
+	}
+
+	/* results are positive until the request has been acknowledged */
+	res = malloc(sizeof(*res) * batch->count);
+	if (res == NULL)
+		goto exec_return;
+	buf = malloc(buf_size);
+	if (buf == NULL)
+		goto exec_return;
+
+	/* assign consecutive sequence numbers to the requests */
+	for (iter = 0; iter < batch->count; iter++) {
+		rc = nlbl_comm_msg_complete(p_hndl, batch->msgs[iter]);
+		if (rc < 0)
+			goto exec_return;
+		nl_hdr = nlbl_msg_nlhdr(batch->msgs[iter]);
+		if (iter == 0)
+			seq_first = nl_hdr->nlmsg_seq;
+		res[iter] = 1;
+	}
+
+	while (acked < batch->count) {
+		/* refill the window once it is half empty */
+		buf_len = 0;
+		while (sent < batch->count &&
+		       (buf_len > 0 || sent - acked <= NLBL_BATCH_WINDOW / 2) &&
+		       sent - acked < NLBL_BATCH_WINDOW) {
+			nl_hdr = nlbl_msg_nlhdr(batch->msgs[sent]);
+			msg_len = NLMSG_ALIGN(nl_hdr->nlmsg_len);
+			if (buf_len > 0 && buf_len + msg_len > buf_size)
+				break;
+			if (msg_len > buf_size) {
+				free(buf);
+				buf = malloc(msg_len);
+				if (buf == NULL) {
+					rc = -ENOMEM;
+					goto exec_return;
+				}
+				buf_size = msg_len;
+			}
+			memcpy(buf + buf_len, nl_hdr, nl_hdr->nlmsg_len);
+			memset(buf + buf_len + nl_hdr->nlmsg_len, 0,
+			       msg_len - nl_hdr->nlmsg_len);
+			buf_len += msg_len;
+			sent++;
+		}
+		if (buf_len > 0) {
+			rc = nlbl_comm_send_raw(p_hndl, buf, buf_len);
+			if (rc <= 0) {
+				if (rc == 0)
+					rc = -ENODATA;
+				goto exec_return;
+			}
+		}
+
+		/* collect the ACKs */
+		rc = nlbl_comm_recv_raw(p_hndl, &data);
+		if (rc <= 0) {
+			if (rc == 0)
+				rc = -ENODATA;
+			goto exec_return;
+		}
+		data_len = rc;
+		nl_hdr = (struct nlmsghdr *)data;
+		while (nlmsg_ok(nl_hdr, data_len)) {
+			seq_idx = nl_hdr->nlmsg_seq - seq_first;
+			if (nl_hdr->nlmsg_type != NLMSG_ERROR &&
+			    nl_hdr->nlmsg_type != NLMSG_DONE &&
+			    cb != NULL && seq_idx < sent && res[seq_idx] > 0)
+				cb(seq_idx, nl_hdr, cb_arg);
+			else if (nl_hdr->nlmsg_type == NLMSG_ERROR &&
+				 seq_idx < sent && res[seq_idx] > 0) {
+				nl_err = nlmsg_data(nl_hdr);
+				res[seq_idx] = nl_err->error;
+				if (res[seq_idx] < 0)
+					failed++;
+				acked++;
+			}
+			nl_hdr = nlmsg_next(nl_hdr, &data_len);
+		}
+		free(data);
+		data = NULL;
+	}
+
+	if (status != NULL)
+		memcpy(status, res, sizeof(*res) * batch->count);
+	rc = failed;
+
+exec_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	if (data != NULL)
+		free(data);
+	if (buf != NULL)
+		free(buf);
+	if (res != NULL)
+		free(res);
+	return rc;
+}
+
+/**
+ * Send the requests in a NetLabel batch and collect the results
+ * @param hndl the NetLabel handle
+ * @param batch the NetLabel batch
+ * @param status the per-request status array, may be NULL
+ *
+ * Send all of the requests queued in @batch to the kernel, writing multiple
+ * requests at once and keeping a window of requests outstanding rather than
+ * waiting for each ACK in turn.  The ACKs are matched to their requests using
+ * the netlink sequence numbers and the result of each request is stored in
+ * the matching entry of @status, which must be large enough to hold
+ * nlbl_batch_count() entries.  If @hndl is NULL then the function will borrow
+ * a handle from the handle pool.  Returns the number of failed requests on
+ * success, negative values if the batch could not be completed.
+ *
+ */
+int nlbl_batch_exec(struct nlbl_handle *hndl,
+		    struct nlbl_batch *batch,
+		    int *status)
+{
+	return nlbl_batch_exec_reply(hndl, batch, status, NULL, NULL);
+}
@@ -0,0 +1,742 @@
+/** @file
+ * NetLabel Request Cache
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The request cache keeps a mirror of the kernel's NetLabel configuration in
+ * the form of the kernel's replies to the NetLabel queries, the list and
+ * version commands.  A query is answered from the cache when the same query,
+ * with the same attributes, has been answered by the kernel before; otherwise
+ * it is passed to the kernel and the replies are kept.  Configuration changes
+ * are always passed to the kernel and drop the cached replies of the families
+ * they change.  Replies are sent back with the port and sequence number of the
+ * request they answer, so to the requester the cache looks just like the
+ * kernel.  Changes made to the kernel's configuration by other means are only
+ * seen once the cached replies expire or the cache is flushed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* maximum number of cached queries for each family */
+#define NLBL_CACHE_ENTRY_MAX		1024
+
+/* size at which replies are handed to the requester */
+#define NLBL_CACHE_OUT_SIZE		32768
+
+/* NetLabel families */
+#define NLBL_CACHE_FAM_MGMT		0
+#define NLBL_CACHE_FAM_CIPSOV4		1
+#define NLBL_CACHE_FAM_UNLBL		2
+
+/* NetLabel families, their queries, and the families whose configuration
+ * their changes affect; removing a CIPSOv4 DOI also removes the domain
+ * mappings which use it */
+#define NLBL_CACHE_CMD(cmd)		(1U << (cmd))
+#define NLBL_CACHE_FAM(fam)		(1U << (fam))
+static const struct {
+	const char *name;
+	uint32_t queries;
+	uint32_t changes;
+} nlcache_fams[] = {
+	[NLBL_CACHE_FAM_MGMT] = {
+		NETLBL_NLTYPE_MGMT_NAME,
+		NLBL_CACHE_CMD(NLBL_MGMT_C_LISTALL) |
+		NLBL_CACHE_CMD(NLBL_MGMT_C_LISTDEF) |
+		NLBL_CACHE_CMD(NLBL_MGMT_C_PROTOCOLS) |
+		NLBL_CACHE_CMD(NLBL_MGMT_C_VERSION),
+		NLBL_CACHE_FAM(NLBL_CACHE_FAM_MGMT) },
+	[NLBL_CACHE_FAM_CIPSOV4] = {
+		NETLBL_NLTYPE_CIPSOV4_NAME,
+		NLBL_CACHE_CMD(NLBL_CIPSOV4_C_LIST) |
+		NLBL_CACHE_CMD(NLBL_CIPSOV4_C_LISTALL),
+		NLBL_CACHE_FAM(NLBL_CACHE_FAM_CIPSOV4) |
+		NLBL_CACHE_FAM(NLBL_CACHE_FAM_MGMT) },
+	[NLBL_CACHE_FAM_UNLBL] = {
+		NETLBL_NLTYPE_UNLABELED_NAME,
+		NLBL_CACHE_CMD(NLBL_UNLABEL_C_LIST) |
+		NLBL_CACHE_CMD(NLBL_UNLABEL_C_STATICLIST) |
+		NLBL_CACHE_CMD(NLBL_UNLABEL_C_STATICLISTDEF),
+		NLBL_CACHE_FAM(NLBL_CACHE_FAM_UNLBL) },
+};
+#define NLBL_CACHE_FAM_MAX \
+	(sizeof(nlcache_fams) / sizeof(nlcache_fams[0]))
+
+/* buffer of replies */
+struct nlbl_cache_buf {
+	struct nlbl_cache_buf *next;
+	size_t len;
+	unsigned char data[];
+};
+
+/* cached query and its replies */
+struct nlbl_cache_entry {
+	struct nlbl_cache_entry *next;
+	uint8_t cmd;
+	uint16_t dump;
+	uint64_t stamp;
+	struct nlbl_cache_buf *bufs;
+	struct nlbl_cache_buf **bufs_tail;
+	size_t attr_len;
+	unsigned char attr[];
+};
+
+/* request cache */
+struct nlbl_cache {
+	struct nlbl_handle *hndl;
+	uint32_t max_age;
+	int fid[NLBL_CACHE_FAM_MAX];
+	struct nlbl_cache_entry *entries[NLBL_CACHE_FAM_MAX];
+	unsigned int entry_cnt[NLBL_CACHE_FAM_MAX];
+};
+
+/* request being answered */
+struct nlbl_cache_req {
+	struct nlmsghdr *nl_hdr;
+	nlbl_cache_reply_cb cb;
+	void *arg;
+	int rc;
+	unsigned char *out;
+	size_t out_len;
+	size_t out_size;
+};
+
+/*
+ * Helper Functions
+ */
+
+/**
+ * Return the current time
+ *
+ * Returns the value of the monotonic clock in seconds.
+ *
+ */
+static uint64_t nlbl_cache_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/**
+ * Address a buffer of replies to a request
+ * @param buf the reply buffer
+ * @param len the length of the reply buffer
+ * @param port the port of the request
+ * @param seq the sequence number of the request
+ *
+ * Set the port and sequence number of each reply in @buf, including the copy
+ * of the request carried by errors and ACKs.
+ *
+ */
+static void nlbl_cache_address(void *buf, size_t len,
+			       uint32_t port, uint32_t seq)
+{
+	struct nlmsghdr *nl_hdr = buf;
+	struct nlmsgerr *nl_err;
+	int rem = len;
+
+	for (; nlmsg_ok(nl_hdr, rem); nl_hdr = nlmsg_next(nl_hdr, &rem)) {
+		nl_hdr->nlmsg_pid = port;
+		nl_hdr->nlmsg_seq = seq;
+		if (nl_hdr->nlmsg_type == NLMSG_ERROR &&
+		    nl_hdr->nlmsg_len >= nlmsg_size(sizeof(*nl_err))) {
+			nl_err = nlmsg_data(nl_hdr);
+			nl_err->msg.nlmsg_pid = port;
+			nl_err->msg.nlmsg_seq = seq;
+		}
+	}
+}
+
+/**
+ * Check if a buffer of replies completes a request
+ * @param buf the reply buffer
+ * @param len the length of the reply buffer
+ * @param flags the flags of the request
+ *
+ * Returns true if @buf holds the last reply to a request with the flags
+ * @flags, false otherwise.
+ *
+ */
+static unsigned int nlbl_cache_complete(const void *buf, size_t len,
+					uint16_t flags)
+{
+	const struct nlmsghdr *nl_hdr = buf;
+	int rem = len;
+
+	for (; nlmsg_ok(nl_hdr, rem);
+	     nl_hdr = nlmsg_next((struct nlmsghdr *)nl_hdr, &rem)) {
+		if (nl_hdr->nlmsg_type == NLMSG_DONE ||
+		    nl_hdr->nlmsg_type == NLMSG_ERROR)
+			return 1;
+		if (!(nl_hdr->nlmsg_flags & NLM_F_MULTI) &&
+		    !(flags & (NLM_F_ACK | NLM_F_DUMP)))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Hand the pending replies to the requester
+ * @param req the request
+ *
+ * Pass the replies collected by nlbl_cache_reply() to the requester's
+ * callback.  Once the callback fails no more replies are sent and the failure
+ * is returned to the caller of nlbl_cache_request().
+ *
+ */
+static void nlbl_cache_reply_flush(struct nlbl_cache_req *req)
+{
+	if (req->out_len == 0)
+		return;
+	if (req->rc == 0)
+		req->rc = req->cb(req->out, req->out_len, req->arg);
+	req->out_len = 0;
+}
+
+/**
+ * Send a buffer of replies to the requester
+ * @param req the request
+ * @param buf the reply buffer
+ * @param len the length of the reply buffer
+ *
+ * Add a copy of @buf, addressed to @req, to the pending replies.  Replies are
+ * collected until they fill NLBL_CACHE_OUT_SIZE bytes or the whole buffer of
+ * requests has been answered, this avoids a write to the requester for each
+ * ACK of a batch.  Only dumps are split in the middle, a reply and the ACK
+ * which follows it are handed over together so that the ACK is waiting by the
+ * time the reply is read, as it is with the kernel.
+ *
+ */
+static void nlbl_cache_reply(struct nlbl_cache_req *req,
+			     const void *buf, size_t len)
+{
+	unsigned char *out;
+	size_t size;
+
+	if (req->rc < 0)
+		return;
+
+	if (req->out_len > 0 && req->out_len + len > NLBL_CACHE_OUT_SIZE &&
+	    (req->nl_hdr->nlmsg_flags & NLM_F_DUMP))
+		nlbl_cache_reply_flush(req);
+	if (req->out_len + NLMSG_ALIGN(len) > req->out_size) {
+		size = req->out_len + NLMSG_ALIGN(len);
+		if (size < NLBL_CACHE_OUT_SIZE)
+			size = NLBL_CACHE_OUT_SIZE;
+		out = realloc(req->out, size);
+		if (out == NULL) {
+			req->rc = -ENOMEM;
+			return;
+		}
+		req->out = out;
+		req->out_size = size;
+	}
+
+	out = req->out + req->out_len;
+	memcpy(out, buf, len);
+	memset(out + len, 0, NLMSG_ALIGN(len) - len);
+	nlbl_cache_address(out, len, req->nl_hdr->nlmsg_pid,
+			   req->nl_hdr->nlmsg_seq);
+	req->out_len += NLMSG_ALIGN(len);
+}
+
+/**
+ * Send an error or ACK to the requester
+ * @param req the request
+ * @param error the error code, zero for an ACK
+ *
+ * An ACK is only sent if the request asked for one.
+ *
+ */
+static void nlbl_cache_ack(struct nlbl_cache_req *req, int error)
+{
+	struct {
+		struct nlmsghdr nl_hdr;
+		struct nlmsgerr nl_err;
+	} ack;
+
+	if (error == 0 && !(req->nl_hdr->nlmsg_flags & NLM_F_ACK))
+		return;
+
+	memset(&ack, 0, sizeof(ack));
+	ack.nl_hdr.nlmsg_len = sizeof(ack);
+	ack.nl_hdr.nlmsg_type = NLMSG_ERROR;
+	ack.nl_err.error = error;
+	ack.nl_err.msg = *req->nl_hdr;
+	nlbl_cache_reply(req, &ack, sizeof(ack));
+}
+
+/*
+ * Cache Entry Functions
+ */
+
+/**
+ * Free a cache entry
+ * @param entry the cache entry
+ *
+ */
+static void nlbl_cache_entry_free(struct nlbl_cache_entry *entry)
+{
+	struct nlbl_cache_buf *buf;
+
+	while (entry->bufs != NULL) {
+		buf = entry->bufs;
+		entry->bufs = buf->next;
+		free(buf);
+	}
+	free(entry);
+}
+
+/**
+ * Drop the cached queries of a family
+ * @param cache the request cache
+ * @param fam the family
+ *
+ */
+static void nlbl_cache_drop(struct nlbl_cache *cache, unsigned int fam)
+{
+	struct nlbl_cache_entry *entry;
+
+	while (cache->entries[fam] != NULL) {
+		entry = cache->entries[fam];
+		cache->entries[fam] = entry->next;
+		nlbl_cache_entry_free(entry);
+	}
+	cache->entry_cnt[fam] = 0;
+}
+
+/**
+ * Find a cached query
+ * @param cache the request cache
+ * @param fam the family
+ * @param nl_hdr the query
+ *
+ * Look for a cached query matching the command, dump flag and attributes of
+ * @nl_hdr; expired queries are dropped.  Returns the cache entry if found,
+ * NULL otherwise.
+ *
+ */
+static struct nlbl_cache_entry *nlbl_cache_find(struct nlbl_cache *cache,
+						unsigned int fam,
+						struct nlmsghdr *nl_hdr)
+{
+	struct nlbl_cache_entry **iter;
+	struct nlbl_cache_entry *entry;
+	struct genlmsghdr *genl_hdr = nlmsg_data(nl_hdr);
+	size_t attr_len = genlmsg_attrlen(genl_hdr, 0);
+
+	for (iter = &cache->entries[fam]; *iter != NULL;
+	     iter = &(*iter)->next) {
+		entry = *iter;
+		if (entry->cmd != genl_hdr->cmd ||
+		    entry->dump != (nl_hdr->nlmsg_flags & NLM_F_DUMP) ||
+		    entry->attr_len != attr_len ||
+		    memcmp(entry->attr, genlmsg_attrdata(genl_hdr, 0),
+			   attr_len) != 0)
+			continue;
+
+		if (cache->max_age > 0 &&
+		    nlbl_cache_now() - entry->stamp >= cache->max_age) {
+			*iter = entry->next;
+			nlbl_cache_entry_free(entry);
+			cache->entry_cnt[fam]--;
+			return NULL;
+		}
+		return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * Create a cache entry for a query
+ * @param nl_hdr the query
+ *
+ * Returns a new, empty, cache entry on success, NULL on failure.
+ *
+ */
+static struct nlbl_cache_entry *nlbl_cache_entry_new(struct nlmsghdr *nl_hdr)
+{
+	struct nlbl_cache_entry *entry;
+	struct genlmsghdr *genl_hdr = nlmsg_data(nl_hdr);
+	size_t attr_len = genlmsg_attrlen(genl_hdr, 0);
+
+	entry = calloc(1, sizeof(*entry) + attr_len);
+	if (entry == NULL)
+		return NULL;
+	entry->cmd = genl_hdr->cmd;
+	entry->dump = nl_hdr->nlmsg_flags & NLM_F_DUMP;
+	entry->stamp = nlbl_cache_now();
+	entry->bufs_tail = &entry->bufs;
+	entry->attr_len = attr_len;
+	memcpy(entry->attr, genlmsg_attrdata(genl_hdr, 0), attr_len);
+
+	return entry;
+}
+
+/**
+ * Add a buffer of replies to a cache entry
+ * @param entry the cache entry
+ * @param data the reply buffer
+ * @param len the length of the reply buffer
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cache_entry_add(struct nlbl_cache_entry *entry,
+				const void *data, size_t len)
+{
+	struct nlbl_cache_buf *buf;
+
+	buf = malloc(sizeof(*buf) + len);
+	if (buf == NULL)
+		return -ENOMEM;
+	buf->next = NULL;
+	buf->len = len;
+	memcpy(buf->data, data, len);
+	*entry->bufs_tail = buf;
+	entry->bufs_tail = &buf->next;
+
+	return 0;
+}
+
+/*
+ * Request Functions
+ */
+
+/**
+ * Answer a request from the cache
+ * @param entry the cache entry
+ * @param req the request
+ *
+ */
+static void nlbl_cache_replay(struct nlbl_cache_entry *entry,
+			      struct nlbl_cache_req *req)
+{
+	struct nlbl_cache_buf *buf;
+
+	for (buf = entry->bufs; buf != NULL && req->rc == 0; buf = buf->next)
+		nlbl_cache_reply(req, buf->data, buf->len);
+}
+
+/**
+ * Pass a request to the kernel
+ * @param cache the request cache
+ * @param req the request
+ * @param entry the cache entry for the replies, NULL if they are not cached
+ *
+ * Send the request in @req to the kernel using the cache's handle and pass the
+ * kernel's replies back to the requester, keeping a copy in @entry.  Returns
+ * zero on success, negative values if the kernel could not be reached.
+ *
+ */
+static int nlbl_cache_forward(struct nlbl_cache *cache,
+			      struct nlbl_cache_req *req,
+			      struct nlbl_cache_entry *entry)
+{
+	int rc;
+	struct nlmsghdr *nl_hdr;
+	unsigned char *data = NULL;
+	unsigned int done = 0;
+
+	nl_hdr = malloc(req->nl_hdr->nlmsg_len);
+	if (nl_hdr == NULL)
+		return -ENOMEM;
+	memcpy(nl_hdr, req->nl_hdr, req->nl_hdr->nlmsg_len);
+	nl_hdr->nlmsg_pid = cache->hndl->ops->port(cache->hndl);
+	nl_hdr->nlmsg_seq = cache->hndl->ops->seq(cache->hndl);
+
+	/* discard anything left over from an earlier request */
+	cache->hndl->ops->drain(cache->hndl);
+	rc = nlbl_comm_send_raw(cache->hndl, nl_hdr, nl_hdr->nlmsg_len);
+	if (rc < 0)
+		goto forward_return;
+
+	while (!done) {
+		rc = nlbl_comm_recv_raw(cache->hndl, &data);
+		if (rc <= 0) {
+			if (rc == 0)
+				rc = -ENODATA;
+			goto forward_return;
+		}
+		done = nlbl_cache_complete(data, rc, nl_hdr->nlmsg_flags);
+		if (entry != NULL &&
+		    nlbl_cache_entry_add(entry, data, rc) < 0) {
+			rc = -ENOMEM;
+			goto forward_return;
+		}
+		nlbl_cache_reply(req, data, rc);
+		free(data);
+		data = NULL;
+	}
+	rc = 0;
+
+forward_return:
+	free(data);
+	free(nl_hdr);
+	return rc;
+}
+
+/**
+ * Answer a Generic Netlink family request
+ * @param cache the request cache
+ * @param req the request
+ *
+ * Answer a CTRL_CMD_GETFAMILY request for one of the NetLabel families with the
+ * kernel's family ID.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_cache_family(struct nlbl_cache *cache,
+			     struct nlbl_cache_req *req)
+{
+	int rc;
+	unsigned int fam;
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct nl_msg *msg;
+	struct nlmsghdr *nl_hdr;
+
+	if (((struct genlmsghdr *)nlmsg_data(req->nl_hdr))->cmd !=
+	    CTRL_CMD_GETFAMILY)
+		return -EOPNOTSUPP;
+	rc = nla_parse(tb, CTRL_ATTR_MAX,
+		       genlmsg_attrdata(nlmsg_data(req->nl_hdr), 0),
+		       genlmsg_attrlen(nlmsg_data(req->nl_hdr), 0), NULL);
+	if (rc != 0 || tb[CTRL_ATTR_FAMILY_NAME] == NULL)
+		return -EINVAL;
+	for (fam = 0; fam < NLBL_CACHE_FAM_MAX; fam++)
+		if (nla_strcmp(tb[CTRL_ATTR_FAMILY_NAME],
+			       nlcache_fams[fam].name) == 0)
+			break;
+	if (fam == NLBL_CACHE_FAM_MAX || cache->fid[fam] < 0)
+		return -ENOENT;
+
+	msg = nlmsg_alloc();
+	if (msg == NULL)
+		return -ENOMEM;
+	if (genlmsg_put(msg, 0, 0, GENL_ID_CTRL, 0, 0,
+			CTRL_CMD_NEWFAMILY, 2) == NULL ||
+	    nla_put_u16(msg, CTRL_ATTR_FAMILY_ID, cache->fid[fam]) < 0 ||
+	    nla_put_string(msg, CTRL_ATTR_FAMILY_NAME,
+			   nlcache_fams[fam].name) < 0) {
+		nlmsg_free(msg);
+		return -ENOMEM;
+	}
+	nl_hdr = nlmsg_hdr(msg);
+	nlbl_cache_reply(req, nl_hdr, nl_hdr->nlmsg_len);
+	nlmsg_free(msg);
+	nlbl_cache_ack(req, 0);
+
+	return 0;
+}
+
+/**
+ * Answer a NetLabel request
+ * @param cache the request cache
+ * @param req the request
+ * @param admin true if the requester may change the configuration
+ *
+ * Answer a query from the cache, or from the kernel if it is not cached, and
+ * pass configuration changes to the kernel.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_cache_netlabel(struct nlbl_cache *cache,
+			       struct nlbl_cache_req *req,
+			       unsigned int admin)
+{
+	int rc;
+	unsigned int fam;
+	unsigned int iter;
+	uint8_t cmd = ((struct genlmsghdr *)nlmsg_data(req->nl_hdr))->cmd;
+	struct nlbl_cache_entry *entry;
+
+	for (fam = 0; fam < NLBL_CACHE_FAM_MAX; fam++)
+		if (cache->fid[fam] >= 0 &&
+		    cache->fid[fam] == req->nl_hdr->nlmsg_type)
+			break;
+	if (fam == NLBL_CACHE_FAM_MAX)
+		return -ENOENT;
+
+	/* configuration changes */
+	if (cmd >= 32 || !(nlcache_fams[fam].queries & NLBL_CACHE_CMD(cmd))) {
+		if (!admin)
+			return -EPERM;
+		rc = nlbl_cache_forward(cache, req, NULL);
+		for (iter = 0; iter < NLBL_CACHE_FAM_MAX; iter++)
+			if (nlcache_fams[fam].changes & NLBL_CACHE_FAM(iter))
+				nlbl_cache_drop(cache, iter);
+		return rc;
+	}
+
+	/* queries */
+	entry = nlbl_cache_find(cache, fam, req->nl_hdr);
+	if (entry != NULL) {
+		nlbl_cache_replay(entry, req);
+		return 0;
+	}
+	entry = nlbl_cache_entry_new(req->nl_hdr);
+	if (entry == NULL)
+		return -ENOMEM;
+	rc = nlbl_cache_forward(cache, req, entry);
+	if (rc < 0) {
+		nlbl_cache_entry_free(entry);
+		return rc;
+	}
+	if (cache->entry_cnt[fam] >= NLBL_CACHE_ENTRY_MAX)
+		nlbl_cache_drop(cache, fam);
+	entry->next = cache->entries[fam];
+	cache->entries[fam] = entry;
+	cache->entry_cnt[fam]++;
+
+	return 0;
+}
+
+/*
+ * Request Cache Functions
+ */
+
+/**
+ * Create a NetLabel request cache
+ * @param max_age the time to keep cached replies, in seconds
+ *
+ * Create a new request cache which talks to the kernel using a NetLabel
+ * handle opened with the currently selected transport.  Cached replies are
+ * dropped @max_age seconds after they were received, or only when the
+ * configuration is changed through the cache if @max_age is zero.  Returns a
+ * pointer to the request cache on success, NULL on failure.
+ *
+ */
+struct nlbl_cache *nlbl_cache_new(uint32_t max_age)
+{
+	struct nlbl_cache *cache;
+	unsigned int iter;
+
+	cache = calloc(1, sizeof(*cache));
+	if (cache == NULL)
+		return NULL;
+	cache->max_age = max_age;
+
+	cache->hndl = nlbl_comm_open();
+	if (cache->hndl == NULL) {
+		free(cache);
+		return NULL;
+	}
+	for (iter = 0; iter < NLBL_CACHE_FAM_MAX; iter++)
+		cache->fid[iter] = nlbl_comm_resolve(cache->hndl,
+						     nlcache_fams[iter].name);
+
+	return cache;
+}
+
+/**
+ * Free a NetLabel request cache
+ * @param cache the request cache
+ *
+ */
+void nlbl_cache_free(struct nlbl_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	nlbl_cache_flush(cache);
+	nlbl_comm_close(cache->hndl);
+	free(cache);
+}
+
+/**
+ * Flush a NetLabel request cache
+ * @param cache the request cache
+ *
+ * Drop all of the cached replies so that the next queries are answered by the
+ * kernel, this should be done when the kernel's configuration may have been
+ * changed without going through the cache.
+ *
+ */
+void nlbl_cache_flush(struct nlbl_cache *cache)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < NLBL_CACHE_FAM_MAX; iter++)
+		nlbl_cache_drop(cache, iter);
+}
+
+/**
+ * Answer a buffer of NetLabel requests
+ * @param cache the request cache
+ * @param buf the request buffer
+ * @param len the length of the request buffer
+ * @param admin true if the requester may change the configuration
+ * @param cb the reply callback
+ * @param arg the argument passed to @cb
+ *
+ * Answer each of the generic netlink requests in @buf in turn, passing the
+ * replies to @cb just as the kernel would send them, the reply buffer is only
+ * valid during the callback.  Queries are answered from the cache when
+ * possible; configuration changes are passed to the kernel if @admin is true
+ * and fail with -EPERM otherwise.  Requests which fail are answered with an
+ * error message.  Returns zero on success, negative values if @cb fails.
+ *
+ */
+int nlbl_cache_request(struct nlbl_cache *cache,
+		       void *buf, size_t len, unsigned int admin,
+		       nlbl_cache_reply_cb cb, void *arg)
+{
+	int rc;
+	int rem = len;
+	struct nlbl_cache_req req;
+
+	if (cache == NULL || buf == NULL || cb == NULL)
+		return -EINVAL;
+
+	memset(&req, 0, sizeof(req));
+	req.cb = cb;
+	req.arg = arg;
+	for (req.nl_hdr = buf; nlmsg_ok(req.nl_hdr, rem) && req.rc == 0;
+	     req.nl_hdr = nlmsg_next(req.nl_hdr, &rem)) {
+		if (!(req.nl_hdr->nlmsg_flags & NLM_F_REQUEST))
+			continue;
+
+		if (req.nl_hdr->nlmsg_len < NLMSG_HDRLEN + GENL_HDRLEN)
+			rc = -EINVAL;
+		else if (req.nl_hdr->nlmsg_type == GENL_ID_CTRL)
+			rc = nlbl_cache_family(cache, &req);
+		else
+			rc = nlbl_cache_netlabel(cache, &req, admin);
+		if (rc < 0)
+			nlbl_cache_ack(&req, rc);
+		if (req.out_len >= NLBL_CACHE_OUT_SIZE)
+			nlbl_cache_reply_flush(&req);
+	}
+	nlbl_cache_reply_flush(&req);
+	free(req.out);
+
+	return req.rc;
+}
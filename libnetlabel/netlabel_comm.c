@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <linux/types.h>
 #include <sys/types.h>
 
@@ -43,6 +44,295 @@
 /* Netlink read timeout (in seconds) */
 static uint32_t nlcomm_read_timeout = 10;
 
+/* NetLabel handle pool, used by functions called with a NULL handle */
+static pthread_mutex_t nlcomm_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct nlbl_handle **nlcomm_pool = NULL;
+static uint32_t nlcomm_pool_count = 0;
+static uint32_t nlcomm_pool_max = 1;
+
+/*
+ * Netlink Transport
+ */
+
+/**
+ * Convert a libnl error into an errno value
+ * @param rc the libnl return value
+ *
+ * Convert a negative libnl error code, as returned by nl_recv() and
+ * nl_sendto(), into the matching negative errno value so that the netlink
+ * transport reports errors the same way as the other transports.  libnl
+ * reports both a failed allocation and a receive buffer overflow as
+ * NLE_NOMEM, the overflow is told apart by the errno left by recvmsg().
+ * Values which are not errors are returned unchanged.
+ *
+ */
+static int nlbl_comm_nl_errno(int rc)
+{
+	if (rc >= 0)
+		return rc;
+
+	switch (-rc) {
+	case NLE_INTR:
+		return -EINTR;
+	case NLE_BAD_SOCK:
+		return -EBADF;
+	case NLE_AGAIN:
+		return -EAGAIN;
+	case NLE_NOMEM:
+		return (errno == ENOBUFS ? -ENOBUFS : -ENOMEM);
+	case NLE_EXIST:
+		return -EEXIST;
+	case NLE_INVAL:
+		return -EINVAL;
+	case NLE_RANGE:
+		return -ERANGE;
+	case NLE_MSGSIZE:
+	case NLE_MSG_TRUNC:
+		return -EMSGSIZE;
+	case NLE_OPNOTSUPP:
+		return -EOPNOTSUPP;
+	case NLE_AF_NOSUPPORT:
+		return -EAFNOSUPPORT;
+	case NLE_OBJ_NOTFOUND:
+		return -ENOENT;
+	case NLE_MSG_OVERFLOW:
+	case NLE_MSG_TOOSHORT:
+		return -EBADMSG;
+	case NLE_BUSY:
+		return -EBUSY;
+	case NLE_PROTO_MISMATCH:
+		return -EPROTONOSUPPORT;
+	case NLE_NOACCESS:
+		return -EACCES;
+	case NLE_PERM:
+		return -EPERM;
+	case NLE_NODEV:
+		return -ENODEV;
+	}
+
+	return -EIO;
+}
+
+/**
+ * Create and connect a netlink socket
+ * @param hndl the NetLabel handle
+ *
+ * Create a new netlink socket for @hndl and connect it to the Generic Netlink
+ * subsystem in the kernel.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int nlbl_comm_nl_open(struct nlbl_handle *hndl)
+{
+	/* create a new netlink socket */
+	hndl->nl_sock = nl_socket_alloc();
+	if (hndl->nl_sock == NULL)
+		return -ENOMEM;
+
+	/* set the netlink socket properties */
+	nl_socket_set_peer_port(hndl->nl_sock, 0);
+	nl_socket_disable_seq_check(hndl->nl_sock);
+	nl_socket_set_passcred(hndl->nl_sock, 1);
+
+	/* connect to the generic netlink subsystem in the kernel */
+	if (nl_connect(hndl->nl_sock, NETLINK_GENERIC) != 0) {
+		nl_close(hndl->nl_sock);
+		nl_socket_free(hndl->nl_sock);
+		hndl->nl_sock = NULL;
+		return -ENOTCONN;
+	}
+
+	/* make room for many large replies at once, this is only a hint as the
+	 * kernel limits the size to net.core.rmem_max */
+	nl_socket_set_buffer_size(hndl->nl_sock, NLBL_COMM_RCVBUF, 0);
+
+	return 0;
+}
+
+/**
+ * Close a netlink socket
+ * @param hndl the NetLabel handle
+ *
+ */
+static void nlbl_comm_nl_close(struct nlbl_handle *hndl)
+{
+	nl_close(hndl->nl_sock);
+	nl_socket_free(hndl->nl_sock);
+	hndl->nl_sock = NULL;
+}
+
+/**
+ * Resolve a Generic Netlink family
+ * @param hndl the NetLabel handle
+ * @param family the family name
+ *
+ * Returns the family ID on success, negative values on failure.
+ *
+ */
+static int nlbl_comm_nl_resolve(struct nlbl_handle *hndl, const char *family)
+{
+	return genl_ctrl_resolve(hndl->nl_sock, family);
+}
+
+/**
+ * Return the netlink port of a socket
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_comm_nl_port(struct nlbl_handle *hndl)
+{
+	return nl_socket_get_local_port(hndl->nl_sock);
+}
+
+/**
+ * Return the next sequence number of a socket
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_comm_nl_seq(struct nlbl_handle *hndl)
+{
+	return nl_socket_use_seq(hndl->nl_sock);
+}
+
+/**
+ * Write a buffer of messages to a netlink socket
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ *
+ * Returns the number of bytes written on success, or negative values on
+ * failure.
+ *
+ */
+static int nlbl_comm_nl_send(struct nlbl_handle *hndl, void *buf, size_t len)
+{
+	return nlbl_comm_nl_errno(nl_sendto(hndl->nl_sock, buf, len));
+}
+
+/**
+ * Read a message from a netlink socket without waiting
+ * @param hndl the NetLabel handle
+ * @param data the message buffer
+ *
+ * See nlbl_comm_recv_nowait().  Messages which were not sent by the kernel
+ * are discarded.
+ *
+ */
+static int nlbl_comm_nl_recv(struct nlbl_handle *hndl, unsigned char **data)
+{
+	int rc;
+	struct sockaddr_nl peer_nladdr;
+	struct ucred *creds = NULL;
+
+	/* perform the read operation */
+	*data = NULL;
+	errno = 0;
+	rc = nlbl_comm_nl_errno(nl_recv(hndl->nl_sock,
+					&peer_nladdr, data, &creds));
+	if (rc <= 0)
+		goto recv_failure;
+
+	/* if we are setup to receive credentials, only accept messages from
+	 * the kernel (ignore all others and send an -EAGAIN) */
+	if (creds != NULL && creds->pid != 0) {
+		rc = -EAGAIN;
+		goto recv_failure;
+	}
+
+	return rc;
+
+recv_failure:
+	if (*data != NULL) {
+		free(*data);
+		*data = NULL;
+	}
+	return rc;
+}
+
+/**
+ * Wait for a netlink socket to become readable
+ * @param hndl the NetLabel handle
+ * @param timeout the timeout in seconds
+ *
+ * Returns a positive value if a message is waiting, zero if the timeout
+ * expired, and negative values on failure.
+ *
+ */
+static int nlbl_comm_nl_wait(struct nlbl_handle *hndl, uint32_t timeout)
+{
+	int rc;
+	int nl_fd;
+	fd_set read_fds;
+	struct timeval tv;
+
+	/* we use blocking sockets so do enforce a timeout using select() if
+	 * no data is waiting to be read from the handle */
+	tv.tv_sec = timeout;
+	tv.tv_usec = 0;
+	nl_fd = nl_socket_get_fd(hndl->nl_sock);
+	FD_ZERO(&read_fds);
+	FD_SET(nl_fd, &read_fds);
+	rc = select(nl_fd + 1, &read_fds, NULL, NULL, &tv);
+	if (rc < 0)
+		return -errno;
+
+	return rc;
+}
+
+/**
+ * Discard any unread messages on a netlink socket
+ * @param hndl the NetLabel handle
+ *
+ * Read and discard any messages queued on @hndl without blocking, this
+ * includes trailing ACKs and the remainder of any unfinished dumps.  A receive
+ * buffer overflow reported while draining is cleared along the way.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int nlbl_comm_nl_drain(struct nlbl_handle *hndl)
+{
+	int rc;
+	int nl_fd;
+	unsigned char buf[64];
+
+	nl_fd = nl_socket_get_fd(hndl->nl_sock);
+	do {
+		rc = recv(nl_fd, buf, sizeof(buf), MSG_DONTWAIT | MSG_TRUNC);
+	} while (rc >= 0 || errno == EINTR || errno == ENOBUFS);
+	if (errno != EAGAIN && errno != EWOULDBLOCK)
+		return -errno;
+
+	return 0;
+}
+
+/**
+ * Return the file descriptor of a netlink socket
+ * @param hndl the NetLabel handle
+ *
+ */
+static int nlbl_comm_nl_fd(struct nlbl_handle *hndl)
+{
+	return nl_socket_get_fd(hndl->nl_sock);
+}
+
+/* netlink transport, talks to the NetLabel subsystem in the kernel */
+static const struct nlbl_comm_ops nlbl_comm_nl_ops = {
+	.open = nlbl_comm_nl_open,
+	.close = nlbl_comm_nl_close,
+	.resolve = nlbl_comm_nl_resolve,
+	.port = nlbl_comm_nl_port,
+	.seq = nlbl_comm_nl_seq,
+	.send = nlbl_comm_nl_send,
+	.recv = nlbl_comm_nl_recv,
+	.wait = nlbl_comm_nl_wait,
+	.drain = nlbl_comm_nl_drain,
+	.fd = nlbl_comm_nl_fd,
+};
+
+/* transport used by new handles */
+static const struct nlbl_comm_ops *nlcomm_ops = &nlbl_comm_nl_ops;
+static nlbl_transport nlcomm_transport = NLBL_TRANSPORT_NETLINK;
+
 /*
  * Helper Functions
  */
@@ -56,7 +346,7 @@ static uint32_t nlcomm_read_timeout = 10;
  */
 static int nlbl_comm_hndl_valid(struct nlbl_handle *hndl)
 {
-	return (hndl != NULL && hndl->nl_sock != NULL);
+	return (hndl != NULL && hndl->ops != NULL);
 }
 
 /*
@@ -75,6 +365,190 @@ void nlbl_comm_timeout(uint32_t seconds)
 	nlcomm_read_timeout = seconds;
 }
 
+/**
+ * Return the NetLabel timeout
+ *
+ * Returns the timeout value used by the NetLabel communications layer, in
+ * seconds.
+ *
+ */
+uint32_t nlbl_comm_timeout_get(void)
+{
+	return nlcomm_read_timeout;
+}
+
+/**
+ * Select the NetLabel transport
+ * @param transport the transport
+ *
+ * Select the transport used by NetLabel handles opened from now on, either
+ * NLBL_TRANSPORT_NETLINK to talk to the kernel, NLBL_TRANSPORT_FAKE to talk
+ * to an in-process emulation of the kernel's NetLabel subsystem which is
+ * shared by all of the process' fake handles, NLBL_TRANSPORT_REPLAY to
+ * replay the capture loaded by nlbl_comm_replay(), or NLBL_TRANSPORT_DAEMON
+ * to talk to netlabeld on the socket set with nlbl_comm_daemon().  The idle
+ * handles in the handle pool are closed and the NetLabel families are
+ * resolved again.  This should be called before nlbl_init() and before any
+ * handles are opened.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_comm_transport(nlbl_transport transport)
+{
+	const struct nlbl_comm_ops *ops;
+
+	switch (transport) {
+	case NLBL_TRANSPORT_NETLINK:
+		ops = &nlbl_comm_nl_ops;
+		break;
+	case NLBL_TRANSPORT_FAKE:
+		ops = &nlbl_fake_ops;
+		break;
+	case NLBL_TRANSPORT_REPLAY:
+		ops = &nlbl_replay_ops;
+		break;
+	case NLBL_TRANSPORT_DAEMON:
+		ops = &nlbl_daemon_ops;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	nlbl_comm_pool_drain();
+	nlcomm_ops = ops;
+	nlcomm_transport = transport;
+	nlbl_family_reset();
+
+	return 0;
+}
+
+/**
+ * Return the NetLabel transport
+ *
+ * Returns the transport used by NetLabel handles opened from now on.
+ *
+ */
+nlbl_transport nlbl_comm_transport_get(void)
+{
+	return nlcomm_transport;
+}
+
+/**
+ * Set the size of the NetLabel handle pool
+ * @param size the maximum number of idle handles
+ *
+ * Set the maximum number of idle, connected NetLabel handles which are kept by
+ * the library for use by functions called with a NULL handle.  A @size of
+ * zero disables the pool so that every such call opens and closes its own
+ * handle.  Any idle handles beyond the new limit are closed.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int nlbl_comm_pool_size(uint32_t size)
+{
+	int rc = 0;
+	struct nlbl_handle **pool_new;
+
+	pthread_mutex_lock(&nlcomm_pool_lock);
+
+	while (nlcomm_pool_count > size)
+		nlbl_comm_close(nlcomm_pool[--nlcomm_pool_count]);
+
+	if (size > 0) {
+		pool_new = realloc(nlcomm_pool, sizeof(*nlcomm_pool) * size);
+		if (pool_new == NULL) {
+			rc = -ENOMEM;
+			goto size_return;
+		}
+		nlcomm_pool = pool_new;
+	} else if (nlcomm_pool != NULL) {
+		free(nlcomm_pool);
+		nlcomm_pool = NULL;
+	}
+	nlcomm_pool_max = size;
+
+size_return:
+	pthread_mutex_unlock(&nlcomm_pool_lock);
+	return rc;
+}
+
+/*
+ * Handle Pool Functions
+ */
+
+/**
+ * Borrow a NetLabel handle from the handle pool
+ *
+ * Return an idle NetLabel handle from the pool, or open a new handle if the
+ * pool is empty.  The handle should be returned with nlbl_comm_pool_put()
+ * when it is no longer needed.  Returns a pointer to the handle on success,
+ * NULL on failure.
+ *
+ */
+struct nlbl_handle *nlbl_comm_pool_get(void)
+{
+	struct nlbl_handle *hndl = NULL;
+
+	pthread_mutex_lock(&nlcomm_pool_lock);
+	if (nlcomm_pool_count > 0)
+		hndl = nlcomm_pool[--nlcomm_pool_count];
+	pthread_mutex_unlock(&nlcomm_pool_lock);
+
+	if (hndl == NULL)
+		hndl = nlbl_comm_open();
+	return hndl;
+}
+
+/**
+ * Return a NetLabel handle to the handle pool
+ * @param hndl the NetLabel handle
+ *
+ * Return a handle obtained from nlbl_comm_pool_get() to the pool.  Any
+ * unread messages are discarded so the next borrower starts with an empty
+ * socket; if this fails, or the pool is full, the handle is closed.
+ *
+ */
+void nlbl_comm_pool_put(struct nlbl_handle *hndl)
+{
+	if (!nlbl_comm_hndl_valid(hndl))
+		return;
+
+	if (hndl->ops->drain(hndl) == 0 && hndl->ops == nlcomm_ops) {
+		pthread_mutex_lock(&nlcomm_pool_lock);
+		if (nlcomm_pool_count < nlcomm_pool_max) {
+			if (nlcomm_pool == NULL)
+				nlcomm_pool = malloc(sizeof(*nlcomm_pool) *
+						     nlcomm_pool_max);
+			if (nlcomm_pool != NULL) {
+				nlcomm_pool[nlcomm_pool_count++] = hndl;
+				hndl = NULL;
+			}
+		}
+		pthread_mutex_unlock(&nlcomm_pool_lock);
+	}
+
+	if (hndl != NULL)
+		nlbl_comm_close(hndl);
+}
+
+/**
+ * Close all of the idle handles in the handle pool
+ *
+ * Close and free every idle handle in the pool, the pool size is unchanged so
+ * later calls will repopulate the pool as needed.
+ *
+ */
+void nlbl_comm_pool_drain(void)
+{
+	pthread_mutex_lock(&nlcomm_pool_lock);
+	while (nlcomm_pool_count > 0)
+		nlbl_comm_close(nlcomm_pool[--nlcomm_pool_count]);
+	if (nlcomm_pool != NULL) {
+		free(nlcomm_pool);
+		nlcomm_pool = NULL;
+	}
+	pthread_mutex_unlock(&nlcomm_pool_lock);
+}
+
 /*
  * Communication Functions
  */
@@ -83,8 +557,8 @@ void nlbl_comm_timeout(uint32_t seconds)
  * Create and bind a NetLabel handle
  *
  * Create a new NetLabel handle, bind it to the running process, and connect to
- * the Generic Netlink subsystem.  Returns a pointer to the NetLabel handle
- * structure.
+ * the Generic Netlink subsystem using the transport selected with
+ * nlbl_comm_transport().  Returns a pointer to the NetLabel handle structure.
  *
  */
 struct nlbl_handle *nlbl_comm_open(void)
@@ -96,28 +570,14 @@ struct nlbl_handle *nlbl_comm_open(void)
 	if (hndl == NULL)
 		return NULL;
 
-	/* create a new netlink socket */
-	hndl->nl_sock = nl_socket_alloc();
-	if (hndl->nl_sock == NULL)
-		goto open_failure;
-
-	/* set the netlink socket properties */
-	nl_socket_set_peer_port(hndl->nl_sock, 0);
-	nl_socket_disable_seq_check(hndl->nl_sock);
-	nl_socket_set_passcred(hndl->nl_sock, 1);
-
-	/* connect to the generic netlink subsystem in the kernel */
-	if (nl_connect(hndl->nl_sock, NETLINK_GENERIC) != 0)
-		goto open_failure_handle;
+	/* connect the handle */
+	hndl->ops = nlcomm_ops;
+	if (hndl->ops->open(hndl) < 0) {
+		free(hndl);
+		return NULL;
+	}
 
 	return hndl;
-
-open_failure_handle:
-	nl_close(hndl->nl_sock);
-	nl_socket_free(hndl->nl_sock);
-open_failure:
-	free(hndl);
-	return NULL;
 }
 
 /**
@@ -134,9 +594,9 @@ int nlbl_comm_close(struct nlbl_handle *hndl)
 	if (!nlbl_comm_hndl_valid(hndl))
 		return -EINVAL;
 
-	/* close and destroy the socket */
-	nl_close(hndl->nl_sock);
-	nl_socket_free(hndl->nl_sock);
+	/* close and destroy the connection */
+	nlbl_stats_close(hndl);
+	hndl->ops->close(hndl);
 
 	/* free the memory */
 	free(hndl);
@@ -144,6 +604,36 @@ int nlbl_comm_close(struct nlbl_handle *hndl)
 	return 0;
 }
 
+/**
+ * Read a message from a NetLabel handle without waiting
+ * @param hndl the NetLabel handle
+ * @param data the message buffer
+ *
+ * Reads a message from the NetLabel handle, which must either have data
+ * waiting or be in non-blocking mode, and stores it the pointer returned in
+ * @data.  This function allocates space for @data, making the caller
+ * responsibile for freeing @data later.  Returns the number of bytes read on
+ * success, zero on EOF, -EAGAIN if no message is available, and negative
+ * values on failure.
+ *
+ */
+int nlbl_comm_recv_nowait(struct nlbl_handle *hndl, unsigned char **data)
+{
+	int rc;
+
+	/* sanity checks */
+	if (!nlbl_comm_hndl_valid(hndl) || data == NULL)
+		return -EINVAL;
+
+	/* perform the read operation */
+	rc = hndl->ops->recv(hndl, data);
+	if (rc > 0) {
+		nlbl_pcap_write(NLBL_PCAP_REPLY, *data, rc);
+		nlbl_stats_recv(hndl, *data, rc);
+	}
+	return rc;
+}
+
 /**
  * Read a message from a NetLabel handle
  * @param hndl the NetLabel handle
@@ -158,50 +648,22 @@ int nlbl_comm_close(struct nlbl_handle *hndl)
 int nlbl_comm_recv_raw(struct nlbl_handle *hndl, unsigned char **data)
 {
 	int rc;
-	struct sockaddr_nl peer_nladdr;
-	struct ucred *creds = NULL;
-	int nl_fd;
-	fd_set read_fds;
-	struct timeval timeout;
 
 	/* sanity checks */
 	if (!nlbl_comm_hndl_valid(hndl) || data == NULL)
 		return -EINVAL;
 
-	/* we use blocking sockets so do enforce a timeout using select() if
-	 * no data is waiting to be read from the handle */
-	timeout.tv_sec = nlcomm_read_timeout;
-	timeout.tv_usec = 0;
-	nl_fd = nl_socket_get_fd(hndl->nl_sock);
-	FD_ZERO(&read_fds);
-	FD_SET(nl_fd, &read_fds);
-	rc = select(nl_fd + 1, &read_fds, NULL, NULL, &timeout);
-	if (rc < 0)
-		return -errno;
-	else if (rc == 0)
-		return -EAGAIN;
-
-	/* perform the read operation */
-	*data = NULL;
-	rc = nl_recv(hndl->nl_sock, &peer_nladdr, data, &creds);
+	/* wait for a message, enforcing the timeout */
+	rc = hndl->ops->wait(hndl, nlcomm_read_timeout);
 	if (rc < 0)
 		return rc;
-
-	/* if we are setup to receive credentials, only accept messages from
-	 * the kernel (ignore all others and send an -EAGAIN) */
-	if (creds != NULL && creds->pid != 0) {
-		rc = -EAGAIN;
-		goto recv_raw_failure;
+	else if (rc == 0) {
+		nlbl_stats_timeout(hndl);
+		return -EAGAIN;
 	}
 
-	return rc;
-
-recv_raw_failure:
-	if (*data != NULL) {
-		free(*data);
-		*data = NULL;
-	}
-	return rc;
+	/* perform the read operation */
+	return nlbl_comm_recv_nowait(hndl, data);
 }
 
 /**
@@ -247,6 +709,7 @@ int nlbl_comm_recv(struct nlbl_handle *hndl, nlbl_msg **msg)
 		rc = -EBADMSG;
 		goto recv_failure;
 	}
+	free(data);
 
 	return rc;
 
@@ -266,6 +729,38 @@ recv_failure:
  *
  */
 int nlbl_comm_send(struct nlbl_handle *hndl, nlbl_msg *msg)
+{
+	int rc;
+	struct nlmsghdr *nl_hdr;
+	uint64_t start;
+
+	/* fill in the header, requesting a netlink ack message */
+	rc = nlbl_comm_msg_complete(hndl, msg);
+	if (rc < 0)
+		return rc;
+
+	/* send the message */
+	nl_hdr = nlbl_msg_nlhdr(msg);
+	start = nlbl_stats_clock();
+	rc = hndl->ops->send(hndl, nl_hdr, nl_hdr->nlmsg_len);
+	if (rc > 0)
+		nlbl_pcap_write(NLBL_PCAP_REQUEST, nl_hdr, nl_hdr->nlmsg_len);
+	nlbl_stats_send(hndl, nl_hdr, nl_hdr->nlmsg_len, start, rc);
+	return rc;
+}
+
+/**
+ * Prepare a message to be written to a NetLabel handle
+ * @param hndl the NetLabel handle
+ * @param msg the message
+ *
+ * Fill in the port, sequence number, and flags of @msg so that it can be
+ * written to @hndl with nlbl_comm_send_raw(), a new sequence number is
+ * assigned each time this function is called.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int nlbl_comm_msg_complete(struct nlbl_handle *hndl, nlbl_msg *msg)
 {
 	struct nlmsghdr *nl_hdr;
 
@@ -273,12 +768,181 @@ int nlbl_comm_send(struct nlbl_handle *hndl, nlbl_msg *msg)
 	if (!nlbl_comm_hndl_valid(hndl) || msg == NULL)
 		return -EINVAL;
 
-	/* request a netlink ack message */
 	nl_hdr = nlbl_msg_nlhdr(msg);
 	if (nl_hdr == NULL)
 		return -EBADMSG;
-	nl_hdr->nlmsg_flags |= NLM_F_ACK;
+	nl_hdr->nlmsg_pid = hndl->ops->port(hndl);
+	nl_hdr->nlmsg_seq = hndl->ops->seq(hndl);
+	nl_hdr->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
 
-	/* send the message */
-	return nl_send_auto(hndl->nl_sock, msg);
+	return 0;
+}
+
+/**
+ * Write a buffer of messages to a NetLabel handle
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ *
+ * Write one or more complete netlink messages in @buf to the NetLabel handle
+ * @hndl using a single write.  If the handle is in non-blocking mode and the
+ * messages can not be written without waiting then nothing is written, or
+ * recorded in the capture and statistics, and -EAGAIN is returned so the
+ * caller can try again later.  Returns the number of bytes written on
+ * success, or negative values on failure.
+ *
+ */
+int nlbl_comm_send_raw(struct nlbl_handle *hndl, void *buf, size_t len)
+{
+	int rc;
+	uint64_t start;
+
+	/* sanity checks */
+	if (!nlbl_comm_hndl_valid(hndl) || buf == NULL || len == 0)
+		return -EINVAL;
+
+	start = nlbl_stats_clock();
+	rc = hndl->ops->send(hndl, buf, len);
+	if (rc == -EAGAIN)
+		return rc;
+	if (rc > 0)
+		nlbl_pcap_write(NLBL_PCAP_REQUEST, buf, len);
+	nlbl_stats_send(hndl, buf, len, start, rc);
+	return rc;
+}
+
+/**
+ * Return the file descriptor of a NetLabel handle
+ * @param hndl the NetLabel handle
+ *
+ * Returns the file descriptor of the socket underlying @hndl on success,
+ * negative values on failure.
+ *
+ */
+int nlbl_comm_fd(struct nlbl_handle *hndl)
+{
+	/* sanity checks */
+	if (!nlbl_comm_hndl_valid(hndl))
+		return -EINVAL;
+
+	return hndl->ops->fd(hndl);
+}
+
+/**
+ * Resolve a NetLabel Generic Netlink family
+ * @param hndl the NetLabel handle
+ * @param family the family name
+ *
+ * Ask the handle's transport for the Generic Netlink family ID of @family.
+ * Returns the family ID on success, negative values on failure.
+ *
+ */
+int nlbl_comm_resolve(struct nlbl_handle *hndl, const char *family)
+{
+	int rc;
+
+	/* sanity checks */
+	if (!nlbl_comm_hndl_valid(hndl) || family == NULL)
+		return -EINVAL;
+
+	rc = hndl->ops->resolve(hndl, family);
+	if (rc >= 0)
+		nlbl_stats_family(family, rc);
+	return rc;
+}
+
+/**
+ * Perform a dump request on a NetLabel handle
+ * @param hndl the NetLabel handle
+ * @param msg the dump request
+ * @param cb the per-message callback
+ * @param arg the callback argument
+ *
+ * Send the dump request in @msg and call @cb for each message in the reply as
+ * it is read from the handle.  If @cb returns a non-zero value it is not
+ * called again, but the rest of the reply is still read and discarded so that
+ * the handle can be reused.  If @hndl is NULL then the function will borrow a
+ * handle from the handle pool.  Returns zero on success, the first negative
+ * value returned by @cb, or negative values on failure.
+ *
+ */
+int nlbl_comm_dump(struct nlbl_handle *hndl,
+		   nlbl_msg *msg,
+		   nlbl_comm_dump_cb cb, void *arg)
+{
+	int rc = -ENOMEM;
+	int rc_cb = 0;
+	struct nlbl_handle *p_hndl = hndl;
+	unsigned char *data = NULL;
+	int data_len;
+	struct nlmsghdr *nl_hdr;
+	struct nlmsgerr *nl_err;
+	unsigned int done = 0;
+
+	/* borrow a handle from the pool if we need one */
+	if (p_hndl == NULL) {
+		p_hndl = nlbl_comm_pool_get();
+		if (p_hndl == NULL)
+			goto dump_return;
+	}
+
+	/* send the request */
+	rc = nlbl_comm_send(p_hndl, msg);
+	if (rc <= 0) {
+		if (rc == 0)
+			rc = -ENODATA;
+		goto dump_return;
+	}
+
+	/* read all of the messages (multi-message response) */
+	while (!done) {
+		/* get the next set of messages */
+		rc = nlbl_comm_recv_raw(p_hndl, &data);
+		if (rc <= 0) {
+			if (rc == 0)
+				rc = -ENODATA;
+			goto dump_return;
+		}
+		data_len = rc;
+		nl_hdr = (struct nlmsghdr *)data;
+
+		/* check to see if this is a netlink control message we don't
+		 * care about */
+		if (nl_hdr->nlmsg_type == NLMSG_NOOP ||
+		    nl_hdr->nlmsg_type == NLMSG_OVERRUN) {
+			rc = -EBADMSG;
+			goto dump_return;
+		}
+		if (nl_hdr->nlmsg_type == NLMSG_ERROR) {
+			nl_err = nlmsg_data(nl_hdr);
+			rc = (nl_err->error < 0 ? nl_err->error : -EBADMSG);
+			goto dump_return;
+		}
+
+		/* loop through the messages */
+		while (nlmsg_ok(nl_hdr, data_len)) {
+			if (nl_hdr->nlmsg_type == NLMSG_DONE ||
+			    !(nl_hdr->nlmsg_flags & NLM_F_MULTI))
+				done = 1;
+			if (nl_hdr->nlmsg_type == NLMSG_DONE)
+				break;
+			if (rc_cb == 0)
+				rc_cb = cb(nl_hdr, arg);
+
+			/* next message */
+			nl_hdr = nlmsg_next(nl_hdr, &data_len);
+		}
+
+		free(data);
+		data = NULL;
+	}
+
+	rc = (rc_cb < 0 ? rc_cb : 0);
+
+dump_return:
+	if (hndl == NULL)
+		nlbl_comm_pool_put(p_hndl);
+	if (data != NULL)
+		free(data);
+	return rc;
 }
@@ -0,0 +1,390 @@
+/** @file
+ * NetLabel Daemon Transport
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The daemon transport talks to netlabeld over a Unix domain sequenced packet
+ * socket using the same generic netlink messages as the kernel; each write is
+ * one packet holding one or more requests and each read returns one packet of
+ * replies.  Generic Netlink families are resolved by sending a
+ * CTRL_CMD_GETFAMILY request to the daemon, which answers with the kernel's
+ * family IDs, so messages pass through the daemon unchanged.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* daemon handle */
+struct nlbl_daemon_hndl {
+	int fd;
+	uint32_t port;
+	uint32_t seq;
+};
+
+/* socket used by new handles */
+static pthread_mutex_t nldaemon_lock = PTHREAD_MUTEX_INITIALIZER;
+static char nldaemon_path[sizeof(((struct sockaddr_un *)0)->sun_path)] =
+	NLBL_DAEMON_PATH;
+static uint32_t nldaemon_port_next = 1;
+
+/*
+ * Control Functions
+ */
+
+/**
+ * Talk to the NetLabel daemon
+ * @param path the daemon's socket, NULL for the default socket
+ *
+ * Select the daemon transport for NetLabel handles opened from now on, which
+ * connect to the netlabeld socket @path, or NLBL_DAEMON_PATH if @path is NULL.
+ * This should be called before nlbl_init() and before any handles are opened.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_comm_daemon(const char *path)
+{
+	if (path == NULL)
+		path = NLBL_DAEMON_PATH;
+	if (strlen(path) >= sizeof(nldaemon_path))
+		return -ENAMETOOLONG;
+
+	pthread_mutex_lock(&nldaemon_lock);
+	strcpy(nldaemon_path, path);
+	pthread_mutex_unlock(&nldaemon_lock);
+
+	return nlbl_comm_transport(NLBL_TRANSPORT_DAEMON);
+}
+
+/*
+ * Daemon Transport
+ */
+
+/**
+ * Connect to the daemon
+ * @param hndl the NetLabel handle
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_daemon_open(struct nlbl_handle *hndl)
+{
+	int rc;
+	struct nlbl_daemon_hndl *dh;
+	struct sockaddr_un addr;
+
+	dh = calloc(1, sizeof(*dh));
+	if (dh == NULL)
+		return -ENOMEM;
+	dh->seq = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	pthread_mutex_lock(&nldaemon_lock);
+	strcpy(addr.sun_path, nldaemon_path);
+	dh->port = nldaemon_port_next++;
+	pthread_mutex_unlock(&nldaemon_lock);
+
+	dh->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (dh->fd < 0) {
+		rc = -errno;
+		goto open_failure;
+	}
+	if (connect(dh->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		rc = -errno;
+		close(dh->fd);
+		goto open_failure;
+	}
+
+	hndl->priv = dh;
+	return 0;
+
+open_failure:
+	free(dh);
+	return rc;
+}
+
+/**
+ * Disconnect from the daemon
+ * @param hndl the NetLabel handle
+ *
+ */
+static void nlbl_daemon_close(struct nlbl_handle *hndl)
+{
+	struct nlbl_daemon_hndl *dh = hndl->priv;
+
+	close(dh->fd);
+	free(dh);
+	hndl->priv = NULL;
+}
+
+/**
+ * Return the port of a daemon handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_daemon_port(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_daemon_hndl *)hndl->priv)->port;
+}
+
+/**
+ * Return the next sequence number of a daemon handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_daemon_seq(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_daemon_hndl *)hndl->priv)->seq++;
+}
+
+/**
+ * Write a buffer of requests to the daemon
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ *
+ * Returns the number of bytes written on success, negative values on failure.
+ *
+ */
+static int nlbl_daemon_send(struct nlbl_handle *hndl, void *buf, size_t len)
+{
+	ssize_t rc;
+	struct nlbl_daemon_hndl *dh = hndl->priv;
+
+	do {
+		rc = send(dh->fd, buf, len, MSG_NOSIGNAL);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0)
+		return -errno;
+
+	return rc;
+}
+
+/**
+ * Read a packet of replies from the daemon
+ * @param hndl the NetLabel handle
+ * @param data the message buffer
+ *
+ * See nlbl_comm_recv_nowait().
+ *
+ */
+static int nlbl_daemon_recv(struct nlbl_handle *hndl, unsigned char **data)
+{
+	ssize_t rc;
+	ssize_t len;
+	struct nlbl_daemon_hndl *dh = hndl->priv;
+
+	*data = NULL;
+	do {
+		len = recv(dh->fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+	} while (len < 0 && errno == EINTR);
+	if (len < 0)
+		return (errno == EWOULDBLOCK ? -EAGAIN : -errno);
+	else if (len == 0) {
+		/* either the daemon went away or it sent an empty packet, both
+		 * of which end the conversation */
+		recv(dh->fd, NULL, 0, MSG_DONTWAIT);
+		return 0;
+	}
+
+	*data = malloc(len);
+	if (*data == NULL)
+		return -ENOMEM;
+	do {
+		rc = recv(dh->fd, *data, len, 0);
+	} while (rc < 0 && errno == EINTR);
+	if (rc <= 0) {
+		free(*data);
+		*data = NULL;
+		return (rc < 0 ? -errno : 0);
+	}
+
+	return rc;
+}
+
+/**
+ * Wait for replies from the daemon
+ * @param hndl the NetLabel handle
+ * @param timeout the timeout in seconds
+ *
+ * Returns a positive value if a reply is waiting, zero if the timeout
+ * expired, and negative values on failure.
+ *
+ */
+static int nlbl_daemon_wait(struct nlbl_handle *hndl, uint32_t timeout)
+{
+	int rc;
+	struct pollfd pfd;
+
+	pfd.fd = ((struct nlbl_daemon_hndl *)hndl->priv)->fd;
+	pfd.events = POLLIN;
+	do {
+		rc = poll(&pfd, 1, timeout * 1000);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0)
+		return -errno;
+
+	return rc;
+}
+
+/**
+ * Discard any unread replies from the daemon
+ * @param hndl the NetLabel handle
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_daemon_drain(struct nlbl_handle *hndl)
+{
+	ssize_t rc;
+	int fd = ((struct nlbl_daemon_hndl *)hndl->priv)->fd;
+
+	do {
+		rc = recv(fd, NULL, 0, MSG_DONTWAIT | MSG_TRUNC);
+	} while (rc > 0 || (rc < 0 && errno == EINTR));
+	if (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		return -errno;
+
+	return 0;
+}
+
+/**
+ * Return the file descriptor of a daemon handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static int nlbl_daemon_fd(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_daemon_hndl *)hndl->priv)->fd;
+}
+
+/**
+ * Resolve a Generic Netlink family
+ * @param hndl the NetLabel handle
+ * @param family the family name
+ *
+ * Ask the daemon for the family ID of @family.  Returns the family ID on
+ * success, negative values on failure.
+ *
+ */
+static int nlbl_daemon_resolve(struct nlbl_handle *hndl, const char *family)
+{
+	int rc;
+	int len;
+	int fid = -ENOENT;
+	unsigned int done = 0;
+	struct nl_msg *msg;
+	struct nlmsghdr *nl_hdr;
+	struct nlmsgerr *nl_err;
+	struct genlmsghdr *genl_hdr;
+	struct nlattr *nla;
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	unsigned char *data = NULL;
+	uint32_t seq;
+
+	msg = nlmsg_alloc();
+	if (msg == NULL)
+		return -ENOMEM;
+	seq = nlbl_daemon_seq(hndl);
+	if (genlmsg_put(msg, nlbl_daemon_port(hndl), seq, GENL_ID_CTRL, 0,
+			NLM_F_REQUEST | NLM_F_ACK, CTRL_CMD_GETFAMILY,
+			1) == NULL ||
+	    nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, family) < 0) {
+		rc = -ENOMEM;
+		goto resolve_return;
+	}
+
+	nlbl_daemon_drain(hndl);
+	nl_hdr = nlmsg_hdr(msg);
+	rc = nlbl_daemon_send(hndl, nl_hdr, nl_hdr->nlmsg_len);
+	if (rc < 0)
+		goto resolve_return;
+
+	/* read the family and the ACK which follows it */
+	while (!done) {
+		rc = nlbl_daemon_wait(hndl, nlbl_comm_timeout_get());
+		if (rc == 0)
+			rc = -EAGAIN;
+		if (rc < 0)
+			goto resolve_return;
+		rc = nlbl_daemon_recv(hndl, &data);
+		if (rc <= 0) {
+			if (rc == 0)
+				rc = -ENODATA;
+			goto resolve_return;
+		}
+
+		len = rc;
+		for (nl_hdr = (struct nlmsghdr *)data;
+		     nlmsg_ok(nl_hdr, len) && !done;
+		     nl_hdr = nlmsg_next(nl_hdr, &len)) {
+			if (nl_hdr->nlmsg_seq != seq)
+				continue;
+			if (nl_hdr->nlmsg_type == NLMSG_ERROR) {
+				nl_err = nlmsg_data(nl_hdr);
+				if (nl_err->error != 0)
+					fid = nl_err->error;
+				done = 1;
+			} else if (nl_hdr->nlmsg_type == GENL_ID_CTRL) {
+				genl_hdr = nlmsg_data(nl_hdr);
+				if (nla_parse(tb, CTRL_ATTR_MAX,
+					      genlmsg_attrdata(genl_hdr, 0),
+					      genlmsg_attrlen(genl_hdr, 0),
+					      NULL) < 0)
+					continue;
+				nla = tb[CTRL_ATTR_FAMILY_ID];
+				if (nla != NULL)
+					fid = nla_get_u16(nla);
+			}
+		}
+		free(data);
+		data = NULL;
+	}
+	rc = fid;
+
+resolve_return:
+	nlmsg_free(msg);
+	return rc;
+}
+
+/* daemon transport, talks to netlabeld */
+const struct nlbl_comm_ops nlbl_daemon_ops = {
+	.open = nlbl_daemon_open,
+	.close = nlbl_daemon_close,
+	.resolve = nlbl_daemon_resolve,
+	.port = nlbl_daemon_port,
+	.seq = nlbl_daemon_seq,
+	.send = nlbl_daemon_send,
+	.recv = nlbl_daemon_recv,
+	.wait = nlbl_daemon_wait,
+	.drain = nlbl_daemon_drain,
+	.fd = nlbl_daemon_fd,
+};
@@ -0,0 +1,2250 @@
+/** @file
+ * NetLabel In-Process Kernel Emulation
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The fake transport answers NetLabel requests with an emulation of the
+ * kernel's NetLabel subsystem which lives in the calling process, so the
+ * library and its users can be tested and benchmarked without root or kernel
+ * support.  The emulation follows the kernel's generic netlink protocol and
+ * configuration rules: dumps are multi-part messages ending with NLMSG_DONE,
+ * other replies and ACKs are sent one per read, errors are reported in
+ * NLMSG_ERROR messages, and the configuration starts out in the kernel's
+ * default state.  Network interfaces and security labels are not checked
+ * against the system, any name or label is accepted.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* Generic Netlink family IDs of the emulated kernel */
+#define NLBL_FAKE_FID(type)		(0x1000 + (type))
+#define NLBL_FAKE_FID_MGMT		NLBL_FAKE_FID(NETLBL_NLTYPE_MGMT)
+#define NLBL_FAKE_FID_CIPSOV4		NLBL_FAKE_FID(NETLBL_NLTYPE_CIPSOV4)
+#define NLBL_FAKE_FID_UNLBL		NLBL_FAKE_FID(NETLBL_NLTYPE_UNLABELED)
+
+/* size at which a dump's reply buffer is handed to the reader */
+#define NLBL_FAKE_BUF_SIZE		16384
+
+/* socket receive buffer, the size the netlink transport asks for doubled by
+ * the kernel, and the overhead the kernel charges against it for each queued
+ * message buffer */
+#define NLBL_FAKE_RCVBUF		(2 * NLBL_COMM_RCVBUF)
+#define NLBL_FAKE_RCVBUF_OVERHEAD	512
+
+/* initial number of hash buckets */
+#define NLBL_FAKE_HASH_SIZE		64
+
+/* FNV-1a hash */
+#define NLBL_FAKE_HASH_INIT		2166136261U
+#define NLBL_FAKE_HASH_PRIME		16777619U
+
+/* request handler return value for a dump, no ACK is sent */
+#define NLBL_FAKE_DUMPED		1
+
+/* CIPSOv4 limits, as in the kernel */
+#define NLBL_FAKE_CV4_TAG_MAXCNT	5
+#define NLBL_FAKE_CV4_TAG_INVALID	0
+#define NLBL_FAKE_CV4_TAG_RBITMAP	1
+#define NLBL_FAKE_CV4_TAG_ENUM		2
+#define NLBL_FAKE_CV4_TAG_RANGE		5
+#define NLBL_FAKE_CV4_TAG_LOCAL		128
+#define NLBL_FAKE_CV4_MAX_LOC		0x7fffffff
+#define NLBL_FAKE_CV4_MAX_REM_LVLS	255
+#define NLBL_FAKE_CV4_MAX_REM_CATS	65534
+
+/* hash table entry, embedded at the start of each table's entries */
+struct nlbl_fake_node {
+	uint32_t hash;
+	struct nlbl_fake_node *chain;
+	struct nlbl_fake_node *prev;
+	struct nlbl_fake_node *next;
+};
+
+/* hash table, the entries are also kept in the order they were added */
+struct nlbl_fake_tbl {
+	struct nlbl_fake_node **bkts;
+	uint32_t size;
+	uint32_t count;
+	struct nlbl_fake_node *head;
+	struct nlbl_fake_node *tail;
+};
+
+/* CIPSOv4 DOI definition */
+struct nlbl_fake_doi {
+	struct nlbl_fake_node node;
+	nlbl_cv4_doi doi;
+	nlbl_cv4_mtype mtype;
+	uint8_t tags[NLBL_FAKE_CV4_TAG_MAXCNT];
+	uint32_t *lvls;
+	size_t lvl_cnt;
+	uint32_t *cats;
+	size_t cat_cnt;
+	uint32_t refs;
+};
+
+/* address selector of a domain mapping, or a static label */
+struct nlbl_fake_addr {
+	struct nlbl_fake_node node;
+	const void *owner;
+	struct nlbl_netaddr addr;
+	nlbl_proto proto_type;
+	struct nlbl_fake_doi *doi;
+	char *label;
+	struct nlbl_fake_addr *prev;
+	struct nlbl_fake_addr *next;
+};
+
+/* address selectors, in the order they were added */
+struct nlbl_fake_addr_list {
+	struct nlbl_fake_addr *head;
+	struct nlbl_fake_addr *tail;
+	uint32_t count;
+};
+
+/* domain mapping, the default mapping has no name */
+struct nlbl_fake_dom {
+	struct nlbl_fake_node node;
+	char *name;
+	nlbl_proto proto_type;
+	struct nlbl_fake_doi *doi;
+	struct nlbl_fake_addr_list sels;
+};
+
+/* static labels of a network interface, or the default static labels */
+struct nlbl_fake_iface {
+	struct nlbl_fake_node node;
+	char *name;
+	struct nlbl_fake_addr_list addrs;
+};
+
+/* reply buffer, holding one or more complete messages */
+struct nlbl_fake_buf {
+	unsigned char *data;
+	size_t len;
+	size_t size;
+	struct nlbl_fake_buf *next;
+};
+
+/* fake handle */
+struct nlbl_fake_hndl {
+	uint32_t port;
+	uint32_t seq;
+	int fd;
+
+	/* replies waiting to be read, oldest first */
+	struct nlbl_fake_buf *head;
+	struct nlbl_fake_buf *tail;
+	size_t queued;
+	unsigned int overrun;
+
+	/* reply being built */
+	struct nlbl_fake_buf *cur;
+};
+
+/* emulated kernel state, protected by nlfake_lock */
+static pthread_mutex_t nlfake_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int nlfake_booted = 0;
+static uint32_t nlfake_port_next = 1;
+static struct nlbl_fake_tbl nlfake_dois;
+static struct nlbl_fake_tbl nlfake_doms;
+static struct nlbl_fake_dom *nlfake_dom_def = NULL;
+static struct nlbl_fake_tbl nlfake_ifaces;
+static struct nlbl_fake_iface nlfake_iface_def;
+static struct nlbl_fake_tbl nlfake_addrs;
+static uint8_t nlfake_accept = 0;
+
+/* NetLabel management attribute policy */
+static struct nla_policy nlbl_fake_mgmt_policy[NLBL_MGMT_A_MAX + 1] = {
+	[NLBL_MGMT_A_DOMAIN] = { .type = NLA_STRING },
+	[NLBL_MGMT_A_PROTOCOL] = { .type = NLA_U32 },
+	[NLBL_MGMT_A_VERSION] = { .type = NLA_U32 },
+	[NLBL_MGMT_A_CV4DOI] = { .type = NLA_U32 },
+	[NLBL_MGMT_A_IPV6ADDR] = { .minlen = sizeof(struct in6_addr),
+				   .maxlen = sizeof(struct in6_addr) },
+	[NLBL_MGMT_A_IPV6MASK] = { .minlen = sizeof(struct in6_addr),
+				   .maxlen = sizeof(struct in6_addr) },
+	[NLBL_MGMT_A_IPV4ADDR] = { .minlen = sizeof(struct in_addr),
+				   .maxlen = sizeof(struct in_addr) },
+	[NLBL_MGMT_A_IPV4MASK] = { .minlen = sizeof(struct in_addr),
+				   .maxlen = sizeof(struct in_addr) },
+	[NLBL_MGMT_A_ADDRSELECTOR] = { .type = NLA_NESTED },
+	[NLBL_MGMT_A_SELECTORLIST] = { .type = NLA_NESTED },
+};
+
+/* NetLabel CIPSOv4 attribute policy */
+static struct nla_policy nlbl_fake_cipsov4_policy[NLBL_CIPSOV4_A_MAX + 1] = {
+	[NLBL_CIPSOV4_A_DOI] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MTYPE] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_TAG] = { .type = NLA_U8 },
+	[NLBL_CIPSOV4_A_TAGLST] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSLVLLOC] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSLVLREM] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSLVL] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSLVLLST] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSCATLOC] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSCATREM] = { .type = NLA_U32 },
+	[NLBL_CIPSOV4_A_MLSCAT] = { .type = NLA_NESTED },
+	[NLBL_CIPSOV4_A_MLSCATLST] = { .type = NLA_NESTED },
+};
+
+/* NetLabel unlabeled attribute policy */
+static struct nla_policy nlbl_fake_unlbl_policy[NLBL_UNLABEL_A_MAX + 1] = {
+	[NLBL_UNLABEL_A_ACPTFLG] = { .type = NLA_U8 },
+	[NLBL_UNLABEL_A_IPV6ADDR] = { .minlen = sizeof(struct in6_addr),
+				      .maxlen = sizeof(struct in6_addr) },
+	[NLBL_UNLABEL_A_IPV6MASK] = { .minlen = sizeof(struct in6_addr),
+				      .maxlen = sizeof(struct in6_addr) },
+	[NLBL_UNLABEL_A_IPV4ADDR] = { .minlen = sizeof(struct in_addr),
+				      .maxlen = sizeof(struct in_addr) },
+	[NLBL_UNLABEL_A_IPV4MASK] = { .minlen = sizeof(struct in_addr),
+				      .maxlen = sizeof(struct in_addr) },
+	[NLBL_UNLABEL_A_IFACE] = { .type = NLA_STRING },
+	[NLBL_UNLABEL_A_SECCTX] = { .type = NLA_STRING },
+};
+
+/*
+ * Hash Table Functions
+ */
+
+/**
+ * Hash a buffer
+ * @param data the buffer
+ * @param len the length of the buffer
+ * @param hash the hash of any preceding data, or NLBL_FAKE_HASH_INIT
+ *
+ */
+static uint32_t nlbl_fake_hash(const void *data, size_t len, uint32_t hash)
+{
+	const unsigned char *iter = data;
+
+	while (len-- > 0)
+		hash = (hash ^ *iter++) * NLBL_FAKE_HASH_PRIME;
+	return hash;
+}
+
+/**
+ * Return the first entry in a hash bucket
+ * @param tbl the hash table
+ * @param hash the hash value
+ *
+ * Returns the first entry in the chain which would hold entries with @hash,
+ * callers must compare the hash and key of each entry in the chain.
+ *
+ */
+static struct nlbl_fake_node *nlbl_fake_tbl_bkt(const struct nlbl_fake_tbl *tbl,
+						uint32_t hash)
+{
+	if (tbl->size == 0)
+		return NULL;
+	return tbl->bkts[hash & (tbl->size - 1)];
+}
+
+/**
+ * Add an entry to a hash table
+ * @param tbl the hash table
+ * @param node the entry
+ * @param hash the hash of the entry's key
+ *
+ * Add @node to @tbl, growing the table as needed.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int nlbl_fake_tbl_add(struct nlbl_fake_tbl *tbl,
+			     struct nlbl_fake_node *node, uint32_t hash)
+{
+	struct nlbl_fake_node **bkts_new;
+	struct nlbl_fake_node *iter;
+	uint32_t size_new;
+
+	if (tbl->count >= tbl->size) {
+		size_new = (tbl->size > 0 ?
+			    tbl->size * 2 : NLBL_FAKE_HASH_SIZE);
+		bkts_new = calloc(size_new, sizeof(*bkts_new));
+		if (bkts_new == NULL)
+			return -ENOMEM;
+		for (iter = tbl->head; iter != NULL; iter = iter->next) {
+			iter->chain = bkts_new[iter->hash & (size_new - 1)];
+			bkts_new[iter->hash & (size_new - 1)] = iter;
+		}
+		free(tbl->bkts);
+		tbl->bkts = bkts_new;
+		tbl->size = size_new;
+	}
+
+	node->hash = hash;
+	node->chain = tbl->bkts[hash & (tbl->size - 1)];
+	tbl->bkts[hash & (tbl->size - 1)] = node;
+	node->prev = tbl->tail;
+	node->next = NULL;
+	if (tbl->tail != NULL)
+		tbl->tail->next = node;
+	else
+		tbl->head = node;
+	tbl->tail = node;
+	tbl->count++;
+
+	return 0;
+}
+
+/**
+ * Remove an entry from a hash table
+ * @param tbl the hash table
+ * @param node the entry
+ *
+ */
+static void nlbl_fake_tbl_del(struct nlbl_fake_tbl *tbl,
+			      struct nlbl_fake_node *node)
+{
+	struct nlbl_fake_node **iter;
+
+	iter = &tbl->bkts[node->hash & (tbl->size - 1)];
+	while (*iter != node)
+		iter = &(*iter)->chain;
+	*iter = node->chain;
+
+	if (node->prev != NULL)
+		node->prev->next = node->next;
+	else
+		tbl->head = node->next;
+	if (node->next != NULL)
+		node->next->prev = node->prev;
+	else
+		tbl->tail = node->prev;
+	tbl->count--;
+}
+
+/*
+ * Configuration Functions
+ */
+
+/**
+ * Find a CIPSOv4 DOI definition
+ * @param doi the DOI value
+ *
+ * Returns the DOI definition on success, NULL if it does not exist.
+ *
+ */
+static struct nlbl_fake_doi *nlbl_fake_doi_find(nlbl_cv4_doi doi)
+{
+	struct nlbl_fake_node *iter;
+	uint32_t hash;
+
+	hash = nlbl_fake_hash(&doi, sizeof(doi), NLBL_FAKE_HASH_INIT);
+	for (iter = nlbl_fake_tbl_bkt(&nlfake_dois, hash);
+	     iter != NULL; iter = iter->chain)
+		if (iter->hash == hash &&
+		    ((struct nlbl_fake_doi *)iter)->doi == doi)
+			return (struct nlbl_fake_doi *)iter;
+
+	return NULL;
+}
+
+/**
+ * Free a CIPSOv4 DOI definition
+ * @param doi the DOI definition
+ *
+ */
+static void nlbl_fake_doi_free(struct nlbl_fake_doi *doi)
+{
+	free(doi->lvls);
+	free(doi->cats);
+	free(doi);
+}
+
+/**
+ * Hash an address selector's key
+ * @param owner the domain mapping or interface
+ * @param addr the address
+ *
+ */
+static uint32_t nlbl_fake_addr_hash(const void *owner,
+				    const struct nlbl_netaddr *addr)
+{
+	uint32_t hash;
+	size_t len;
+
+	len = (addr->type == AF_INET ?
+	       sizeof(struct in_addr) : sizeof(struct in6_addr));
+	hash = nlbl_fake_hash(&owner, sizeof(owner), NLBL_FAKE_HASH_INIT);
+	hash = nlbl_fake_hash(&addr->addr, len, hash);
+	return nlbl_fake_hash(&addr->mask, len, hash);
+}
+
+/**
+ * Find an address selector
+ * @param owner the domain mapping or interface
+ * @param addr the address
+ *
+ * Returns the address selector of @owner which exactly matches @addr on
+ * success, NULL if there is none.
+ *
+ */
+static struct nlbl_fake_addr *nlbl_fake_addr_find(const void *owner,
+					const struct nlbl_netaddr *addr)
+{
+	struct nlbl_fake_node *iter;
+	struct nlbl_fake_addr *sel;
+	uint32_t hash;
+	size_t len;
+
+	len = (addr->type == AF_INET ?
+	       sizeof(struct in_addr) : sizeof(struct in6_addr));
+	hash = nlbl_fake_addr_hash(owner, addr);
+	for (iter = nlbl_fake_tbl_bkt(&nlfake_addrs, hash);
+	     iter != NULL; iter = iter->chain) {
+		sel = (struct nlbl_fake_addr *)iter;
+		if (iter->hash == hash && sel->owner == owner &&
+		    sel->addr.type == addr->type &&
+		    memcmp(&sel->addr.addr, &addr->addr, len) == 0 &&
+		    memcmp(&sel->addr.mask, &addr->mask, len) == 0)
+			return sel;
+	}
+
+	return NULL;
+}
+
+/**
+ * Add an address selector
+ * @param owner the domain mapping or interface
+ * @param list the owner's address selectors
+ * @param addr the address
+ *
+ * Returns the new address selector on success, NULL on failure.
+ *
+ */
+static struct nlbl_fake_addr *nlbl_fake_addr_add(const void *owner,
+					struct nlbl_fake_addr_list *list,
+					const struct nlbl_netaddr *addr)
+{
+	struct nlbl_fake_addr *sel;
+
+	sel = calloc(1, sizeof(*sel));
+	if (sel == NULL)
+		return NULL;
+	sel->owner = owner;
+	sel->addr = *addr;
+	if (nlbl_fake_tbl_add(&nlfake_addrs, &sel->node,
+			      nlbl_fake_addr_hash(owner, addr)) < 0) {
+		free(sel);
+		return NULL;
+	}
+
+	sel->prev = list->tail;
+	if (list->tail != NULL)
+		list->tail->next = sel;
+	else
+		list->head = sel;
+	list->tail = sel;
+	list->count++;
+
+	return sel;
+}
+
+/**
+ * Remove and free an address selector
+ * @param list the owner's address selectors
+ * @param sel the address selector
+ *
+ */
+static void nlbl_fake_addr_del(struct nlbl_fake_addr_list *list,
+			       struct nlbl_fake_addr *sel)
+{
+	nlbl_fake_tbl_del(&nlfake_addrs, &sel->node);
+
+	if (sel->prev != NULL)
+		sel->prev->next = sel->next;
+	else
+		list->head = sel->next;
+	if (sel->next != NULL)
+		sel->next->prev = sel->prev;
+	else
+		list->tail = sel->prev;
+	list->count--;
+
+	if (sel->doi != NULL)
+		sel->doi->refs--;
+	free(sel->label);
+	free(sel);
+}
+
+/**
+ * Return the length of an address mask
+ * @param addr the address
+ *
+ */
+static unsigned int nlbl_fake_addr_len(const struct nlbl_netaddr *addr)
+{
+	unsigned int len = 0;
+	unsigned int iter;
+
+	if (addr->type == AF_INET)
+		return __builtin_popcount(addr->mask.v4.s_addr);
+	for (iter = 0; iter < 4; iter++)
+		len += __builtin_popcount(addr->mask.v6.s6_addr32[iter]);
+	return len;
+}
+
+/**
+ * Sort a list of address selectors
+ * @param list the address selectors
+ *
+ * Return an array of the address selectors in @list in the order the kernel
+ * keeps them: IPv4 before IPv6, longer masks first, and otherwise in the order
+ * they were added.  The caller must free the array.  Returns the array on
+ * success, NULL on failure.
+ *
+ */
+static struct nlbl_fake_addr **nlbl_fake_addr_sort(
+				const struct nlbl_fake_addr_list *list)
+{
+	struct nlbl_fake_addr **array;
+	struct nlbl_fake_addr *iter;
+	size_t pos[33 + 129 + 1];
+	unsigned int key;
+
+	array = malloc((list->count > 0 ? list->count : 1) * sizeof(*array));
+	if (array == NULL)
+		return NULL;
+
+	/* counting sort on the family and mask length */
+	memset(pos, 0, sizeof(pos));
+	for (iter = list->head; iter != NULL; iter = iter->next) {
+		key = (iter->addr.type == AF_INET ?
+		       32 - nlbl_fake_addr_len(&iter->addr) :
+		       33 + 128 - nlbl_fake_addr_len(&iter->addr));
+		pos[key + 1]++;
+	}
+	for (key = 1; key < 33 + 129 + 1; key++)
+		pos[key] += pos[key - 1];
+	for (iter = list->head; iter != NULL; iter = iter->next) {
+		key = (iter->addr.type == AF_INET ?
+		       32 - nlbl_fake_addr_len(&iter->addr) :
+		       33 + 128 - nlbl_fake_addr_len(&iter->addr));
+		array[pos[key]++] = iter;
+	}
+
+	return array;
+}
+
+/**
+ * Find a domain mapping
+ * @param name the domain, NULL for the default mapping
+ *
+ * Returns the domain mapping on success, NULL if it does not exist.
+ *
+ */
+static struct nlbl_fake_dom *nlbl_fake_dom_find(const char *name)
+{
+	struct nlbl_fake_node *iter;
+	uint32_t hash;
+
+	if (name == NULL)
+		return nlfake_dom_def;
+
+	hash = nlbl_fake_hash(name, strlen(name), NLBL_FAKE_HASH_INIT);
+	for (iter = nlbl_fake_tbl_bkt(&nlfake_doms, hash);
+	     iter != NULL; iter = iter->chain)
+		if (iter->hash == hash &&
+		    strcmp(((struct nlbl_fake_dom *)iter)->name, name) == 0)
+			return (struct nlbl_fake_dom *)iter;
+
+	return NULL;
+}
+
+/**
+ * Add an empty domain mapping
+ * @param name the domain, NULL for the default mapping
+ *
+ * Returns the new domain mapping on success, NULL on failure.
+ *
+ */
+static struct nlbl_fake_dom *nlbl_fake_dom_add(const char *name)
+{
+	struct nlbl_fake_dom *dom;
+
+	dom = calloc(1, sizeof(*dom));
+	if (dom == NULL)
+		return NULL;
+	if (name == NULL) {
+		nlfake_dom_def = dom;
+		return dom;
+	}
+
+	dom->name = strdup(name);
+	if (dom->name == NULL)
+		goto add_failure;
+	if (nlbl_fake_tbl_add(&nlfake_doms, &dom->node,
+			      nlbl_fake_hash(name, strlen(name),
+					     NLBL_FAKE_HASH_INIT)) < 0)
+		goto add_failure;
+
+	return dom;
+
+add_failure:
+	free(dom->name);
+	free(dom);
+	return NULL;
+}
+
+/**
+ * Remove and free a domain mapping
+ * @param dom the domain mapping
+ *
+ */
+static void nlbl_fake_dom_del(struct nlbl_fake_dom *dom)
+{
+	while (dom->sels.head != NULL)
+		nlbl_fake_addr_del(&dom->sels, dom->sels.head);
+	if (dom->doi != NULL)
+		dom->doi->refs--;
+
+	if (dom->name != NULL)
+		nlbl_fake_tbl_del(&nlfake_doms, &dom->node);
+	else
+		nlfake_dom_def = NULL;
+	free(dom->name);
+	free(dom);
+}
+
+/**
+ * Find the static labels of an interface
+ * @param name the interface, NULL for the default static labels
+ *
+ * Returns the interface on success, NULL if it has no static labels.
+ *
+ */
+static struct nlbl_fake_iface *nlbl_fake_iface_find(const char *name)
+{
+	struct nlbl_fake_node *iter;
+	uint32_t hash;
+
+	if (name == NULL)
+		return &nlfake_iface_def;
+
+	hash = nlbl_fake_hash(name, strlen(name), NLBL_FAKE_HASH_INIT);
+	for (iter = nlbl_fake_tbl_bkt(&nlfake_ifaces, hash);
+	     iter != NULL; iter = iter->chain)
+		if (iter->hash == hash &&
+		    strcmp(((struct nlbl_fake_iface *)iter)->name, name) == 0)
+			return (struct nlbl_fake_iface *)iter;
+
+	return NULL;
+}
+
+/**
+ * Set up the emulated kernel's default configuration
+ *
+ * Put the emulated kernel into the state the kernel boots in, a default
+ * domain mapping to the unlabeled protocol with unlabeled traffic allowed,
+ * the first time a fake handle is opened.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_fake_boot(void)
+{
+	struct nlbl_fake_dom *dom;
+
+	if (nlfake_booted)
+		return 0;
+
+	dom = nlbl_fake_dom_add(NULL);
+	if (dom == NULL)
+		return -ENOMEM;
+	dom->proto_type = NETLBL_NLTYPE_UNLABELED;
+	nlfake_accept = 1;
+	nlfake_booted = 1;
+
+	return 0;
+}
+
+/*
+ * Reply Functions
+ */
+
+/**
+ * Make room in the reply being built
+ * @param fh the fake handle
+ * @param len the number of bytes needed
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_reserve(struct nlbl_fake_hndl *fh, size_t len)
+{
+	struct nlbl_fake_buf *buf = fh->cur;
+	unsigned char *data_new;
+	size_t size_new;
+
+	if (buf == NULL) {
+		buf = calloc(1, sizeof(*buf));
+		if (buf == NULL)
+			return -ENOMEM;
+		fh->cur = buf;
+	}
+	if (buf->len + len <= buf->size)
+		return 0;
+
+	size_new = (buf->size > 0 ? buf->size : 256);
+	while (size_new < buf->len + len)
+		size_new *= 2;
+	data_new = realloc(buf->data, size_new);
+	if (data_new == NULL)
+		return -ENOMEM;
+	buf->data = data_new;
+	buf->size = size_new;
+
+	return 0;
+}
+
+/**
+ * Queue the reply being built
+ * @param fh the fake handle
+ *
+ * Queue the messages built so far as a single read on the handle.  As in the
+ * kernel, a reply which arrives when the receive buffer is already full is
+ * dropped and the overflow is reported by the next read.  Dumps are never
+ * dropped as the kernel only continues a dump once the reader makes room.
+ *
+ */
+static void nlbl_fake_flush(struct nlbl_fake_hndl *fh)
+{
+	struct nlbl_fake_buf *buf = fh->cur;
+	struct nlmsghdr *nl_hdr;
+
+	if (buf == NULL || buf->len == 0)
+		return;
+
+	nl_hdr = (struct nlmsghdr *)buf->data;
+	if (!(nl_hdr->nlmsg_flags & NLM_F_MULTI) &&
+	    fh->queued > NLBL_FAKE_RCVBUF) {
+		buf->len = 0;
+		fh->overrun = 1;
+		return;
+	}
+	fh->queued += buf->len + NLBL_FAKE_RCVBUF_OVERHEAD;
+
+	if (fh->tail != NULL)
+		fh->tail->next = buf;
+	else
+		fh->head = buf;
+	fh->tail = buf;
+	fh->cur = NULL;
+}
+
+/**
+ * Start a reply message
+ * @param fh the fake handle
+ * @param req the request
+ * @param type the message type
+ * @param flags the message flags
+ * @param cmd the generic netlink command
+ * @param off the offset of the new message
+ *
+ * Start a new generic netlink message replying to @req, unless @type is a
+ * netlink control message in which case there is no generic netlink header.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_msg_start(struct nlbl_fake_hndl *fh,
+			       const struct nlmsghdr *req,
+			       uint16_t type, uint16_t flags, uint8_t cmd,
+			       size_t *off)
+{
+	int rc;
+	size_t len;
+	struct nlmsghdr *nl_hdr;
+	struct genlmsghdr *genl_hdr;
+
+	len = NLMSG_HDRLEN + (type >= NLMSG_MIN_TYPE ? GENL_HDRLEN : 0);
+	rc = nlbl_fake_reserve(fh, len);
+	if (rc < 0)
+		return rc;
+
+	*off = fh->cur->len;
+	nl_hdr = (struct nlmsghdr *)(fh->cur->data + *off);
+	memset(nl_hdr, 0, len);
+	nl_hdr->nlmsg_type = type;
+	nl_hdr->nlmsg_flags = flags;
+	nl_hdr->nlmsg_seq = req->nlmsg_seq;
+	nl_hdr->nlmsg_pid = req->nlmsg_pid;
+	if (type >= NLMSG_MIN_TYPE) {
+		genl_hdr = nlmsg_data(nl_hdr);
+		genl_hdr->cmd = cmd;
+		genl_hdr->version = NETLBL_PROTO_VERSION;
+	}
+	fh->cur->len += len;
+
+	return 0;
+}
+
+/**
+ * Finish a reply message
+ * @param fh the fake handle
+ * @param off the offset of the message
+ *
+ * Set the length of the message, and queue it unless it is part of a dump
+ * which has not yet filled the reply buffer.
+ *
+ */
+static void nlbl_fake_msg_end(struct nlbl_fake_hndl *fh, size_t off)
+{
+	struct nlmsghdr *nl_hdr;
+
+	nl_hdr = (struct nlmsghdr *)(fh->cur->data + off);
+	nl_hdr->nlmsg_len = fh->cur->len - off;
+	if (!(nl_hdr->nlmsg_flags & NLM_F_MULTI) ||
+	    fh->cur->len >= NLBL_FAKE_BUF_SIZE)
+		nlbl_fake_flush(fh);
+}
+
+/**
+ * Add an attribute to the message being built
+ * @param fh the fake handle
+ * @param type the attribute type
+ * @param data the attribute data
+ * @param len the length of the attribute data
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_put(struct nlbl_fake_hndl *fh,
+			 int type, const void *data, size_t len)
+{
+	int rc;
+	struct nlattr *nla;
+
+	rc = nlbl_fake_reserve(fh, nla_total_size(len));
+	if (rc < 0)
+		return rc;
+
+	nla = (struct nlattr *)(fh->cur->data + fh->cur->len);
+	memset(nla, 0, nla_total_size(len));
+	nla->nla_type = type;
+	nla->nla_len = nla_attr_size(len);
+	if (len > 0)
+		memcpy(nla_data(nla), data, len);
+	fh->cur->len += nla_total_size(len);
+
+	return 0;
+}
+
+/**
+ * Add a u32 attribute to the message being built
+ * @param fh the fake handle
+ * @param type the attribute type
+ * @param value the attribute value
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_put_u32(struct nlbl_fake_hndl *fh,
+			     int type, uint32_t value)
+{
+	return nlbl_fake_put(fh, type, &value, sizeof(value));
+}
+
+/**
+ * Start a nested attribute in the message being built
+ * @param fh the fake handle
+ * @param type the attribute type
+ * @param off the offset of the nested attribute
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_nest_start(struct nlbl_fake_hndl *fh,
+				int type, size_t *off)
+{
+	*off = (fh->cur != NULL ? fh->cur->len : 0);
+	return nlbl_fake_put(fh, type, NULL, 0);
+}
+
+/**
+ * Finish a nested attribute in the message being built
+ * @param fh the fake handle
+ * @param off the offset of the nested attribute
+ *
+ * Returns zero on success, negative values if the nested attribute is too
+ * large for its length field.
+ *
+ */
+static int nlbl_fake_nest_end(struct nlbl_fake_hndl *fh, size_t off)
+{
+	struct nlattr *nla;
+
+	if (fh->cur->len - off > UINT16_MAX)
+		return -EMSGSIZE;
+	nla = (struct nlattr *)(fh->cur->data + off);
+	nla->nla_len = fh->cur->len - off;
+
+	return 0;
+}
+
+/**
+ * Add an address and mask to the message being built
+ * @param fh the fake handle
+ * @param addr the address
+ * @param addr_v4 the IPv4 address attribute type
+ * @param mask_v4 the IPv4 mask attribute type
+ * @param addr_v6 the IPv6 address attribute type
+ * @param mask_v6 the IPv6 mask attribute type
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_put_addr(struct nlbl_fake_hndl *fh,
+			      const struct nlbl_netaddr *addr,
+			      int addr_v4, int mask_v4,
+			      int addr_v6, int mask_v6)
+{
+	int rc;
+
+	if (addr->type == AF_INET) {
+		rc = nlbl_fake_put(fh, addr_v4,
+				   &addr->addr.v4, sizeof(struct in_addr));
+		if (rc < 0)
+			return rc;
+		return nlbl_fake_put(fh, mask_v4,
+				     &addr->mask.v4, sizeof(struct in_addr));
+	}
+
+	rc = nlbl_fake_put(fh, addr_v6,
+			   &addr->addr.v6, sizeof(struct in6_addr));
+	if (rc < 0)
+		return rc;
+	return nlbl_fake_put(fh, mask_v6,
+			     &addr->mask.v6, sizeof(struct in6_addr));
+}
+
+/**
+ * Send an ACK
+ * @param fh the fake handle
+ * @param req the request
+ * @param err the result of the request
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_ack(struct nlbl_fake_hndl *fh,
+			 const struct nlmsghdr *req, int err)
+{
+	int rc;
+	size_t off;
+	struct nlmsgerr nl_err;
+
+	rc = nlbl_fake_msg_start(fh, req, NLMSG_ERROR, 0, 0, &off);
+	if (rc < 0)
+		return rc;
+	memset(&nl_err, 0, sizeof(nl_err));
+	nl_err.error = err;
+	nl_err.msg = *req;
+	rc = nlbl_fake_reserve(fh, NLMSG_ALIGN(sizeof(nl_err)));
+	if (rc < 0)
+		return rc;
+	memcpy(fh->cur->data + fh->cur->len, &nl_err, sizeof(nl_err));
+	fh->cur->len += NLMSG_ALIGN(sizeof(nl_err));
+	nlbl_fake_msg_end(fh, off);
+
+	return 0;
+}
+
+/**
+ * Finish a dump
+ * @param fh the fake handle
+ * @param req the request
+ *
+ * Add the NLMSG_DONE message which ends a dump and queue the reply.  Returns
+ * NLBL_FAKE_DUMPED on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_done(struct nlbl_fake_hndl *fh,
+			  const struct nlmsghdr *req)
+{
+	int rc;
+	size_t off;
+	int32_t done = 0;
+
+	rc = nlbl_fake_msg_start(fh, req, NLMSG_DONE, NLM_F_MULTI, 0, &off);
+	if (rc < 0)
+		return rc;
+	rc = nlbl_fake_reserve(fh, NLMSG_ALIGN(sizeof(done)));
+	if (rc < 0)
+		return rc;
+	memcpy(fh->cur->data + fh->cur->len, &done, sizeof(done));
+	fh->cur->len += NLMSG_ALIGN(sizeof(done));
+	nlbl_fake_msg_end(fh, off);
+	nlbl_fake_flush(fh);
+
+	return NLBL_FAKE_DUMPED;
+}
+
+/*
+ * Request Functions
+ */
+
+/**
+ * Parse the attributes of a request
+ * @param req the request
+ * @param tb the attribute table
+ * @param maxtype the highest attribute type in @tb
+ * @param policy the attribute policy
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_parse(struct nlmsghdr *req,
+			   struct nlattr **tb, int maxtype,
+			   struct nla_policy *policy)
+{
+	struct genlmsghdr *genl_hdr = nlmsg_data(req);
+
+	if (nla_parse(tb, maxtype,
+		      genlmsg_attrdata(genl_hdr, 0),
+		      genlmsg_attrlen(genl_hdr, 0), policy) < 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Parse an address and mask
+ * @param addr_v4 the IPv4 address attribute
+ * @param mask_v4 the IPv4 mask attribute
+ * @param addr_v6 the IPv6 address attribute
+ * @param mask_v6 the IPv6 mask attribute
+ * @param addr the address
+ *
+ * Parse the optional address in the attributes into @addr, masking the
+ * address; @addr's family is zero if there is no address.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int nlbl_fake_parse_addr(struct nlattr *addr_v4, struct nlattr *mask_v4,
+				struct nlattr *addr_v6, struct nlattr *mask_v6,
+				struct nlbl_netaddr *addr)
+{
+	unsigned int iter;
+
+	memset(addr, 0, sizeof(*addr));
+	if ((addr_v4 == NULL) != (mask_v4 == NULL) ||
+	    (addr_v6 == NULL) != (mask_v6 == NULL) ||
+	    (addr_v4 != NULL && addr_v6 != NULL))
+		return -EINVAL;
+
+	if (addr_v4 != NULL) {
+		addr->type = AF_INET;
+		memcpy(&addr->addr.v4, nla_data(addr_v4),
+		       sizeof(struct in_addr));
+		memcpy(&addr->mask.v4, nla_data(mask_v4),
+		       sizeof(struct in_addr));
+		addr->addr.v4.s_addr &= addr->mask.v4.s_addr;
+	} else if (addr_v6 != NULL) {
+		addr->type = AF_INET6;
+		memcpy(&addr->addr.v6, nla_data(addr_v6),
+		       sizeof(struct in6_addr));
+		memcpy(&addr->mask.v6, nla_data(mask_v6),
+		       sizeof(struct in6_addr));
+		for (iter = 0; iter < 4; iter++)
+			addr->addr.v6.s6_addr32[iter] &=
+				addr->mask.v6.s6_addr32[iter];
+	}
+
+	return 0;
+}
+
+/**
+ * Check that a request is, or is not, a dump request
+ * @param req the request
+ * @param dump true if the command is a dump
+ *
+ * Generic netlink refuses dump requests for commands which are not dumps and
+ * regular requests for commands which are.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_fake_dump_check(const struct nlmsghdr *req, unsigned int dump)
+{
+	if (((req->nlmsg_flags & NLM_F_DUMP) == NLM_F_DUMP) != !!dump)
+		return -EOPNOTSUPP;
+	return 0;
+}
+
+/**
+ * Add a domain mapping message to the reply
+ * @param fh the fake handle
+ * @param req the request
+ * @param cmd the NetLabel management command
+ * @param flags the message flags
+ * @param dom the domain mapping
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_mgmt_put(struct nlbl_fake_hndl *fh,
+			      const struct nlmsghdr *req,
+			      uint8_t cmd, uint16_t flags,
+			      const struct nlbl_fake_dom *dom)
+{
+	int rc;
+	size_t off;
+	size_t off_list;
+	size_t off_sel;
+	struct nlbl_fake_addr **sels = NULL;
+	uint32_t iter;
+
+	rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_MGMT, flags, cmd, &off);
+	if (rc < 0)
+		return rc;
+	if (dom->name != NULL) {
+		rc = nlbl_fake_put(fh, NLBL_MGMT_A_DOMAIN,
+				   dom->name, strlen(dom->name) + 1);
+		if (rc < 0)
+			return rc;
+	}
+
+	switch (dom->proto_type) {
+	case NETLBL_NLTYPE_ADDRSELECT:
+		sels = nlbl_fake_addr_sort(&dom->sels);
+		if (sels == NULL)
+			return -ENOMEM;
+		rc = nlbl_fake_nest_start(fh, NLBL_MGMT_A_SELECTORLIST,
+					  &off_list);
+		for (iter = 0; rc == 0 && iter < dom->sels.count; iter++) {
+			rc = nlbl_fake_nest_start(fh, NLBL_MGMT_A_ADDRSELECTOR,
+						  &off_sel);
+			if (rc == 0)
+				rc = nlbl_fake_put_addr(fh, &sels[iter]->addr,
+							NLBL_MGMT_A_IPV4ADDR,
+							NLBL_MGMT_A_IPV4MASK,
+							NLBL_MGMT_A_IPV6ADDR,
+							NLBL_MGMT_A_IPV6MASK);
+			if (rc == 0)
+				rc = nlbl_fake_put_u32(fh,
+						       NLBL_MGMT_A_PROTOCOL,
+						       sels[iter]->proto_type);
+			if (rc == 0 && sels[iter]->doi != NULL)
+				rc = nlbl_fake_put_u32(fh, NLBL_MGMT_A_CV4DOI,
+						       sels[iter]->doi->doi);
+			if (rc == 0)
+				rc = nlbl_fake_nest_end(fh, off_sel);
+		}
+		if (rc == 0)
+			rc = nlbl_fake_nest_end(fh, off_list);
+		free(sels);
+		break;
+	default:
+		rc = nlbl_fake_put_u32(fh, NLBL_MGMT_A_PROTOCOL,
+				       dom->proto_type);
+		if (rc == 0 && dom->doi != NULL)
+			rc = nlbl_fake_put_u32(fh, NLBL_MGMT_A_CV4DOI,
+					       dom->doi->doi);
+		break;
+	}
+	if (rc < 0)
+		return rc;
+
+	nlbl_fake_msg_end(fh, off);
+	return 0;
+}
+
+/**
+ * Add a domain mapping
+ * @param tb the request attributes
+ * @param name the domain, NULL for the default mapping
+ *
+ * Add a domain mapping, or an address selector to an existing domain mapping
+ * with address selectors.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int nlbl_fake_mgmt_add(struct nlattr **tb, const char *name)
+{
+	int rc;
+	struct nlbl_netaddr addr;
+	nlbl_proto proto_type;
+	struct nlbl_fake_doi *doi = NULL;
+	struct nlbl_fake_dom *dom;
+	struct nlbl_fake_addr *sel;
+
+	if (tb[NLBL_MGMT_A_PROTOCOL] == NULL)
+		return -EINVAL;
+	rc = nlbl_fake_parse_addr(tb[NLBL_MGMT_A_IPV4ADDR],
+				  tb[NLBL_MGMT_A_IPV4MASK],
+				  tb[NLBL_MGMT_A_IPV6ADDR],
+				  tb[NLBL_MGMT_A_IPV6MASK], &addr);
+	if (rc < 0)
+		return rc;
+
+	proto_type = nla_get_u32(tb[NLBL_MGMT_A_PROTOCOL]);
+	switch (proto_type) {
+	case NETLBL_NLTYPE_UNLABELED:
+		break;
+	case NETLBL_NLTYPE_CIPSOV4:
+		if (tb[NLBL_MGMT_A_CV4DOI] == NULL || addr.type == AF_INET6)
+			return -EINVAL;
+		doi = nlbl_fake_doi_find(nla_get_u32(tb[NLBL_MGMT_A_CV4DOI]));
+		if (doi == NULL)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	dom = nlbl_fake_dom_find(name);
+	if (addr.type == 0) {
+		if (dom != NULL)
+			return -EEXIST;
+		dom = nlbl_fake_dom_add(name);
+		if (dom == NULL)
+			return -ENOMEM;
+		dom->proto_type = proto_type;
+		dom->doi = doi;
+		if (doi != NULL)
+			doi->refs++;
+		return 0;
+	}
+
+	if (dom != NULL &&
+	    (dom->proto_type != NETLBL_NLTYPE_ADDRSELECT ||
+	     nlbl_fake_addr_find(dom, &addr) != NULL))
+		return -EEXIST;
+	if (dom == NULL) {
+		dom = nlbl_fake_dom_add(name);
+		if (dom == NULL)
+			return -ENOMEM;
+		dom->proto_type = NETLBL_NLTYPE_ADDRSELECT;
+	}
+	sel = nlbl_fake_addr_add(dom, &dom->sels, &addr);
+	if (sel == NULL) {
+		if (dom->sels.count == 0)
+			nlbl_fake_dom_del(dom);
+		return -ENOMEM;
+	}
+	sel->proto_type = proto_type;
+	sel->doi = doi;
+	if (doi != NULL)
+		doi->refs++;
+
+	return 0;
+}
+
+/**
+ * Handle a NetLabel management request
+ * @param fh the fake handle
+ * @param req the request
+ * @param cmd the NetLabel management command
+ *
+ * Returns zero or NLBL_FAKE_DUMPED on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_mgmt(struct nlbl_fake_hndl *fh,
+			  struct nlmsghdr *req, uint8_t cmd)
+{
+	int rc;
+	size_t off;
+	struct nlattr *tb[NLBL_MGMT_A_MAX + 1];
+	struct nlbl_fake_dom *dom;
+	struct nlbl_fake_node *iter;
+
+	rc = nlbl_fake_parse(req, tb, NLBL_MGMT_A_MAX, nlbl_fake_mgmt_policy);
+	if (rc < 0)
+		return rc;
+	rc = nlbl_fake_dump_check(req, (cmd == NLBL_MGMT_C_LISTALL ||
+					cmd == NLBL_MGMT_C_PROTOCOLS));
+	if (rc < 0)
+		return rc;
+
+	switch (cmd) {
+	case NLBL_MGMT_C_ADD:
+		if (tb[NLBL_MGMT_A_DOMAIN] == NULL)
+			return -EINVAL;
+		return nlbl_fake_mgmt_add(tb, nla_data(tb[NLBL_MGMT_A_DOMAIN]));
+	case NLBL_MGMT_C_ADDDEF:
+		return nlbl_fake_mgmt_add(tb, NULL);
+	case NLBL_MGMT_C_REMOVE:
+	case NLBL_MGMT_C_REMOVEDEF:
+		if (cmd == NLBL_MGMT_C_REMOVE && tb[NLBL_MGMT_A_DOMAIN] == NULL)
+			return -EINVAL;
+		dom = nlbl_fake_dom_find(cmd == NLBL_MGMT_C_REMOVE ?
+					 nla_data(tb[NLBL_MGMT_A_DOMAIN]) :
+					 NULL);
+		if (dom == NULL)
+			return -ENOENT;
+		nlbl_fake_dom_del(dom);
+		return 0;
+	case NLBL_MGMT_C_LISTALL:
+		for (iter = nlfake_doms.head; iter != NULL; iter = iter->next) {
+			rc = nlbl_fake_mgmt_put(fh, req, cmd, NLM_F_MULTI,
+						(struct nlbl_fake_dom *)iter);
+			if (rc < 0)
+				return rc;
+		}
+		return nlbl_fake_done(fh, req);
+	case NLBL_MGMT_C_LISTDEF:
+		if (nlfake_dom_def == NULL)
+			return -ENOENT;
+		return nlbl_fake_mgmt_put(fh, req, cmd, 0, nlfake_dom_def);
+	case NLBL_MGMT_C_PROTOCOLS:
+		rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_MGMT,
+					 NLM_F_MULTI, cmd, &off);
+		if (rc == 0)
+			rc = nlbl_fake_put_u32(fh, NLBL_MGMT_A_PROTOCOL,
+					       NETLBL_NLTYPE_UNLABELED);
+		if (rc < 0)
+			return rc;
+		nlbl_fake_msg_end(fh, off);
+		rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_MGMT,
+					 NLM_F_MULTI, cmd, &off);
+		if (rc == 0)
+			rc = nlbl_fake_put_u32(fh, NLBL_MGMT_A_PROTOCOL,
+					       NETLBL_NLTYPE_CIPSOV4);
+		if (rc < 0)
+			return rc;
+		nlbl_fake_msg_end(fh, off);
+		return nlbl_fake_done(fh, req);
+	case NLBL_MGMT_C_VERSION:
+		rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_MGMT,
+					 0, cmd, &off);
+		if (rc == 0)
+			rc = nlbl_fake_put_u32(fh, NLBL_MGMT_A_VERSION,
+					       NETLBL_PROTO_VERSION);
+		if (rc < 0)
+			return rc;
+		nlbl_fake_msg_end(fh, off);
+		return 0;
+	}
+
+	return -EOPNOTSUPP;
+}
+
+/**
+ * Compare two CIPSOv4 level or category mappings
+ * @param a the first mapping
+ * @param b the second mapping
+ *
+ * Order the mappings by local value, then by the order they were given in.
+ *
+ */
+static int nlbl_fake_cv4_map_cmp(const void *a, const void *b)
+{
+	const uint32_t *map_a = a;
+	const uint32_t *map_b = b;
+
+	if (map_a[0] != map_b[0])
+		return (map_a[0] < map_b[0] ? -1 : 1);
+	return (map_a[2] < map_b[2] ? -1 : (map_a[2] > map_b[2]));
+}
+
+/**
+ * Parse a list of CIPSOv4 level or category mappings
+ * @param list the list attribute
+ * @param type the mapping attribute type
+ * @param loc_type the local value attribute type
+ * @param rem_type the remote value attribute type
+ * @param rem_max the highest remote value
+ * @param array the mappings, pairs of local and remote values
+ * @param count the number of mappings
+ *
+ * Parse the mappings in @list and return them ordered by local value, as the
+ * kernel does a later mapping of the same local value replaces an earlier
+ * one.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_cv4_map(struct nlattr *list,
+			     int type, int loc_type, int rem_type,
+			     uint32_t rem_max, uint32_t **array, size_t *count)
+{
+	int rc = -EINVAL;
+	struct nlattr *tb[NLBL_CIPSOV4_A_MAX + 1];
+	struct nlattr *nla;
+	int nla_rem;
+	uint32_t *maps = NULL;
+	uint32_t *maps_new;
+	size_t cnt = 0;
+	size_t iter;
+
+	nla_for_each_nested(nla, list, nla_rem) {
+		if (nla_type(nla) != type)
+			continue;
+		if (nla_parse_nested(tb, NLBL_CIPSOV4_A_MAX, nla,
+				     nlbl_fake_cipsov4_policy) < 0 ||
+		    tb[loc_type] == NULL || tb[rem_type] == NULL ||
+		    nla_get_u32(tb[loc_type]) >= NLBL_FAKE_CV4_MAX_LOC ||
+		    nla_get_u32(tb[rem_type]) > rem_max)
+			goto map_failure;
+		maps_new = nlbl_array_grow(maps, cnt, 3 * sizeof(*maps));
+		if (maps_new == NULL) {
+			rc = -ENOMEM;
+			goto map_failure;
+		}
+		maps = maps_new;
+		maps[cnt * 3] = nla_get_u32(tb[loc_type]);
+		maps[cnt * 3 + 1] = nla_get_u32(tb[rem_type]);
+		maps[cnt * 3 + 2] = cnt;
+		cnt++;
+	}
+
+	/* sort by local value, keeping the last mapping of each value */
+	*count = 0;
+	*array = NULL;
+	if (cnt == 0)
+		return 0;
+	qsort(maps, cnt, 3 * sizeof(*maps), nlbl_fake_cv4_map_cmp);
+	for (iter = 0; iter < cnt; iter++) {
+		if (iter + 1 < cnt && maps[iter * 3] == maps[iter * 3 + 3])
+			continue;
+		maps[*count * 2] = maps[iter * 3];
+		maps[*count * 2 + 1] = maps[iter * 3 + 1];
+		(*count)++;
+	}
+	*array = maps;
+	return 0;
+
+map_failure:
+	free(maps);
+	return rc;
+}
+
+/**
+ * Add a CIPSOv4 DOI definition
+ * @param tb the request attributes
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_cv4_add(struct nlattr **tb)
+{
+	int rc = -EINVAL;
+	struct nlbl_fake_doi *doi;
+	struct nlattr *nla;
+	int nla_rem;
+	unsigned int tag_cnt = 0;
+	unsigned int iter;
+
+	if (tb[NLBL_CIPSOV4_A_DOI] == NULL ||
+	    tb[NLBL_CIPSOV4_A_MTYPE] == NULL ||
+	    tb[NLBL_CIPSOV4_A_TAGLST] == NULL)
+		return -EINVAL;
+
+	doi = calloc(1, sizeof(*doi));
+	if (doi == NULL)
+		return -ENOMEM;
+	doi->doi = nla_get_u32(tb[NLBL_CIPSOV4_A_DOI]);
+	doi->mtype = nla_get_u32(tb[NLBL_CIPSOV4_A_MTYPE]);
+	switch (doi->mtype) {
+	case CIPSO_V4_MAP_TRANS:
+		if (tb[NLBL_CIPSOV4_A_MLSLVLLST] == NULL)
+			goto add_failure;
+		break;
+	case CIPSO_V4_MAP_PASS:
+	case CIPSO_V4_MAP_LOCAL:
+		break;
+	default:
+		goto add_failure;
+	}
+
+	/* tags, checked as the kernel does */
+	if (nla_validate(nla_data(tb[NLBL_CIPSOV4_A_TAGLST]),
+			 nla_len(tb[NLBL_CIPSOV4_A_TAGLST]),
+			 NLBL_CIPSOV4_A_MAX, nlbl_fake_cipsov4_policy) < 0)
+		goto add_failure;
+	nla_for_each_nested(nla, tb[NLBL_CIPSOV4_A_TAGLST], nla_rem)
+		if (nla_type(nla) == NLBL_CIPSOV4_A_TAG) {
+			if (tag_cnt >= NLBL_FAKE_CV4_TAG_MAXCNT)
+				goto add_failure;
+			doi->tags[tag_cnt++] = nla_get_u8(nla);
+		}
+	for (iter = 0; iter < NLBL_FAKE_CV4_TAG_MAXCNT; iter++)
+		switch (doi->tags[iter]) {
+		case NLBL_FAKE_CV4_TAG_RBITMAP:
+			break;
+		case NLBL_FAKE_CV4_TAG_ENUM:
+		case NLBL_FAKE_CV4_TAG_RANGE:
+			if (doi->mtype != CIPSO_V4_MAP_PASS)
+				goto add_failure;
+			break;
+		case NLBL_FAKE_CV4_TAG_LOCAL:
+			if (doi->mtype != CIPSO_V4_MAP_LOCAL)
+				goto add_failure;
+			break;
+		case NLBL_FAKE_CV4_TAG_INVALID:
+			if (iter == 0)
+				goto add_failure;
+			break;
+		default:
+			goto add_failure;
+		}
+
+	/* level and category translations */
+	if (doi->mtype == CIPSO_V4_MAP_TRANS) {
+		rc = nlbl_fake_cv4_map(tb[NLBL_CIPSOV4_A_MLSLVLLST],
+				       NLBL_CIPSOV4_A_MLSLVL,
+				       NLBL_CIPSOV4_A_MLSLVLLOC,
+				       NLBL_CIPSOV4_A_MLSLVLREM,
+				       NLBL_FAKE_CV4_MAX_REM_LVLS,
+				       &doi->lvls, &doi->lvl_cnt);
+		if (rc < 0)
+			goto add_failure;
+		if (tb[NLBL_CIPSOV4_A_MLSCATLST] != NULL) {
+			rc = nlbl_fake_cv4_map(tb[NLBL_CIPSOV4_A_MLSCATLST],
+					       NLBL_CIPSOV4_A_MLSCAT,
+					       NLBL_CIPSOV4_A_MLSCATLOC,
+					       NLBL_CIPSOV4_A_MLSCATREM,
+					       NLBL_FAKE_CV4_MAX_REM_CATS,
+					       &doi->cats, &doi->cat_cnt);
+			if (rc < 0)
+				goto add_failure;
+		}
+		rc = -EINVAL;
+	}
+
+	if (doi->doi == 0)
+		goto add_failure;
+	if (nlbl_fake_doi_find(doi->doi) != NULL) {
+		rc = -EEXIST;
+		goto add_failure;
+	}
+	rc = nlbl_fake_tbl_add(&nlfake_dois, &doi->node,
+			       nlbl_fake_hash(&doi->doi, sizeof(doi->doi),
+					      NLBL_FAKE_HASH_INIT));
+	if (rc < 0)
+		goto add_failure;
+
+	return 0;
+
+add_failure:
+	nlbl_fake_doi_free(doi);
+	return rc;
+}
+
+/**
+ * Remove a CIPSOv4 DOI definition
+ * @param doi_val the DOI value
+ *
+ * Remove the DOI definition along with the domain mappings which use it, as
+ * the kernel does the DOI can not be removed while the default mapping or an
+ * address selector still uses it.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+static int nlbl_fake_cv4_remove(nlbl_cv4_doi doi_val)
+{
+	struct nlbl_fake_doi *doi;
+	struct nlbl_fake_node *iter;
+	struct nlbl_fake_node *next;
+	struct nlbl_fake_dom *dom;
+
+	doi = nlbl_fake_doi_find(doi_val);
+	if (doi == NULL)
+		return -ENOENT;
+
+	for (iter = nlfake_doms.head; iter != NULL; iter = next) {
+		next = iter->next;
+		dom = (struct nlbl_fake_dom *)iter;
+		if (dom->doi == doi)
+			nlbl_fake_dom_del(dom);
+	}
+	if (doi->refs > 0)
+		return -EBUSY;
+
+	nlbl_fake_tbl_del(&nlfake_dois, &doi->node);
+	nlbl_fake_doi_free(doi);
+	return 0;
+}
+
+/**
+ * Add a CIPSOv4 level or category mapping list to the reply
+ * @param fh the fake handle
+ * @param array the mappings
+ * @param count the number of mappings
+ * @param list_type the list attribute type
+ * @param type the mapping attribute type
+ * @param loc_type the local value attribute type
+ * @param rem_type the remote value attribute type
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_cv4_put_map(struct nlbl_fake_hndl *fh,
+				 const uint32_t *array, size_t count,
+				 int list_type, int type,
+				 int loc_type, int rem_type)
+{
+	int rc;
+	size_t off_list;
+	size_t off_map;
+	size_t iter;
+
+	rc = nlbl_fake_nest_start(fh, list_type, &off_list);
+	for (iter = 0; rc == 0 && iter < count; iter++) {
+		rc = nlbl_fake_nest_start(fh, type, &off_map);
+		if (rc == 0)
+			rc = nlbl_fake_put_u32(fh, loc_type, array[iter * 2]);
+		if (rc == 0)
+			rc = nlbl_fake_put_u32(fh, rem_type,
+					       array[iter * 2 + 1]);
+		if (rc == 0)
+			rc = nlbl_fake_nest_end(fh, off_map);
+	}
+	if (rc < 0)
+		return rc;
+
+	return nlbl_fake_nest_end(fh, off_list);
+}
+
+/**
+ * Handle a NetLabel CIPSOv4 request
+ * @param fh the fake handle
+ * @param req the request
+ * @param cmd the NetLabel CIPSOv4 command
+ *
+ * Returns zero or NLBL_FAKE_DUMPED on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_cipsov4(struct nlbl_fake_hndl *fh,
+			     struct nlmsghdr *req, uint8_t cmd)
+{
+	int rc;
+	size_t off;
+	size_t off_tags;
+	struct nlattr *tb[NLBL_CIPSOV4_A_MAX + 1];
+	struct nlbl_fake_doi *doi;
+	struct nlbl_fake_node *iter;
+	unsigned int tag;
+
+	rc = nlbl_fake_parse(req, tb, NLBL_CIPSOV4_A_MAX,
+			     nlbl_fake_cipsov4_policy);
+	if (rc < 0)
+		return rc;
+	rc = nlbl_fake_dump_check(req, cmd == NLBL_CIPSOV4_C_LISTALL);
+	if (rc < 0)
+		return rc;
+
+	switch (cmd) {
+	case NLBL_CIPSOV4_C_ADD:
+		return nlbl_fake_cv4_add(tb);
+	case NLBL_CIPSOV4_C_REMOVE:
+		if (tb[NLBL_CIPSOV4_A_DOI] == NULL)
+			return -EINVAL;
+		return nlbl_fake_cv4_remove(
+				nla_get_u32(tb[NLBL_CIPSOV4_A_DOI]));
+	case NLBL_CIPSOV4_C_LIST:
+		if (tb[NLBL_CIPSOV4_A_DOI] == NULL)
+			return -EINVAL;
+		doi = nlbl_fake_doi_find(nla_get_u32(tb[NLBL_CIPSOV4_A_DOI]));
+		if (doi == NULL)
+			return -ENOENT;
+		rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_CIPSOV4,
+					 0, cmd, &off);
+		if (rc == 0)
+			rc = nlbl_fake_put_u32(fh, NLBL_CIPSOV4_A_MTYPE,
+					       doi->mtype);
+		if (rc == 0)
+			rc = nlbl_fake_nest_start(fh, NLBL_CIPSOV4_A_TAGLST,
+						  &off_tags);
+		for (tag = 0; rc == 0 && tag < NLBL_FAKE_CV4_TAG_MAXCNT &&
+			      doi->tags[tag] != NLBL_FAKE_CV4_TAG_INVALID;
+		     tag++)
+			rc = nlbl_fake_put(fh, NLBL_CIPSOV4_A_TAG,
+					   &doi->tags[tag], 1);
+		if (rc == 0)
+			rc = nlbl_fake_nest_end(fh, off_tags);
+		if (rc == 0 && doi->mtype == CIPSO_V4_MAP_TRANS)
+			rc = nlbl_fake_cv4_put_map(fh,
+						   doi->lvls, doi->lvl_cnt,
+						   NLBL_CIPSOV4_A_MLSLVLLST,
+						   NLBL_CIPSOV4_A_MLSLVL,
+						   NLBL_CIPSOV4_A_MLSLVLLOC,
+						   NLBL_CIPSOV4_A_MLSLVLREM);
+		if (rc == 0 && doi->mtype == CIPSO_V4_MAP_TRANS)
+			rc = nlbl_fake_cv4_put_map(fh,
+						   doi->cats, doi->cat_cnt,
+						   NLBL_CIPSOV4_A_MLSCATLST,
+						   NLBL_CIPSOV4_A_MLSCAT,
+						   NLBL_CIPSOV4_A_MLSCATLOC,
+						   NLBL_CIPSOV4_A_MLSCATREM);
+		if (rc < 0)
+			return rc;
+		nlbl_fake_msg_end(fh, off);
+		return 0;
+	case NLBL_CIPSOV4_C_LISTALL:
+		for (iter = nlfake_dois.head; iter != NULL; iter = iter->next) {
+			doi = (struct nlbl_fake_doi *)iter;
+			rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_CIPSOV4,
+						 NLM_F_MULTI, cmd, &off);
+			if (rc == 0)
+				rc = nlbl_fake_put_u32(fh, NLBL_CIPSOV4_A_DOI,
+						       doi->doi);
+			if (rc == 0)
+				rc = nlbl_fake_put_u32(fh,
+						       NLBL_CIPSOV4_A_MTYPE,
+						       doi->mtype);
+			if (rc < 0)
+				return rc;
+			nlbl_fake_msg_end(fh, off);
+		}
+		return nlbl_fake_done(fh, req);
+	}
+
+	return -EOPNOTSUPP;
+}
+
+/**
+ * Add the static labels of an interface to the reply
+ * @param fh the fake handle
+ * @param req the request
+ * @param cmd the NetLabel unlabeled command
+ * @param iface the interface
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_unlbl_put(struct nlbl_fake_hndl *fh,
+			       const struct nlmsghdr *req, uint8_t cmd,
+			       const struct nlbl_fake_iface *iface)
+{
+	int rc = 0;
+	size_t off;
+	struct nlbl_fake_addr **addrs;
+	uint32_t iter;
+
+	addrs = nlbl_fake_addr_sort(&iface->addrs);
+	if (addrs == NULL)
+		return -ENOMEM;
+
+	for (iter = 0; iter < iface->addrs.count; iter++) {
+		rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_UNLBL,
+					 NLM_F_MULTI, cmd, &off);
+		if (rc == 0 && iface->name != NULL)
+			rc = nlbl_fake_put(fh, NLBL_UNLABEL_A_IFACE,
+					   iface->name,
+					   strlen(iface->name) + 1);
+		if (rc == 0)
+			rc = nlbl_fake_put_addr(fh, &addrs[iter]->addr,
+						NLBL_UNLABEL_A_IPV4ADDR,
+						NLBL_UNLABEL_A_IPV4MASK,
+						NLBL_UNLABEL_A_IPV6ADDR,
+						NLBL_UNLABEL_A_IPV6MASK);
+		if (rc == 0)
+			rc = nlbl_fake_put(fh, NLBL_UNLABEL_A_SECCTX,
+					   addrs[iter]->label,
+					   strlen(addrs[iter]->label) + 1);
+		if (rc < 0)
+			break;
+		nlbl_fake_msg_end(fh, off);
+	}
+
+	free(addrs);
+	return rc;
+}
+
+/**
+ * Add a static label
+ * @param tb the request attributes
+ * @param name the interface, NULL for a default static label
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_unlbl_add(struct nlattr **tb, const char *name)
+{
+	int rc;
+	struct nlbl_netaddr addr;
+	const char *label;
+	struct nlbl_fake_iface *iface;
+	struct nlbl_fake_addr *sel;
+
+	if (tb[NLBL_UNLABEL_A_SECCTX] == NULL)
+		return -EINVAL;
+	label = nla_data(tb[NLBL_UNLABEL_A_SECCTX]);
+	rc = nlbl_fake_parse_addr(tb[NLBL_UNLABEL_A_IPV4ADDR],
+				  tb[NLBL_UNLABEL_A_IPV4MASK],
+				  tb[NLBL_UNLABEL_A_IPV6ADDR],
+				  tb[NLBL_UNLABEL_A_IPV6MASK], &addr);
+	if (rc < 0 || addr.type == 0 || label[0] == '\0')
+		return -EINVAL;
+
+	iface = nlbl_fake_iface_find(name);
+	if (iface == NULL) {
+		iface = calloc(1, sizeof(*iface));
+		if (iface == NULL)
+			return -ENOMEM;
+		iface->name = strdup(name);
+		if (iface->name == NULL ||
+		    nlbl_fake_tbl_add(&nlfake_ifaces, &iface->node,
+				      nlbl_fake_hash(name, strlen(name),
+					      NLBL_FAKE_HASH_INIT)) < 0) {
+			free(iface->name);
+			free(iface);
+			return -ENOMEM;
+		}
+	} else if (nlbl_fake_addr_find(iface, &addr) != NULL)
+		return -EEXIST;
+
+	sel = nlbl_fake_addr_add(iface, &iface->addrs, &addr);
+	if (sel != NULL)
+		sel->label = strdup(label);
+	if (sel == NULL || sel->label == NULL) {
+		if (sel != NULL)
+			nlbl_fake_addr_del(&iface->addrs, sel);
+		rc = -ENOMEM;
+	}
+	if (iface->name != NULL && iface->addrs.count == 0) {
+		nlbl_fake_tbl_del(&nlfake_ifaces, &iface->node);
+		free(iface->name);
+		free(iface);
+	}
+
+	return rc;
+}
+
+/**
+ * Remove a static label
+ * @param tb the request attributes
+ * @param name the interface, NULL for a default static label
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_unlbl_remove(struct nlattr **tb, const char *name)
+{
+	int rc;
+	struct nlbl_netaddr addr;
+	struct nlbl_fake_iface *iface;
+	struct nlbl_fake_addr *sel;
+
+	rc = nlbl_fake_parse_addr(tb[NLBL_UNLABEL_A_IPV4ADDR],
+				  tb[NLBL_UNLABEL_A_IPV4MASK],
+				  tb[NLBL_UNLABEL_A_IPV6ADDR],
+				  tb[NLBL_UNLABEL_A_IPV6MASK], &addr);
+	if (rc < 0 || addr.type == 0)
+		return -EINVAL;
+
+	iface = nlbl_fake_iface_find(name);
+	if (iface == NULL)
+		return -ENOENT;
+	sel = nlbl_fake_addr_find(iface, &addr);
+	if (sel == NULL)
+		return -ENOENT;
+	nlbl_fake_addr_del(&iface->addrs, sel);
+
+	if (iface->name != NULL && iface->addrs.count == 0) {
+		nlbl_fake_tbl_del(&nlfake_ifaces, &iface->node);
+		free(iface->name);
+		free(iface);
+	}
+
+	return 0;
+}
+
+/**
+ * Handle a NetLabel unlabeled request
+ * @param fh the fake handle
+ * @param req the request
+ * @param cmd the NetLabel unlabeled command
+ *
+ * Returns zero or NLBL_FAKE_DUMPED on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_unlbl(struct nlbl_fake_hndl *fh,
+			   struct nlmsghdr *req, uint8_t cmd)
+{
+	int rc;
+	size_t off;
+	struct nlattr *tb[NLBL_UNLABEL_A_MAX + 1];
+	struct nlbl_fake_node *iter;
+
+	rc = nlbl_fake_parse(req, tb, NLBL_UNLABEL_A_MAX,
+			     nlbl_fake_unlbl_policy);
+	if (rc < 0)
+		return rc;
+	rc = nlbl_fake_dump_check(req, (cmd == NLBL_UNLABEL_C_STATICLIST ||
+					cmd == NLBL_UNLABEL_C_STATICLISTDEF));
+	if (rc < 0)
+		return rc;
+
+	switch (cmd) {
+	case NLBL_UNLABEL_C_ACCEPT:
+		if (tb[NLBL_UNLABEL_A_ACPTFLG] == NULL ||
+		    nla_get_u8(tb[NLBL_UNLABEL_A_ACPTFLG]) > 1)
+			return -EINVAL;
+		nlfake_accept = nla_get_u8(tb[NLBL_UNLABEL_A_ACPTFLG]);
+		return 0;
+	case NLBL_UNLABEL_C_LIST:
+		rc = nlbl_fake_msg_start(fh, req, NLBL_FAKE_FID_UNLBL,
+					 0, cmd, &off);
+		if (rc == 0)
+			rc = nlbl_fake_put(fh, NLBL_UNLABEL_A_ACPTFLG,
+					   &nlfake_accept, 1);
+		if (rc < 0)
+			return rc;
+		nlbl_fake_msg_end(fh, off);
+		return 0;
+	case NLBL_UNLABEL_C_STATICADD:
+	case NLBL_UNLABEL_C_STATICREMOVE:
+		if (tb[NLBL_UNLABEL_A_IFACE] == NULL)
+			return -EINVAL;
+		if (cmd == NLBL_UNLABEL_C_STATICADD)
+			return nlbl_fake_unlbl_add(tb,
+					nla_data(tb[NLBL_UNLABEL_A_IFACE]));
+		return nlbl_fake_unlbl_remove(tb,
+					nla_data(tb[NLBL_UNLABEL_A_IFACE]));
+	case NLBL_UNLABEL_C_STATICADDDEF:
+		return nlbl_fake_unlbl_add(tb, NULL);
+	case NLBL_UNLABEL_C_STATICREMOVEDEF:
+		return nlbl_fake_unlbl_remove(tb, NULL);
+	case NLBL_UNLABEL_C_STATICLIST:
+		for (iter = nlfake_ifaces.head;
+		     iter != NULL; iter = iter->next) {
+			rc = nlbl_fake_unlbl_put(fh, req, cmd,
+					(struct nlbl_fake_iface *)iter);
+			if (rc < 0)
+				return rc;
+		}
+		return nlbl_fake_done(fh, req);
+	case NLBL_UNLABEL_C_STATICLISTDEF:
+		rc = nlbl_fake_unlbl_put(fh, req, cmd, &nlfake_iface_def);
+		if (rc < 0)
+			return rc;
+		return nlbl_fake_done(fh, req);
+	}
+
+	return -EOPNOTSUPP;
+}
+
+/**
+ * Handle a request
+ * @param fh the fake handle
+ * @param req the request
+ *
+ * Returns zero or NLBL_FAKE_DUMPED on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_request(struct nlbl_fake_hndl *fh, struct nlmsghdr *req)
+{
+	uint8_t cmd;
+
+	if (req->nlmsg_len < NLMSG_HDRLEN + GENL_HDRLEN)
+		return -EINVAL;
+	cmd = ((struct genlmsghdr *)nlmsg_data(req))->cmd;
+
+	switch (req->nlmsg_type) {
+	case NLBL_FAKE_FID_MGMT:
+		return nlbl_fake_mgmt(fh, req, cmd);
+	case NLBL_FAKE_FID_CIPSOV4:
+		return nlbl_fake_cipsov4(fh, req, cmd);
+	case NLBL_FAKE_FID_UNLBL:
+		return nlbl_fake_unlbl(fh, req, cmd);
+	}
+
+	return -ENOENT;
+}
+
+/*
+ * Transport Functions
+ */
+
+/**
+ * Signal the state of the reply queue on the handle's file descriptor
+ * @param fh the fake handle
+ *
+ * Make the handle's file descriptor, if it has one, readable if and only if
+ * there are replies or a receive buffer overflow waiting to be read.
+ *
+ */
+static void nlbl_fake_signal(struct nlbl_fake_hndl *fh)
+{
+	uint64_t val;
+
+	if (fh->fd < 0)
+		return;
+	if (fh->head != NULL || fh->overrun) {
+		val = 1;
+		if (write(fh->fd, &val, sizeof(val)) < 0)
+			return;
+	} else if (read(fh->fd, &val, sizeof(val)) < 0)
+		return;
+}
+
+/**
+ * Open a fake handle
+ * @param hndl the NetLabel handle
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_open(struct nlbl_handle *hndl)
+{
+	int rc;
+	struct nlbl_fake_hndl *fh;
+
+	fh = calloc(1, sizeof(*fh));
+	if (fh == NULL)
+		return -ENOMEM;
+	fh->fd = -1;
+	fh->seq = 1;
+
+	pthread_mutex_lock(&nlfake_lock);
+	rc = nlbl_fake_boot();
+	fh->port = nlfake_port_next++;
+	pthread_mutex_unlock(&nlfake_lock);
+	if (rc < 0) {
+		free(fh);
+		return rc;
+	}
+
+	hndl->priv = fh;
+	return 0;
+}
+
+/**
+ * Discard any unread replies on a fake handle
+ * @param hndl the NetLabel handle
+ *
+ * Returns zero.
+ *
+ */
+static int nlbl_fake_drain(struct nlbl_handle *hndl)
+{
+	struct nlbl_fake_hndl *fh = hndl->priv;
+	struct nlbl_fake_buf *buf;
+
+	while (fh->head != NULL) {
+		buf = fh->head;
+		fh->head = buf->next;
+		free(buf->data);
+		free(buf);
+	}
+	fh->tail = NULL;
+	fh->queued = 0;
+	fh->overrun = 0;
+	nlbl_fake_signal(fh);
+
+	return 0;
+}
+
+/**
+ * Close a fake handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static void nlbl_fake_close(struct nlbl_handle *hndl)
+{
+	struct nlbl_fake_hndl *fh = hndl->priv;
+
+	nlbl_fake_drain(hndl);
+	if (fh->cur != NULL) {
+		free(fh->cur->data);
+		free(fh->cur);
+	}
+	if (fh->fd >= 0)
+		close(fh->fd);
+	free(fh);
+	hndl->priv = NULL;
+}
+
+/**
+ * Resolve a Generic Netlink family
+ * @param hndl the NetLabel handle
+ * @param family the family name
+ *
+ * Returns the family ID on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_resolve(struct nlbl_handle *hndl, const char *family)
+{
+	if (strcmp(family, NETLBL_NLTYPE_MGMT_NAME) == 0)
+		return NLBL_FAKE_FID_MGMT;
+	if (strcmp(family, NETLBL_NLTYPE_CIPSOV4_NAME) == 0)
+		return NLBL_FAKE_FID_CIPSOV4;
+	if (strcmp(family, NETLBL_NLTYPE_UNLABELED_NAME) == 0)
+		return NLBL_FAKE_FID_UNLBL;
+	return -ENOENT;
+}
+
+/**
+ * Return the port of a fake handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_fake_port(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_fake_hndl *)hndl->priv)->port;
+}
+
+/**
+ * Return the next sequence number of a fake handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_fake_seq(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_fake_hndl *)hndl->priv)->seq++;
+}
+
+/**
+ * Send a buffer of requests to the emulated kernel
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ *
+ * Handle each of the requests in @buf in turn, queuing the replies on the
+ * handle.  Returns the number of bytes written on success, negative values on
+ * failure.
+ *
+ */
+static int nlbl_fake_send(struct nlbl_handle *hndl, void *buf, size_t len)
+{
+	int rc = 0;
+	struct nlbl_fake_hndl *fh = hndl->priv;
+	struct nlmsghdr *req = buf;
+	int rem = len;
+	size_t mark;
+
+	pthread_mutex_lock(&nlfake_lock);
+	while (nlmsg_ok(req, rem)) {
+		mark = (fh->cur != NULL ? fh->cur->len : 0);
+		if ((req->nlmsg_flags & NLM_F_REQUEST) &&
+		    req->nlmsg_type >= NLMSG_MIN_TYPE)
+			rc = nlbl_fake_request(fh, req);
+		else
+			rc = 0;
+
+		/* drop any partial reply before reporting an error */
+		if (rc < 0 && fh->cur != NULL)
+			fh->cur->len = mark;
+		if (rc < 0 || (rc == 0 && (req->nlmsg_flags & NLM_F_ACK))) {
+			rc = nlbl_fake_ack(fh, req, rc);
+			if (rc < 0)
+				break;
+		}
+		rc = 0;
+
+		req = nlmsg_next(req, &rem);
+	}
+	pthread_mutex_unlock(&nlfake_lock);
+
+	nlbl_fake_flush(fh);
+	nlbl_fake_signal(fh);
+	return (rc < 0 ? rc : (int)len);
+}
+
+/**
+ * Read a reply from a fake handle
+ * @param hndl the NetLabel handle
+ * @param data the message buffer
+ *
+ * See nlbl_comm_recv_nowait().  A receive buffer overflow is reported once,
+ * with -ENOBUFS, ahead of any replies still waiting to be read.
+ *
+ */
+static int nlbl_fake_recv(struct nlbl_handle *hndl, unsigned char **data)
+{
+	int rc;
+	struct nlbl_fake_hndl *fh = hndl->priv;
+	struct nlbl_fake_buf *buf;
+
+	*data = NULL;
+	if (fh->overrun) {
+		fh->overrun = 0;
+		nlbl_fake_signal(fh);
+		return -ENOBUFS;
+	}
+	buf = fh->head;
+	if (buf == NULL)
+		return -EAGAIN;
+	fh->head = buf->next;
+	fh->queued -= buf->len + NLBL_FAKE_RCVBUF_OVERHEAD;
+	if (fh->head == NULL) {
+		fh->tail = NULL;
+		nlbl_fake_signal(fh);
+	}
+
+	*data = buf->data;
+	rc = buf->len;
+	free(buf);
+	return rc;
+}
+
+/**
+ * Wait for a reply on a fake handle
+ * @param hndl the NetLabel handle
+ * @param timeout the timeout in seconds
+ *
+ * Replies are queued as soon as a request is sent, so there is never a need
+ * to wait.  Returns a positive value if a reply or a receive buffer overflow
+ * is waiting, zero otherwise.
+ *
+ */
+static int nlbl_fake_wait(struct nlbl_handle *hndl, uint32_t timeout)
+{
+	struct nlbl_fake_hndl *fh = hndl->priv;
+
+	return (fh->head != NULL || fh->overrun);
+}
+
+/**
+ * Return the file descriptor of a fake handle
+ * @param hndl the NetLabel handle
+ *
+ * Return an event file descriptor which is readable whenever replies are
+ * waiting on the handle, creating it the first time it is needed.  Returns
+ * the file descriptor on success, negative values on failure.
+ *
+ */
+static int nlbl_fake_fd(struct nlbl_handle *hndl)
+{
+	struct nlbl_fake_hndl *fh = hndl->priv;
+
+	if (fh->fd < 0) {
+		fh->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fh->fd < 0)
+			return -errno;
+		if (fh->head != NULL || fh->overrun)
+			nlbl_fake_signal(fh);
+	}
+
+	return fh->fd;
+}
+
+/* fake transport, talks to the in-process kernel emulation */
+const struct nlbl_comm_ops nlbl_fake_ops = {
+	.open = nlbl_fake_open,
+	.close = nlbl_fake_close,
+	.resolve = nlbl_fake_resolve,
+	.port = nlbl_fake_port,
+	.seq = nlbl_fake_seq,
+	.send = nlbl_fake_send,
+	.recv = nlbl_fake_recv,
+	.wait = nlbl_fake_wait,
+	.drain = nlbl_fake_drain,
+	.fd = nlbl_fake_fd,
+};
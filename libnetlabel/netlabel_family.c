@@ -0,0 +1,324 @@
+/** @file
+ * NetLabel Generic Netlink Family Resolution
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The NetLabel Generic Netlink families are resolved the first time a request
+ * of the family is made, so a process which only talks to one family only
+ * pays for one controller round trip.  The kernel assigns the family IDs when
+ * the NetLabel families are registered at boot and they never change until
+ * the next boot, so when the family ID cache is enabled the IDs resolved over
+ * netlink are also written to a file, together with the kernel's boot ID,
+ * and later processes take the IDs from the file without asking the kernel.
+ * The file is ignored unless it belongs to root, or to us, and can only be
+ * written by its owner.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* kernel's boot ID */
+#define NLBL_FAMILY_BOOT_ID		"/proc/sys/kernel/random/boot_id"
+#define NLBL_FAMILY_BOOT_ID_LEN		36
+
+/* NetLabel Generic Netlink family */
+struct nlbl_family {
+	nlbl_proto type;
+	const char *name;
+	int fid;
+};
+
+/* NetLabel families, a family ID of zero has not been resolved yet; the IDs
+ * are only changed with nlfamily_lock held but resolved IDs may be read
+ * without it */
+static pthread_mutex_t nlfamily_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct nlbl_family nlfamily_tbl[] = {
+	{ NETLBL_NLTYPE_MGMT, NETLBL_NLTYPE_MGMT_NAME, 0 },
+	{ NETLBL_NLTYPE_CIPSOV4, NETLBL_NLTYPE_CIPSOV4_NAME, 0 },
+	{ NETLBL_NLTYPE_UNLABELED, NETLBL_NLTYPE_UNLABELED_NAME, 0 },
+};
+#define NLBL_FAMILY_COUNT \
+	(sizeof(nlfamily_tbl) / sizeof(nlfamily_tbl[0]))
+
+/* family ID cache, NULL if disabled */
+static char *nlfamily_cache = NULL;
+static unsigned int nlfamily_cache_read = 0;
+
+/*
+ * Helper Functions
+ */
+
+/**
+ * Read the kernel's boot ID
+ * @param boot_id the boot ID buffer
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_family_boot_id(char boot_id[NLBL_FAMILY_BOOT_ID_LEN + 1])
+{
+	int rc;
+	int fd;
+
+	fd = open(NLBL_FAMILY_BOOT_ID, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	rc = read(fd, boot_id, NLBL_FAMILY_BOOT_ID_LEN);
+	close(fd);
+	if (rc != NLBL_FAMILY_BOOT_ID_LEN)
+		return -EIO;
+	boot_id[NLBL_FAMILY_BOOT_ID_LEN] = '\0';
+
+	return 0;
+}
+
+/**
+ * Load the family ID cache
+ *
+ * Take the IDs of any families which have not been resolved yet from the
+ * family ID cache, if the cache was written during this boot by a trusted
+ * user.  The caller must hold nlfamily_lock.
+ *
+ */
+static void nlbl_family_cache_load(void)
+{
+	int fid;
+	unsigned int iter;
+	char boot_id[NLBL_FAMILY_BOOT_ID_LEN + 1];
+	char line[64];
+	char name[32];
+	struct stat st;
+	FILE *fp;
+
+	if (nlbl_family_boot_id(boot_id) < 0)
+		return;
+
+	fp = fopen(nlfamily_cache, "re");
+	if (fp == NULL)
+		return;
+	if (fstat(fileno(fp), &st) < 0 || !S_ISREG(st.st_mode) ||
+	    (st.st_uid != 0 && st.st_uid != geteuid()) ||
+	    (st.st_mode & (S_IWGRP | S_IWOTH)))
+		goto load_return;
+
+	/* the first line is the boot ID the IDs are valid for */
+	if (fgets(line, sizeof(line), fp) == NULL ||
+	    strncmp(line, boot_id, NLBL_FAMILY_BOOT_ID_LEN) != 0 ||
+	    line[NLBL_FAMILY_BOOT_ID_LEN] != '\n')
+		goto load_return;
+
+	/* each of the other lines is a family name and ID */
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (sscanf(line, "%31s %d", name, &fid) != 2 ||
+		    fid <= 0 || fid > 0xffff)
+			continue;
+		for (iter = 0; iter < NLBL_FAMILY_COUNT; iter++) {
+			if (nlfamily_tbl[iter].fid != 0 ||
+			    strcmp(nlfamily_tbl[iter].name, name) != 0)
+				continue;
+			__atomic_store_n(&nlfamily_tbl[iter].fid, fid,
+					 __ATOMIC_RELEASE);
+			nlbl_stats_family(name, fid);
+		}
+	}
+
+load_return:
+	fclose(fp);
+}
+
+/**
+ * Save the family ID cache
+ *
+ * Write the IDs of all of the resolved families to the family ID cache,
+ * replacing the file atomically.  Failures are ignored as the cache is only an
+ * optimization, e.g. only root can write the default cache.  The caller must
+ * hold nlfamily_lock.
+ *
+ */
+static void nlbl_family_cache_save(void)
+{
+	int fd;
+	unsigned int iter;
+	char boot_id[NLBL_FAMILY_BOOT_ID_LEN + 1];
+	char *path;
+	FILE *fp;
+	struct nlbl_family *fam;
+
+	if (nlbl_family_boot_id(boot_id) < 0)
+		return;
+
+	path = malloc(strlen(nlfamily_cache) + 8);
+	if (path == NULL)
+		return;
+	sprintf(path, "%s.XXXXXX", nlfamily_cache);
+	fd = mkstemp(path);
+	if (fd < 0)
+		goto save_return;
+	fp = fdopen(fd, "w");
+	if (fp == NULL) {
+		close(fd);
+		unlink(path);
+		goto save_return;
+	}
+
+	fchmod(fd, 0644);
+	fprintf(fp, "%s\n", boot_id);
+	for (iter = 0; iter < NLBL_FAMILY_COUNT; iter++) {
+		fam = &nlfamily_tbl[iter];
+		if (fam->fid > 0)
+			fprintf(fp, "%s %d\n", fam->name, fam->fid);
+	}
+	if (fclose(fp) != 0 || rename(path, nlfamily_cache) < 0)
+		unlink(path);
+
+save_return:
+	free(path);
+}
+
+/*
+ * Control Functions
+ */
+
+/**
+ * Cache the Generic Netlink family IDs
+ * @param path the cache file, NULL for the default cache file
+ *
+ * Enable the family ID cache kept in the file @path, or NLBL_FID_CACHE_PATH if
+ * @path is NULL, so that the NetLabel Generic Netlink family IDs only need to
+ * be resolved by the first process to use the netlink transport after each
+ * boot.  This should be called before nlbl_init().  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int nlbl_comm_fid_cache(const char *path)
+{
+	char *cache;
+
+	cache = strdup(path != NULL ? path : NLBL_FID_CACHE_PATH);
+	if (cache == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_lock(&nlfamily_lock);
+	free(nlfamily_cache);
+	nlfamily_cache = cache;
+	nlfamily_cache_read = 0;
+	pthread_mutex_unlock(&nlfamily_lock);
+
+	return 0;
+}
+
+/**
+ * Forget the resolved family IDs
+ *
+ * Forget the family IDs resolved so far, which belong to the old transport,
+ * when the NetLabel transport is changed.
+ *
+ */
+void nlbl_family_reset(void)
+{
+	unsigned int iter;
+
+	pthread_mutex_lock(&nlfamily_lock);
+	for (iter = 0; iter < NLBL_FAMILY_COUNT; iter++)
+		__atomic_store_n(&nlfamily_tbl[iter].fid, 0, __ATOMIC_RELEASE);
+	nlfamily_cache_read = 0;
+	pthread_mutex_unlock(&nlfamily_lock);
+}
+
+/*
+ * Resolution Functions
+ */
+
+/**
+ * Return the Generic Netlink family ID of a NetLabel family
+ * @param type the NetLabel family, NETLBL_NLTYPE_*
+ *
+ * Return the family ID of @type, resolving it first if this is the first
+ * time it is needed.  Once resolved the ID is returned without taking any
+ * locks, as this is called for every message.  Returns the family ID on
+ * success, negative values on failure.
+ *
+ */
+int nlbl_comm_family(nlbl_proto type)
+{
+	int rc;
+	unsigned int iter;
+	unsigned int cached;
+	struct nlbl_family *fam = NULL;
+	struct nlbl_handle *hndl;
+
+	for (iter = 0; iter < NLBL_FAMILY_COUNT; iter++)
+		if (nlfamily_tbl[iter].type == type)
+			fam = &nlfamily_tbl[iter];
+	if (fam == NULL)
+		return -EINVAL;
+
+	rc = __atomic_load_n(&fam->fid, __ATOMIC_ACQUIRE);
+	if (rc > 0)
+		return rc;
+
+	pthread_mutex_lock(&nlfamily_lock);
+	if (fam->fid > 0) {
+		rc = fam->fid;
+		goto family_return;
+	}
+
+	/* the cache only holds the kernel's family IDs */
+	cached = (nlbl_comm_transport_get() == NLBL_TRANSPORT_NETLINK &&
+		   nlfamily_cache != NULL);
+	if (cached && !nlfamily_cache_read) {
+		nlfamily_cache_read = 1;
+		nlbl_family_cache_load();
+		if (fam->fid > 0) {
+			rc = fam->fid;
+			goto family_return;
+		}
+	}
+
+	hndl = nlbl_comm_pool_get();
+	if (hndl == NULL) {
+		rc = -ENOMEM;
+		goto family_return;
+	}
+	rc = nlbl_comm_resolve(hndl, fam->name);
+	nlbl_comm_pool_put(hndl);
+	if (rc < 0)
+		goto family_return;
+	__atomic_store_n(&fam->fid, rc, __ATOMIC_RELEASE);
+
+	if (cached)
+		nlbl_family_cache_save();
+
+family_return:
+	pthread_mutex_unlock(&nlfamily_lock);
+	return rc;
+}
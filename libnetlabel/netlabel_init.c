@@ -31,46 +31,31 @@
 #include <libnetlabel.h>
 
 #include "netlabel_internal.h"
-#include "mod_mgmt.h"
-#include "mod_unlabeled.h"
-#include "mod_cipsov4.h"
 
 /**
  * Handle any NetLabel setup needed
  *
  * Initialize the NetLabel communication link, but do not open any general use
- * NetLabel handles.  Returns zero on success, negative values on failure.
+ * NetLabel handles.  The NetLabel Generic Netlink families are resolved when
+ * they are first used.  Returns zero on success, negative values on failure.
  *
  */
 int nlbl_init(void)
 {
-	int rc;
-
 	nlmsg_set_default_size(8192);
 
-	rc = nlbl_mgmt_init();
-	if (rc < 0)
-		return rc;
-
-	rc = nlbl_cipsov4_init();
-	if (rc < 0)
-		return rc;
-
-	rc = nlbl_unlbl_init();
-	if (rc < 0)
-		return rc;
-
 	return 0;
 }
 
 /**
  * Handle any NetLabel cleanup
  *
- * Perform any cleanup duties for the NetLabel communication link, does not
- * close any handles.
+ * Perform any cleanup duties for the NetLabel communication link, closes the
+ * idle handles in the library's handle pool but does not close any handles
+ * owned by the caller.
  *
  */
 void nlbl_exit(void)
 {
-	return;
+	nlbl_comm_pool_drain();
 }
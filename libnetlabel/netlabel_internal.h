@@ -31,9 +31,138 @@
 
 /* NetLabel communication handle */
 struct nlbl_handle {
+	const struct nlbl_comm_ops *ops;
 	struct nl_sock *nl_sock;
+	void *priv;
 };
 
+/* NetLabel transport operations */
+struct nlbl_comm_ops {
+	int (*open)(struct nlbl_handle *hndl);
+	void (*close)(struct nlbl_handle *hndl);
+	int (*resolve)(struct nlbl_handle *hndl, const char *family);
+	uint32_t (*port)(struct nlbl_handle *hndl);
+	uint32_t (*seq)(struct nlbl_handle *hndl);
+	/* errors are negative errno values, -EAGAIN if a non-blocking handle
+	 * can not be written without waiting */
+	int (*send)(struct nlbl_handle *hndl, void *buf, size_t len);
+	int (*recv)(struct nlbl_handle *hndl, unsigned char **data);
+	int (*wait)(struct nlbl_handle *hndl, uint32_t timeout);
+	int (*drain)(struct nlbl_handle *hndl);
+	int (*fd)(struct nlbl_handle *hndl);
+};
+
+/* netlink socket receive buffer, the kernel's default limit for SO_RCVBUF,
+ * which the kernel doubles to allow for its own overhead */
+#define NLBL_COMM_RCVBUF		212992
+
+/* NetLabel transports */
+extern const struct nlbl_comm_ops nlbl_fake_ops;
+extern const struct nlbl_comm_ops nlbl_replay_ops;
+extern const struct nlbl_comm_ops nlbl_daemon_ops;
+
+/* NetLabel traffic capture */
+#define NLBL_PCAP_REQUEST		6
+#define NLBL_PCAP_REPLY			7
+void nlbl_pcap_write(unsigned int dir, const void *buf, size_t len);
+
+/* NetLabel statistics */
+void nlbl_stats_family(const char *family, int fid);
+uint64_t nlbl_stats_clock(void);
+void nlbl_stats_send(struct nlbl_handle *hndl, const void *buf, size_t len,
+		     uint64_t start, int rc);
+void nlbl_stats_recv(struct nlbl_handle *hndl, const void *buf, size_t len);
+void nlbl_stats_timeout(struct nlbl_handle *hndl);
+void nlbl_stats_close(struct nlbl_handle *hndl);
+
+/* NetLabel communications control */
+uint32_t nlbl_comm_timeout_get(void);
+nlbl_transport nlbl_comm_transport_get(void);
+
+/* NetLabel handle pool */
+struct nlbl_handle *nlbl_comm_pool_get(void);
+void nlbl_comm_pool_put(struct nlbl_handle *hndl);
+void nlbl_comm_pool_drain(void);
+
+/* NetLabel generic netlink families */
+int nlbl_comm_resolve(struct nlbl_handle *hndl, const char *family);
+int nlbl_comm_family(nlbl_proto type);
+void nlbl_family_reset(void);
+
+/* NetLabel message allocation */
+nlbl_msg *nlbl_msg_new_size(size_t len);
+
+/* NetLabel raw message I/O */
+int nlbl_comm_msg_complete(struct nlbl_handle *hndl, nlbl_msg *msg);
+int nlbl_comm_send_raw(struct nlbl_handle *hndl, void *buf, size_t len);
+int nlbl_comm_recv_nowait(struct nlbl_handle *hndl, unsigned char **data);
+int nlbl_comm_fd(struct nlbl_handle *hndl);
+
+/* NetLabel dump requests */
+typedef int (*nlbl_comm_dump_cb)(struct nlmsghdr *nl_hdr, void *arg);
+int nlbl_comm_dump(struct nlbl_handle *hndl,
+		   nlbl_msg *msg,
+		   nlbl_comm_dump_cb cb, void *arg);
+
+/* NetLabel attribute parsing */
+int nlbl_attr_parse(struct nlmsghdr *nl_hdr,
+		    uint8_t command,
+		    struct nlattr **tb, int maxtype,
+		    const struct nla_policy *policy);
+int nlbl_attr_parse_nested(struct nlattr *nla,
+			   struct nlattr **tb, int maxtype,
+			   const struct nla_policy *policy);
+struct nlattr *nlbl_attr_nest_start(nlbl_msg *msg, int nla_type);
+int nlbl_attr_nest_end(nlbl_msg *msg, struct nlattr *nla);
+
+/* NetLabel result arrays */
+void *nlbl_array_grow(void *array, size_t count, size_t size);
+
+/* NetLabel longest prefix match tries */
+struct nlbl_lpm_node;
+struct nlbl_lpm {
+	struct nlbl_lpm_node *root4;
+	struct nlbl_lpm_node *root6;
+	size_t count;
+};
+typedef void (*nlbl_lpm_release)(void *value);
+void nlbl_lpm_init(struct nlbl_lpm *lpm);
+void nlbl_lpm_destroy(struct nlbl_lpm *lpm, nlbl_lpm_release release);
+int nlbl_lpm_insert(struct nlbl_lpm *lpm,
+		    const struct nlbl_netaddr *addr, void *value);
+void *nlbl_lpm_lookup(const struct nlbl_lpm *lpm,
+		      const struct nlbl_netaddr *addr);
+
+/* NetLabel batch requests */
+typedef void (*nlbl_batch_reply_cb)(uint32_t idx,
+				    struct nlmsghdr *nl_hdr, void *arg);
+int nlbl_batch_queue(struct nlbl_batch *batch, nlbl_msg *msg);
+int nlbl_batch_exec_reply(struct nlbl_handle *hndl,
+			  struct nlbl_batch *batch,
+			  int *status,
+			  nlbl_batch_reply_cb cb, void *cb_arg);
+
+/* NetLabel asynchronous request result handling */
+struct nlbl_async_ops {
+	int (*decode)(struct nlmsghdr *nl_hdr, struct nlbl_async_result *res);
+	void (*release)(struct nlbl_async_result *res);
+};
+int nlbl_async_submit(struct nlbl_async *async,
+		      nlbl_msg *msg,
+		      const struct nlbl_async_ops *ops,
+		      nlbl_async_cb cb, void *cb_arg);
+
+/* NetLabel request cache, only used by netlabeld; queries are served from a
+ * cache of the kernel's replies, configuration changes go to the kernel */
+struct nlbl_cache;
+typedef int (*nlbl_cache_reply_cb)(const void *buf, size_t len, void *arg);
+struct nlbl_cache *nlbl_cache_new(uint32_t max_age);
+void nlbl_cache_free(struct nlbl_cache *cache);
+void nlbl_cache_flush(struct nlbl_cache *cache);
+int nlbl_cache_request(struct nlbl_cache *cache,
+		       void *buf, size_t len, unsigned int admin,
+		       nlbl_cache_reply_cb cb, void *arg);
+
 #define NL_MULTI_CONTINUE(hdr) \
 	(((hdr)->nlmsg_type == 0) || \
 	 (((hdr)->nlmsg_flags & NLM_F_MULTI) && \
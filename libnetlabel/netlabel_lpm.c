@@ -0,0 +1,909 @@
+/** @file
+ * NetLabel Address Lookup Functions
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* NetLabel prefix trie node, internal nodes have a NULL value */
+struct nlbl_lpm_node {
+	uint32_t key[4];
+	uint32_t len;
+	void *value;
+	struct nlbl_lpm_node *child[2];
+};
+
+/* initial number of buckets in a named trie hash table */
+#define NLBL_LPM_HASH_SIZE	16
+
+/* NetLabel named prefix trie, for an interface or a domain */
+struct nlbl_lpm_ent {
+	char *name;
+	uint32_t hash;
+	struct nlbl_lpm lpm;
+	void *value;
+	struct nlbl_lpm_ent *next;
+};
+
+/* NetLabel named prefix trie hash table */
+struct nlbl_lpm_hash {
+	struct nlbl_lpm_ent **bkts;
+	uint32_t size;
+	uint32_t count;
+};
+
+/* NetLabel static label table */
+struct nlbl_unlbl_table {
+	struct nlbl_lpm_hash ifaces;
+	struct nlbl_lpm def;
+};
+
+/* NetLabel domain mapping table */
+struct nlbl_mgmt_table {
+	struct nlbl_lpm_hash domains;
+	struct nlbl_lpm_ent def;
+	uint8_t def_valid;
+};
+
+/*
+ * Prefix Trie Functions
+ */
+
+/**
+ * Convert a network address into a trie key
+ * @param addr the network address
+ * @param key the trie key
+ * @param len the prefix length
+ * @param bits the key length
+ *
+ * Convert @addr into a host byte order @key masked to the @len bits set in the
+ * address mask, and set @bits to the key length of the address family.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_lpm_key(const struct nlbl_netaddr *addr,
+			uint32_t *key, uint32_t *len, uint32_t *bits)
+{
+	uint32_t iter;
+	uint32_t words;
+	uint32_t mask;
+
+	switch (addr->type) {
+	case AF_INET:
+		words = 1;
+		key[0] = ntohl(addr->addr.v4.s_addr);
+		break;
+	case AF_INET6:
+		words = 4;
+		for (iter = 0; iter < 4; iter++)
+			key[iter] = ntohl(addr->addr.v6.s6_addr32[iter]);
+		break;
+	default:
+		return -EINVAL;
+	}
+	*bits = words * 32;
+
+	if (len == NULL)
+		return 0;
+	for (*len = 0, iter = 0; iter < words; iter++) {
+		mask = (addr->type == AF_INET ?
+			ntohl(addr->mask.v4.s_addr) :
+			ntohl(addr->mask.v6.s6_addr32[iter]));
+		if (mask == 0xffffffff) {
+			*len += 32;
+			continue;
+		}
+		if (mask != 0)
+			*len += __builtin_clz(~mask);
+		key[iter] &= mask;
+		for (iter++; iter < words; iter++)
+			key[iter] = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Return a bit from a trie key
+ * @param key the trie key
+ * @param bit the bit offset
+ *
+ * Returns the value of bit @bit in @key, counting from the most significant
+ * bit.
+ *
+ */
+static inline unsigned int nlbl_lpm_bit(const uint32_t *key, uint32_t bit)
+{
+	return (key[bit / 32] >> (31 - (bit % 32))) & 1;
+}
+
+/**
+ * Return the length of the common prefix of two trie keys
+ * @param a the first key
+ * @param b the second key
+ * @param max the maximum length
+ *
+ * Returns the number of leading bits, up to @max, which are the same in @a
+ * and @b.
+ *
+ */
+static uint32_t nlbl_lpm_common(const uint32_t *a, const uint32_t *b,
+				uint32_t max)
+{
+	uint32_t iter;
+	uint32_t diff;
+	uint32_t len;
+
+	for (iter = 0; iter * 32 < max; iter++) {
+		diff = a[iter] ^ b[iter];
+		if (diff != 0) {
+			len = iter * 32 + __builtin_clz(diff);
+			return (len < max ? len : max);
+		}
+	}
+
+	return max;
+}
+
+/**
+ * Allocate a trie node
+ * @param key the trie key
+ * @param len the prefix length
+ * @param value the node value
+ *
+ * Allocate a new node for the first @len bits of @key.  Returns a pointer to
+ * the node on success, NULL on failure.
+ *
+ */
+static struct nlbl_lpm_node *nlbl_lpm_node_new(const uint32_t *key,
+					       uint32_t len, void *value)
+{
+	struct nlbl_lpm_node *node;
+	uint32_t iter;
+
+	node = calloc(1, sizeof(*node));
+	if (node == NULL)
+		return NULL;
+	for (iter = 0; iter * 32 < len; iter++)
+		node->key[iter] = key[iter];
+	if (len % 32)
+		node->key[len / 32] &= ~(0xffffffff >> (len % 32));
+	node->len = len;
+	node->value = value;
+
+	return node;
+}
+
+/**
+ * Free a trie
+ * @param node the trie root
+ * @param release the value release function, may be NULL
+ *
+ * Free @node and all of the nodes below it, calling @release for each value.
+ *
+ */
+static void nlbl_lpm_node_free(struct nlbl_lpm_node *node,
+			       nlbl_lpm_release release)
+{
+	if (node == NULL)
+		return;
+
+	nlbl_lpm_node_free(node->child[0], release);
+	nlbl_lpm_node_free(node->child[1], release);
+	if (node->value != NULL && release != NULL)
+		release(node->value);
+	free(node);
+}
+
+/**
+ * Initialize a prefix trie
+ * @param lpm the prefix trie
+ *
+ * Initialize @lpm as an empty trie.
+ *
+ */
+void nlbl_lpm_init(struct nlbl_lpm *lpm)
+{
+	memset(lpm, 0, sizeof(*lpm));
+}
+
+/**
+ * Destroy a prefix trie
+ * @param lpm the prefix trie
+ * @param release the value release function, may be NULL
+ *
+ * Free all of the nodes in @lpm, calling @release for each value, and leave
+ * @lpm empty.
+ *
+ */
+void nlbl_lpm_destroy(struct nlbl_lpm *lpm, nlbl_lpm_release release)
+{
+	nlbl_lpm_node_free(lpm->root4, release);
+	nlbl_lpm_node_free(lpm->root6, release);
+	nlbl_lpm_init(lpm);
+}
+
+/**
+ * Add a prefix to a prefix trie
+ * @param lpm the prefix trie
+ * @param addr the network address and mask
+ * @param value the value, must not be NULL
+ *
+ * Add the network prefix given by @addr to @lpm, the address bits outside of
+ * the mask are ignored.  The trie is path compressed so each lookup visits at
+ * most one node for each distinct prefix length along the path.  Returns zero
+ * on success, -EEXIST if the prefix is already present, other negative values
+ * on failure.
+ *
+ */
+int nlbl_lpm_insert(struct nlbl_lpm *lpm,
+		    const struct nlbl_netaddr *addr, void *value)
+{
+	int rc;
+	uint32_t key[4];
+	uint32_t len;
+	uint32_t bits;
+	uint32_t common;
+	struct nlbl_lpm_node **slot;
+	struct nlbl_lpm_node *node;
+	struct nlbl_lpm_node *new;
+	struct nlbl_lpm_node *split;
+
+	if (value == NULL)
+		return -EINVAL;
+	rc = nlbl_lpm_key(addr, key, &len, &bits);
+	if (rc < 0)
+		return rc;
+
+	slot = (addr->type == AF_INET ? &lpm->root4 : &lpm->root6);
+	while ((node = *slot) != NULL) {
+		common = nlbl_lpm_common(key, node->key,
+					 (len < node->len ? len : node->len));
+		if (common == node->len) {
+			if (node->len == len) {
+				/* exact match */
+				if (node->value != NULL)
+					return -EEXIST;
+				node->value = value;
+				lpm->count++;
+				return 0;
+			}
+			/* the node is a prefix of the key, descend */
+			slot = &node->child[nlbl_lpm_bit(key, node->len)];
+			continue;
+		}
+
+		/* the key and the node diverge above the node */
+		new = nlbl_lpm_node_new(key, len, value);
+		if (new == NULL)
+			return -ENOMEM;
+		if (common == len) {
+			/* the key is a prefix of the node */
+			new->child[nlbl_lpm_bit(node->key, len)] = node;
+			*slot = new;
+		} else {
+			split = nlbl_lpm_node_new(key, common, NULL);
+			if (split == NULL) {
+				free(new);
+				return -ENOMEM;
+			}
+			split->child[nlbl_lpm_bit(node->key, common)] = node;
+			split->child[nlbl_lpm_bit(key, common)] = new;
+			*slot = split;
+		}
+		lpm->count++;
+		return 0;
+	}
+
+	new = nlbl_lpm_node_new(key, len, value);
+	if (new == NULL)
+		return -ENOMEM;
+	*slot = new;
+	lpm->count++;
+
+	return 0;
+}
+
+/**
+ * Find the longest matching prefix in a prefix trie
+ * @param lpm the prefix trie
+ * @param addr the network address
+ *
+ * Search @lpm for the longest prefix which contains the address in @addr, the
+ * address mask is ignored.  Lookups do not modify the trie so they may run
+ * concurrently.  Returns the value of the matching prefix, NULL if there is
+ * no match.
+ *
+ */
+void *nlbl_lpm_lookup(const struct nlbl_lpm *lpm,
+		      const struct nlbl_netaddr *addr)
+{
+	uint32_t key[4];
+	uint32_t bits;
+	const struct nlbl_lpm_node *node;
+	void *best = NULL;
+
+	if (nlbl_lpm_key(addr, key, NULL, &bits) < 0)
+		return NULL;
+
+	node = (addr->type == AF_INET ? lpm->root4 : lpm->root6);
+	while (node != NULL &&
+	       nlbl_lpm_common(key, node->key, node->len) == node->len) {
+		if (node->value != NULL)
+			best = node->value;
+		if (node->len == bits)
+			break;
+		node = node->child[nlbl_lpm_bit(key, node->len)];
+	}
+
+	return best;
+}
+
+/*
+ * Named Prefix Trie Hash Table Functions
+ */
+
+/**
+ * Hash a name
+ * @param name the name
+ *
+ * Returns the FNV-1a hash of @name.
+ *
+ */
+static uint32_t nlbl_lpm_hash_str(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name != '\0') {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * Find a named trie
+ * @param tbl the hash table
+ * @param name the name
+ *
+ * Returns the trie named @name in @tbl, NULL if there is none.
+ *
+ */
+static struct nlbl_lpm_ent *nlbl_lpm_hash_find(const struct nlbl_lpm_hash *tbl,
+					       const char *name)
+{
+	uint32_t hash;
+	struct nlbl_lpm_ent *iter;
+
+	if (tbl->count == 0)
+		return NULL;
+
+	hash = nlbl_lpm_hash_str(name);
+	for (iter = tbl->bkts[hash & (tbl->size - 1)];
+	     iter != NULL; iter = iter->next)
+		if (iter->hash == hash && strcmp(iter->name, name) == 0)
+			return iter;
+
+	return NULL;
+}
+
+/**
+ * Find or add a named trie
+ * @param tbl the hash table
+ * @param name the name
+ *
+ * Return the trie named @name in @tbl, adding an empty one and growing the
+ * hash table as needed if there is none.  Returns NULL on failure.
+ *
+ */
+static struct nlbl_lpm_ent *nlbl_lpm_hash_get(struct nlbl_lpm_hash *tbl,
+					      const char *name)
+{
+	struct nlbl_lpm_ent **bkts_new;
+	struct nlbl_lpm_ent *ent;
+	struct nlbl_lpm_ent *next;
+	uint32_t size_new;
+	uint32_t bkt;
+	uint32_t iter;
+
+	ent = nlbl_lpm_hash_find(tbl, name);
+	if (ent != NULL)
+		return ent;
+
+	if (tbl->count >= tbl->size) {
+		size_new = (tbl->size > 0 ? tbl->size * 2 :
+			    NLBL_LPM_HASH_SIZE);
+		bkts_new = calloc(size_new, sizeof(*bkts_new));
+		if (bkts_new == NULL)
+			return NULL;
+		for (iter = 0; iter < tbl->size; iter++)
+			for (ent = tbl->bkts[iter]; ent; ent = next) {
+				next = ent->next;
+				bkt = ent->hash & (size_new - 1);
+				ent->next = bkts_new[bkt];
+				bkts_new[bkt] = ent;
+			}
+		free(tbl->bkts);
+		tbl->bkts = bkts_new;
+		tbl->size = size_new;
+	}
+
+	ent = calloc(1, sizeof(*ent));
+	if (ent == NULL)
+		return NULL;
+	ent->name = strdup(name);
+	if (ent->name == NULL) {
+		free(ent);
+		return NULL;
+	}
+	ent->hash = nlbl_lpm_hash_str(name);
+	nlbl_lpm_init(&ent->lpm);
+	ent->next = tbl->bkts[ent->hash & (tbl->size - 1)];
+	tbl->bkts[ent->hash & (tbl->size - 1)] = ent;
+	tbl->count++;
+
+	return ent;
+}
+
+/**
+ * Destroy a named trie hash table
+ * @param tbl the hash table
+ * @param release the value release function, may be NULL
+ *
+ * Free all of the tries in @tbl, calling @release for each trie value and for
+ * the values held in each trie.
+ *
+ */
+static void nlbl_lpm_hash_destroy(struct nlbl_lpm_hash *tbl,
+				  nlbl_lpm_release release)
+{
+	uint32_t iter;
+	struct nlbl_lpm_ent *ent;
+	struct nlbl_lpm_ent *next;
+
+	for (iter = 0; iter < tbl->size; iter++)
+		for (ent = tbl->bkts[iter]; ent; ent = next) {
+			next = ent->next;
+			nlbl_lpm_destroy(&ent->lpm, release);
+			if (ent->value != NULL && release != NULL)
+				release(ent->value);
+			free(ent->name);
+			free(ent);
+		}
+	free(tbl->bkts);
+	memset(tbl, 0, sizeof(*tbl));
+}
+
+/*
+ * Static Label Table Functions
+ */
+
+/**
+ * Free a static label table mapping
+ * @param value the static label address mapping
+ *
+ * Free a mapping added by nlbl_unlbl_table_add(), the interface name belongs
+ * to the interface's trie.
+ *
+ */
+static void nlbl_unlbl_table_release(void *value)
+{
+	struct nlbl_addrmap *addr = value;
+
+	free(addr->label);
+	free(addr);
+}
+
+/**
+ * Walk callback used to load a static label table
+ * @param addr the static label address mapping
+ * @param arg the static label table
+ *
+ * Add @addr to the static label table.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_unlbl_table_load_cb(struct nlbl_addrmap *addr, void *arg)
+{
+	return nlbl_unlbl_table_add(arg, addr);
+}
+
+/**
+ * Walk callback used to load the default entries of a static label table
+ * @param addr the static label address mapping
+ * @param arg the static label table
+ *
+ * Add @addr to the default interface entries of the static label table.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_unlbl_table_loaddef_cb(struct nlbl_addrmap *addr, void *arg)
+{
+	struct nlbl_addrmap def = *addr;
+
+	def.dev = NULL;
+	return nlbl_unlbl_table_add(arg, &def);
+}
+
+/**
+ * Create a new static label table
+ *
+ * Create a new, empty, static label table which can be used to find the
+ * static label the kernel would assign to unlabeled traffic.  Returns a
+ * pointer to the table on success, NULL on failure.
+ *
+ */
+struct nlbl_unlbl_table *nlbl_unlbl_table_new(void)
+{
+	return calloc(1, sizeof(struct nlbl_unlbl_table));
+}
+
+/**
+ * Free a static label table
+ * @param tbl the static label table
+ *
+ * Free the static label table and all of the mappings within it.
+ *
+ */
+void nlbl_unlbl_table_free(struct nlbl_unlbl_table *tbl)
+{
+	if (tbl == NULL)
+		return;
+
+	nlbl_lpm_hash_destroy(&tbl->ifaces, nlbl_unlbl_table_release);
+	nlbl_lpm_destroy(&tbl->def, nlbl_unlbl_table_release);
+	free(tbl);
+}
+
+/**
+ * Add a static label mapping to a static label table
+ * @param tbl the static label table
+ * @param addr the static label address mapping
+ *
+ * Add a copy of @addr to @tbl, a NULL interface adds the mapping to the
+ * default interface entries.  Returns zero on success, -EEXIST if the
+ * interface already has a mapping for the same network, other negative values
+ * on failure.
+ *
+ */
+int nlbl_unlbl_table_add(struct nlbl_unlbl_table *tbl,
+			 struct nlbl_addrmap *addr)
+{
+	int rc;
+	struct nlbl_lpm_ent *iface = NULL;
+	struct nlbl_lpm *lpm;
+	struct nlbl_addrmap *entry;
+
+	/* sanity checks */
+	if (tbl == NULL || addr == NULL || addr->label == NULL)
+		return -EINVAL;
+	if (addr->addr.type != AF_INET && addr->addr.type != AF_INET6)
+		return -EINVAL;
+
+	if (addr->dev != NULL) {
+		iface = nlbl_lpm_hash_get(&tbl->ifaces, addr->dev);
+		if (iface == NULL)
+			return -ENOMEM;
+		lpm = &iface->lpm;
+	} else
+		lpm = &tbl->def;
+
+	entry = malloc(sizeof(*entry));
+	if (entry == NULL)
+		return -ENOMEM;
+	entry->dev = (iface != NULL ? iface->name : NULL);
+	entry->addr = addr->addr;
+	entry->label = strdup(addr->label);
+	if (entry->label == NULL) {
+		free(entry);
+		return -ENOMEM;
+	}
+
+	rc = nlbl_lpm_insert(lpm, &addr->addr, entry);
+	if (rc < 0)
+		nlbl_unlbl_table_release(entry);
+	return rc;
+}
+
+/**
+ * Load the kernel's static label configuration into a static label table
+ * @param hndl the NetLabel handle
+ * @param tbl the static label table
+ *
+ * Dump the NetLabel static label configuration, both the interface and the
+ * default mappings, into @tbl.  If @hndl is NULL then the function will handle
+ * opening and closing it's own NetLabel handle.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int nlbl_unlbl_table_load(struct nlbl_handle *hndl,
+			  struct nlbl_unlbl_table *tbl)
+{
+	int rc;
+
+	/* sanity checks */
+	if (tbl == NULL)
+		return -EINVAL;
+
+	rc = nlbl_unlbl_staticlist_walk(hndl, nlbl_unlbl_table_load_cb, tbl);
+	if (rc < 0)
+		return rc;
+	rc = nlbl_unlbl_staticlistdef_walk(hndl,
+					   nlbl_unlbl_table_loaddef_cb, tbl);
+	if (rc < 0)
+		return rc;
+
+	return 0;
+}
+
+/**
+ * Find the static label mapping for a packet
+ * @param tbl the static label table
+ * @param dev the network interface, NULL for the default interface
+ * @param addr the packet's source address
+ *
+ * Find the static label the kernel would assign to an unlabeled packet from
+ * @addr arriving on @dev.  As in the kernel, if @dev has any static label
+ * mappings only those are searched, otherwise the default interface mappings
+ * are used; the longest matching prefix wins and the address mask in @addr is
+ * ignored.  Lookups do not modify @tbl so they may run concurrently.  Returns
+ * a pointer to the matching mapping, valid until @tbl is freed, or NULL if
+ * there is no match.
+ *
+ */
+struct nlbl_addrmap *nlbl_unlbl_table_lookup(struct nlbl_unlbl_table *tbl,
+					     nlbl_netdev dev,
+					     struct nlbl_netaddr *addr)
+{
+	struct nlbl_lpm_ent *iface = NULL;
+
+	/* sanity checks */
+	if (tbl == NULL || addr == NULL)
+		return NULL;
+
+	if (dev != NULL)
+		iface = nlbl_lpm_hash_find(&tbl->ifaces, dev);
+	if (iface == NULL || iface->lpm.count == 0)
+		return nlbl_lpm_lookup(&tbl->def, addr);
+	return nlbl_lpm_lookup(&iface->lpm, addr);
+}
+
+/*
+ * Domain Mapping Table Functions
+ */
+
+/**
+ * Add a domain mapping to a domain mapping trie
+ * @param ent the domain mapping trie
+ * @param domain the domain mapping
+ *
+ * Add copies of the protocol configuration, or each of the address selectors,
+ * in @domain to @ent.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_mgmt_table_fill(struct nlbl_lpm_ent *ent,
+				struct nlbl_dommap *domain)
+{
+	int rc;
+	struct nlbl_dommap_addr *iter;
+	struct nlbl_dommap_addr *sel;
+
+	if (domain->proto_type != NETLBL_NLTYPE_ADDRSELECT) {
+		sel = calloc(1, sizeof(*sel));
+		if (sel == NULL)
+			return -ENOMEM;
+		sel->proto_type = domain->proto_type;
+		sel->proto.cv4_doi = domain->proto.cv4_doi;
+		ent->value = sel;
+		return 0;
+	}
+
+	for (iter = domain->proto.addrsel; iter != NULL; iter = iter->next) {
+		sel = malloc(sizeof(*sel));
+		if (sel == NULL)
+			return -ENOMEM;
+		*sel = *iter;
+		sel->next = NULL;
+		rc = nlbl_lpm_insert(&ent->lpm, &sel->addr, sel);
+		if (rc < 0) {
+			free(sel);
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Walk callback used to load a domain mapping table
+ * @param domain the domain mapping
+ * @param arg the domain mapping table
+ *
+ * Add @domain to the domain mapping table.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlbl_mgmt_table_load_cb(struct nlbl_dommap *domain, void *arg)
+{
+	return nlbl_mgmt_table_add(arg, domain);
+}
+
+/**
+ * Create a new domain mapping table
+ *
+ * Create a new, empty, domain mapping table which can be used to find the
+ * labeling protocol the kernel would use for outbound traffic.  Returns a
+ * pointer to the table on success, NULL on failure.
+ *
+ */
+struct nlbl_mgmt_table *nlbl_mgmt_table_new(void)
+{
+	return calloc(1, sizeof(struct nlbl_mgmt_table));
+}
+
+/**
+ * Free a domain mapping table
+ * @param tbl the domain mapping table
+ *
+ * Free the domain mapping table and all of the mappings within it.
+ *
+ */
+void nlbl_mgmt_table_free(struct nlbl_mgmt_table *tbl)
+{
+	if (tbl == NULL)
+		return;
+
+	nlbl_lpm_hash_destroy(&tbl->domains, free);
+	nlbl_lpm_destroy(&tbl->def.lpm, free);
+	free(tbl->def.value);
+	free(tbl);
+}
+
+/**
+ * Add a domain mapping to a domain mapping table
+ * @param tbl the domain mapping table
+ * @param domain the domain mapping
+ *
+ * Add a copy of @domain to @tbl, a NULL domain name adds the default mapping.
+ * Returns zero on success, -EEXIST if the domain is already present or has a
+ * duplicate address selector, other negative values on failure.
+ *
+ */
+int nlbl_mgmt_table_add(struct nlbl_mgmt_table *tbl,
+			struct nlbl_dommap *domain)
+{
+	struct nlbl_lpm_ent *ent;
+
+	/* sanity checks */
+	if (tbl == NULL || domain == NULL)
+		return -EINVAL;
+
+	if (domain->domain != NULL) {
+		if (nlbl_lpm_hash_find(&tbl->domains, domain->domain) != NULL)
+			return -EEXIST;
+		ent = nlbl_lpm_hash_get(&tbl->domains, domain->domain);
+		if (ent == NULL)
+			return -ENOMEM;
+	} else {
+		if (tbl->def_valid)
+			return -EEXIST;
+		ent = &tbl->def;
+		tbl->def_valid = 1;
+	}
+
+	return nlbl_mgmt_table_fill(ent, domain);
+}
+
+/**
+ * Load the kernel's domain mapping configuration into a domain mapping table
+ * @param hndl the NetLabel handle
+ * @param tbl the domain mapping table
+ *
+ * Dump the NetLabel domain mappings, including the default mapping if there is
+ * one, into @tbl.  If @hndl is NULL then the function will handle opening and
+ * closing it's own NetLabel handle.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+int nlbl_mgmt_table_load(struct nlbl_handle *hndl,
+			 struct nlbl_mgmt_table *tbl)
+{
+	int rc;
+	struct nlbl_dommap def;
+	struct nlbl_dommap_addr *iter;
+	struct nlbl_dommap_addr *next;
+
+	/* sanity checks */
+	if (tbl == NULL)
+		return -EINVAL;
+
+	rc = nlbl_mgmt_listall_walk(hndl, nlbl_mgmt_table_load_cb, tbl);
+	if (rc < 0)
+		return rc;
+
+	memset(&def, 0, sizeof(def));
+	rc = nlbl_mgmt_listdef(hndl, &def);
+	if (rc == -ENOENT)
+		return 0;
+	if (rc < 0)
+		return rc;
+	rc = nlbl_mgmt_table_add(tbl, &def);
+	if (def.proto_type == NETLBL_NLTYPE_ADDRSELECT)
+		for (iter = def.proto.addrsel; iter != NULL; iter = next) {
+			next = iter->next;
+			free(iter);
+		}
+	free(def.domain);
+
+	return (rc < 0 ? rc : 0);
+}
+
+/**
+ * Find the labeling protocol for outbound traffic
+ * @param tbl the domain mapping table
+ * @param domain the LSM domain
+ * @param addr the destination address
+ * @param def_flag set if the default mapping was used, may be NULL
+ *
+ * Find the labeling protocol the kernel would use for traffic sent by @domain
+ * to @addr.  As in the kernel, a domain without a mapping of its own uses the
+ * default mapping, and a mapping with address selectors uses the longest
+ * matching selector without falling back to the default mapping; the address
+ * mask in @addr is ignored.  Lookups do not modify @tbl so they may run
+ * concurrently.  Returns a pointer to the matching protocol configuration,
+ * valid until @tbl is freed, whose address family is zero if the mapping has
+ * no address selectors.  Returns NULL if there is no match, in which case the
+ * kernel refuses to send the traffic.
+ *
+ */
+struct nlbl_dommap_addr *nlbl_mgmt_table_lookup(struct nlbl_mgmt_table *tbl,
+						const char *domain,
+						struct nlbl_netaddr *addr,
+						uint8_t *def_flag)
+{
+	struct nlbl_lpm_ent *ent = NULL;
+
+	/* sanity checks */
+	if (tbl == NULL || addr == NULL)
+		return NULL;
+
+	if (domain != NULL)
+		ent = nlbl_lpm_hash_find(&tbl->domains, domain);
+	if (def_flag != NULL)
+		*def_flag = (ent == NULL);
+	if (ent == NULL) {
+		if (!tbl->def_valid)
+			return NULL;
+		ent = &tbl->def;
+	}
+
+	if (ent->value != NULL)
+		return ent->value;
+	return nlbl_lpm_lookup(&ent->lpm, addr);
+}
@@ -23,6 +23,7 @@
  */
 
 #include <stdlib.h>
+#include <limits.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -51,18 +52,25 @@ void nlbl_msg_free(nlbl_msg *msg)
 }
 
 /**
- * Create a new NetLabel message
+ * Create a new NetLabel message with room for a given payload
+ * @param len the length of the attributes, zero for the default size
  *
- * Creates a new NetLabel message and allocates space for both the Netlink and
- * Generic Netlink headers.
+ * Creates a new NetLabel message with space for both the Netlink and Generic
+ * Netlink headers followed by exactly @len bytes of attributes, so a message
+ * whose size is known in advance is built in a single allocation no matter
+ * how large it is.  If @len is zero the message has the default size.
+ * Returns a pointer to the new message on success, or NULL on failure.
  *
  */
-nlbl_msg *nlbl_msg_new(void)
+nlbl_msg *nlbl_msg_new_size(size_t len)
 {
 	nlbl_msg *msg;
 	void *msg_buf;
 
-	msg = nlmsg_alloc();
+	if (len > 0)
+		msg = nlmsg_alloc_size(NLMSG_HDRLEN + GENL_HDRLEN + len);
+	else
+		msg = nlmsg_alloc();
 	if (msg == NULL)
 		goto msg_new_failure;
 
@@ -77,6 +85,18 @@ msg_new_failure:
 	return NULL;
 }
 
+/**
+ * Create a new NetLabel message
+ *
+ * Creates a new NetLabel message and allocates space for both the Netlink and
+ * Generic Netlink headers.
+ *
+ */
+nlbl_msg *nlbl_msg_new(void)
+{
+	return nlbl_msg_new_size(0);
+}
+
 /*
  * Netlink Header Functions
  */
@@ -186,3 +206,123 @@ struct nlattr *nlbl_attr_find(nlbl_msg *msg, int nla_type)
 
 	return nla_find(nla_head, genlmsg_attrlen(genl_hdr, 0), nla_type);
 }
+
+/**
+ * Parse the attributes of a NetLabel message
+ * @param nl_hdr the netlink message
+ * @param command the expected NetLabel command
+ * @param tb the attribute table
+ * @param maxtype the highest attribute type in @tb
+ * @param policy the attribute policy
+ *
+ * Verify that @nl_hdr carries @command and index its top level attributes by
+ * type into @tb, which must have room for @maxtype + 1 entries.  Every
+ * attribute is validated against @policy during the single pass over the
+ * message; attributes that are not present are left as NULL in @tb.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int nlbl_attr_parse(struct nlmsghdr *nl_hdr,
+		    uint8_t command,
+		    struct nlattr **tb, int maxtype,
+		    const struct nla_policy *policy)
+{
+	struct genlmsghdr *genl_hdr;
+
+	genl_hdr = (struct genlmsghdr *)nlmsg_data(nl_hdr);
+	if (genl_hdr == NULL || genl_hdr->cmd != command)
+		return -EBADMSG;
+
+	if (nla_parse(tb, maxtype,
+		      genlmsg_attrdata(genl_hdr, 0),
+		      genlmsg_attrlen(genl_hdr, 0), policy) < 0)
+		return -EBADMSG;
+
+	return 0;
+}
+
+/**
+ * Parse the attributes of a nested attribute
+ * @param nla the nested attribute
+ * @param tb the attribute table
+ * @param maxtype the highest attribute type in @tb
+ * @param policy the attribute policy
+ *
+ * Index the attributes nested inside @nla into @tb in a single pass, see
+ * nlbl_attr_parse() for details.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int nlbl_attr_parse_nested(struct nlattr *nla,
+			   struct nlattr **tb, int maxtype,
+			   const struct nla_policy *policy)
+{
+	if (nla_parse_nested(tb, maxtype, nla, policy) < 0)
+		return -EBADMSG;
+
+	return 0;
+}
+
+/**
+ * Start a nested attribute
+ * @param msg the NetLabel message
+ * @param nla_type the attribute type
+ *
+ * Add the header of a nested attribute to the end of @msg, the attributes
+ * added to @msg after this are nested inside it until nlbl_attr_nest_end() is
+ * called.  The nested attributes are written in place, so unlike
+ * nla_put_nested() they are not copied from another message.  Returns a
+ * pointer to the nested attribute on success, NULL on failure.
+ *
+ */
+struct nlattr *nlbl_attr_nest_start(nlbl_msg *msg, int nla_type)
+{
+	return nla_reserve(msg, nla_type, 0);
+}
+
+/**
+ * Finish a nested attribute
+ * @param msg the NetLabel message
+ * @param nla the nested attribute
+ *
+ * Set the length of @nla, started with nlbl_attr_nest_start(), to cover all
+ * of the attributes added to @msg since.  Returns zero on success, -EMSGSIZE
+ * if the nested attributes are too long for a single attribute.
+ *
+ */
+int nlbl_attr_nest_end(nlbl_msg *msg, struct nlattr *nla)
+{
+	size_t len;
+
+	len = (unsigned char *)nlmsg_tail(nlmsg_hdr(msg)) -
+	      (unsigned char *)nla;
+	if (len > USHRT_MAX)
+		return -EMSGSIZE;
+	nla->nla_len = len;
+
+	return 0;
+}
+
+/*
+ * Result Array Functions
+ */
+
+/**
+ * Make room for another entry in a result array
+ * @param array the array
+ * @param count the number of entries in the array
+ * @param size the size of an entry
+ *
+ * Ensure that @array, which holds @count entries of @size bytes, has room for
+ * at least one more entry.  The array is only reallocated when @count is zero
+ * or a power of two, doubling its capacity each time, so that building an
+ * array one entry at a time takes linear time.  Returns a pointer to the
+ * array on success, NULL on failure in which case @array is unchanged.
+ *
+ */
+void *nlbl_array_grow(void *array, size_t count, size_t size)
+{
+	if (array != NULL && (count & (count - 1)) != 0)
+		return array;
+	return realloc(array, size * (count > 0 ? count * 2 : 1));
+}
@@ -0,0 +1,948 @@
+/** @file
+ * NetLabel Traffic Capture and Replay
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Captures are written in the pcap format with nanosecond timestamps and the
+ * LINKTYPE_NETLINK link type used by the kernel's nlmon device, so they can be
+ * read by the usual packet analyzers.  Each record holds the buffer given to,
+ * or returned by, a single read or write on a NetLabel handle; requests have
+ * the PACKET_USER packet type and replies the PACKET_KERNEL packet type.
+ *
+ * The replay transport answers each request with the replies which were
+ * captured for the request at the same position in the capture, rewriting
+ * their port, sequence number and family ID to match the new request.  When
+ * the capture runs out it starts again from the beginning, so a sequence of
+ * operations can be replayed repeatedly for profiling.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+#include <linux/if_arp.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* pcap file format */
+#define NLBL_PCAP_MAGIC_NSEC		0xa1b23c4d
+#define NLBL_PCAP_MAGIC_USEC		0xa1b2c3d4
+#define NLBL_PCAP_VERSION_MAJOR		2
+#define NLBL_PCAP_VERSION_MINOR		4
+#define NLBL_PCAP_SNAPLEN		262144
+#define NLBL_PCAP_LINKTYPE_NETLINK	253
+
+/* Generic Netlink family IDs of the replay transport */
+#define NLBL_REPLAY_FID(type)		(0x1000 + (type))
+
+/* maximum number of distinct family IDs in a capture */
+#define NLBL_REPLAY_FAMILY_MAX		8
+
+/* pcap file header */
+struct nlbl_pcap_hdr {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t linktype;
+};
+
+/* pcap record header */
+struct nlbl_pcap_rec {
+	uint32_t ts_sec;
+	uint32_t ts_frac;
+	uint32_t caplen;
+	uint32_t len;
+};
+
+/* LINKTYPE_NETLINK header, all fields are big endian */
+struct nlbl_pcap_sll {
+	uint16_t pkttype;
+	uint16_t hatype;
+	uint16_t halen;
+	uint8_t addr[8];
+	uint16_t protocol;
+};
+
+/* captured request */
+struct nlbl_replay_req {
+	struct nlmsghdr *msg;
+	size_t reply;
+	size_t reply_last;
+};
+
+/* captured reply buffer */
+struct nlbl_replay_reply {
+	unsigned char *data;
+	size_t len;
+	size_t next;
+};
+
+/* replay handle */
+struct nlbl_replay_hndl {
+	uint32_t port;
+	uint32_t seq;
+	int fd;
+
+	/* replies waiting to be read, oldest first */
+	struct nlbl_replay_buf *head;
+	struct nlbl_replay_buf *tail;
+};
+
+/* reply waiting to be read */
+struct nlbl_replay_buf {
+	unsigned char *data;
+	size_t len;
+	struct nlbl_replay_buf *next;
+};
+
+/* capture file */
+static pthread_mutex_t nlpcap_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *nlpcap_file = NULL;
+
+/* loaded capture, protected by nlreplay_lock */
+static pthread_mutex_t nlreplay_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char *nlreplay_data = NULL;
+static struct nlbl_replay_req *nlreplay_reqs = NULL;
+static size_t nlreplay_req_cnt = 0;
+static struct nlbl_replay_reply *nlreplay_replies = NULL;
+static size_t nlreplay_reply_cnt = 0;
+static size_t nlreplay_pos = 0;
+static uint16_t nlreplay_fam_old[NLBL_REPLAY_FAMILY_MAX];
+static uint16_t nlreplay_fam_new[NLBL_REPLAY_FAMILY_MAX];
+static unsigned int nlreplay_fam_cnt = 0;
+static uint32_t nlreplay_port_next = 1;
+
+/*
+ * Capture Functions
+ */
+
+/**
+ * Write a record to the capture file
+ * @param dir NLBL_PCAP_REQUEST or NLBL_PCAP_REPLY
+ * @param buf the buffer
+ * @param len the length of the buffer
+ *
+ * Must be called with nlpcap_lock held.
+ *
+ */
+static void nlbl_pcap_rec_write(unsigned int dir,
+				const void *buf, size_t len)
+{
+	struct timespec ts;
+	struct nlbl_pcap_rec rec;
+	struct nlbl_pcap_sll sll;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	rec.ts_sec = ts.tv_sec;
+	rec.ts_frac = ts.tv_nsec;
+	rec.caplen = sizeof(sll) + len;
+	rec.len = rec.caplen;
+
+	memset(&sll, 0, sizeof(sll));
+	sll.pkttype = htons(dir);
+	sll.hatype = htons(ARPHRD_NETLINK);
+	sll.protocol = htons(NETLINK_GENERIC);
+
+	fwrite(&rec, sizeof(rec), 1, nlpcap_file);
+	fwrite(&sll, sizeof(sll), 1, nlpcap_file);
+	fwrite(buf, len, 1, nlpcap_file);
+}
+
+/**
+ * Capture a buffer
+ * @param dir NLBL_PCAP_REQUEST or NLBL_PCAP_REPLY
+ * @param buf the buffer
+ * @param len the length of the buffer
+ *
+ * Write the netlink messages in @buf to the capture file if a capture is
+ * running.  Requests which are too large for a single record are split
+ * between messages.
+ *
+ */
+void nlbl_pcap_write(unsigned int dir, const void *buf, size_t len)
+{
+	const unsigned char *start = buf;
+	const struct nlmsghdr *nl_hdr = buf;
+	int rem = len;
+	size_t rec_len = 0;
+
+	if (nlpcap_file == NULL)
+		return;
+
+	pthread_mutex_lock(&nlpcap_lock);
+	if (nlpcap_file == NULL)
+		goto write_return;
+
+	if (dir == NLBL_PCAP_REPLY ||
+	    len + sizeof(struct nlbl_pcap_sll) <= NLBL_PCAP_SNAPLEN) {
+		nlbl_pcap_rec_write(dir, buf, len);
+		goto write_return;
+	}
+	while (nlmsg_ok(nl_hdr, rem)) {
+		if (rec_len > 0 &&
+		    rec_len + NLMSG_ALIGN(nl_hdr->nlmsg_len) +
+		    sizeof(struct nlbl_pcap_sll) > NLBL_PCAP_SNAPLEN) {
+			nlbl_pcap_rec_write(dir, start, rec_len);
+			start = (const unsigned char *)nl_hdr;
+			rec_len = 0;
+		}
+		rec_len += NLMSG_ALIGN(nl_hdr->nlmsg_len);
+		nl_hdr = nlmsg_next((struct nlmsghdr *)nl_hdr, &rem);
+	}
+	if (rec_len > 0)
+		nlbl_pcap_rec_write(dir, start, rec_len);
+
+write_return:
+	pthread_mutex_unlock(&nlpcap_lock);
+}
+
+/**
+ * Start or stop capturing NetLabel traffic
+ * @param path the capture file, NULL to stop capturing
+ *
+ * Write every request sent and every reply read on any NetLabel handle to
+ * the pcap file @path, replacing its contents, until the capture is stopped.
+ * Any running capture is stopped first.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+int nlbl_comm_capture(const char *path)
+{
+	int rc = 0;
+	FILE *file = NULL;
+	struct nlbl_pcap_hdr hdr;
+
+	if (path != NULL) {
+		file = fopen(path, "w");
+		if (file == NULL)
+			return -errno;
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.magic = NLBL_PCAP_MAGIC_NSEC;
+		hdr.version_major = NLBL_PCAP_VERSION_MAJOR;
+		hdr.version_minor = NLBL_PCAP_VERSION_MINOR;
+		hdr.snaplen = NLBL_PCAP_SNAPLEN;
+		hdr.linktype = NLBL_PCAP_LINKTYPE_NETLINK;
+		if (fwrite(&hdr, sizeof(hdr), 1, file) != 1) {
+			rc = -EIO;
+			fclose(file);
+			return rc;
+		}
+	}
+
+	pthread_mutex_lock(&nlpcap_lock);
+	if (nlpcap_file != NULL && fclose(nlpcap_file) != 0)
+		rc = -EIO;
+	nlpcap_file = file;
+	pthread_mutex_unlock(&nlpcap_lock);
+
+	return rc;
+}
+
+/*
+ * Replay Functions
+ */
+
+/**
+ * Free the loaded capture
+ *
+ * Must be called with nlreplay_lock held.
+ *
+ */
+static void nlbl_replay_unload(void)
+{
+	free(nlreplay_data);
+	nlreplay_data = NULL;
+	free(nlreplay_reqs);
+	nlreplay_reqs = NULL;
+	nlreplay_req_cnt = 0;
+	free(nlreplay_replies);
+	nlreplay_replies = NULL;
+	nlreplay_reply_cnt = 0;
+	nlreplay_pos = 0;
+	nlreplay_fam_cnt = 0;
+}
+
+/**
+ * Read a file into memory
+ * @param path the file
+ * @param data the file's contents
+ * @param len the length of the file
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_read(const char *path,
+			    unsigned char **data, size_t *len)
+{
+	int rc = 0;
+	FILE *file;
+	unsigned char *buf = NULL;
+	unsigned char *buf_new;
+	size_t size = 0;
+	size_t amt;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return -errno;
+
+	*len = 0;
+	do {
+		if (*len == size) {
+			size = (size > 0 ? size * 2 : 65536);
+			buf_new = realloc(buf, size);
+			if (buf_new == NULL) {
+				rc = -ENOMEM;
+				goto read_return;
+			}
+			buf = buf_new;
+		}
+		amt = fread(buf + *len, 1, size - *len, file);
+		*len += amt;
+	} while (amt > 0);
+	if (ferror(file))
+		rc = -EIO;
+
+read_return:
+	fclose(file);
+	if (rc < 0) {
+		free(buf);
+		return rc;
+	}
+	*data = buf;
+	return 0;
+}
+
+/**
+ * Check if a captured message is a NetLabel request
+ * @param nl_hdr the netlink message
+ *
+ * Returns true if @nl_hdr is a Generic Netlink request other than a request
+ * to the Generic Netlink controller, false otherwise.
+ *
+ */
+static int nlbl_replay_is_req(const struct nlmsghdr *nl_hdr)
+{
+	return (nl_hdr->nlmsg_type >= NLMSG_MIN_TYPE &&
+		nl_hdr->nlmsg_type != GENL_ID_CTRL &&
+		(nl_hdr->nlmsg_flags & NLM_F_REQUEST));
+}
+
+/**
+ * Hash a port and sequence number
+ * @param port the port
+ * @param seq the sequence number
+ * @param size the size of the hash table
+ *
+ */
+static size_t nlbl_replay_hash(uint32_t port, uint32_t seq, size_t size)
+{
+	return ((port * 2654435761U) ^ (seq * 2246822519U)) & (size - 1);
+}
+
+/**
+ * Index the records of a capture
+ * @param data the capture
+ * @param len the length of the capture
+ *
+ * Build the list of captured requests and attach each captured reply to the
+ * request with the same port and sequence number.  Must be called with
+ * nlreplay_lock held.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_index(unsigned char *data, size_t len)
+{
+	int rc = 0;
+	struct nlbl_pcap_hdr *hdr = (struct nlbl_pcap_hdr *)data;
+	struct nlbl_pcap_rec rec;
+	struct nlbl_pcap_sll sll;
+	struct nlmsghdr *nl_hdr;
+	struct nlmsghdr *run;
+	size_t run_len;
+	struct nlbl_replay_req *req;
+	struct nlbl_replay_reply *reply;
+	size_t *hash = NULL;
+	size_t hash_size = 1;
+	size_t off;
+	size_t iter;
+	int rem;
+	void *array_new;
+
+	if (len < sizeof(*hdr) ||
+	    (hdr->magic != NLBL_PCAP_MAGIC_NSEC &&
+	     hdr->magic != NLBL_PCAP_MAGIC_USEC) ||
+	    hdr->linktype != NLBL_PCAP_LINKTYPE_NETLINK)
+		return -EPROTO;
+
+	/* first pass, collect the requests */
+	for (off = sizeof(*hdr); off + sizeof(rec) <= len;
+	     off += sizeof(rec) + rec.caplen) {
+		memcpy(&rec, data + off, sizeof(rec));
+		if (rec.caplen > len - off - sizeof(rec))
+			return -EPROTO;
+		if (rec.caplen < sizeof(sll) + NLMSG_HDRLEN)
+			continue;
+		memcpy(&sll, data + off + sizeof(rec), sizeof(sll));
+		if (ntohs(sll.protocol) != NETLINK_GENERIC ||
+		    ntohs(sll.pkttype) != NLBL_PCAP_REQUEST)
+			continue;
+
+		nl_hdr = (struct nlmsghdr *)(data + off + sizeof(rec) +
+					     sizeof(sll));
+		rem = rec.caplen - sizeof(sll);
+		for (; nlmsg_ok(nl_hdr, rem);
+		     nl_hdr = nlmsg_next(nl_hdr, &rem)) {
+			if (!nlbl_replay_is_req(nl_hdr))
+				continue;
+			array_new = nlbl_array_grow(nlreplay_reqs,
+						    nlreplay_req_cnt,
+						    sizeof(*nlreplay_reqs));
+			if (array_new == NULL)
+				return -ENOMEM;
+			nlreplay_reqs = array_new;
+			req = &nlreplay_reqs[nlreplay_req_cnt++];
+			req->msg = nl_hdr;
+			req->reply = SIZE_MAX;
+			req->reply_last = SIZE_MAX;
+		}
+	}
+	if (nlreplay_req_cnt == 0)
+		return -ENOENT;
+
+	/* index the requests by port and sequence number, the last request
+	 * with a given port and sequence number wins */
+	while (hash_size < nlreplay_req_cnt * 2)
+		hash_size *= 2;
+	hash = malloc(hash_size * sizeof(*hash));
+	if (hash == NULL)
+		return -ENOMEM;
+	for (iter = 0; iter < hash_size; iter++)
+		hash[iter] = SIZE_MAX;
+
+	/* second pass, attach the replies to the requests */
+	nlreplay_req_cnt = 0;
+	for (off = sizeof(*hdr); off + sizeof(rec) <= len;
+	     off += sizeof(rec) + rec.caplen) {
+		memcpy(&rec, data + off, sizeof(rec));
+		if (rec.caplen < sizeof(sll) + NLMSG_HDRLEN)
+			continue;
+		memcpy(&sll, data + off + sizeof(rec), sizeof(sll));
+		if (ntohs(sll.protocol) != NETLINK_GENERIC)
+			continue;
+		nl_hdr = (struct nlmsghdr *)(data + off + sizeof(rec) +
+					     sizeof(sll));
+		rem = rec.caplen - sizeof(sll);
+
+		if (ntohs(sll.pkttype) == NLBL_PCAP_REQUEST) {
+			for (; nlmsg_ok(nl_hdr, rem);
+			     nl_hdr = nlmsg_next(nl_hdr, &rem)) {
+				if (!nlbl_replay_is_req(nl_hdr))
+					continue;
+				iter = nlbl_replay_hash(nl_hdr->nlmsg_pid,
+							nl_hdr->nlmsg_seq,
+							hash_size);
+				while (hash[iter] != SIZE_MAX &&
+				       (nlreplay_reqs[hash[iter]].msg->nlmsg_pid
+					!= nl_hdr->nlmsg_pid ||
+					nlreplay_reqs[hash[iter]].msg->nlmsg_seq
+					!= nl_hdr->nlmsg_seq))
+					iter = (iter + 1) & (hash_size - 1);
+				hash[iter] = nlreplay_req_cnt++;
+			}
+			continue;
+		}
+		if (ntohs(sll.pkttype) != NLBL_PCAP_REPLY)
+			continue;
+
+		/* a buffer may hold the replies to several requests, attach
+		 * each run of messages to the request it belongs to */
+		while (nlmsg_ok(nl_hdr, rem)) {
+			run = nl_hdr;
+			do {
+				run_len = (unsigned char *)nl_hdr -
+					  (unsigned char *)run +
+					  nl_hdr->nlmsg_len;
+				nl_hdr = nlmsg_next(nl_hdr, &rem);
+			} while (nlmsg_ok(nl_hdr, rem) &&
+				 nl_hdr->nlmsg_pid == run->nlmsg_pid &&
+				 nl_hdr->nlmsg_seq == run->nlmsg_seq);
+
+			/* find the request the replies belong to */
+			iter = nlbl_replay_hash(run->nlmsg_pid, run->nlmsg_seq,
+						hash_size);
+			while (hash[iter] != SIZE_MAX &&
+			       (nlreplay_reqs[hash[iter]].msg->nlmsg_pid !=
+				run->nlmsg_pid ||
+				nlreplay_reqs[hash[iter]].msg->nlmsg_seq !=
+				run->nlmsg_seq))
+				iter = (iter + 1) & (hash_size - 1);
+			if (hash[iter] == SIZE_MAX)
+				continue;
+			req = &nlreplay_reqs[hash[iter]];
+
+			array_new = nlbl_array_grow(nlreplay_replies,
+						    nlreplay_reply_cnt,
+						    sizeof(*nlreplay_replies));
+			if (array_new == NULL) {
+				rc = -ENOMEM;
+				goto index_return;
+			}
+			nlreplay_replies = array_new;
+			reply = &nlreplay_replies[nlreplay_reply_cnt];
+			reply->data = (unsigned char *)run;
+			reply->len = run_len;
+			reply->next = SIZE_MAX;
+			if (req->reply_last != SIZE_MAX)
+				nlreplay_replies[req->reply_last].next =
+					nlreplay_reply_cnt;
+			else
+				req->reply = nlreplay_reply_cnt;
+			req->reply_last = nlreplay_reply_cnt;
+			nlreplay_reply_cnt++;
+		}
+	}
+
+index_return:
+	free(hash);
+	return rc;
+}
+
+/**
+ * Replay a capture of NetLabel traffic
+ * @param path the capture file, NULL to stop replaying
+ *
+ * Load the pcap file @path, written by nlbl_comm_capture(), and select the
+ * replay transport for NetLabel handles opened from now on.  The replay
+ * transport answers requests with the replies in the capture, which allows
+ * the library's message handling to be tested and profiled without the
+ * kernel.  The requests must be made in the same order as when the capture
+ * was taken; requests which do not match the capture fail with -EPROTO.  If
+ * @path is NULL the capture is unloaded and the netlink transport selected.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlbl_comm_replay(const char *path)
+{
+	int rc;
+	unsigned char *data = NULL;
+	size_t len;
+
+	if (path != NULL) {
+		rc = nlbl_replay_read(path, &data, &len);
+		if (rc < 0)
+			return rc;
+	}
+
+	rc = nlbl_comm_transport(path != NULL ?
+				 NLBL_TRANSPORT_REPLAY :
+				 NLBL_TRANSPORT_NETLINK);
+	if (rc < 0) {
+		free(data);
+		return rc;
+	}
+
+	pthread_mutex_lock(&nlreplay_lock);
+	nlbl_replay_unload();
+	if (data != NULL) {
+		nlreplay_data = data;
+		rc = nlbl_replay_index(data, len);
+		if (rc < 0)
+			nlbl_replay_unload();
+	}
+	pthread_mutex_unlock(&nlreplay_lock);
+
+	return rc;
+}
+
+/**
+ * Map a captured family ID to the family ID of a new request
+ * @param fid_old the captured family ID
+ * @param fid_new the new family ID
+ *
+ * Record that @fid_old corresponds to @fid_new, or check that it does if it
+ * has been seen before.  Must be called with nlreplay_lock held.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_family(uint16_t fid_old, uint16_t fid_new)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < nlreplay_fam_cnt; iter++)
+		if (nlreplay_fam_old[iter] == fid_old)
+			return (nlreplay_fam_new[iter] == fid_new ?
+				0 : -EPROTO);
+	if (nlreplay_fam_cnt == NLBL_REPLAY_FAMILY_MAX)
+		return -EPROTO;
+	nlreplay_fam_old[nlreplay_fam_cnt] = fid_old;
+	nlreplay_fam_new[nlreplay_fam_cnt] = fid_new;
+	nlreplay_fam_cnt++;
+
+	return 0;
+}
+
+/**
+ * Rewrite a captured netlink header for a new request
+ * @param nl_hdr the netlink header
+ * @param req the new request
+ *
+ * Must be called with nlreplay_lock held.
+ *
+ */
+static void nlbl_replay_rewrite(struct nlmsghdr *nl_hdr,
+				const struct nlmsghdr *req)
+{
+	unsigned int iter;
+
+	nl_hdr->nlmsg_pid = req->nlmsg_pid;
+	nl_hdr->nlmsg_seq = req->nlmsg_seq;
+	for (iter = 0; iter < nlreplay_fam_cnt; iter++)
+		if (nl_hdr->nlmsg_type == nlreplay_fam_old[iter]) {
+			nl_hdr->nlmsg_type = nlreplay_fam_new[iter];
+			break;
+		}
+}
+
+/**
+ * Queue the captured replies to a request
+ * @param rh the replay handle
+ * @param req the request
+ *
+ * Match @req against the next captured request and queue copies of the
+ * captured replies, rewritten to match @req.  Must be called with
+ * nlreplay_lock held.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_request(struct nlbl_replay_hndl *rh,
+			       const struct nlmsghdr *req)
+{
+	int rc;
+	struct nlbl_replay_req *cap;
+	struct nlbl_replay_reply *reply;
+	struct nlbl_replay_buf *buf;
+	struct nlmsghdr *nl_hdr;
+	struct nlmsgerr *nl_err;
+	size_t iter;
+	int rem;
+
+	if (nlreplay_req_cnt == 0)
+		return -ENOENT;
+	if (req->nlmsg_len < NLMSG_HDRLEN + GENL_HDRLEN)
+		return -EPROTO;
+
+	/* the next captured request must be the same command */
+	if (nlreplay_pos == nlreplay_req_cnt)
+		nlreplay_pos = 0;
+	cap = &nlreplay_reqs[nlreplay_pos];
+	if (cap->msg->nlmsg_len < NLMSG_HDRLEN + GENL_HDRLEN ||
+	    ((struct genlmsghdr *)nlmsg_data(cap->msg))->cmd !=
+	    ((struct genlmsghdr *)nlmsg_data(req))->cmd ||
+	    (cap->msg->nlmsg_flags & NLM_F_DUMP) !=
+	    (req->nlmsg_flags & NLM_F_DUMP))
+		return -EPROTO;
+	rc = nlbl_replay_family(cap->msg->nlmsg_type, req->nlmsg_type);
+	if (rc < 0)
+		return rc;
+	nlreplay_pos++;
+
+	for (iter = cap->reply; iter != SIZE_MAX; iter = reply->next) {
+		reply = &nlreplay_replies[iter];
+
+		buf = malloc(sizeof(*buf));
+		if (buf == NULL)
+			return -ENOMEM;
+		buf->data = malloc(reply->len);
+		if (buf->data == NULL) {
+			free(buf);
+			return -ENOMEM;
+		}
+		memcpy(buf->data, reply->data, reply->len);
+		buf->len = reply->len;
+		buf->next = NULL;
+
+		nl_hdr = (struct nlmsghdr *)buf->data;
+		rem = buf->len;
+		for (; nlmsg_ok(nl_hdr, rem);
+		     nl_hdr = nlmsg_next(nl_hdr, &rem)) {
+			nlbl_replay_rewrite(nl_hdr, req);
+			if (nl_hdr->nlmsg_type == NLMSG_ERROR &&
+			    nl_hdr->nlmsg_len >= nlmsg_size(sizeof(*nl_err))) {
+				nl_err = nlmsg_data(nl_hdr);
+				nlbl_replay_rewrite(&nl_err->msg, req);
+			}
+		}
+
+		if (rh->tail != NULL)
+			rh->tail->next = buf;
+		else
+			rh->head = buf;
+		rh->tail = buf;
+	}
+
+	return 0;
+}
+
+/**
+ * Signal the state of the reply queue on the handle's file descriptor
+ * @param rh the replay handle
+ *
+ * Make the handle's file descriptor, if it has one, readable if and only if
+ * there are replies waiting to be read.
+ *
+ */
+static void nlbl_replay_signal(struct nlbl_replay_hndl *rh)
+{
+	uint64_t val;
+
+	if (rh->fd < 0)
+		return;
+	if (rh->head != NULL) {
+		val = 1;
+		if (write(rh->fd, &val, sizeof(val)) < 0)
+			return;
+	} else if (read(rh->fd, &val, sizeof(val)) < 0)
+		return;
+}
+
+/**
+ * Open a replay handle
+ * @param hndl the NetLabel handle
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_open(struct nlbl_handle *hndl)
+{
+	struct nlbl_replay_hndl *rh;
+
+	rh = calloc(1, sizeof(*rh));
+	if (rh == NULL)
+		return -ENOMEM;
+	rh->fd = -1;
+	rh->seq = 1;
+
+	pthread_mutex_lock(&nlreplay_lock);
+	rh->port = nlreplay_port_next++;
+	pthread_mutex_unlock(&nlreplay_lock);
+
+	hndl->priv = rh;
+	return 0;
+}
+
+/**
+ * Discard any unread replies on a replay handle
+ * @param hndl the NetLabel handle
+ *
+ * Returns zero.
+ *
+ */
+static int nlbl_replay_drain(struct nlbl_handle *hndl)
+{
+	struct nlbl_replay_hndl *rh = hndl->priv;
+	struct nlbl_replay_buf *buf;
+
+	while (rh->head != NULL) {
+		buf = rh->head;
+		rh->head = buf->next;
+		free(buf->data);
+		free(buf);
+	}
+	rh->tail = NULL;
+	nlbl_replay_signal(rh);
+
+	return 0;
+}
+
+/**
+ * Close a replay handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static void nlbl_replay_close(struct nlbl_handle *hndl)
+{
+	struct nlbl_replay_hndl *rh = hndl->priv;
+
+	nlbl_replay_drain(hndl);
+	if (rh->fd >= 0)
+		close(rh->fd);
+	free(rh);
+	hndl->priv = NULL;
+}
+
+/**
+ * Resolve a Generic Netlink family
+ * @param hndl the NetLabel handle
+ * @param family the family name
+ *
+ * Returns the family ID on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_resolve(struct nlbl_handle *hndl, const char *family)
+{
+	if (strcmp(family, NETLBL_NLTYPE_MGMT_NAME) == 0)
+		return NLBL_REPLAY_FID(NETLBL_NLTYPE_MGMT);
+	if (strcmp(family, NETLBL_NLTYPE_CIPSOV4_NAME) == 0)
+		return NLBL_REPLAY_FID(NETLBL_NLTYPE_CIPSOV4);
+	if (strcmp(family, NETLBL_NLTYPE_UNLABELED_NAME) == 0)
+		return NLBL_REPLAY_FID(NETLBL_NLTYPE_UNLABELED);
+	return -ENOENT;
+}
+
+/**
+ * Return the port of a replay handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_replay_port(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_replay_hndl *)hndl->priv)->port;
+}
+
+/**
+ * Return the next sequence number of a replay handle
+ * @param hndl the NetLabel handle
+ *
+ */
+static uint32_t nlbl_replay_seq(struct nlbl_handle *hndl)
+{
+	return ((struct nlbl_replay_hndl *)hndl->priv)->seq++;
+}
+
+/**
+ * Send a buffer of requests to the replay transport
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ *
+ * Queue the captured replies to each of the requests in @buf.  Returns the
+ * number of bytes written on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_send(struct nlbl_handle *hndl, void *buf, size_t len)
+{
+	int rc = 0;
+	struct nlbl_replay_hndl *rh = hndl->priv;
+	struct nlmsghdr *req = buf;
+	int rem = len;
+
+	pthread_mutex_lock(&nlreplay_lock);
+	for (; rc == 0 && nlmsg_ok(req, rem); req = nlmsg_next(req, &rem))
+		if ((req->nlmsg_flags & NLM_F_REQUEST) &&
+		    req->nlmsg_type >= NLMSG_MIN_TYPE)
+			rc = nlbl_replay_request(rh, req);
+	pthread_mutex_unlock(&nlreplay_lock);
+
+	nlbl_replay_signal(rh);
+	return (rc < 0 ? rc : (int)len);
+}
+
+/**
+ * Read a reply from a replay handle
+ * @param hndl the NetLabel handle
+ * @param data the message buffer
+ *
+ * See nlbl_comm_recv_nowait().
+ *
+ */
+static int nlbl_replay_recv(struct nlbl_handle *hndl, unsigned char **data)
+{
+	int rc;
+	struct nlbl_replay_hndl *rh = hndl->priv;
+	struct nlbl_replay_buf *buf;
+
+	*data = NULL;
+	buf = rh->head;
+	if (buf == NULL)
+		return -EAGAIN;
+	rh->head = buf->next;
+	if (rh->head == NULL) {
+		rh->tail = NULL;
+		nlbl_replay_signal(rh);
+	}
+
+	*data = buf->data;
+	rc = buf->len;
+	free(buf);
+	return rc;
+}
+
+/**
+ * Wait for a reply on a replay handle
+ * @param hndl the NetLabel handle
+ * @param timeout the timeout in seconds
+ *
+ * Replies are queued as soon as a request is sent, so there is never a need
+ * to wait.  Returns a positive value if a reply is waiting, zero otherwise.
+ *
+ */
+static int nlbl_replay_wait(struct nlbl_handle *hndl, uint32_t timeout)
+{
+	return (((struct nlbl_replay_hndl *)hndl->priv)->head != NULL);
+}
+
+/**
+ * Return the file descriptor of a replay handle
+ * @param hndl the NetLabel handle
+ *
+ * Return an event file descriptor which is readable whenever replies are
+ * waiting on the handle, creating it the first time it is needed.  Returns
+ * the file descriptor on success, negative values on failure.
+ *
+ */
+static int nlbl_replay_fd(struct nlbl_handle *hndl)
+{
+	struct nlbl_replay_hndl *rh = hndl->priv;
+
+	if (rh->fd < 0) {
+		rh->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (rh->fd < 0)
+			return -errno;
+		if (rh->head != NULL)
+			nlbl_replay_signal(rh);
+	}
+
+	return rh->fd;
+}
+
+/* replay transport, answers requests from a capture */
+const struct nlbl_comm_ops nlbl_replay_ops = {
+	.open = nlbl_replay_open,
+	.close = nlbl_replay_close,
+	.resolve = nlbl_replay_resolve,
+	.port = nlbl_replay_port,
+	.seq = nlbl_replay_seq,
+	.send = nlbl_replay_send,
+	.recv = nlbl_replay_recv,
+	.wait = nlbl_replay_wait,
+	.drain = nlbl_replay_drain,
+	.fd = nlbl_replay_fd,
+};
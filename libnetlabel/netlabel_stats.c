@@ -0,0 +1,526 @@
+/** @file
+ * NetLabel Request Statistics
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Statistics are collected as requests are written to, and replies read
+ * from, NetLabel handles.  Each request waiting for its reply is kept in a
+ * table indexed by the handle's port and the request's sequence number so
+ * that replies can be matched to requests even when many requests are in
+ * flight, as with batches and asynchronous requests.  A request is complete
+ * when its ACK, error, reply or NLMSG_DONE message is read; the ACK which
+ * follows a reply is not counted.  When statistics are
+ * disabled the hooks return immediately.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/types.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* highest command number of any NetLabel family, plus one */
+#define NLBL_STATS_CMD_MAX		16
+
+/* NetLabel families */
+#define NLBL_STATS_FAM_MGMT		0
+#define NLBL_STATS_FAM_CIPSOV4		1
+#define NLBL_STATS_FAM_UNLBL		2
+#define NLBL_STATS_FAM_MAX		3
+
+/* initial size of the request table */
+#define NLBL_STATS_REQ_SIZE		64
+
+/* request waiting for its reply */
+struct nlbl_stats_req {
+	struct nlbl_stats *stats;
+	uint32_t port;
+	uint32_t seq;
+	uint64_t start;
+};
+
+/* statistics, protected by nlstats_lock */
+static pthread_mutex_t nlstats_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int nlstats_enabled = 0;
+static struct nlbl_stats nlstats[NLBL_STATS_FAM_MAX][NLBL_STATS_CMD_MAX];
+static int nlstats_fid[NLBL_STATS_FAM_MAX] = { -1, -1, -1 };
+
+/* requests waiting for their reply, protected by nlstats_lock */
+static struct nlbl_stats_req *nlstats_reqs = NULL;
+static size_t nlstats_req_size = 0;
+static size_t nlstats_req_cnt = 0;
+
+/*
+ * Helper Functions
+ */
+
+/**
+ * Return the current time
+ *
+ * Returns the value of the monotonic clock in nanoseconds.
+ *
+ */
+static uint64_t nlbl_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Find the statistics of a command
+ * @param fid the Generic Netlink family ID
+ * @param cmd the command
+ *
+ * Returns the statistics of the command on success, NULL if the family or
+ * command is not known.  Must be called with nlstats_lock held.
+ *
+ */
+static struct nlbl_stats *nlbl_stats_find(int fid, uint8_t cmd)
+{
+	unsigned int iter;
+
+	if (cmd >= NLBL_STATS_CMD_MAX)
+		return NULL;
+	for (iter = 0; iter < NLBL_STATS_FAM_MAX; iter++)
+		if (nlstats_fid[iter] == fid)
+			return &nlstats[iter][cmd];
+	return NULL;
+}
+
+/**
+ * Hash a request
+ * @param port the port
+ * @param seq the sequence number
+ *
+ * Returns the first request table slot to try for the request.  Must be
+ * called with nlstats_lock held and a non-empty table.
+ *
+ */
+static size_t nlbl_stats_hash(uint32_t port, uint32_t seq)
+{
+	return ((port * 2654435761U) ^ (seq * 2246822519U)) &
+		(nlstats_req_size - 1);
+}
+
+/**
+ * Return the request table slot of a request
+ * @param port the port
+ * @param seq the sequence number
+ *
+ * Returns the slot holding the request, or the empty slot where it would be
+ * added.  Must be called with nlstats_lock held and a non-empty table.
+ *
+ */
+static size_t nlbl_stats_slot(uint32_t port, uint32_t seq)
+{
+	size_t iter;
+
+	iter = nlbl_stats_hash(port, seq);
+	while (nlstats_reqs[iter].stats != NULL &&
+	       (nlstats_reqs[iter].port != port ||
+		nlstats_reqs[iter].seq != seq))
+		iter = (iter + 1) & (nlstats_req_size - 1);
+	return iter;
+}
+
+/**
+ * Add a request to the request table
+ * @param req the request
+ *
+ * Returns zero on success, negative values on failure.  Must be called with
+ * nlstats_lock held.
+ *
+ */
+static int nlbl_stats_req_add(const struct nlbl_stats_req *req)
+{
+	struct nlbl_stats_req *reqs_old = nlstats_reqs;
+	size_t size_old = nlstats_req_size;
+	size_t iter;
+	size_t slot;
+
+	if ((nlstats_req_cnt + 1) * 2 > nlstats_req_size) {
+		nlstats_req_size = (size_old > 0 ?
+				    size_old * 2 : NLBL_STATS_REQ_SIZE);
+		nlstats_reqs = calloc(nlstats_req_size, sizeof(*nlstats_reqs));
+		if (nlstats_reqs == NULL) {
+			nlstats_reqs = reqs_old;
+			nlstats_req_size = size_old;
+			return -ENOMEM;
+		}
+		for (iter = 0; iter < size_old; iter++) {
+			if (reqs_old[iter].stats == NULL)
+				continue;
+			slot = nlbl_stats_slot(reqs_old[iter].port,
+					       reqs_old[iter].seq);
+			nlstats_reqs[slot] = reqs_old[iter];
+		}
+		free(reqs_old);
+	}
+
+	iter = nlbl_stats_slot(req->port, req->seq);
+	if (nlstats_reqs[iter].stats == NULL)
+		nlstats_req_cnt++;
+	nlstats_reqs[iter] = *req;
+
+	return 0;
+}
+
+/**
+ * Remove a request from the request table
+ * @param slot the request's slot
+ *
+ * Must be called with nlstats_lock held.
+ *
+ */
+static void nlbl_stats_req_del(size_t slot)
+{
+	size_t iter;
+	size_t home;
+
+	nlstats_reqs[slot].stats = NULL;
+	nlstats_req_cnt--;
+
+	/* move any following entries of the probe sequence into the hole */
+	iter = (slot + 1) & (nlstats_req_size - 1);
+	while (nlstats_reqs[iter].stats != NULL) {
+		home = nlbl_stats_hash(nlstats_reqs[iter].port,
+				       nlstats_reqs[iter].seq);
+		if (((iter - home) & (nlstats_req_size - 1)) >=
+		    ((iter - slot) & (nlstats_req_size - 1))) {
+			nlstats_reqs[slot] = nlstats_reqs[iter];
+			nlstats_reqs[iter].stats = NULL;
+			slot = iter;
+		}
+		iter = (iter + 1) & (nlstats_req_size - 1);
+	}
+}
+
+/**
+ * Complete a request
+ * @param slot the request's slot
+ * @param now the current time
+ *
+ * Record the latency of the request and remove it from the request table.
+ * Must be called with nlstats_lock held.
+ *
+ */
+static void nlbl_stats_req_done(size_t slot, uint64_t now)
+{
+	struct nlbl_stats *stats = nlstats_reqs[slot].stats;
+	uint64_t lat;
+	unsigned int bkt;
+
+	lat = now - nlstats_reqs[slot].start;
+	bkt = (lat > 0 ? 63 - __builtin_clzll(lat) : 0);
+	if (bkt >= NLBL_STATS_HIST_SIZE)
+		bkt = NLBL_STATS_HIST_SIZE - 1;
+
+	stats->lat_count++;
+	stats->lat_total += lat;
+	if (lat > stats->lat_max)
+		stats->lat_max = lat;
+	stats->lat_hist[bkt]++;
+
+	nlbl_stats_req_del(slot);
+}
+
+/*
+ * Collection Functions
+ */
+
+/**
+ * Record the Generic Netlink family ID of a NetLabel family
+ * @param family the family name
+ * @param fid the family ID
+ *
+ */
+void nlbl_stats_family(const char *family, int fid)
+{
+	unsigned int fam;
+
+	if (strcmp(family, NETLBL_NLTYPE_MGMT_NAME) == 0)
+		fam = NLBL_STATS_FAM_MGMT;
+	else if (strcmp(family, NETLBL_NLTYPE_CIPSOV4_NAME) == 0)
+		fam = NLBL_STATS_FAM_CIPSOV4;
+	else if (strcmp(family, NETLBL_NLTYPE_UNLABELED_NAME) == 0)
+		fam = NLBL_STATS_FAM_UNLBL;
+	else
+		return;
+
+	pthread_mutex_lock(&nlstats_lock);
+	nlstats_fid[fam] = fid;
+	pthread_mutex_unlock(&nlstats_lock);
+}
+
+/**
+ * Return the start time of a request
+ *
+ * Returns the current time if statistics are being collected, zero otherwise.
+ * The kernel handles NetLabel requests as they are written, so the time must
+ * be taken before the write.
+ *
+ */
+uint64_t nlbl_stats_clock(void)
+{
+	if (!nlstats_enabled)
+		return 0;
+	return nlbl_stats_now();
+}
+
+/**
+ * Record the requests written to a NetLabel handle
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ * @param start the time the write started, from nlbl_stats_clock()
+ * @param rc the result of the write
+ *
+ */
+void nlbl_stats_send(struct nlbl_handle *hndl, const void *buf, size_t len,
+		     uint64_t start, int rc)
+{
+	const struct nlmsghdr *nl_hdr = buf;
+	int rem = len;
+	struct nlbl_stats_req req;
+
+	if (!nlstats_enabled || start == 0)
+		return;
+
+	req.port = hndl->ops->port(hndl);
+	pthread_mutex_lock(&nlstats_lock);
+	for (; nlmsg_ok(nl_hdr, rem);
+	     nl_hdr = nlmsg_next((struct nlmsghdr *)nl_hdr, &rem)) {
+		if (nl_hdr->nlmsg_len < NLMSG_HDRLEN + GENL_HDRLEN)
+			continue;
+		req.stats = nlbl_stats_find(nl_hdr->nlmsg_type,
+			((struct genlmsghdr *)nlmsg_data(nl_hdr))->cmd);
+		if (req.stats == NULL)
+			continue;
+
+		req.stats->requests++;
+		if (rc < 0) {
+			req.stats->errors++;
+			continue;
+		}
+		req.stats->bytes_sent += nl_hdr->nlmsg_len;
+		req.seq = nl_hdr->nlmsg_seq;
+		req.start = start;
+		nlbl_stats_req_add(&req);
+	}
+	pthread_mutex_unlock(&nlstats_lock);
+}
+
+/**
+ * Record the replies read from a NetLabel handle
+ * @param hndl the NetLabel handle
+ * @param buf the message buffer
+ * @param len the length of the message buffer
+ *
+ */
+void nlbl_stats_recv(struct nlbl_handle *hndl, const void *buf, size_t len)
+{
+	const struct nlmsghdr *nl_hdr = buf;
+	const struct nlmsgerr *nl_err;
+	int rem = len;
+	struct nlbl_stats *stats;
+	uint32_t port;
+	uint64_t now;
+	size_t slot;
+
+	if (!nlstats_enabled)
+		return;
+
+	now = nlbl_stats_now();
+	port = hndl->ops->port(hndl);
+	pthread_mutex_lock(&nlstats_lock);
+	if (nlstats_req_cnt == 0)
+		goto recv_return;
+	for (; nlmsg_ok(nl_hdr, rem);
+	     nl_hdr = nlmsg_next((struct nlmsghdr *)nl_hdr, &rem)) {
+		slot = nlbl_stats_slot(port, nl_hdr->nlmsg_seq);
+		stats = nlstats_reqs[slot].stats;
+		if (stats == NULL)
+			continue;
+		stats->bytes_recv += nl_hdr->nlmsg_len;
+
+		switch (nl_hdr->nlmsg_type) {
+		case NLMSG_ERROR:
+			nl_err = nlmsg_data(nl_hdr);
+			if (nl_hdr->nlmsg_len >= nlmsg_size(sizeof(*nl_err)) &&
+			    nl_err->error != 0)
+				stats->errors++;
+			nlbl_stats_req_done(slot, now);
+			break;
+		case NLMSG_DONE:
+			nlbl_stats_req_done(slot, now);
+			break;
+		default:
+			if (nl_hdr->nlmsg_type < NLMSG_MIN_TYPE)
+				break;
+			if (nl_hdr->nlmsg_flags & NLM_F_MULTI)
+				stats->dump_msgs++;
+			else
+				nlbl_stats_req_done(slot, now);
+			break;
+		}
+	}
+
+recv_return:
+	pthread_mutex_unlock(&nlstats_lock);
+}
+
+/**
+ * Forget the requests waiting on a NetLabel handle
+ * @param hndl the NetLabel handle
+ * @param timeout true if the requests timed out
+ *
+ */
+static void nlbl_stats_forget(struct nlbl_handle *hndl, unsigned int timeout)
+{
+	uint32_t port;
+	size_t iter;
+
+	if (!nlstats_enabled)
+		return;
+
+	port = hndl->ops->port(hndl);
+	pthread_mutex_lock(&nlstats_lock);
+	iter = 0;
+	while (iter < nlstats_req_size && nlstats_req_cnt > 0) {
+		if (nlstats_reqs[iter].stats == NULL ||
+		    nlstats_reqs[iter].port != port) {
+			iter++;
+			continue;
+		}
+		if (timeout)
+			nlstats_reqs[iter].stats->timeouts++;
+		/* removal may move another request into this slot */
+		nlbl_stats_req_del(iter);
+	}
+	pthread_mutex_unlock(&nlstats_lock);
+}
+
+/**
+ * Record a timeout on a NetLabel handle
+ * @param hndl the NetLabel handle
+ *
+ * Count a timeout for each of the requests waiting on the handle, which are
+ * then forgotten.
+ *
+ */
+void nlbl_stats_timeout(struct nlbl_handle *hndl)
+{
+	nlbl_stats_forget(hndl, 1);
+}
+
+/**
+ * Forget the requests waiting on a NetLabel handle which is being closed
+ * @param hndl the NetLabel handle
+ *
+ */
+void nlbl_stats_close(struct nlbl_handle *hndl)
+{
+	nlbl_stats_forget(hndl, 0);
+}
+
+/*
+ * Statistics Functions
+ */
+
+/**
+ * Enable or disable the collection of statistics
+ * @param enable true to collect statistics, false otherwise
+ *
+ * Statistics are not collected by default.  Disabling the collection keeps
+ * the statistics collected so far.
+ *
+ */
+void nlbl_stats_enable(unsigned int enable)
+{
+	pthread_mutex_lock(&nlstats_lock);
+	nlstats_enabled = (enable ? 1 : 0);
+	if (!nlstats_enabled) {
+		free(nlstats_reqs);
+		nlstats_reqs = NULL;
+		nlstats_req_size = 0;
+		nlstats_req_cnt = 0;
+	}
+	pthread_mutex_unlock(&nlstats_lock);
+}
+
+/**
+ * Reset the statistics
+ *
+ * Set all of the statistics to zero.
+ *
+ */
+void nlbl_stats_reset(void)
+{
+	pthread_mutex_lock(&nlstats_lock);
+	memset(nlstats, 0, sizeof(nlstats));
+	pthread_mutex_unlock(&nlstats_lock);
+}
+
+/**
+ * Return the statistics of a NetLabel command
+ * @param family the NetLabel family, NETLBL_NLTYPE_*
+ * @param cmd the command
+ * @param stats the statistics
+ *
+ * Copy the statistics of command @cmd of NetLabel family @family, which must
+ * be one of NETLBL_NLTYPE_MGMT, NETLBL_NLTYPE_CIPSOV4 or
+ * NETLBL_NLTYPE_UNLABELED, into @stats.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+int nlbl_stats_get(nlbl_proto family, uint8_t cmd, struct nlbl_stats *stats)
+{
+	unsigned int fam;
+
+	if (stats == NULL || cmd >= NLBL_STATS_CMD_MAX)
+		return -EINVAL;
+	switch (family) {
+	case NETLBL_NLTYPE_MGMT:
+		fam = NLBL_STATS_FAM_MGMT;
+		break;
+	case NETLBL_NLTYPE_CIPSOV4:
+		fam = NLBL_STATS_FAM_CIPSOV4;
+		break;
+	case NETLBL_NLTYPE_UNLABELED:
+		fam = NLBL_STATS_FAM_UNLBL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&nlstats_lock);
+	*stats = nlstats[fam][cmd];
+	pthread_mutex_unlock(&nlstats_lock);
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+/** @file
+ * NetLabel Interned String Table
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Large static label configurations repeat a handful of interface names and
+ * security contexts across many entries, so the dump results can share a
+ * single copy of each string.  The strings are packed into large chunks which
+ * are only freed with the table, and are found again through an open
+ * addressing hash table of pointers into the chunks.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* size of a string chunk */
+#define NLBL_STRTAB_CHUNK_SIZE		16384
+
+/* initial number of hash table slots, must be a power of two */
+#define NLBL_STRTAB_HASH_SIZE		64
+
+/* FNV-1a hash */
+#define NLBL_STRTAB_HASH_INIT		2166136261U
+#define NLBL_STRTAB_HASH_PRIME		16777619U
+
+/* string chunk */
+struct nlbl_strtab_chunk {
+	struct nlbl_strtab_chunk *next;
+	size_t len;
+	size_t size;
+	char data[];
+};
+
+/* interned string table */
+struct nlbl_strtab {
+	struct nlbl_strtab_chunk *chunks;
+	const char **slots;
+	uint32_t size;
+	uint32_t count;
+};
+
+/*
+ * Helper Functions
+ */
+
+/**
+ * Hash a string
+ * @param str the string
+ * @param len the length of the string
+ *
+ */
+static uint32_t nlbl_strtab_hash(const char *str, size_t len)
+{
+	size_t iter;
+	uint32_t hash = NLBL_STRTAB_HASH_INIT;
+
+	for (iter = 0; iter < len; iter++) {
+		hash ^= (unsigned char)str[iter];
+		hash *= NLBL_STRTAB_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+ * Double the size of the hash table
+ * @param tab the string table
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nlbl_strtab_grow(struct nlbl_strtab *tab)
+{
+	uint32_t iter;
+	uint32_t slot;
+	uint32_t size = tab->size * 2;
+	const char **slots;
+
+	slots = calloc(size, sizeof(*slots));
+	if (slots == NULL)
+		return -ENOMEM;
+	for (iter = 0; iter < tab->size; iter++) {
+		if (tab->slots[iter] == NULL)
+			continue;
+		slot = nlbl_strtab_hash(tab->slots[iter],
+					strlen(tab->slots[iter])) & (size - 1);
+		while (slots[slot] != NULL)
+			slot = (slot + 1) & (size - 1);
+		slots[slot] = tab->slots[iter];
+	}
+
+	free(tab->slots);
+	tab->slots = slots;
+	tab->size = size;
+	return 0;
+}
+
+/**
+ * Copy a string into the string chunks
+ * @param tab the string table
+ * @param str the string
+ * @param len the length of the string
+ *
+ * Returns a pointer to the copy on success, NULL on failure.
+ *
+ */
+static const char *nlbl_strtab_copy(struct nlbl_strtab *tab,
+				    const char *str, size_t len)
+{
+	size_t size;
+	char *copy;
+	struct nlbl_strtab_chunk *chunk = tab->chunks;
+
+	if (chunk == NULL || chunk->size - chunk->len < len + 1) {
+		size = (len + 1 > NLBL_STRTAB_CHUNK_SIZE ?
+			len + 1 : NLBL_STRTAB_CHUNK_SIZE);
+		chunk = malloc(sizeof(*chunk) + size);
+		if (chunk == NULL)
+			return NULL;
+		chunk->len = 0;
+		chunk->size = size;
+		chunk->next = tab->chunks;
+		tab->chunks = chunk;
+	}
+
+	copy = &chunk->data[chunk->len];
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	chunk->len += len + 1;
+
+	return copy;
+}
+
+/*
+ * Interned String Functions
+ */
+
+/**
+ * Create a new interned string table
+ *
+ * Returns a pointer to the new table on success, NULL on failure.
+ *
+ */
+struct nlbl_strtab *nlbl_strtab_new(void)
+{
+	struct nlbl_strtab *tab;
+
+	tab = calloc(1, sizeof(*tab));
+	if (tab == NULL)
+		return NULL;
+	tab->slots = calloc(NLBL_STRTAB_HASH_SIZE, sizeof(*tab->slots));
+	if (tab->slots == NULL) {
+		free(tab);
+		return NULL;
+	}
+	tab->size = NLBL_STRTAB_HASH_SIZE;
+
+	return tab;
+}
+
+/**
+ * Free an interned string table
+ * @param tab the string table
+ *
+ * Free @tab and all of the strings interned in it.
+ *
+ */
+void nlbl_strtab_free(struct nlbl_strtab *tab)
+{
+	struct nlbl_strtab_chunk *chunk;
+
+	if (tab == NULL)
+		return;
+
+	while (tab->chunks != NULL) {
+		chunk = tab->chunks;
+		tab->chunks = chunk->next;
+		free(chunk);
+	}
+	free(tab->slots);
+	free(tab);
+}
+
+/**
+ * Intern a string
+ * @param tab the string table
+ * @param str the string
+ *
+ * Return the copy of @str held by @tab, adding it if this is the first time
+ * @str has been seen, so that equal strings interned in the same table are
+ * returned as the same pointer.  The copy lives until @tab is freed and must
+ * not be modified.  Returns a pointer to the copy on success, NULL on failure.
+ *
+ */
+const char *nlbl_strtab_intern(struct nlbl_strtab *tab, const char *str)
+{
+	uint32_t slot;
+	size_t len;
+	const char *copy;
+
+	if (tab == NULL || str == NULL)
+		return NULL;
+
+	/* keep the table at most half full */
+	if ((tab->count + 1) * 2 > tab->size && nlbl_strtab_grow(tab) < 0)
+		return NULL;
+
+	len = strlen(str);
+	slot = nlbl_strtab_hash(str, len) & (tab->size - 1);
+	while (tab->slots[slot] != NULL) {
+		if (strcmp(tab->slots[slot], str) == 0)
+			return tab->slots[slot];
+		slot = (slot + 1) & (tab->size - 1);
+	}
+
+	copy = nlbl_strtab_copy(tab, str, len);
+	if (copy == NULL)
+		return NULL;
+	tab->slots[slot] = copy;
+	tab->count++;
+
+	return copy;
+}
@@ -0,0 +1,2536 @@
+/*
+ * Declarative Configuration Functions
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include <libnetlabel.h>
+
+#include "netlabelctl.h"
+
+/* configuration entry types */
+#define APPLY_T_MAP		1
+#define APPLY_T_DOI		2
+#define APPLY_T_UNLBL		3
+
+/* configuration scope */
+#define APPLY_F_MAP		0x01
+#define APPLY_F_CV4		0x02
+#define APPLY_F_UNLBL		0x04
+#define APPLY_F_ALL		(APPLY_F_MAP | APPLY_F_CV4 | APPLY_F_UNLBL)
+#define APPLY_F_DETAIL		0x08
+
+/* kernel configuration lists, see apply_cfg_kernel() */
+#define APPLY_L_MAP		0
+#define APPLY_L_MAPDEF		1
+#define APPLY_L_CV4		2
+#define APPLY_L_ACCEPT		3
+#define APPLY_L_UNLBL		4
+#define APPLY_L_UNLBLDEF	5
+#define APPLY_L_MAX		6
+
+/* configuration entry state */
+#define APPLY_S_DEL		0x01
+
+/* configuration update phases, in the order they are sent to the kernel */
+#define APPLY_P_MAP_DEL		0
+#define APPLY_P_CV4_DEL		1
+#define APPLY_P_CV4_ADD		2
+#define APPLY_P_MAP_ADD		3
+#define APPLY_P_UNLBL_DEL	4
+#define APPLY_P_UNLBL_ADD	5
+#define APPLY_P_UNLBL_ACCEPT	6
+#define APPLY_P_MAX		7
+
+static const char *apply_phase_name[APPLY_P_MAX] = {
+	"map del",
+	"cipsov4 del",
+	"cipsov4 add",
+	"map add",
+	"unlbl del",
+	"unlbl add",
+	"unlbl accept",
+};
+
+/* CIPSOv4 DOI removal retry delays, in microseconds, see apply_exec() */
+#define APPLY_BUSY_DELAY	1000
+#define APPLY_BUSY_DELAY_MAX	64000
+#define APPLY_BUSY_TIMEOUT	1000000
+
+/* output buffer size used when saving a configuration */
+#define APPLY_SAVE_BUF		(1024 * 1024)
+
+/* address selector comparison results */
+#define APPLY_SEL_EQUAL		0
+#define APPLY_SEL_SUBSET	1
+#define APPLY_SEL_DIFF		2
+
+/* CIPSOv4 DOI definition */
+struct apply_doi {
+	nlbl_cv4_doi doi;
+	nlbl_cv4_mtype mtype;
+	struct nlbl_cv4_tag_a tags;
+	struct nlbl_cv4_range_a lvls;
+	struct nlbl_cv4_range_a cats;
+};
+
+/* configuration entry */
+struct apply_entry {
+	struct apply_entry *next;
+	uint32_t hash;
+	unsigned int type;
+	unsigned int state;
+	struct apply_entry *match;
+	union {
+		struct nlbl_dommap map;
+		struct apply_doi doi;
+		struct nlbl_addrmap unlbl;
+	} d;
+};
+
+/* configuration entry hash table */
+#define APPLY_TABLE_SIZE	256
+struct apply_table {
+	struct apply_entry **bkts;
+	size_t size;
+	size_t count;
+};
+
+/* NetLabel configuration */
+struct apply_cfg {
+	struct apply_table tbl;
+	uint8_t accept;
+};
+
+/* kernel configuration list load, one per thread */
+struct apply_load {
+	unsigned int type;
+	unsigned int detail;
+	struct apply_cfg cfg;
+	int rc;
+};
+
+/*
+ * Hash table functions
+ */
+
+/**
+ * Hash a block of data
+ * @param hash the current hash value
+ * @param data the data
+ * @param len the length of @data
+ *
+ * Add @len bytes of @data to the FNV-1a hash value @hash and return the new
+ * hash value.
+ *
+ */
+static uint32_t apply_hash(uint32_t hash, const void *data, size_t len)
+{
+	const unsigned char *iter = data;
+
+	while (len-- > 0) {
+		hash ^= *iter++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+/**
+ * Hash a network address
+ * @param hash the current hash value
+ * @param addr the network address
+ *
+ * Add the address and mask in @addr to the hash value @hash and return the new
+ * hash value.
+ *
+ */
+static uint32_t apply_hash_addr(uint32_t hash, const struct nlbl_netaddr *addr)
+{
+	hash = apply_hash(hash, &addr->type, sizeof(addr->type));
+	switch (addr->type) {
+	case AF_INET:
+		hash = apply_hash(hash, &addr->addr.v4, sizeof(addr->addr.v4));
+		hash = apply_hash(hash, &addr->mask.v4, sizeof(addr->mask.v4));
+		break;
+	case AF_INET6:
+		hash = apply_hash(hash, &addr->addr.v6, sizeof(addr->addr.v6));
+		hash = apply_hash(hash, &addr->mask.v6, sizeof(addr->mask.v6));
+		break;
+	}
+
+	return hash;
+}
+
+/**
+ * Hash a string which may be NULL
+ * @param hash the current hash value
+ * @param str the string
+ *
+ * Add @str to the hash value @hash and return the new hash value, a NULL
+ * string hashes differently from an empty string.
+ *
+ */
+static uint32_t apply_hash_str(uint32_t hash, const char *str)
+{
+	if (str == NULL)
+		return hash;
+	return apply_hash(hash, str, strlen(str) + 1);
+}
+
+/**
+ * Compute the hash value of a configuration entry
+ * @param entry the configuration entry
+ *
+ * Compute the hash value of the key fields in @entry and store it in @entry.
+ *
+ */
+static void apply_entry_hash(struct apply_entry *entry)
+{
+	uint32_t hash = 2166136261U;
+
+	hash = apply_hash(hash, &entry->type, sizeof(entry->type));
+	switch (entry->type) {
+	case APPLY_T_MAP:
+		hash = apply_hash_str(hash, entry->d.map.domain);
+		break;
+	case APPLY_T_DOI:
+		hash = apply_hash(hash,
+				  &entry->d.doi.doi, sizeof(entry->d.doi.doi));
+		break;
+	case APPLY_T_UNLBL:
+		hash = apply_hash_str(hash, entry->d.unlbl.dev);
+		hash = apply_hash_addr(hash, &entry->d.unlbl.addr);
+		break;
+	}
+
+	entry->hash = hash;
+}
+
+/**
+ * Compare two strings which may be NULL
+ * @param a the first string
+ * @param b the second string
+ *
+ * Returns true if @a and @b are both NULL or are equal strings, false
+ * otherwise.
+ *
+ */
+static int apply_str_eq(const char *a, const char *b)
+{
+	if (a == NULL || b == NULL)
+		return (a == b);
+	return (strcmp(a, b) == 0);
+}
+
+/**
+ * Compare two network addresses
+ * @param a the first address
+ * @param b the second address
+ *
+ * Returns true if the address and mask in @a and @b are equal, false
+ * otherwise.
+ *
+ */
+static int apply_addr_eq(const struct nlbl_netaddr *a,
+			 const struct nlbl_netaddr *b)
+{
+	if (a->type != b->type)
+		return 0;
+	switch (a->type) {
+	case AF_INET:
+		return (a->addr.v4.s_addr == b->addr.v4.s_addr &&
+			a->mask.v4.s_addr == b->mask.v4.s_addr);
+	case AF_INET6:
+		return (!memcmp(&a->addr.v6, &b->addr.v6, sizeof(a->addr.v6)) &&
+			!memcmp(&a->mask.v6, &b->mask.v6, sizeof(a->mask.v6)));
+	}
+
+	return 1;
+}
+
+/**
+ * Compare the keys of two configuration entries
+ * @param a the first entry
+ * @param b the second entry
+ *
+ * Returns true if @a and @b configure the same object, false otherwise.
+ *
+ */
+static int apply_entry_key_eq(const struct apply_entry *a,
+			      const struct apply_entry *b)
+{
+	if (a->hash != b->hash || a->type != b->type)
+		return 0;
+
+	switch (a->type) {
+	case APPLY_T_MAP:
+		return apply_str_eq(a->d.map.domain, b->d.map.domain);
+	case APPLY_T_DOI:
+		return (a->d.doi.doi == b->d.doi.doi);
+	case APPLY_T_UNLBL:
+		return (apply_str_eq(a->d.unlbl.dev, b->d.unlbl.dev) &&
+			apply_addr_eq(&a->d.unlbl.addr, &b->d.unlbl.addr));
+	}
+
+	return 0;
+}
+
+/**
+ * Add an entry to a hash table
+ * @param tbl the hash table
+ * @param entry the configuration entry
+ *
+ * Compute the hash value of @entry and add it to @tbl, the table takes
+ * ownership of @entry.  The table is grown as entries are added; if that
+ * fails the entry is still added and the hash chains simply get longer.
+ *
+ */
+static void apply_table_add(struct apply_table *tbl, struct apply_entry *entry)
+{
+	struct apply_entry **bkts_new;
+	struct apply_entry *iter;
+	size_t size_new;
+	size_t bkt;
+
+	/* grow the table */
+	if (tbl->count >= tbl->size) {
+		size_new = tbl->size * 2;
+		bkts_new = calloc(size_new, sizeof(*bkts_new));
+		if (bkts_new != NULL) {
+			for (bkt = 0; bkt < tbl->size; bkt++)
+				while ((iter = tbl->bkts[bkt]) != NULL) {
+					tbl->bkts[bkt] = iter->next;
+					iter->next = bkts_new[iter->hash &
+							      (size_new - 1)];
+					bkts_new[iter->hash &
+						 (size_new - 1)] = iter;
+				}
+			free(tbl->bkts);
+			tbl->bkts = bkts_new;
+			tbl->size = size_new;
+		}
+	}
+
+	apply_entry_hash(entry);
+	bkt = entry->hash & (tbl->size - 1);
+	entry->next = tbl->bkts[bkt];
+	tbl->bkts[bkt] = entry;
+	tbl->count++;
+}
+
+/**
+ * Find an entry in a hash table
+ * @param tbl the hash table
+ * @param key an entry with the key fields set
+ *
+ * Search @tbl for an entry with the same key as @key.  Returns a pointer to
+ * the entry on success, or NULL if it was not found.
+ *
+ */
+static struct apply_entry *apply_table_find(struct apply_table *tbl,
+					    struct apply_entry *key)
+{
+	struct apply_entry *iter;
+
+	apply_entry_hash(key);
+	for (iter = tbl->bkts[key->hash & (tbl->size - 1)];
+	     iter != NULL;
+	     iter = iter->next)
+		if (apply_entry_key_eq(iter, key))
+			return iter;
+
+	return NULL;
+}
+
+/**
+ * Remove an entry from a hash table
+ * @param tbl the hash table
+ * @param entry the configuration entry
+ *
+ * Remove @entry from @tbl, the caller takes ownership of @entry.
+ *
+ */
+static void apply_table_remove(struct apply_table *tbl,
+			       struct apply_entry *entry)
+{
+	struct apply_entry **iter;
+
+	for (iter = &tbl->bkts[entry->hash & (tbl->size - 1)];
+	     *iter != NULL;
+	     iter = &(*iter)->next)
+		if (*iter == entry) {
+			*iter = entry->next;
+			tbl->count--;
+			return;
+		}
+}
+
+/*
+ * Configuration entry functions
+ */
+
+/**
+ * Free the contents of a domain mapping
+ * @param map the domain mapping
+ *
+ * Free the domain string and any address selectors in @map.
+ *
+ */
+static void apply_map_release(struct nlbl_dommap *map)
+{
+	struct nlbl_dommap_addr *iter;
+
+	free(map->domain);
+	if (map->proto_type == NETLBL_NLTYPE_ADDRSELECT)
+		while ((iter = map->proto.addrsel) != NULL) {
+			map->proto.addrsel = iter->next;
+			free(iter);
+		}
+}
+
+/**
+ * Free the contents of a DOI definition
+ * @param doi the DOI definition
+ *
+ * Free the tag, level and category arrays in @doi.
+ *
+ */
+static void apply_doi_release(struct apply_doi *doi)
+{
+	free(doi->tags.array);
+	free(doi->lvls.array);
+	free(doi->cats.array);
+}
+
+/**
+ * Free the contents of a static label mapping
+ * @param addr the static label mapping
+ *
+ * Free the interface and label strings in @addr.
+ *
+ */
+static void apply_unlbl_release(struct nlbl_addrmap *addr)
+{
+	free(addr->dev);
+	free(addr->label);
+}
+
+/**
+ * Allocate a new configuration entry
+ * @param type the entry type
+ *
+ * Allocate a new, empty, configuration entry of @type.  Returns a pointer to
+ * the entry on success, NULL on failure.
+ *
+ */
+static struct apply_entry *apply_entry_new(unsigned int type)
+{
+	struct apply_entry *entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return NULL;
+	entry->type = type;
+
+	return entry;
+}
+
+/**
+ * Free a configuration entry
+ * @param entry the configuration entry
+ *
+ * Free @entry and everything it contains.
+ *
+ */
+static void apply_entry_free(struct apply_entry *entry)
+{
+	switch (entry->type) {
+	case APPLY_T_MAP:
+		apply_map_release(&entry->d.map);
+		break;
+	case APPLY_T_DOI:
+		apply_doi_release(&entry->d.doi);
+		break;
+	case APPLY_T_UNLBL:
+		apply_unlbl_release(&entry->d.unlbl);
+		break;
+	}
+	free(entry);
+}
+
+/**
+ * Initialize a NetLabel configuration
+ * @param cfg the NetLabel configuration
+ *
+ * Initialize @cfg as an empty configuration.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int apply_cfg_init(struct apply_cfg *cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->tbl.size = APPLY_TABLE_SIZE;
+	cfg->tbl.bkts = calloc(cfg->tbl.size, sizeof(*cfg->tbl.bkts));
+	if (cfg->tbl.bkts == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * Free a NetLabel configuration
+ * @param cfg the NetLabel configuration
+ *
+ * Free all of the entries in @cfg.
+ *
+ */
+static void apply_cfg_free(struct apply_cfg *cfg)
+{
+	size_t bkt;
+	struct apply_entry *iter;
+
+	for (bkt = 0; bkt < cfg->tbl.size; bkt++)
+		while ((iter = cfg->tbl.bkts[bkt]) != NULL) {
+			cfg->tbl.bkts[bkt] = iter->next;
+			apply_entry_free(iter);
+		}
+	free(cfg->tbl.bkts);
+	memset(cfg, 0, sizeof(*cfg));
+}
+
+/**
+ * Apply a network mask to an address
+ * @param addr the network address
+ *
+ * Clear the bits of the address in @addr which are outside the mask, the
+ * kernel stores and reports addresses in this form.
+ *
+ */
+static void apply_addr_mask(struct nlbl_netaddr *addr)
+{
+	uint32_t iter;
+
+	switch (addr->type) {
+	case AF_INET:
+		addr->addr.v4.s_addr &= addr->mask.v4.s_addr;
+		break;
+	case AF_INET6:
+		for (iter = 0; iter < 4; iter++)
+			addr->addr.v6.s6_addr32[iter] &=
+				addr->mask.v6.s6_addr32[iter];
+		break;
+	}
+}
+
+/**
+ * Compare two level or category mapping ranges
+ * @param a the first mapping range
+ * @param b the second mapping range
+ *
+ * qsort() comparison function for the CIPSOv4 level and category mapping
+ * ranges.
+ *
+ */
+static int apply_range_cmp(const void *a, const void *b)
+{
+	const struct nlbl_cv4_range *range_a = a;
+	const struct nlbl_cv4_range *range_b = b;
+
+	if (range_a->loc != range_b->loc)
+		return (range_a->loc < range_b->loc ? -1 : 1);
+	if (range_a->rem != range_b->rem)
+		return (range_a->rem < range_b->rem ? -1 : 1);
+	if (range_a->count != range_b->count)
+		return (range_a->count < range_b->count ? -1 : 1);
+	return 0;
+}
+
+/**
+ * Put an array of mapping ranges into its canonical form
+ * @param ranges the mapping ranges
+ *
+ * Sort @ranges and join any ranges which follow on from each other, so that
+ * the same mappings are always held as the same ranges.
+ *
+ */
+static void apply_range_sort(struct nlbl_cv4_range_a *ranges)
+{
+	size_t iter;
+	size_t last;
+	struct nlbl_cv4_range *range;
+
+	if (ranges->size == 0)
+		return;
+
+	qsort(ranges->array, ranges->size,
+	      sizeof(*ranges->array), apply_range_cmp);
+	for (iter = 1, last = 0; iter < ranges->size; iter++) {
+		range = &ranges->array[last];
+		if (ranges->array[iter].loc - range->loc == range->count &&
+		    ranges->array[iter].rem - range->rem == range->count &&
+		    ranges->array[iter].loc > range->loc &&
+		    ranges->array[iter].rem > range->rem) {
+			range->count += ranges->array[iter].count;
+			continue;
+		}
+		ranges->array[++last] = ranges->array[iter];
+	}
+	ranges->size = last + 1;
+}
+
+/**
+ * Put a DOI definition into its canonical form
+ * @param doi the DOI definition
+ *
+ * Sort the level and category mappings in @doi so that two definitions of the
+ * same mappings can be compared directly.
+ *
+ */
+static void apply_doi_sort(struct apply_doi *doi)
+{
+	apply_range_sort(&doi->lvls);
+	apply_range_sort(&doi->cats);
+}
+
+/**
+ * Compare two DOI definitions
+ * @param a the first DOI definition
+ * @param b the second DOI definition
+ *
+ * Returns true if @a and @b are equivalent, false otherwise.  Both definitions
+ * must be in their canonical form, see apply_doi_sort().
+ *
+ */
+static int apply_doi_eq(const struct apply_doi *a, const struct apply_doi *b)
+{
+	if (a->mtype != b->mtype)
+		return 0;
+
+	/* the kernel picks the tags for local mappings */
+	if (a->mtype != CIPSO_V4_MAP_LOCAL &&
+	    (a->tags.size != b->tags.size ||
+	     (a->tags.size > 0 &&
+	      memcmp(a->tags.array, b->tags.array,
+		     a->tags.size * sizeof(nlbl_cv4_tag)))))
+		return 0;
+
+	if (a->mtype != CIPSO_V4_MAP_TRANS)
+		return 1;
+	if (a->lvls.size != b->lvls.size ||
+	    (a->lvls.size > 0 &&
+	     memcmp(a->lvls.array, b->lvls.array,
+		    a->lvls.size * sizeof(*a->lvls.array))))
+		return 0;
+	if (a->cats.size != b->cats.size ||
+	    (a->cats.size > 0 &&
+	     memcmp(a->cats.array, b->cats.array,
+		    a->cats.size * sizeof(*a->cats.array))))
+		return 0;
+
+	return 1;
+}
+
+/**
+ * Compare two network addresses
+ * @param addr_a the first address
+ * @param addr_b the second address
+ *
+ * Compare @addr_a and @addr_b by address family, address and then mask.
+ * Returns a value less than, equal to or greater than zero if @addr_a is
+ * ordered before, the same as or after @addr_b.
+ *
+ */
+static int apply_addr_cmp(const struct nlbl_netaddr *addr_a,
+			  const struct nlbl_netaddr *addr_b)
+{
+	int rc;
+
+	if (addr_a->type != addr_b->type)
+		return (addr_a->type < addr_b->type ? -1 : 1);
+	switch (addr_a->type) {
+	case AF_INET:
+		rc = memcmp(&addr_a->addr.v4, &addr_b->addr.v4,
+			    sizeof(addr_a->addr.v4));
+		if (rc == 0)
+			rc = memcmp(&addr_a->mask.v4, &addr_b->mask.v4,
+				    sizeof(addr_a->mask.v4));
+		return rc;
+	case AF_INET6:
+		rc = memcmp(&addr_a->addr.v6, &addr_b->addr.v6,
+			    sizeof(addr_a->addr.v6));
+		if (rc == 0)
+			rc = memcmp(&addr_a->mask.v6, &addr_b->mask.v6,
+				    sizeof(addr_a->mask.v6));
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Compare two address selectors
+ * @param a the first address selector
+ * @param b the second address selector
+ *
+ * qsort() comparison function for arrays of address selector pointers,
+ * ordering the selectors with apply_addr_cmp().
+ *
+ */
+static int apply_sel_cmp(const void *a, const void *b)
+{
+	return apply_addr_cmp(&(*(struct nlbl_dommap_addr * const *)a)->addr,
+			      &(*(struct nlbl_dommap_addr * const *)b)->addr);
+}
+
+/**
+ * Build a sorted array of address selectors
+ * @param list the address selector list
+ * @param count the number of address selectors
+ *
+ * Return an array of pointers to the address selectors in @list, sorted with
+ * apply_sel_cmp(), and the number of selectors in @count.  The caller is
+ * responsible for freeing the array.  Returns a pointer to the array on
+ * success, NULL on failure.
+ *
+ */
+static struct nlbl_dommap_addr **apply_sel_sort(struct nlbl_dommap_addr *list,
+						size_t *count)
+{
+	struct nlbl_dommap_addr **array;
+	struct nlbl_dommap_addr *iter;
+	size_t cnt = 0;
+
+	for (iter = list; iter != NULL; iter = iter->next)
+		cnt++;
+	array = malloc((cnt > 0 ? cnt : 1) * sizeof(*array));
+	if (array == NULL)
+		return NULL;
+	for (cnt = 0, iter = list; iter != NULL; iter = iter->next)
+		array[cnt++] = iter;
+	qsort(array, cnt, sizeof(*array), apply_sel_cmp);
+
+	*count = cnt;
+	return array;
+}
+
+/**
+ * Compare the address selectors of two domain mappings
+ * @param cur the current address selectors
+ * @param new the new address selectors
+ * @param missing the new address selectors not in @cur
+ * @param missing_cnt the number of entries in @missing
+ *
+ * Compare the address selector lists @cur and @new.  If every selector in
+ * @cur is also in @new, the selectors which need to be added to @cur are
+ * returned in @missing, which the caller must free.  Returns APPLY_SEL_EQUAL,
+ * APPLY_SEL_SUBSET or APPLY_SEL_DIFF on success, negative values on failure.
+ *
+ */
+static int apply_sel_diff(struct nlbl_dommap_addr *cur,
+			  struct nlbl_dommap_addr *new,
+			  struct nlbl_dommap_addr ***missing,
+			  size_t *missing_cnt)
+{
+	int rc = APPLY_SEL_EQUAL;
+	struct nlbl_dommap_addr **cur_a;
+	struct nlbl_dommap_addr **new_a;
+	size_t cur_cnt;
+	size_t new_cnt;
+	size_t iter_c = 0;
+	size_t iter_n = 0;
+	size_t miss = 0;
+	int cmp;
+
+	cur_a = apply_sel_sort(cur, &cur_cnt);
+	if (cur_a == NULL)
+		return -ENOMEM;
+	new_a = apply_sel_sort(new, &new_cnt);
+	if (new_a == NULL) {
+		free(cur_a);
+		return -ENOMEM;
+	}
+
+	/* walk both sorted lists, collecting the missing selectors at the
+	 * front of the new array as we go */
+	while (iter_c < cur_cnt && iter_n < new_cnt) {
+		cmp = apply_sel_cmp(&cur_a[iter_c], &new_a[iter_n]);
+		if (cmp == 0) {
+			if (cur_a[iter_c]->proto_type !=
+			    new_a[iter_n]->proto_type ||
+			    (cur_a[iter_c]->proto_type ==
+			     NETLBL_NLTYPE_CIPSOV4 &&
+			     cur_a[iter_c]->proto.cv4_doi !=
+			     new_a[iter_n]->proto.cv4_doi)) {
+				rc = APPLY_SEL_DIFF;
+				goto diff_return;
+			}
+			iter_c++;
+			iter_n++;
+		} else if (cmp < 0) {
+			rc = APPLY_SEL_DIFF;
+			goto diff_return;
+		} else
+			new_a[miss++] = new_a[iter_n++];
+	}
+	if (iter_c < cur_cnt) {
+		rc = APPLY_SEL_DIFF;
+		goto diff_return;
+	}
+	while (iter_n < new_cnt)
+		new_a[miss++] = new_a[iter_n++];
+
+	if (miss > 0) {
+		rc = APPLY_SEL_SUBSET;
+		*missing = new_a;
+		*missing_cnt = miss;
+		new_a = NULL;
+	}
+
+diff_return:
+	free(cur_a);
+	free(new_a);
+	return rc;
+}
+
+/**
+ * Check a domain mapping for duplicate address selectors
+ * @param map the domain mapping
+ *
+ * Returns zero if every address selector in @map is unique, negative values
+ * on failure.
+ *
+ */
+static int apply_sel_check(struct nlbl_dommap *map)
+{
+	int rc = 0;
+	struct nlbl_dommap_addr **array;
+	size_t count;
+	size_t iter;
+
+	if (map->proto_type != NETLBL_NLTYPE_ADDRSELECT)
+		return 0;
+
+	array = apply_sel_sort(map->proto.addrsel, &count);
+	if (array == NULL)
+		return -ENOMEM;
+	for (iter = 1; iter < count; iter++)
+		if (apply_sel_cmp(&array[iter - 1], &array[iter]) == 0) {
+			fprintf(stderr,
+				MSG_ERR_MOD("apply",
+					    "duplicate address selector in "
+					    "%s domain mapping\n"),
+				(map->domain ? map->domain : "the default"));
+			rc = -EEXIST;
+			break;
+		}
+	free(array);
+
+	return rc;
+}
+
+/*
+ * Configuration file functions
+ */
+
+/**
+ * Add a domain mapping to the new configuration
+ * @param cfg the NetLabel configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Apply a "map add" command to @cfg the same way the kernel would.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int apply_cmd_map_add(struct apply_cfg *cfg, int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	struct nlbl_dommap domain;
+	struct nlbl_netaddr addr;
+	struct nlbl_dommap_addr *sel;
+	struct apply_entry key;
+	struct apply_entry *entry;
+
+	rc = map_add_parse(argc, argv, &def_flag, &domain, &addr);
+	if (rc < 0)
+		return rc;
+	if ((def_flag == 0 && domain.domain == NULL) ||
+	    (domain.proto_type != NETLBL_NLTYPE_UNLABELED &&
+	     domain.proto_type != NETLBL_NLTYPE_CIPSOV4))
+		return -EINVAL;
+
+	memset(&key, 0, sizeof(key));
+	key.type = APPLY_T_MAP;
+	key.d.map.domain = (def_flag ? NULL : domain.domain);
+	entry = apply_table_find(&cfg->tbl, &key);
+
+	/* mappings without an address selector */
+	if (addr.type == 0) {
+		if (entry != NULL)
+			return -EEXIST;
+		entry = apply_entry_new(APPLY_T_MAP);
+		if (entry == NULL)
+			return -ENOMEM;
+		if (key.d.map.domain != NULL) {
+			entry->d.map.domain = strdup(key.d.map.domain);
+			if (entry->d.map.domain == NULL) {
+				apply_entry_free(entry);
+				return -ENOMEM;
+			}
+		}
+		entry->d.map.proto_type = domain.proto_type;
+		entry->d.map.proto.cv4_doi = domain.proto.cv4_doi;
+		apply_table_add(&cfg->tbl, entry);
+		return 0;
+	}
+
+	/* mappings with address selectors, duplicate selectors are caught
+	 * later by apply_sel_check() */
+	if (entry != NULL &&
+	    entry->d.map.proto_type != NETLBL_NLTYPE_ADDRSELECT)
+		return -EEXIST;
+	sel = calloc(1, sizeof(*sel));
+	if (sel == NULL)
+		return -ENOMEM;
+	apply_addr_mask(&addr);
+	sel->addr = addr;
+	sel->proto_type = domain.proto_type;
+	sel->proto.cv4_doi = domain.proto.cv4_doi;
+	if (entry == NULL) {
+		entry = apply_entry_new(APPLY_T_MAP);
+		if (entry == NULL) {
+			free(sel);
+			return -ENOMEM;
+		}
+		if (key.d.map.domain != NULL) {
+			entry->d.map.domain = strdup(key.d.map.domain);
+			if (entry->d.map.domain == NULL) {
+				free(sel);
+				apply_entry_free(entry);
+				return -ENOMEM;
+			}
+		}
+		entry->d.map.proto_type = NETLBL_NLTYPE_ADDRSELECT;
+		apply_table_add(&cfg->tbl, entry);
+	}
+	sel->next = entry->d.map.proto.addrsel;
+	entry->d.map.proto.addrsel = sel;
+
+	return 0;
+}
+
+/**
+ * Remove a domain mapping from the new configuration
+ * @param cfg the NetLabel configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Apply a "map del" command to @cfg the same way the kernel would.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int apply_cmd_map_del(struct apply_cfg *cfg, int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	char *domain;
+	struct apply_entry key;
+	struct apply_entry *entry;
+
+	rc = map_del_parse(argc, argv, &def_flag, &domain);
+	if (rc < 0)
+		return rc;
+	if (def_flag == 0 && domain == NULL)
+		return -EINVAL;
+
+	memset(&key, 0, sizeof(key));
+	key.type = APPLY_T_MAP;
+	key.d.map.domain = (def_flag ? NULL : domain);
+	entry = apply_table_find(&cfg->tbl, &key);
+	if (entry == NULL)
+		return -ENOENT;
+	apply_table_remove(&cfg->tbl, entry);
+	apply_entry_free(entry);
+
+	return 0;
+}
+
+/**
+ * Add a static label mapping to the new configuration
+ * @param cfg the NetLabel configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Apply an "unlbl add" command to @cfg the same way the kernel would.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int apply_cmd_unlbl_add(struct apply_cfg *cfg, int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	nlbl_netdev dev;
+	struct nlbl_netaddr addr;
+	nlbl_secctx label;
+	struct apply_entry key;
+	struct apply_entry *entry;
+
+	rc = unlbl_static_parse(argc, argv, &def_flag, &dev, &addr, &label);
+	if (rc < 0)
+		return rc;
+	if ((def_flag == 0 && dev == NULL) || addr.type == 0 || label == NULL)
+		return -EINVAL;
+	apply_addr_mask(&addr);
+
+	memset(&key, 0, sizeof(key));
+	key.type = APPLY_T_UNLBL;
+	key.d.unlbl.dev = (def_flag ? NULL : dev);
+	key.d.unlbl.addr = addr;
+	if (apply_table_find(&cfg->tbl, &key) != NULL)
+		return -EEXIST;
+
+	entry = apply_entry_new(APPLY_T_UNLBL);
+	if (entry == NULL)
+		return -ENOMEM;
+	entry->d.unlbl.addr = addr;
+	if (key.d.unlbl.dev != NULL) {
+		entry->d.unlbl.dev = strdup(key.d.unlbl.dev);
+		if (entry->d.unlbl.dev == NULL)
+			goto add_failure;
+	}
+	entry->d.unlbl.label = strdup(label);
+	if (entry->d.unlbl.label == NULL)
+		goto add_failure;
+	apply_table_add(&cfg->tbl, entry);
+
+	return 0;
+
+add_failure:
+	apply_entry_free(entry);
+	return -ENOMEM;
+}
+
+/**
+ * Remove a static label mapping from the new configuration
+ * @param cfg the NetLabel configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Apply an "unlbl del" command to @cfg the same way the kernel would.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int apply_cmd_unlbl_del(struct apply_cfg *cfg, int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	nlbl_netdev dev;
+	struct nlbl_netaddr addr;
+	struct apply_entry key;
+	struct apply_entry *entry;
+
+	rc = unlbl_static_parse(argc, argv, &def_flag, &dev, &addr, NULL);
+	if (rc < 0)
+		return rc;
+	if ((def_flag == 0 && dev == NULL) || addr.type == 0)
+		return -EINVAL;
+	apply_addr_mask(&addr);
+
+	memset(&key, 0, sizeof(key));
+	key.type = APPLY_T_UNLBL;
+	key.d.unlbl.dev = (def_flag ? NULL : dev);
+	key.d.unlbl.addr = addr;
+	entry = apply_table_find(&cfg->tbl, &key);
+	if (entry == NULL)
+		return -ENOENT;
+	apply_table_remove(&cfg->tbl, entry);
+	apply_entry_free(entry);
+
+	return 0;
+}
+
+/**
+ * Add a CIPSOv4 DOI definition to the new configuration
+ * @param cfg the NetLabel configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Apply a "cipsov4 add" command to @cfg the same way the kernel would.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_cmd_cv4_add(struct apply_cfg *cfg, int argc, char *argv[])
+{
+	int rc;
+	struct apply_entry *entry;
+
+	entry = apply_entry_new(APPLY_T_DOI);
+	if (entry == NULL)
+		return -ENOMEM;
+
+	rc = cipsov4_add_parse(argc, argv,
+			       &entry->d.doi.doi, &entry->d.doi.mtype,
+			       &entry->d.doi.tags,
+			       &entry->d.doi.lvls, &entry->d.doi.cats);
+	if (rc < 0)
+		goto add_failure;
+	switch (entry->d.doi.mtype) {
+	case CIPSO_V4_MAP_TRANS:
+	case CIPSO_V4_MAP_PASS:
+	case CIPSO_V4_MAP_LOCAL:
+		break;
+	default:
+		rc = -EINVAL;
+		goto add_failure;
+	}
+	if (apply_table_find(&cfg->tbl, entry) != NULL) {
+		rc = -EEXIST;
+		goto add_failure;
+	}
+	apply_doi_sort(&entry->d.doi);
+	apply_table_add(&cfg->tbl, entry);
+
+	return 0;
+
+add_failure:
+	apply_entry_free(entry);
+	return rc;
+}
+
+/**
+ * Remove a CIPSOv4 DOI definition from the new configuration
+ * @param cfg the NetLabel configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Apply a "cipsov4 del" command to @cfg the same way the kernel would.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_cmd_cv4_del(struct apply_cfg *cfg, int argc, char *argv[])
+{
+	int rc;
+	struct apply_entry key;
+	struct apply_entry *entry;
+
+	memset(&key, 0, sizeof(key));
+	key.type = APPLY_T_DOI;
+	rc = cipsov4_del_parse(argc, argv, &key.d.doi.doi);
+	if (rc < 0)
+		return rc;
+
+	entry = apply_table_find(&cfg->tbl, &key);
+	if (entry == NULL)
+		return -ENOENT;
+	apply_table_remove(&cfg->tbl, entry);
+	apply_entry_free(entry);
+
+	return 0;
+}
+
+/**
+ * Apply a configuration file command to the new configuration
+ * @param argc the number of arguments
+ * @param argv the module name followed by the module's commands
+ * @param arg the NetLabel configuration
+ *
+ * Update the configuration in @arg with the command in @argv.  Commands which
+ * only query the kernel are ignored.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+static int apply_cmd(int argc, char *argv[], void *arg)
+{
+	struct apply_cfg *cfg = arg;
+
+	if (argc < 2)
+		return -EINVAL;
+
+	if (strcmp(argv[0], "map") == 0) {
+		if (strcmp(argv[1], "add") == 0)
+			return apply_cmd_map_add(cfg, argc - 2, argv + 2);
+		else if (strcmp(argv[1], "del") == 0)
+			return apply_cmd_map_del(cfg, argc - 2, argv + 2);
+		else if (strcmp(argv[1], "list") == 0)
+			return 0;
+	} else if (strcmp(argv[0], "unlbl") == 0) {
+		if (strcmp(argv[1], "accept") == 0)
+			return unlbl_accept_parse(argc - 2, argv + 2,
+						  &cfg->accept);
+		else if (strcmp(argv[1], "add") == 0)
+			return apply_cmd_unlbl_add(cfg, argc - 2, argv + 2);
+		else if (strcmp(argv[1], "del") == 0)
+			return apply_cmd_unlbl_del(cfg, argc - 2, argv + 2);
+		else if (strcmp(argv[1], "list") == 0)
+			return 0;
+	} else if (strcmp(argv[0], "cipsov4") == 0) {
+		if (strcmp(argv[1], "add") == 0)
+			return apply_cmd_cv4_add(cfg, argc - 2, argv + 2);
+		else if (strcmp(argv[1], "del") == 0)
+			return apply_cmd_cv4_del(cfg, argc - 2, argv + 2);
+		else if (strcmp(argv[1], "list") == 0)
+			return 0;
+	} else if (strcmp(argv[0], "mgmt") == 0)
+		return 0;
+
+	return -EINVAL;
+}
+
+/**
+ * Build the reset configuration
+ * @param cfg the NetLabel configuration
+ * @param scope the configuration scope
+ *
+ * Add the parts of the kernel's reset state selected by @scope to @cfg: a
+ * default domain mapping to the unlabeled protocol, unlabeled packets accepted
+ * and nothing else configured.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int apply_cfg_reset(struct apply_cfg *cfg, unsigned int scope)
+{
+	struct apply_entry *entry;
+
+	if (scope & APPLY_F_UNLBL)
+		cfg->accept = 1;
+	if (scope & APPLY_F_MAP) {
+		entry = apply_entry_new(APPLY_T_MAP);
+		if (entry == NULL)
+			return -ENOMEM;
+		entry->d.map.proto_type = NETLBL_NLTYPE_UNLABELED;
+		apply_table_add(&cfg->tbl, entry);
+	}
+
+	return 0;
+}
+
+/**
+ * Load the new configuration from a file
+ * @param cfg the NetLabel configuration
+ * @param file the configuration file
+ *
+ * Build the configuration described by @file in @cfg.  The file is applied on
+ * top of the kernel's reset state, see apply_cfg_reset().  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int apply_cfg_file(struct apply_cfg *cfg, const char *file)
+{
+	int rc;
+	size_t bkt;
+	struct apply_entry *entry;
+
+	rc = apply_cfg_reset(cfg, APPLY_F_ALL);
+	if (rc < 0)
+		return rc;
+
+	rc = nlctl_file_walk(file, apply_cmd, cfg);
+	if (rc < 0)
+		return rc;
+
+	for (bkt = 0; bkt < cfg->tbl.size; bkt++)
+		for (entry = cfg->tbl.bkts[bkt]; entry; entry = entry->next)
+			if (entry->type == APPLY_T_MAP) {
+				rc = apply_sel_check(&entry->d.map);
+				if (rc < 0)
+					return rc;
+			}
+
+	return 0;
+}
+
+/*
+ * Kernel configuration functions
+ */
+
+/**
+ * Load the domain mappings from the kernel
+ * @param cfg the NetLabel configuration
+ * @param def_flag the default mapping flag
+ *
+ * Add the kernel's domain mappings, either the mappings for specific domains
+ * or the default mapping as selected by @def_flag, to @cfg.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int apply_cfg_kernel_map(struct apply_cfg *cfg, uint8_t def_flag)
+{
+	int rc;
+	struct nlbl_dommap *maps;
+	size_t count;
+	size_t iter;
+	struct apply_entry *entry;
+
+	if (def_flag) {
+		entry = apply_entry_new(APPLY_T_MAP);
+		if (entry == NULL)
+			return -ENOMEM;
+		rc = nlbl_mgmt_listdef(NULL, &entry->d.map);
+		if (rc < 0) {
+			apply_entry_free(entry);
+			return (rc == -ENOENT ? 0 : rc);
+		}
+		apply_table_add(&cfg->tbl, entry);
+		return 0;
+	}
+
+	rc = nlbl_mgmt_listall(NULL, &maps);
+	if (rc < 0)
+		return rc;
+	count = rc;
+	for (iter = 0; iter < count; iter++) {
+		entry = apply_entry_new(APPLY_T_MAP);
+		if (entry == NULL)
+			break;
+		entry->d.map = maps[iter];
+		apply_table_add(&cfg->tbl, entry);
+	}
+	rc = (iter < count ? -ENOMEM : 0);
+	for (; iter < count; iter++)
+		apply_map_release(&maps[iter]);
+	free(maps);
+
+	return rc;
+}
+
+/**
+ * Load the CIPSOv4 DOI definitions from the kernel
+ * @param cfg the NetLabel configuration
+ * @param detail the DOI detail flag
+ *
+ * Add the kernel's CIPSOv4 DOI definitions to @cfg.  If @detail is false only
+ * the DOI values and mapping types are loaded, which is enough to remove the
+ * DOIs but not to compare them.  Otherwise the full DOI definitions are
+ * fetched together.  Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_cfg_kernel_cv4(struct apply_cfg *cfg, int detail)
+{
+	int rc;
+	nlbl_cv4_doi *dois = NULL;
+	nlbl_cv4_mtype *mtypes = NULL;
+	struct nlbl_cv4_def *defs = NULL;
+	struct apply_entry *entry;
+	struct apply_doi *doi;
+	size_t count;
+	size_t iter;
+
+	if (detail)
+		rc = nlbl_cipsov4_listall_detail(NULL, &defs);
+	else
+		rc = nlbl_cipsov4_listall(NULL, &dois, &mtypes);
+	if (rc < 0)
+		return rc;
+	count = rc;
+
+	for (iter = 0; iter < count; iter++) {
+		entry = apply_entry_new(APPLY_T_DOI);
+		if (entry == NULL) {
+			rc = -ENOMEM;
+			goto cv4_return;
+		}
+		doi = &entry->d.doi;
+		if (detail) {
+			doi->doi = defs[iter].doi;
+			doi->mtype = defs[iter].mtype;
+			doi->tags = defs[iter].tags;
+			doi->lvls = defs[iter].lvls;
+			doi->cats = defs[iter].cats;
+			memset(&defs[iter], 0, sizeof(defs[iter]));
+			apply_doi_sort(doi);
+		} else {
+			doi->doi = dois[iter];
+			doi->mtype = mtypes[iter];
+		}
+		apply_table_add(&cfg->tbl, entry);
+	}
+	rc = 0;
+
+cv4_return:
+	nlbl_cipsov4_def_free(defs, count);
+	free(dois);
+	free(mtypes);
+	return rc;
+}
+
+/**
+ * Load the static label mappings from the kernel
+ * @param cfg the NetLabel configuration
+ * @param def_flag the default interface flag
+ *
+ * Add the kernel's static label mappings, either those for specific interfaces
+ * or those for the default interface as selected by @def_flag, to @cfg.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_cfg_kernel_unlbl(struct apply_cfg *cfg, uint8_t def_flag)
+{
+	int rc;
+	struct nlbl_addrmap *addrs;
+	size_t count;
+	size_t iter;
+	struct apply_entry *entry;
+
+	if (def_flag)
+		rc = nlbl_unlbl_staticlistdef(NULL, &addrs);
+	else
+		rc = nlbl_unlbl_staticlist(NULL, &addrs);
+	if (rc < 0)
+		return rc;
+	count = rc;
+	for (iter = 0; iter < count; iter++) {
+		entry = apply_entry_new(APPLY_T_UNLBL);
+		if (entry == NULL)
+			break;
+		entry->d.unlbl = addrs[iter];
+		apply_table_add(&cfg->tbl, entry);
+	}
+	rc = (iter < count ? -ENOMEM : 0);
+	for (; iter < count; iter++)
+		apply_unlbl_release(&addrs[iter]);
+	free(addrs);
+
+	return rc;
+}
+
+/**
+ * Kernel configuration load thread
+ * @param arg the kernel configuration load
+ *
+ * Load one part of the kernel's configuration into the load's own, private,
+ * configuration.  Returns @arg.
+ *
+ */
+static void *apply_load_worker(void *arg)
+{
+	struct apply_load *load = arg;
+
+	switch (load->type) {
+	case APPLY_L_MAP:
+		load->rc = apply_cfg_kernel_map(&load->cfg, 0);
+		break;
+	case APPLY_L_MAPDEF:
+		load->rc = apply_cfg_kernel_map(&load->cfg, 1);
+		break;
+	case APPLY_L_CV4:
+		load->rc = apply_cfg_kernel_cv4(&load->cfg, load->detail);
+		break;
+	case APPLY_L_ACCEPT:
+		load->rc = nlbl_unlbl_list(NULL, &load->cfg.accept);
+		break;
+	case APPLY_L_UNLBL:
+		load->rc = apply_cfg_kernel_unlbl(&load->cfg, 0);
+		break;
+	case APPLY_L_UNLBLDEF:
+		load->rc = apply_cfg_kernel_unlbl(&load->cfg, 1);
+		break;
+	}
+
+	return arg;
+}
+
+/**
+ * Load the current configuration from the kernel
+ * @param cfg the NetLabel configuration
+ * @param scope the configuration scope
+ *
+ * Query the kernel and build the parts of its current NetLabel configuration
+ * selected by @scope in @cfg.  The lists are independent of each other so,
+ * unless the requests must be kept in order, each list is fetched by its own
+ * thread on its own handle and the total time is close to that of the longest
+ * list rather than the sum.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int apply_cfg_kernel(struct apply_cfg *cfg, unsigned int scope)
+{
+	int rc = 0;
+	struct apply_load loads[APPLY_L_MAX];
+	pthread_t tids[APPLY_L_MAX];
+	unsigned int count = 0;
+	unsigned int started = 0;
+	unsigned int iter;
+	size_t bkt;
+	struct apply_table *tbl;
+	struct apply_entry *entry;
+
+	/* select the lists to load, the order here is the merge order */
+	memset(loads, 0, sizeof(loads));
+	if (scope & APPLY_F_MAP) {
+		loads[count++].type = APPLY_L_MAP;
+		loads[count++].type = APPLY_L_MAPDEF;
+	}
+	if (scope & APPLY_F_CV4) {
+		loads[count].detail = (scope & APPLY_F_DETAIL ? 1 : 0);
+		loads[count++].type = APPLY_L_CV4;
+	}
+	if (scope & APPLY_F_UNLBL) {
+		loads[count++].type = APPLY_L_ACCEPT;
+		loads[count++].type = APPLY_L_UNLBL;
+		loads[count++].type = APPLY_L_UNLBLDEF;
+	}
+	for (iter = 0; iter < count; iter++) {
+		rc = apply_cfg_init(&loads[iter].cfg);
+		if (rc < 0)
+			goto kernel_return;
+	}
+
+	/* load the lists, the first list is loaded by this thread */
+	for (iter = 1; iter < count && !opt_ordered; iter++) {
+		if (pthread_create(&tids[iter], NULL,
+				   apply_load_worker, &loads[iter]) != 0)
+			break;
+		started++;
+	}
+	if (count > 0)
+		apply_load_worker(&loads[0]);
+	for (iter = 1; iter <= started; iter++)
+		pthread_join(tids[iter], NULL);
+	for (iter = started + 1; iter < count; iter++)
+		apply_load_worker(&loads[iter]);
+
+	/* merge the lists */
+	for (iter = 0; iter < count; iter++) {
+		if (loads[iter].rc < 0) {
+			rc = loads[iter].rc;
+			goto kernel_return;
+		}
+		if (loads[iter].type == APPLY_L_ACCEPT)
+			cfg->accept = loads[iter].cfg.accept;
+		tbl = &loads[iter].cfg.tbl;
+		for (bkt = 0; bkt < tbl->size; bkt++)
+			while ((entry = tbl->bkts[bkt]) != NULL) {
+				tbl->bkts[bkt] = entry->next;
+				apply_table_add(&cfg->tbl, entry);
+			}
+	}
+
+kernel_return:
+	for (iter = 0; iter < count; iter++)
+		apply_cfg_free(&loads[iter].cfg);
+	return rc;
+}
+
+/*
+ * Configuration update functions
+ */
+
+/**
+ * Queue the addition of an address selector
+ * @param batch the NetLabel batch
+ * @param domain the domain, NULL for the default domain
+ * @param sel the address selector
+ *
+ * Queue a request to add @sel to the @domain mapping.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int apply_queue_sel_add(struct nlbl_batch *batch,
+			       char *domain,
+			       struct nlbl_dommap_addr *sel)
+{
+	struct nlbl_dommap map;
+
+	memset(&map, 0, sizeof(map));
+	map.domain = domain;
+	map.proto_type = sel->proto_type;
+	map.proto.cv4_doi = sel->proto.cv4_doi;
+
+	if (domain == NULL)
+		return nlbl_batch_mgmt_adddef(batch, &map, &sel->addr);
+	return nlbl_batch_mgmt_add(batch, &map, &sel->addr);
+}
+
+/**
+ * Queue the addition of a domain mapping
+ * @param batch the NetLabel batch
+ * @param map the domain mapping
+ *
+ * Queue the requests needed to add @map.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int apply_queue_map_add(struct nlbl_batch *batch,
+			       struct nlbl_dommap *map)
+{
+	int rc;
+	struct nlbl_netaddr addr;
+	struct nlbl_dommap_addr *iter;
+
+	if (map->proto_type == NETLBL_NLTYPE_ADDRSELECT) {
+		for (iter = map->proto.addrsel; iter; iter = iter->next) {
+			rc = apply_queue_sel_add(batch, map->domain, iter);
+			if (rc < 0)
+				return rc;
+		}
+		return 0;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	if (map->domain == NULL)
+		return nlbl_batch_mgmt_adddef(batch, map, &addr);
+	return nlbl_batch_mgmt_add(batch, map, &addr);
+}
+
+/**
+ * Queue the removal of a domain mapping
+ * @param batch the NetLabel batch
+ * @param map the domain mapping
+ *
+ * Queue the request needed to remove @map.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int apply_queue_map_del(struct nlbl_batch *batch,
+			       struct nlbl_dommap *map)
+{
+	if (map->domain == NULL)
+		return nlbl_batch_mgmt_deldef(batch);
+	return nlbl_batch_mgmt_del(batch, map->domain);
+}
+
+/**
+ * Queue the addition of a CIPSOv4 DOI definition
+ * @param batch the NetLabel batch
+ * @param doi the DOI definition
+ *
+ * Queue the request needed to add @doi.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int apply_queue_doi_add(struct nlbl_batch *batch,
+			       struct apply_doi *doi)
+{
+	switch (doi->mtype) {
+	case CIPSO_V4_MAP_TRANS:
+		return nlbl_batch_cipsov4_add_trans_range(batch, doi->doi,
+							  &doi->tags,
+							  &doi->lvls,
+							  &doi->cats);
+	case CIPSO_V4_MAP_PASS:
+		return nlbl_batch_cipsov4_add_pass(batch, doi->doi,
+						   &doi->tags);
+	case CIPSO_V4_MAP_LOCAL:
+		return nlbl_batch_cipsov4_add_local(batch, doi->doi);
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * Queue the addition of a static label mapping
+ * @param batch the NetLabel batch
+ * @param addr the static label mapping
+ *
+ * Queue the request needed to add @addr.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int apply_queue_unlbl_add(struct nlbl_batch *batch,
+				 struct nlbl_addrmap *addr)
+{
+	if (addr->dev == NULL)
+		return nlbl_batch_unlbl_staticadddef(batch,
+						     &addr->addr, addr->label);
+	return nlbl_batch_unlbl_staticadd(batch,
+					  addr->dev, &addr->addr, addr->label);
+}
+
+/**
+ * Queue the removal of a static label mapping
+ * @param batch the NetLabel batch
+ * @param addr the static label mapping
+ *
+ * Queue the request needed to remove @addr.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int apply_queue_unlbl_del(struct nlbl_batch *batch,
+				 struct nlbl_addrmap *addr)
+{
+	if (addr->dev == NULL)
+		return nlbl_batch_unlbl_staticdeldef(batch, &addr->addr);
+	return nlbl_batch_unlbl_staticdel(batch, addr->dev, &addr->addr);
+}
+
+/**
+ * Check if a domain mapping uses a DOI which is being removed
+ * @param cur the current NetLabel configuration
+ * @param map the domain mapping
+ *
+ * Returns true if @map, or any of its address selectors, uses a CIPSOv4 DOI
+ * which is marked for removal in @cur, false otherwise.
+ *
+ */
+static int apply_map_doi_del(struct apply_cfg *cur, struct nlbl_dommap *map)
+{
+	struct apply_entry key;
+	struct apply_entry *entry;
+	struct nlbl_dommap_addr *iter;
+
+	memset(&key, 0, sizeof(key));
+	key.type = APPLY_T_DOI;
+
+	switch (map->proto_type) {
+	case NETLBL_NLTYPE_CIPSOV4:
+		key.d.doi.doi = map->proto.cv4_doi;
+		entry = apply_table_find(&cur->tbl, &key);
+		return (entry != NULL && (entry->state & APPLY_S_DEL));
+	case NETLBL_NLTYPE_ADDRSELECT:
+		for (iter = map->proto.addrsel; iter; iter = iter->next) {
+			if (iter->proto_type != NETLBL_NLTYPE_CIPSOV4)
+				continue;
+			key.d.doi.doi = iter->proto.cv4_doi;
+			entry = apply_table_find(&cur->tbl, &key);
+			if (entry != NULL && (entry->state & APPLY_S_DEL))
+				return 1;
+		}
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * Queue the changes needed for a domain mapping
+ * @param batch the NetLabel batches, one per phase
+ * @param cur the current NetLabel configuration
+ * @param cur_map the current domain mapping, NULL if there is none
+ * @param new_map the new domain mapping
+ *
+ * Compare @cur_map and @new_map and queue the smallest set of requests which
+ * turns one into the other.  Address selectors can be added to an existing
+ * mapping, but any other change means removing and re-adding the mapping.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_diff_map(struct nlbl_batch **batch,
+			  struct apply_cfg *cur,
+			  struct nlbl_dommap *cur_map,
+			  struct nlbl_dommap *new_map)
+{
+	int rc;
+	struct nlbl_dommap_addr **missing;
+	size_t missing_cnt;
+	size_t iter;
+
+	if (cur_map == NULL)
+		return apply_queue_map_add(batch[APPLY_P_MAP_ADD], new_map);
+
+	if (apply_map_doi_del(cur, cur_map))
+		goto diff_replace;
+	if (cur_map->proto_type != new_map->proto_type)
+		goto diff_replace;
+	switch (cur_map->proto_type) {
+	case NETLBL_NLTYPE_UNLABELED:
+		return 0;
+	case NETLBL_NLTYPE_CIPSOV4:
+		if (cur_map->proto.cv4_doi != new_map->proto.cv4_doi)
+			goto diff_replace;
+		return 0;
+	case NETLBL_NLTYPE_ADDRSELECT:
+		rc = apply_sel_diff(cur_map->proto.addrsel,
+				    new_map->proto.addrsel,
+				    &missing, &missing_cnt);
+		if (rc < 0)
+			return rc;
+		else if (rc == APPLY_SEL_DIFF)
+			goto diff_replace;
+		else if (rc == APPLY_SEL_EQUAL)
+			return 0;
+		for (iter = 0, rc = 0; iter < missing_cnt && rc == 0; iter++)
+			rc = apply_queue_sel_add(batch[APPLY_P_MAP_ADD],
+						 new_map->domain,
+						 missing[iter]);
+		free(missing);
+		return rc;
+	}
+
+diff_replace:
+	rc = apply_queue_map_del(batch[APPLY_P_MAP_DEL], cur_map);
+	if (rc < 0)
+		return rc;
+	return apply_queue_map_add(batch[APPLY_P_MAP_ADD], new_map);
+}
+
+/**
+ * Queue the changes needed to move from one configuration to another
+ * @param batch the NetLabel batches, one per phase
+ * @param cur the current NetLabel configuration
+ * @param new the new NetLabel configuration
+ *
+ * Match the entries in @new with those in @cur using the hash tables and queue
+ * the requests needed to turn @cur into @new in the @batch phases.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int apply_diff(struct nlbl_batch **batch,
+		      struct apply_cfg *cur, struct apply_cfg *new)
+{
+	int rc = 0;
+	size_t bkt;
+	struct apply_entry *iter;
+	struct apply_entry *match;
+
+	/* CIPSOv4 DOI definitions, these need to be handled first as domain
+	 * mappings which use a changed DOI have to be replaced */
+	for (bkt = 0; bkt < new->tbl.size; bkt++)
+		for (iter = new->tbl.bkts[bkt]; iter; iter = iter->next) {
+			if (iter->type != APPLY_T_DOI)
+				continue;
+			match = apply_table_find(&cur->tbl, iter);
+			if (match != NULL) {
+				match->match = iter;
+				iter->match = match;
+				if (apply_doi_eq(&match->d.doi, &iter->d.doi))
+					continue;
+				match->state |= APPLY_S_DEL;
+				rc = nlbl_batch_cipsov4_del(
+						batch[APPLY_P_CV4_DEL],
+						match->d.doi.doi);
+				if (rc < 0)
+					return rc;
+			}
+			rc = apply_queue_doi_add(batch[APPLY_P_CV4_ADD],
+						 &iter->d.doi);
+			if (rc < 0)
+				return rc;
+		}
+	for (bkt = 0; bkt < cur->tbl.size; bkt++)
+		for (iter = cur->tbl.bkts[bkt]; iter; iter = iter->next) {
+			if (iter->type != APPLY_T_DOI || iter->match != NULL)
+				continue;
+			iter->state |= APPLY_S_DEL;
+			rc = nlbl_batch_cipsov4_del(batch[APPLY_P_CV4_DEL],
+						    iter->d.doi.doi);
+			if (rc < 0)
+				return rc;
+		}
+
+	/* domain mappings and static label mappings */
+	for (bkt = 0; bkt < new->tbl.size; bkt++)
+		for (iter = new->tbl.bkts[bkt]; iter; iter = iter->next) {
+			if (iter->type == APPLY_T_DOI)
+				continue;
+			match = apply_table_find(&cur->tbl, iter);
+			if (match != NULL) {
+				match->match = iter;
+				iter->match = match;
+			}
+			if (iter->type == APPLY_T_MAP) {
+				rc = apply_diff_map(batch, cur,
+						    (match ?
+						     &match->d.map : NULL),
+						    &iter->d.map);
+			} else if (match == NULL) {
+				rc = apply_queue_unlbl_add(
+						batch[APPLY_P_UNLBL_ADD],
+						&iter->d.unlbl);
+			} else if (!apply_str_eq(match->d.unlbl.label,
+						 iter->d.unlbl.label)) {
+				rc = apply_queue_unlbl_del(
+						batch[APPLY_P_UNLBL_DEL],
+						&match->d.unlbl);
+				if (rc == 0)
+					rc = apply_queue_unlbl_add(
+						batch[APPLY_P_UNLBL_ADD],
+						&iter->d.unlbl);
+			}
+			if (rc < 0)
+				return rc;
+		}
+	for (bkt = 0; bkt < cur->tbl.size; bkt++)
+		for (iter = cur->tbl.bkts[bkt]; iter; iter = iter->next) {
+			if (iter->match != NULL)
+				continue;
+			if (iter->type == APPLY_T_MAP)
+				rc = apply_queue_map_del(batch[APPLY_P_MAP_DEL],
+							 &iter->d.map);
+			else if (iter->type == APPLY_T_UNLBL)
+				rc = apply_queue_unlbl_del(
+						batch[APPLY_P_UNLBL_DEL],
+						&iter->d.unlbl);
+			if (rc < 0)
+				return rc;
+		}
+
+	/* unlabeled packet handling */
+	if (cur->accept != new->accept)
+		return nlbl_batch_unlbl_accept(batch[APPLY_P_UNLBL_ACCEPT],
+					       new->accept);
+
+	return 0;
+}
+
+/**
+ * Retry the CIPSOv4 DOI removals which failed because the DOI is busy
+ * @param batch the NetLabel batch
+ * @param status the request status values
+ *
+ * The kernel drops a domain mapping's reference to its DOI only after a RCU
+ * grace period, so removing a DOI right after the mappings which use it can
+ * fail with EBUSY.  Resend @batch with an increasing delay until none of the
+ * requests in @status fail with EBUSY or the timeout expires, updating
+ * @status as we go; DOIs which were removed by an earlier attempt fail with
+ * ENOENT on a retry and keep their original status.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int apply_exec_busy(struct nlbl_batch *batch, int *status)
+{
+	int rc = 0;
+	size_t count = nlbl_batch_count(batch);
+	size_t iter;
+	int busy;
+	int *retry;
+	useconds_t delay = APPLY_BUSY_DELAY;
+	useconds_t total = 0;
+
+	retry = calloc(count, sizeof(*retry));
+	if (retry == NULL)
+		return -ENOMEM;
+
+	do {
+		for (iter = 0, busy = 0; iter < count && !busy; iter++)
+			busy = (status[iter] == -EBUSY);
+		if (!busy || total >= APPLY_BUSY_TIMEOUT)
+			break;
+		usleep(delay);
+		total += delay;
+		if (delay < APPLY_BUSY_DELAY_MAX)
+			delay *= 2;
+
+		rc = nlbl_batch_exec(NULL, batch, retry);
+		if (rc < 0)
+			break;
+		rc = 0;
+		for (iter = 0; iter < count; iter++)
+			if (status[iter] == -EBUSY)
+				status[iter] = retry[iter];
+	} while (1);
+
+	free(retry);
+	return rc;
+}
+
+/**
+ * Send the queued configuration changes to the kernel
+ * @param batch the NetLabel batches, one per phase
+ *
+ * Send each phase in @batch to the kernel in order, stopping after the first
+ * phase with a failed request since later phases may depend on it.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int apply_exec(struct nlbl_batch **batch)
+{
+	int rc = 0;
+	unsigned int phase;
+	size_t count;
+	size_t iter;
+	size_t fail;
+	int *status;
+
+	for (phase = 0; phase < APPLY_P_MAX; phase++) {
+		count = nlbl_batch_count(batch[phase]);
+		if (opt_verbose)
+			printf("%s: %zu request(s)\n",
+			       apply_phase_name[phase], count);
+		if (count == 0)
+			continue;
+
+		status = calloc(count, sizeof(*status));
+		if (status == NULL)
+			return -ENOMEM;
+		rc = nlbl_batch_exec(NULL, batch[phase], status);
+		if (rc > 0 && phase == APPLY_P_CV4_DEL)
+			rc = apply_exec_busy(batch[phase], status);
+		if (rc < 0)
+			goto exec_next;
+
+		for (iter = 0, fail = 0; iter < count; iter++)
+			if (status[iter] < 0 && fail++ == 0)
+				rc = status[iter];
+		if (fail > 0)
+			fprintf(stderr,
+				MSG_ERR_MOD("apply", "%zu of %zu %s request(s)"
+					    " failed\n"),
+				fail, count, apply_phase_name[phase]);
+
+exec_next:
+		free(status);
+		if (rc < 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Bring the kernel's configuration in line with a new configuration
+ * @param new the new NetLabel configuration
+ * @param scope the configuration scope
+ *
+ * Load the parts of the kernel's current configuration selected by @scope,
+ * work out the changes needed to turn it into @new and send them to the
+ * kernel.  Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_cfg(struct apply_cfg *new, unsigned int scope)
+{
+	int rc;
+	struct apply_cfg cur;
+	struct nlbl_batch *batch[APPLY_P_MAX];
+	unsigned int phase;
+
+	memset(batch, 0, sizeof(batch));
+
+	rc = apply_cfg_init(&cur);
+	if (rc < 0)
+		goto cfg_return;
+	cur.accept = new->accept;
+	rc = apply_cfg_kernel(&cur, scope);
+	if (rc < 0)
+		goto cfg_return;
+
+	for (phase = 0; phase < APPLY_P_MAX; phase++) {
+		batch[phase] = nlbl_batch_new();
+		if (batch[phase] == NULL) {
+			rc = -ENOMEM;
+			goto cfg_return;
+		}
+	}
+	rc = apply_diff(batch, &cur, new);
+	if (rc < 0)
+		goto cfg_return;
+	rc = apply_exec(batch);
+
+cfg_return:
+	for (phase = 0; phase < APPLY_P_MAX; phase++)
+		nlbl_batch_free(batch[phase]);
+	apply_cfg_free(&cur);
+	return rc;
+}
+
+/*
+ * Configuration save functions
+ */
+
+/**
+ * Compare two configuration entries
+ * @param a the first entry
+ * @param b the second entry
+ *
+ * qsort() comparison function for arrays of configuration entry pointers of
+ * the same type.  DOIs are ordered by value, domain mappings by domain and
+ * static label mappings by interface and then address, with the default
+ * domain and interface first.
+ *
+ */
+static int apply_entry_cmp(const void *a, const void *b)
+{
+	const struct apply_entry *entry_a = *(struct apply_entry * const *)a;
+	const struct apply_entry *entry_b = *(struct apply_entry * const *)b;
+	const char *str_a = NULL;
+	const char *str_b = NULL;
+	int rc;
+
+	switch (entry_a->type) {
+	case APPLY_T_DOI:
+		if (entry_a->d.doi.doi == entry_b->d.doi.doi)
+			return 0;
+		return (entry_a->d.doi.doi < entry_b->d.doi.doi ? -1 : 1);
+	case APPLY_T_MAP:
+		str_a = entry_a->d.map.domain;
+		str_b = entry_b->d.map.domain;
+		break;
+	case APPLY_T_UNLBL:
+		str_a = entry_a->d.unlbl.dev;
+		str_b = entry_b->d.unlbl.dev;
+		break;
+	}
+
+	if (str_a == NULL || str_b == NULL)
+		rc = (str_a != NULL) - (str_b != NULL);
+	else
+		rc = strcmp(str_a, str_b);
+	if (rc == 0 && entry_a->type == APPLY_T_UNLBL)
+		rc = apply_addr_cmp(&entry_a->d.unlbl.addr,
+				    &entry_b->d.unlbl.addr);
+	return rc;
+}
+
+/**
+ * Sort the entries of a given type
+ * @param cfg the NetLabel configuration
+ * @param type the entry type
+ * @param count the number of entries
+ *
+ * Return an array of pointers to the @type entries in @cfg sorted with
+ * apply_entry_cmp(), and set @count to the number of entries.  The caller is
+ * responsible for freeing the array.  Returns NULL on failure.
+ *
+ */
+static struct apply_entry **apply_cfg_sort(struct apply_cfg *cfg,
+					   unsigned int type, size_t *count)
+{
+	struct apply_entry **array;
+	struct apply_entry *iter;
+	size_t bkt;
+	size_t cnt = 0;
+
+	array = malloc((cfg->tbl.count > 0 ? cfg->tbl.count : 1) *
+		       sizeof(*array));
+	if (array == NULL)
+		return NULL;
+	for (bkt = 0; bkt < cfg->tbl.size; bkt++)
+		for (iter = cfg->tbl.bkts[bkt]; iter; iter = iter->next)
+			if (iter->type == type)
+				array[cnt++] = iter;
+	qsort(array, cnt, sizeof(*array), apply_entry_cmp);
+
+	*count = cnt;
+	return array;
+}
+
+/**
+ * Check if a string can be saved as a single token
+ * @param str the string
+ *
+ * Returns true if @str can be written to a configuration file and read back
+ * by nlctl_file_walk() unchanged, false otherwise.
+ *
+ */
+static int apply_save_token(const char *str)
+{
+	return (str[0] != '\0' && strpbrk(str, " \t\r\n") == NULL);
+}
+
+/**
+ * Write a CIPSOv4 DOI definition
+ * @param fp the output file
+ * @param doi the DOI definition
+ *
+ * Write the command which adds @doi to @fp.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int apply_save_doi(FILE *fp, const struct apply_doi *doi)
+{
+	size_t iter;
+
+	switch (doi->mtype) {
+	case CIPSO_V4_MAP_TRANS:
+		fprintf(fp, "cipsov4 add trans doi:%u", doi->doi);
+		break;
+	case CIPSO_V4_MAP_PASS:
+		fprintf(fp, "cipsov4 add pass doi:%u", doi->doi);
+		break;
+	case CIPSO_V4_MAP_LOCAL:
+		fprintf(fp, "cipsov4 add local doi:%u\n", doi->doi);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+
+	for (iter = 0; iter < doi->tags.size; iter++)
+		fprintf(fp, "%s%u", (iter == 0 ? " tags:" : ","),
+			doi->tags.array[iter]);
+	if (doi->mtype == CIPSO_V4_MAP_TRANS) {
+		for (iter = 0; iter < doi->lvls.size; iter++) {
+			fprintf(fp, "%s", (iter == 0 ? " levels:" : ","));
+			cipsov4_range_print(fp, &doi->lvls.array[iter], "=");
+		}
+		for (iter = 0; iter < doi->cats.size; iter++) {
+			fprintf(fp, "%s", (iter == 0 ? " categories:" : ","));
+			cipsov4_range_print(fp, &doi->cats.array[iter], "=");
+		}
+	}
+	fprintf(fp, "\n");
+
+	return 0;
+}
+
+/**
+ * Write a domain mapping command
+ * @param fp the output file
+ * @param domain the domain, NULL for the default domain
+ * @param addr the address selector, NULL if there is none
+ * @param proto_type the protocol
+ * @param doi the CIPSOv4 DOI
+ *
+ * Write the command which adds the mapping to @fp.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int apply_save_map_cmd(FILE *fp,
+			      const char *domain,
+			      const struct nlbl_netaddr *addr,
+			      nlbl_proto proto_type, nlbl_cv4_doi doi)
+{
+	char buf[NLCTL_ADDR_LEN];
+
+	if (domain == NULL)
+		fprintf(fp, "map add default");
+	else if (apply_save_token(domain))
+		fprintf(fp, "map add domain:%s", domain);
+	else
+		return -EINVAL;
+	if (addr != NULL)
+		fprintf(fp, " address:%s",
+			nlctl_addr_fmt(addr, buf, sizeof(buf)));
+
+	switch (proto_type) {
+	case NETLBL_NLTYPE_UNLABELED:
+		fprintf(fp, " protocol:unlbl\n");
+		break;
+	case NETLBL_NLTYPE_CIPSOV4:
+		fprintf(fp, " protocol:cipsov4,%u\n", doi);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Write a domain mapping
+ * @param fp the output file
+ * @param map the domain mapping
+ *
+ * Write the commands which add @map to @fp, one per address selector.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_save_map(FILE *fp, const struct nlbl_dommap *map)
+{
+	int rc;
+	struct nlbl_dommap_addr **sels;
+	size_t count;
+	size_t iter;
+
+	if (map->proto_type != NETLBL_NLTYPE_ADDRSELECT)
+		return apply_save_map_cmd(fp, map->domain, NULL,
+					  map->proto_type, map->proto.cv4_doi);
+
+	sels = apply_sel_sort(map->proto.addrsel, &count);
+	if (sels == NULL)
+		return -ENOMEM;
+	for (iter = 0, rc = 0; iter < count && rc == 0; iter++)
+		rc = apply_save_map_cmd(fp, map->domain, &sels[iter]->addr,
+					sels[iter]->proto_type,
+					sels[iter]->proto.cv4_doi);
+	free(sels);
+
+	return rc;
+}
+
+/**
+ * Write a static label mapping
+ * @param fp the output file
+ * @param addr the static label mapping
+ *
+ * Write the command which adds @addr to @fp.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int apply_save_unlbl(FILE *fp, const struct nlbl_addrmap *addr)
+{
+	char buf[NLCTL_ADDR_LEN];
+
+	if (addr->label == NULL || !apply_save_token(addr->label))
+		return -EINVAL;
+	if (addr->dev == NULL)
+		fprintf(fp, "unlbl add default");
+	else if (apply_save_token(addr->dev))
+		fprintf(fp, "unlbl add interface:%s", addr->dev);
+	else
+		return -EINVAL;
+	fprintf(fp, " address:%s label:%s\n",
+		nlctl_addr_fmt(&addr->addr, buf, sizeof(buf)), addr->label);
+
+	return 0;
+}
+
+/**
+ * Write a NetLabel configuration
+ * @param cfg the NetLabel configuration
+ * @param fp the output file
+ *
+ * Write @cfg to @fp as the commands which turn the kernel's reset state into
+ * @cfg.  The entries are sorted so that the same configuration always gives
+ * the same output.  Returns zero on success, negative values on failure.
+ *
+ */
+static int apply_save(struct apply_cfg *cfg, FILE *fp)
+{
+	int rc = 0;
+	static const unsigned int types[] = {
+		APPLY_T_DOI, APPLY_T_MAP, APPLY_T_UNLBL
+	};
+	unsigned int type;
+	struct apply_entry **array;
+	struct apply_entry *entry;
+	size_t count;
+	size_t iter;
+
+	fprintf(fp, "# NetLabel configuration saved by netlabelctl\n");
+	for (type = 0; type < sizeof(types) / sizeof(types[0]); type++) {
+		array = apply_cfg_sort(cfg, types[type], &count);
+		if (array == NULL)
+			return -ENOMEM;
+
+		/* the default domain mapping is sorted first, replace the
+		 * reset state's mapping unless it is the same */
+		iter = 0;
+		if (types[type] == APPLY_T_MAP) {
+			if (count > 0 && array[0]->d.map.domain == NULL &&
+			    array[0]->d.map.proto_type ==
+			    NETLBL_NLTYPE_UNLABELED)
+				iter = 1;
+			else
+				fprintf(fp, "map del default\n");
+		} else if (types[type] == APPLY_T_UNLBL && !cfg->accept)
+			fprintf(fp, "unlbl accept off\n");
+
+		for (; iter < count && rc == 0; iter++) {
+			entry = array[iter];
+			switch (entry->type) {
+			case APPLY_T_DOI:
+				rc = apply_save_doi(fp, &entry->d.doi);
+				break;
+			case APPLY_T_MAP:
+				rc = apply_save_map(fp, &entry->d.map);
+				break;
+			case APPLY_T_UNLBL:
+				rc = apply_save_unlbl(fp, &entry->d.unlbl);
+				break;
+			}
+		}
+		free(array);
+		if (rc < 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Entry points
+ */
+
+/**
+ * Entry point for the NetLabel apply function
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Bring the kernel's NetLabel configuration in line with the configuration
+ * file given in @argv, sending only the changes needed.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int apply_main(int argc, char *argv[])
+{
+	int rc;
+	struct apply_cfg new;
+
+	/* sanity checks */
+	if (argc != 1 || argv == NULL || argv[0] == NULL)
+		return -EINVAL;
+
+	rc = apply_cfg_init(&new);
+	if (rc < 0)
+		goto apply_return;
+	rc = apply_cfg_file(&new, argv[0]);
+	if (rc < 0)
+		goto apply_return;
+	rc = apply_cfg(&new, APPLY_F_ALL | APPLY_F_DETAIL);
+
+apply_return:
+	apply_cfg_free(&new);
+	return rc;
+}
+
+/**
+ * Entry point for the NetLabel reset function
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Return the parts of the kernel's NetLabel configuration given in @argv, or
+ * all of it if @argv is empty, to the reset state.  Domain mappings are
+ * removed before the CIPSOv4 DOIs they use.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+int reset_main(int argc, char *argv[])
+{
+	int rc;
+	int iter;
+	unsigned int scope = 0;
+	struct apply_cfg new;
+
+	/* parse the arguments */
+	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
+		if (!strcmp(argv[iter], "map"))
+			scope |= APPLY_F_MAP;
+		else if (!strcmp(argv[iter], "cipsov4"))
+			scope |= APPLY_F_CV4;
+		else if (!strcmp(argv[iter], "unlbl"))
+			scope |= APPLY_F_UNLBL;
+		else if (!strcmp(argv[iter], "all"))
+			scope |= APPLY_F_ALL;
+		else
+			return -EINVAL;
+	}
+	if (scope == 0)
+		scope = APPLY_F_ALL;
+
+	rc = apply_cfg_init(&new);
+	if (rc < 0)
+		goto reset_return;
+	rc = apply_cfg_reset(&new, scope);
+	if (rc < 0)
+		goto reset_return;
+	rc = apply_cfg(&new, scope);
+
+reset_return:
+	apply_cfg_free(&new);
+	return rc;
+}
+
+/**
+ * Entry point for the NetLabel save function
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Write the kernel's NetLabel configuration to the file given in @argv, or
+ * stdout if @argv is empty or "-", in a form which can be loaded with the
+ * apply function or the -f flag.  A named file is replaced atomically.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int save_main(int argc, char *argv[])
+{
+	int rc;
+	struct apply_cfg cfg;
+	const char *file = NULL;
+	char *tmp = NULL;
+	int fd;
+	FILE *fp = NULL;
+	char *buf = NULL;
+
+	/* sanity checks */
+	if (argc > 1 || (argc == 1 && (argv == NULL || argv[0] == NULL)))
+		return -EINVAL;
+	if (argc == 1 && strcmp(argv[0], "-") != 0)
+		file = argv[0];
+
+	/* load the configuration */
+	rc = apply_cfg_init(&cfg);
+	if (rc < 0)
+		goto save_return;
+	cfg.accept = 1;
+	rc = apply_cfg_kernel(&cfg, APPLY_F_ALL | APPLY_F_DETAIL);
+	if (rc < 0)
+		goto save_return;
+
+	/* open the output file, named files are written to a temporary file
+	 * first so that a failure does not leave a partial configuration */
+	if (file != NULL) {
+		tmp = malloc(strlen(file) + 8);
+		if (tmp == NULL) {
+			rc = -ENOMEM;
+			goto save_return;
+		}
+		sprintf(tmp, "%s.XXXXXX", file);
+		fd = mkstemp(tmp);
+		if (fd < 0) {
+			rc = -errno;
+			free(tmp);
+			tmp = NULL;
+			goto save_return;
+		}
+		fp = fdopen(fd, "w");
+		if (fp == NULL) {
+			rc = -errno;
+			close(fd);
+			goto save_return;
+		}
+		if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) < 0) {
+			rc = -errno;
+			goto save_return;
+		}
+	} else {
+		/* use our own stream so the buffer below is ours to free */
+		fflush(stdout);
+		fd = dup(STDOUT_FILENO);
+		if (fd < 0) {
+			rc = -errno;
+			goto save_return;
+		}
+		fp = fdopen(fd, "w");
+		if (fp == NULL) {
+			rc = -errno;
+			close(fd);
+			goto save_return;
+		}
+	}
+	buf = malloc(APPLY_SAVE_BUF);
+	if (buf != NULL)
+		setvbuf(fp, buf, _IOFBF, APPLY_SAVE_BUF);
+
+	/* write the configuration */
+	rc = apply_save(&cfg, fp);
+	if (rc == 0 && fflush(fp) != 0)
+		rc = -errno;
+	if (rc == 0 && ferror(fp))
+		rc = -EIO;
+	if (rc == 0) {
+		rc = fclose(fp);
+		fp = NULL;
+		if (rc != 0)
+			rc = -errno;
+		else if (file != NULL && rename(tmp, file) < 0)
+			rc = -errno;
+	}
+
+save_return:
+	if (fp != NULL)
+		fclose(fp);
+	if (tmp != NULL) {
+		if (rc < 0)
+			unlink(tmp);
+		free(tmp);
+	}
+	free(buf);
+	apply_cfg_free(&cfg);
+	return rc;
+}
@@ -27,110 +27,281 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 
 #include <libnetlabel.h>
 
 #include "netlabelctl.h"
 
 /**
- * Add a CIPSOv4 label mapping
+ * Parse a CIPSOv4 mapping value
+ * @param str the string
+ * @param end the end of the value
+ * @param val the value
+ *
+ * Parse the unsigned decimal value at the start of @str, setting @end to the
+ * first character after it.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int cipsov4_val_parse(const char *str, char **end, uint32_t *val)
+{
+	unsigned long tmp;
+
+	if (*str < '0' || *str > '9')
+		return -EINVAL;
+	errno = 0;
+	tmp = strtoul(str, end, 10);
+	if (errno != 0 || tmp > UINT32_MAX)
+		return -EINVAL;
+	*val = tmp;
+
+	return 0;
+}
+
+/**
+ * Parse a list of CIPSOv4 level or category mappings
+ * @param str the mapping list
+ * @param ranges the mapping ranges
+ *
+ * Parse the comma separated mappings in @str and append them to @ranges.  A
+ * mapping is a single "local=remote" pair, a range of local values mapped to
+ * a range of remote values of the same size, "first-last=first-last" or
+ * "first-last=first", a range of local values mapped with an offset,
+ * "first-last=+offset" or "first-last=-offset", or values which are the same
+ * on both sides, "first-last" or "value".  The array in @ranges must be freed
+ * by the caller, even on failure.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int cipsov4_range_parse(const char *str,
+			       struct nlbl_cv4_range_a *ranges)
+{
+	int rc;
+	char *end;
+	char sign;
+	uint32_t loc_last;
+	uint32_t rem_last;
+	uint32_t offset;
+	struct nlbl_cv4_range range;
+	void *array_new;
+
+	if (*str == '\0')
+		return 0;
+
+	for (;;) {
+		/* local values */
+		rc = cipsov4_val_parse(str, &end, &range.loc);
+		if (rc < 0)
+			return rc;
+		loc_last = range.loc;
+		if (*end == '-') {
+			rc = cipsov4_val_parse(end + 1, &end, &loc_last);
+			if (rc < 0)
+				return rc;
+			if (loc_last < range.loc ||
+			    loc_last - range.loc == UINT32_MAX)
+				return -EINVAL;
+		}
+		range.count = loc_last - range.loc + 1;
+
+		/* remote values, the same as the local values if not given */
+		range.rem = range.loc;
+		if (*end == '=' && (end[1] == '+' || end[1] == '-')) {
+			sign = end[1];
+			rc = cipsov4_val_parse(end + 2, &end, &offset);
+			if (rc < 0)
+				return rc;
+			if (sign == '+') {
+				if (offset > UINT32_MAX - loc_last)
+					return -EINVAL;
+				range.rem = range.loc + offset;
+			} else {
+				if (offset > range.loc)
+					return -EINVAL;
+				range.rem = range.loc - offset;
+			}
+		} else if (*end == '=') {
+			rc = cipsov4_val_parse(end + 1, &end, &range.rem);
+			if (rc < 0)
+				return rc;
+			if (range.rem > UINT32_MAX - (range.count - 1))
+				return -EINVAL;
+			if (*end == '-') {
+				rc = cipsov4_val_parse(end + 1, &end, &rem_last);
+				if (rc < 0)
+					return rc;
+				if (rem_last < range.rem ||
+				    rem_last - range.rem != range.count - 1)
+					return -EINVAL;
+			}
+		}
+		if (*end != ',' && *end != '\0')
+			return -EINVAL;
+
+		array_new = realloc(ranges->array,
+				    sizeof(*ranges->array) * (ranges->size + 1));
+		if (array_new == NULL)
+			return -ENOMEM;
+		ranges->array = array_new;
+		ranges->array[ranges->size++] = range;
+
+		if (*end == '\0')
+			return 0;
+		str = end + 1;
+	}
+}
+
+/**
+ * Count the mappings in an array of CIPSOv4 mapping ranges
+ * @param ranges the mapping ranges
+ *
+ * Returns the number of individual mappings in @ranges.
+ *
+ */
+static size_t cipsov4_range_count(const struct nlbl_cv4_range_a *ranges)
+{
+	size_t iter;
+	size_t count = 0;
+
+	for (iter = 0; iter < ranges->size; iter++)
+		count += ranges->array[iter].count;
+
+	return count;
+}
+
+/**
+ * Display a CIPSOv4 mapping range
+ * @param fp the output file
+ * @param range the mapping range
+ * @param eq the separator between the local and remote values
+ *
+ * Write @range to @fp in the form accepted by the "cipsov4 add" command, with
+ * values and ranges of values which are the same on both sides written once.
+ *
+ */
+void cipsov4_range_print(FILE *fp, const struct nlbl_cv4_range *range,
+			 const char *eq)
+{
+	uint32_t last = range->count - 1;
+
+	if (range->loc == range->rem && range->count == 1)
+		fprintf(fp, "%u", range->loc);
+	else if (range->loc == range->rem)
+		fprintf(fp, "%u-%u", range->loc, range->loc + last);
+	else if (range->count == 1)
+		fprintf(fp, "%u%s%u", range->loc, eq, range->rem);
+	else
+		fprintf(fp, "%u-%u%s%u-%u", range->loc, range->loc + last,
+			eq, range->rem, range->rem + last);
+}
+
+/**
+ * Parse the arguments of a CIPSOv4 add command
  * @param argc the number of arguments
  * @param argv the argument list
+ * @param doi the DOI value
+ * @param mtype the DOI mapping type
+ * @param tags the CIPSO tags
+ * @param lvls the MLS level mapping ranges
+ * @param cats the MLS category mapping ranges
  *
- * Add a CIPSOv4 label mapping to the NetLabel system.  Returns zero on
+ * Parse the "cipsov4 add" arguments in @argv into @doi, @mtype, @tags, @lvls
+ * and @cats.  The arrays in @tags, @lvls and @cats are allocated by this
+ * function and must be freed by the caller, even on failure.  Returns zero on
  * success, negative values on failure.
  *
  */
-int cipsov4_add(int argc, char *argv[])
+int cipsov4_add_parse(int argc, char *argv[],
+		      nlbl_cv4_doi *doi, nlbl_cv4_mtype *mtype,
+		      struct nlbl_cv4_tag_a *tags,
+		      struct nlbl_cv4_range_a *lvls,
+		      struct nlbl_cv4_range_a *cats)
 {
 	int rc;
 	uint32_t iter;
-	uint32_t cipso_type = CIPSO_V4_MAP_UNKNOWN;
-	nlbl_cv4_doi doi = 0;
-	struct nlbl_cv4_tag_a tags = { .array = NULL, .size = 0 };
-	struct nlbl_cv4_lvl_a lvls = { .array = NULL, .size = 0 };
-	struct nlbl_cv4_cat_a cats = { .array = NULL, .size = 0 };
 	char *token_ptr;
 
 	/* sanity checks */
 	if (argc <= 0 || argv == NULL || argv[0] == NULL)
 		return -EINVAL;
 
+	*doi = 0;
+	*mtype = CIPSO_V4_MAP_UNKNOWN;
+
 	/* parse the arguments */
 	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
 		if (strcmp(argv[iter], "trans") == 0) {
-			cipso_type = CIPSO_V4_MAP_TRANS;
+			*mtype = CIPSO_V4_MAP_TRANS;
 		} else if (strcmp(argv[iter], "std") == 0) {
 			fprintf(stderr,
 				MSG_OLD("use 'trans' instead of 'std'\n"));
-			cipso_type = CIPSO_V4_MAP_TRANS;
+			*mtype = CIPSO_V4_MAP_TRANS;
 		} else if (strcmp(argv[iter], "pass") == 0) {
-			cipso_type = CIPSO_V4_MAP_PASS;
+			*mtype = CIPSO_V4_MAP_PASS;
 		} else if (strcmp(argv[iter], "local") == 0) {
-			cipso_type = CIPSO_V4_MAP_LOCAL;
+			*mtype = CIPSO_V4_MAP_LOCAL;
 		} else if (strncmp(argv[iter], "doi:", 4) == 0) {
 			/* doi */
-			doi = atoi(argv[iter] + 4);
+			*doi = atoi(argv[iter] + 4);
 		} else if (strncmp(argv[iter], "tags:", 5) == 0) {
 			/* tags */
 			token_ptr = strtok(argv[iter] + 5, ",");
 			while (token_ptr != NULL) {
-				tags.array = realloc(tags.array,
-						     sizeof(nlbl_cv4_tag) *
-						     (tags.size + 1));
-				if (tags.array == NULL) {
-					rc = -ENOMEM;
-					goto add_return;
-				}
-				tags.array[tags.size++] = atoi(token_ptr);
+				tags->array = realloc(tags->array,
+						      sizeof(nlbl_cv4_tag) *
+						      (tags->size + 1));
+				if (tags->array == NULL)
+					return -ENOMEM;
+				tags->array[tags->size++] = atoi(token_ptr);
 				token_ptr = strtok(NULL, ",");
 			}
 		} else if (strncmp(argv[iter], "levels:", 7) == 0) {
 			/* levels */
-			token_ptr = strtok(argv[iter] + 7, "=");
-			while (token_ptr != NULL) {
-				lvls.array = realloc(lvls.array,
-						     sizeof(nlbl_cv4_lvl) * 2 *
-						     (lvls.size + 1));
-				if (lvls.array == NULL) {
-					rc = -ENOMEM;
-					goto add_return;
-				}
-				/* XXX - should be more robust for bad input */
-				lvls.array[lvls.size * 2] = atoi(token_ptr);
-				token_ptr = strtok(NULL, ",");
-				lvls.array[lvls.size * 2 + 1] = atoi(token_ptr);
-				token_ptr = strtok(NULL, "=");
-				lvls.size++;
-			}
+			rc = cipsov4_range_parse(argv[iter] + 7, lvls);
+			if (rc < 0)
+				return rc;
 		} else if (strncmp(argv[iter], "categories:", 11) == 0) {
 			/* categories */
-			token_ptr = strtok(argv[iter] + 11, "=");
-			while (token_ptr != NULL) {
-				cats.array = realloc(cats.array,
-						     sizeof(nlbl_cv4_cat) * 2 *
-						     (cats.size + 1));
-				if (cats.array == NULL) {
-					rc = -ENOMEM;
-					goto add_return;
-				}
-				/* XXX - should be more robust for bad input */
-				cats.array[cats.size * 2] = atoi(token_ptr);
-				token_ptr = strtok(NULL, ",");
-				cats.array[cats.size * 2 + 1] = atoi(token_ptr);
-				token_ptr = strtok(NULL, "=");
-				cats.size++;
-			}
+			rc = cipsov4_range_parse(argv[iter] + 11, cats);
+			if (rc < 0)
+				return rc;
 		} else
 			return -EINVAL;
 	}
 
+	return 0;
+}
+
+/**
+ * Add a CIPSOv4 label mapping
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Add a CIPSOv4 label mapping to the NetLabel system.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int cipsov4_add(int argc, char *argv[])
+{
+	int rc;
+	nlbl_cv4_mtype cipso_type;
+	nlbl_cv4_doi doi;
+	struct nlbl_cv4_tag_a tags = { .array = NULL, .size = 0 };
+	struct nlbl_cv4_range_a lvls = { .array = NULL, .size = 0 };
+	struct nlbl_cv4_range_a cats = { .array = NULL, .size = 0 };
+
+	rc = cipsov4_add_parse(argc, argv,
+			       &doi, &cipso_type, &tags, &lvls, &cats);
+	if (rc < 0)
+		goto add_return;
+
 	/* add the cipso mapping */
 	switch (cipso_type) {
 	case CIPSO_V4_MAP_TRANS:
 		/* translated mapping */
-		rc = nlbl_cipsov4_add_trans(NULL,
-					    doi, &tags, &lvls, &cats);
+		rc = nlbl_cipsov4_add_trans_range(NULL,
+						  doi, &tags, &lvls, &cats);
 		break;
 	case CIPSO_V4_MAP_PASS:
 		/* pass through mapping */
@@ -155,32 +326,55 @@ add_return:
 }
 
 /**
- * Remove a CIPSOv4 label mapping
+ * Parse the arguments of a CIPSOv4 delete command
  * @param argc the number of arguments
  * @param argv the argument list
+ * @param doi the DOI value
  *
- * Remove a CIPSOv4 label mapping from the NetLabel system.  Returns zero on
+ * Parse the "cipsov4 del" arguments in @argv into @doi.  Returns zero on
  * success, negative values on failure.
  *
  */
-int cipsov4_del(int argc, char *argv[])
+int cipsov4_del_parse(int argc, char *argv[], nlbl_cv4_doi *doi)
 {
 	uint32_t iter;
-	nlbl_cv4_doi doi = 0;
 
 	/* sanity checks */
 	if (argc <= 0 || argv == NULL || argv[0] == NULL)
 		return -EINVAL;
 
+	*doi = 0;
+
 	/* parse the arguments */
 	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
 		if (strncmp(argv[iter], "doi:", 4) == 0) {
 			/* doi */
-			doi = atoi(argv[iter] + 4);
+			*doi = atoi(argv[iter] + 4);
 		} else
 			return -EINVAL;
 	}
 
+	return 0;
+}
+
+/**
+ * Remove a CIPSOv4 label mapping
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Remove a CIPSOv4 label mapping from the NetLabel system.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int cipsov4_del(int argc, char *argv[])
+{
+	int rc;
+	nlbl_cv4_doi doi;
+
+	rc = cipsov4_del_parse(argc, argv, &doi);
+	if (rc < 0)
+		return rc;
+
 	/* delete the mapping */
 	return nlbl_cipsov4_del(NULL, doi);
 }
@@ -265,31 +459,53 @@ list_all_return:
 }
 
 /**
- * List a specific CIPSOv4 DOI label mapping
- * @param doi the DOI value
+ * Display a CIPSOv4 mapping type
+ * @param mtype the mapping type
  *
- * List the configured CIPSOv4 label mapping.  Returns zero on success,
- * negative values on failure.
+ * Display the name of the CIPSOv4 mapping type.
  *
  */
-static int cipsov4_list_doi(uint32_t doi)
+static void cipsov4_list_mtype(nlbl_cv4_mtype mtype)
 {
-	int rc;
-	uint32_t iter;
-	nlbl_cv4_mtype maptype;
-	struct nlbl_cv4_tag_a tags = { .array = NULL, .size = 0 };
-	struct nlbl_cv4_lvl_a lvls = { .array = NULL, .size = 0 };
-	struct nlbl_cv4_cat_a cats = { .array = NULL, .size = 0 };
+	switch (mtype) {
+	case CIPSO_V4_MAP_TRANS:
+		printf("TRANSLATED");
+		break;
+	case CIPSO_V4_MAP_PASS:
+		printf("PASS_THROUGH");
+		break;
+	case CIPSO_V4_MAP_LOCAL:
+		printf("LOCAL");
+		break;
+	default:
+		printf("UNKNOWN(%u)", mtype);
+		break;
+	}
+}
 
-	rc = nlbl_cipsov4_list(NULL, doi, &maptype, &tags, &lvls, &cats);
-	if (rc < 0)
-		return rc;
+/**
+ * Display a CIPSOv4 DOI definition
+ * @param def the DOI definition
+ * @param detail_flag display the DOI and mapping type
+ *
+ * Display the CIPSOv4 DOI definition.
+ *
+ */
+static void cipsov4_list_def(const struct nlbl_cv4_def *def,
+			     uint32_t detail_flag)
+{
+	uint32_t iter;
 
 	if (opt_pretty != 0) {
-		printf("Configured CIPSOv4 mapping (DOI = %u)\n", doi);
-		printf(" tags (%zu): \n", tags.size);
-		for (iter = 0; iter < tags.size; iter++) {
-			switch (tags.array[iter]) {
+		printf("Configured CIPSOv4 mapping (DOI = %u)\n", def->doi);
+		if (detail_flag != 0) {
+			printf(" mapping type : ");
+			cipsov4_list_mtype(def->mtype);
+			printf("\n");
+		}
+		printf(" tags (%zu): \n", def->tags.size);
+		for (iter = 0; iter < def->tags.size; iter++) {
+			switch (def->tags.array[iter]) {
 			case 1:
 				printf("   RESTRICTED BITMAP\n");
 				break;
@@ -309,52 +525,64 @@ static int cipsov4_list_doi(uint32_t doi)
 				printf("   LOCAL\n");
 				break;
 			default:
-				printf("   UNKNOWN(%u)\n", tags.array[iter]);
+				printf("   UNKNOWN(%u)\n",
+				       def->tags.array[iter]);
 				break;
 			}
 		}
-		switch (maptype) {
+		switch (def->mtype) {
 		case CIPSO_V4_MAP_TRANS:
 			/* levels */
-			printf(" levels (%zu): \n", lvls.size);
-			for (iter = 0; iter < lvls.size; iter++)
-				printf("   %u = %u\n",
-				       lvls.array[iter * 2],
-				       lvls.array[iter * 2 + 1]);
+			printf(" levels (%zu): \n",
+			       cipsov4_range_count(&def->lvls));
+			for (iter = 0; iter < def->lvls.size; iter++) {
+				printf("   ");
+				cipsov4_range_print(stdout,
+						    &def->lvls.array[iter],
+						    " = ");
+				printf("\n");
+			}
 			/* categories */
-			printf(" categories (%zu): \n", cats.size);
-			for (iter = 0; iter < cats.size; iter++)
-				printf("   %u = %u\n",
-				       cats.array[iter * 2],
-				       cats.array[iter * 2 + 1]);
+			printf(" categories (%zu): \n",
+			       cipsov4_range_count(&def->cats));
+			for (iter = 0; iter < def->cats.size; iter++) {
+				printf("   ");
+				cipsov4_range_print(stdout,
+						    &def->cats.array[iter],
+						    " = ");
+				printf("\n");
+			}
 			break;
 		}
 	} else {
+		if (detail_flag != 0) {
+			printf("%u,", def->doi);
+			cipsov4_list_mtype(def->mtype);
+			printf(" ");
+		}
 		/* tags */
 		printf("tags:");
-		for (iter = 0; iter < tags.size; iter++) {
-			printf("%u", tags.array[iter]);
-			if (iter + 1 < tags.size)
+		for (iter = 0; iter < def->tags.size; iter++) {
+			printf("%u", def->tags.array[iter]);
+			if (iter + 1 < def->tags.size)
 				printf(",");
 		}
-		switch (maptype) {
+		switch (def->mtype) {
 		case CIPSO_V4_MAP_TRANS:
 			/* levels */
 			printf(" levels:");
-			for (iter = 0; iter < lvls.size; iter++) {
-				printf("%u=%u",
-				       lvls.array[iter * 2],
-				       lvls.array[iter * 2 + 1]);
-				if (iter + 1 < lvls.size)
+			for (iter = 0; iter < def->lvls.size; iter++) {
+				cipsov4_range_print(stdout,
+						    &def->lvls.array[iter], "=");
+				if (iter + 1 < def->lvls.size)
 					printf(",");
 			}
 			/* categories */
 			printf(" categories:");
-			for (iter = 0; iter < cats.size; iter++) {
-				printf("%u=%u",
-				       cats.array[iter * 2],
-				       cats.array[iter * 2 + 1]);
-				if (iter + 1 < cats.size)
+			for (iter = 0; iter < def->cats.size; iter++) {
+				cipsov4_range_print(stdout,
+						    &def->cats.array[iter], "=");
+				if (iter + 1 < def->cats.size)
 					printf(",");
 			}
 			break;
@@ -362,6 +590,62 @@ static int cipsov4_list_doi(uint32_t doi)
 		printf("\n");
 	}
 
+}
+
+/**
+ * List a specific CIPSOv4 DOI label mapping
+ * @param doi the DOI value
+ *
+ * List the configured CIPSOv4 label mapping.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int cipsov4_list_doi(uint32_t doi)
+{
+	int rc;
+	struct nlbl_cv4_def def;
+
+	memset(&def, 0, sizeof(def));
+	def.doi = doi;
+	rc = nlbl_cipsov4_list_range(NULL, doi, &def.mtype,
+				     &def.tags, &def.lvls, &def.cats);
+	if (rc < 0)
+		return rc;
+
+	cipsov4_list_def(&def, 0);
+
+	free(def.tags.array);
+	free(def.lvls.array);
+	free(def.cats.array);
+	return 0;
+}
+
+/**
+ * List the full definition of all of the CIPSOv4 label mappings
+ *
+ * List the configured CIPSOv4 label mappings including the tags, levels and
+ * categories of each mapping.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int cipsov4_list_detail(void)
+{
+	int rc;
+	size_t iter;
+	size_t count;
+	struct nlbl_cv4_def *defs = NULL;
+
+	rc = nlbl_cipsov4_listall_detail(NULL, &defs);
+	if (rc < 0)
+		return rc;
+	count = rc;
+
+	if (opt_pretty != 0)
+		printf("Configured CIPSOv4 mappings (%zu)\n", count);
+	for (iter = 0; iter < count; iter++)
+		cipsov4_list_def(&defs[iter], 1);
+
+	nlbl_cipsov4_def_free(defs, count);
 	return 0;
 }
 
@@ -378,6 +662,7 @@ int cipsov4_list(int argc, char *argv[])
 {
 	uint32_t iter;
 	uint32_t doi_flag = 0;
+	uint32_t detail_flag = 0;
 	nlbl_cv4_doi doi = 0;
 
 	/* parse the arguments */
@@ -386,12 +671,17 @@ int cipsov4_list(int argc, char *argv[])
 			/* doi */
 			doi = atoi(argv[iter] + 4);
 			doi_flag = 1;
+		} else if (strcmp(argv[iter], "detail") == 0) {
+			/* detail */
+			detail_flag = 1;
 		} else
 			return -EINVAL;
 	}
 
 	if (doi_flag != 0)
 		return cipsov4_list_doi(doi);
+	else if (detail_flag != 0)
+		return cipsov4_list_detail();
 	else
 		return cipsov4_list_all();
 }
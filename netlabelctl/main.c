@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <arpa/inet.h>
 
 #include <libnetlabel.h>
@@ -45,6 +46,15 @@
 uint32_t opt_verbose = 0;
 uint32_t opt_timeout = 10;
 uint32_t opt_pretty = 0;
+uint32_t opt_stop = 0;
+/* requests must be sent one at a time in a fixed order, e.g. for replays */
+uint32_t opt_ordered = 0;
+static char *opt_file = NULL;
+static nlbl_transport opt_transport = NLBL_TRANSPORT_NETLINK;
+static char *opt_capture = NULL;
+static char *opt_replay = NULL;
+static char *opt_daemon = NULL;
+static uint32_t opt_stats = 0;
 
 /* program name */
 char *nlctl_name = NULL;
@@ -58,7 +68,10 @@ char *nlctl_name = NULL;
  */
 static void nlctl_usage_print(FILE *fp)
 {
-	fprintf(fp, "usage: %s [<flags>] <module> [<commands>]\n", nlctl_name);
+	fprintf(fp,
+		"usage: %s [<flags>] <module> [<commands>]\n"
+		"       %s [<flags>] -f <file>\n",
+		nlctl_name, nlctl_name);
 }
 
 /**
@@ -85,12 +98,20 @@ static void nlctl_help_print(FILE *fp)
 	nlctl_ver_print(fp);
 	fprintf(fp,
 		" Usage: %s [<flags>] <module> [<commands>]\n"
+		"        %s [<flags>] -f <file>\n"
 		"\n"
 		" Flags:\n"
+		"   -D <path> : talk to netlabeld on the socket <path>\n"
+		"   -f <file> : run the commands in <file>, \"-\" for stdin\n"
 		"   -h        : help/usage message\n"
 		"   -p        : make the output pretty\n"
+		"   -r <file> : replay the kernel's replies from a capture\n"
+		"   -s        : stop at the first failed command\n"
+		"   -S        : display request statistics on exit\n"
 		"   -t <secs> : timeout\n"
+		"   -T <name> : transport: \"netlink\", \"fake\", \"daemon\"\n"
 		"   -v        : verbose mode\n"
+		"   -w <file> : capture the NetLabel traffic to a pcap file\n"
 		"\n"
 		" Modules and Commands:\n"
 		"  mgmt : NetLabel management\n"
@@ -101,12 +122,19 @@ static void nlctl_help_print(FILE *fp)
 		"                                protocol:<protocol>[,<extra>]\n"
 		"    del default|domain:<domain>\n"
 		"    list\n"
+		"    lookup default|domain:<domain>\n"
+		"           address:<ADDR>|file:<FILE> [threads:<N>]\n"
+		"    optimize [file:<FILE>] [verify]\n"
 		"  unlbl : Unlabeled packet handling\n"
 		"    accept on|off\n"
 		"    add default|interface:<DEV> address:<ADDR>[/<MASK>]\n"
 		"                                label:<LABEL>\n"
 		"    del default|interface:<DEV> address:<ADDR>[/<MASK>]\n"
 		"    list\n"
+		"    lookup default|interface:<DEV>\n"
+		"           address:<ADDR>|file:<FILE>\n"
+		"    optimize [file:<FILE>] [verify]\n"
+		"    import <FILE>\n"
 		"  cipsov4 : CIPSO/IPv4 packet handling\n"
 		"    add trans doi:<DOI> tags:<T1>,<Tn>\n"
 		"            levels:<LL1>=<RL1>,<LLn>=<RLn>\n"
@@ -114,9 +142,109 @@ static void nlctl_help_print(FILE *fp)
 		"    add pass doi:<DOI> tags:<T1>,<Tn>\n"
 		"    add local doi:<DOI>\n"
 		"    del doi:<DOI>\n"
-		"    list [doi:<DOI>]\n"
+		"    list [doi:<DOI>|detail]\n"
+		"  apply : Apply a configuration file\n"
+		"    <file>\n"
+		"  reset : Reset the configuration\n"
+		"    [map|cipsov4|unlbl|all]\n"
+		"  save : Save the configuration\n"
+		"    [<file>]\n"
 		"\n",
-		nlctl_name);
+		nlctl_name, nlctl_name);
+}
+
+/* request statistics families */
+static const struct {
+	nlbl_proto family;
+	const char *name;
+	unsigned int cmd_max;
+	const char *cmds[NLBL_UNLABEL_C_MAX + 1];
+} nlctl_stats_fams[] = {
+	{ NETLBL_NLTYPE_MGMT, "mgmt", NLBL_MGMT_C_MAX,
+	  { [NLBL_MGMT_C_ADD] = "add",
+	    [NLBL_MGMT_C_REMOVE] = "remove",
+	    [NLBL_MGMT_C_LISTALL] = "listall",
+	    [NLBL_MGMT_C_ADDDEF] = "adddef",
+	    [NLBL_MGMT_C_REMOVEDEF] = "removedef",
+	    [NLBL_MGMT_C_LISTDEF] = "listdef",
+	    [NLBL_MGMT_C_PROTOCOLS] = "protocols",
+	    [NLBL_MGMT_C_VERSION] = "version" } },
+	{ NETLBL_NLTYPE_CIPSOV4, "cipsov4", NLBL_CIPSOV4_C_MAX,
+	  { [NLBL_CIPSOV4_C_ADD] = "add",
+	    [NLBL_CIPSOV4_C_REMOVE] = "remove",
+	    [NLBL_CIPSOV4_C_LIST] = "list",
+	    [NLBL_CIPSOV4_C_LISTALL] = "listall" } },
+	{ NETLBL_NLTYPE_UNLABELED, "unlbl", NLBL_UNLABEL_C_MAX,
+	  { [NLBL_UNLABEL_C_ACCEPT] = "accept",
+	    [NLBL_UNLABEL_C_LIST] = "list",
+	    [NLBL_UNLABEL_C_STATICADD] = "staticadd",
+	    [NLBL_UNLABEL_C_STATICREMOVE] = "staticremove",
+	    [NLBL_UNLABEL_C_STATICLIST] = "staticlist",
+	    [NLBL_UNLABEL_C_STATICADDDEF] = "staticadddef",
+	    [NLBL_UNLABEL_C_STATICREMOVEDEF] = "staticremovedef",
+	    [NLBL_UNLABEL_C_STATICLISTDEF] = "staticlistdef" } },
+};
+
+/**
+ * Display the request statistics
+ * @param fp the output file pointer
+ *
+ * Display the statistics of each NetLabel command which was sent at least
+ * once.  The 99th percentile latency is the upper bound of the histogram
+ * bucket holding it.
+ *
+ */
+static void nlctl_stats_print(FILE *fp)
+{
+	unsigned int fam_iter;
+	unsigned int cmd_iter;
+	unsigned int bkt;
+	struct nlbl_stats stats;
+	uint64_t p99;
+	uint64_t cnt;
+	char name[32];
+
+	fprintf(fp, "%-24s %8s %6s %8s %10s %10s %8s %10s %10s %10s\n",
+		"command", "requests", "errors", "timeouts", "sent", "recv",
+		"dumps", "avg_us", "p99_us", "max_us");
+	for (fam_iter = 0;
+	     fam_iter < sizeof(nlctl_stats_fams) / sizeof(nlctl_stats_fams[0]);
+	     fam_iter++) {
+		for (cmd_iter = 1;
+		     cmd_iter <= nlctl_stats_fams[fam_iter].cmd_max;
+		     cmd_iter++) {
+			if (nlbl_stats_get(nlctl_stats_fams[fam_iter].family,
+					   cmd_iter, &stats) < 0 ||
+			    stats.requests == 0)
+				continue;
+
+			p99 = 0;
+			cnt = 0;
+			for (bkt = 0; bkt < NLBL_STATS_HIST_SIZE; bkt++) {
+				cnt += stats.lat_hist[bkt];
+				if (cnt * 100 >= stats.lat_count * 99) {
+					p99 = 2ULL << bkt;
+					break;
+				}
+			}
+			if (p99 > stats.lat_max)
+				p99 = stats.lat_max;
+
+			snprintf(name, sizeof(name), "%s %s",
+				 nlctl_stats_fams[fam_iter].name,
+				 nlctl_stats_fams[fam_iter].cmds[cmd_iter]);
+			fprintf(fp, "%-24s %8" PRIu64 " %6" PRIu64
+				" %8" PRIu64 " %10" PRIu64 " %10" PRIu64
+				" %8" PRIu64 " %10.1f %10.1f %10.1f\n",
+				name, stats.requests, stats.errors,
+				stats.timeouts, stats.bytes_sent,
+				stats.bytes_recv, stats.dump_msgs,
+				(stats.lat_count > 0 ?
+				 stats.lat_total / 1000.0 / stats.lat_count :
+				 0.0),
+				p99 / 1000.0, stats.lat_max / 1000.0);
+		}
+	}
 }
 
 /**
@@ -127,7 +255,7 @@ static void nlctl_help_print(FILE *fp)
  * @rc.
  *
  */
-static char *nlctl_strerror(int rc)
+char *nlctl_strerror(int rc)
 {
 	char *str = NULL;
 
@@ -167,13 +295,16 @@ static char *nlctl_strerror(int rc)
 }
 
 /**
- * Display a network address
- * @param addr the IP address to display
+ * Format a network address
+ * @param addr the IP address to format
+ * @param buf the output buffer
+ * @param len the size of @buf
  *
- * Print the IP address and mask, specified in @addr, to STDIO.
+ * Write the IP address and mask, specified in @addr, to @buf in the same
+ * "<ADDR>/<MASK>" form accepted by nlctl_addr_parse().  Returns @buf.
  *
  */
-void nlctl_addr_print(const struct nlbl_netaddr *addr)
+char *nlctl_addr_fmt(const struct nlbl_netaddr *addr, char *buf, size_t len)
 {
 	char addr_s[80];
 	socklen_t addr_s_len = 80;
@@ -187,9 +318,9 @@ void nlctl_addr_print(const struct nlbl_netaddr *addr)
 		mask4.s_addr = ntohl(addr->mask.v4.s_addr);
 		for (mask_size = 0; mask4.s_addr != 0; mask_size++)
 			mask4.s_addr <<= 1;
-		printf("%s/%u",
-		       inet_ntop(AF_INET, &addr->addr.v4, addr_s, addr_s_len),
-		       mask_size);
+		snprintf(buf, len, "%s/%u",
+			 inet_ntop(AF_INET, &addr->addr.v4, addr_s, addr_s_len),
+			 mask_size);
 		break;
 	case AF_INET6:
 		for (mask_size = 0, mask_off = 0; mask_off < 4; mask_off++) {
@@ -200,14 +331,31 @@ void nlctl_addr_print(const struct nlbl_netaddr *addr)
 				mask6.s6_addr32[mask_off] <<= 1;
 			}
 		}
-		printf("%s/%u",
-		       inet_ntop(AF_INET6, &addr->addr.v6, addr_s, addr_s_len),
-		       mask_size);
+		snprintf(buf, len, "%s/%u",
+			 inet_ntop(AF_INET6,
+				   &addr->addr.v6, addr_s, addr_s_len),
+			 mask_size);
 		break;
 	default:
-		printf("UNKNOWN(%u)", addr->type);
+		snprintf(buf, len, "UNKNOWN(%u)", addr->type);
 		break;
 	}
+
+	return buf;
+}
+
+/**
+ * Display a network address
+ * @param addr the IP address to display
+ *
+ * Print the IP address and mask, specified in @addr, to STDIO.
+ *
+ */
+void nlctl_addr_print(const struct nlbl_netaddr *addr)
+{
+	char buf[NLCTL_ADDR_LEN];
+
+	printf("%s", nlctl_addr_fmt(addr, buf, sizeof(buf)));
 }
 
 /**
@@ -233,6 +381,66 @@ static int _nlctl_num_parse(char *str, uint32_t *num)
 	return 0;
 }
 
+/**
+ * Parse a dotted quad IPv4 address
+ * @param str the IPv4 address string
+ * @param addr the IPv4 address
+ *
+ * Parse the IPv4 address in @str in a single pass, accepting the same strict
+ * dotted quad form as inet_pton(), without the locale and copying overhead of
+ * the C library.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _nlctl_addr4_parse(const char *str, struct in_addr *addr)
+{
+	uint32_t val = 0;
+	uint32_t octet;
+	unsigned int iter;
+	unsigned int digits;
+
+	for (iter = 0; iter < 4; iter++) {
+		if (iter > 0 && *str++ != '.')
+			return -EINVAL;
+		octet = 0;
+		for (digits = 0; str[digits] >= '0' && str[digits] <= '9';
+		     digits++) {
+			/* no leading zeros, like inet_pton() */
+			if (digits > 0 && octet == 0)
+				return -EINVAL;
+			octet = octet * 10 + (str[digits] - '0');
+			if (octet > 255)
+				return -EINVAL;
+		}
+		if (digits == 0)
+			return -EINVAL;
+		str += digits;
+		val = (val << 8) | octet;
+	}
+	if (*str != '\0')
+		return -EINVAL;
+
+	addr->s_addr = htonl(val);
+	return 0;
+}
+
+/**
+ * Build a network mask
+ * @param bits the prefix length
+ * @param mask the mask words
+ * @param words the number of 32 bit words in @mask
+ *
+ * Set @mask, in network byte order, to a mask of the first @bits bits.
+ *
+ */
+static void _nlctl_mask_build(uint32_t bits, uint32_t *mask, unsigned int words)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < words; iter++, bits -= (bits > 32 ? 32 : bits))
+		mask[iter] = (bits >= 32 ? 0xffffffff :
+			      (bits == 0 ? 0 : htonl(~(0xffffffff >> bits))));
+}
+
 /**
  * Parse a network address/mask pair
  * @param addr_str the IP address/mask in string format
@@ -244,64 +452,187 @@ static int _nlctl_num_parse(char *str, uint32_t *num)
  */
 int nlctl_addr_parse(char *addr_str, struct nlbl_netaddr *addr)
 {
-	int rc;
+	uint32_t bits;
+	uint32_t bits_max;
 	char *mask;
-	uint32_t iter_a;
-	uint32_t iter_b;
 
 	/* sanity checks */
 	if (addr_str == NULL || addr_str[0] == '\0')
 		return -EINVAL;
 
 	/* separate the address mask */
-	mask = strstr(addr_str, "/");
+	mask = strchr(addr_str, '/');
 	if (mask != NULL) {
 		mask[0] = '\0';
 		mask++;
 	}
 
-	/* ipv4 */
-	rc = inet_pton(AF_INET, addr_str, &addr->addr.v4);
-	if (rc > 0) {
+	/* ipv4 is by far the most common, try the fast parser first */
+	if (_nlctl_addr4_parse(addr_str, &addr->addr.v4) == 0 ||
+	    inet_pton(AF_INET, addr_str, &addr->addr.v4) > 0) {
 		addr->type = AF_INET;
-		if (mask != NULL) {
-			rc = _nlctl_num_parse(mask, &iter_a);
-			if (rc < 0 || iter_a > 32)
-				return -EINVAL;
-		} else
-			iter_a = 32;
-		for (; iter_a > 0; iter_a--) {
-			addr->mask.v4.s_addr >>= 1;
-			addr->mask.v4.s_addr |= 0x80000000;
+		bits_max = 32;
+	} else if (inet_pton(AF_INET6, addr_str, &addr->addr.v6) > 0) {
+		addr->type = AF_INET6;
+		bits_max = 128;
+	} else
+		return -EINVAL;
+
+	if (mask != NULL) {
+		if (mask[0] == '\0' ||
+		    _nlctl_num_parse(mask, &bits) < 0 || bits > bits_max)
+			return -EINVAL;
+	} else
+		bits = bits_max;
+	if (addr->type == AF_INET)
+		_nlctl_mask_build(bits, &addr->mask.v4.s_addr, 1);
+	else
+		_nlctl_mask_build(bits, addr->mask.v6.s6_addr32, 4);
+
+	return 0;
+}
+
+/**
+ * Find a module's entry point
+ * @param name the module name
+ *
+ * Return the entry point for the module @name, or NULL if the module is
+ * unknown.
+ *
+ */
+static main_function_t *nlctl_module_find(const char *name)
+{
+	if (!strcmp(name, "mgmt"))
+		return mgmt_main;
+	else if (!strcmp(name, "map"))
+		return map_main;
+	else if (!strcmp(name, "unlbl"))
+		return unlbl_main;
+	else if (!strcmp(name, "cipsov4"))
+		return cipsov4_main;
+	else if (!strcmp(name, "apply"))
+		return apply_main;
+	else if (!strcmp(name, "reset"))
+		return reset_main;
+	else if (!strcmp(name, "save"))
+		return save_main;
+
+	return NULL;
+}
+
+/**
+ * Walk the commands in a file
+ * @param file the command file, or "-" for stdin
+ * @param cb the per-command callback
+ * @param arg the callback argument
+ *
+ * Split each line in @file into a module name followed by the module's
+ * commands and pass them to @cb, using the same syntax as the
+ * /etc/netlabel.rules file: blank lines and lines starting with '#' are
+ * skipped.  The arguments passed to @cb are only valid until it returns.
+ * Failed commands are reported along with their line number and, unless the
+ * stop-on-error flag is set, processing continues with the next line.  Returns
+ * zero if every command succeeded, negative values on failure.
+ *
+ */
+int nlctl_file_walk(const char *file, nlctl_cmd_cb *cb, void *arg)
+{
+	int rc = 0;
+	int rc_walk = 0;
+	FILE *fp;
+	const char *file_name;
+	char *line = NULL;
+	size_t line_len = 0;
+	unsigned int line_num = 0;
+	char **args = NULL;
+	char **args_new;
+	int args_max = 0;
+	int args_cnt;
+	char *tok;
+	char *tok_save;
+
+	/* open the command file */
+	if (!strcmp(file, "-")) {
+		fp = stdin;
+		file_name = "<stdin>";
+	} else {
+		fp = fopen(file, "r");
+		if (fp == NULL) {
+			rc = -errno;
+			fprintf(stderr,
+				MSG_ERR("unable to open '%s', %s\n"),
+				file, nlctl_strerror(-rc));
+			return rc;
 		}
-		addr->mask.v4.s_addr = htonl(addr->mask.v4.s_addr);
-		return 0;
+		file_name = file;
 	}
 
-	/* ipv6 */
-	rc = inet_pton(AF_INET6, addr_str, &addr->addr.v6);
-	if (rc > 0) {
-		addr->type = AF_INET6;
-		if (mask != NULL) {
-			rc = _nlctl_num_parse(mask, &iter_a);
-			if (rc < 0 || iter_a > 128)
-				return -EINVAL;
-		} else
-			iter_a = 128;
-		for (iter_b = 0; iter_a > 0 && iter_b < 4; iter_b++) {
-			for (; iter_a > 0 &&
-			     addr->mask.v6.s6_addr32[iter_b] < 0xffffffff;
-			     iter_a--) {
-				addr->mask.v6.s6_addr32[iter_b] >>= 1;
-				addr->mask.v6.s6_addr32[iter_b] |= 0x80000000;
+	while (getline(&line, &line_len, fp) >= 0) {
+		line_num++;
+
+		/* split the line into arguments */
+		args_cnt = 0;
+		tok = strtok_r(line, " \t\r\n", &tok_save);
+		if (tok != NULL && tok[0] == '#')
+			tok = NULL;
+		while (tok != NULL) {
+			if (args_cnt + 1 >= args_max) {
+				args_new = realloc(args, (args_max + 8) *
+						   sizeof(*args));
+				if (args_new == NULL) {
+					rc_walk = -ENOMEM;
+					goto walk_return;
+				}
+				args = args_new;
+				args_max += 8;
 			}
-			addr->mask.v6.s6_addr32[iter_b] =
-				htonl(addr->mask.v6.s6_addr32[iter_b]);
+			args[args_cnt++] = tok;
+			tok = strtok_r(NULL, " \t\r\n", &tok_save);
+		}
+		if (args_cnt == 0)
+			continue;
+		args[args_cnt] = NULL;
+
+		/* run the command */
+		if (nlctl_module_find(args[0]) != NULL) {
+			rc = cb(args_cnt, args, arg);
+			if (rc < 0)
+				fprintf(stderr, MSG_ERR("%s:%u: %s\n"),
+					file_name, line_num,
+					nlctl_strerror(-rc));
+		} else {
+			rc = -EINVAL;
+			fprintf(stderr, MSG_ERR("%s:%u: unknown module '%s'\n"),
+				file_name, line_num, args[0]);
+		}
+		if (rc < 0) {
+			rc_walk = rc;
+			if (opt_stop)
+				break;
 		}
-		return 0;
 	}
 
-	return -EINVAL;
+walk_return:
+	if (fp != stdin)
+		fclose(fp);
+	free(line);
+	free(args);
+	return rc_walk;
+}
+
+/**
+ * Run a command from a command file
+ * @param argc the number of arguments
+ * @param argv the module name followed by the module's commands
+ * @param arg unused
+ *
+ * Pass the command in @argv to its module.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int nlctl_batch_cmd(int argc, char *argv[], void *arg)
+{
+	return nlctl_module_find(argv[0])(argc - 1, argv + 1);
 }
 
 /*
@@ -325,7 +656,7 @@ int main(int argc, char *argv[])
 
 	/* get the command line arguments and module information */
 	do {
-		arg_iter = getopt(argc, argv, "hvt:pV");
+		arg_iter = getopt(argc, argv, "hvt:pVf:sST:w:r:D:");
 		switch (arg_iter) {
 		case 'h':
 			/* help */
@@ -353,15 +684,79 @@ int main(int argc, char *argv[])
 			nlctl_ver_print(stdout);
 			return RET_OK;
 			break;
+		case 'f':
+			/* command file */
+			opt_file = optarg;
+			break;
+		case 's':
+			/* stop on error */
+			opt_stop = 1;
+			break;
+		case 'S':
+			/* statistics */
+			opt_stats = 1;
+			break;
+		case 'T':
+			/* transport */
+			if (strcmp(optarg, "netlink") == 0)
+				opt_transport = NLBL_TRANSPORT_NETLINK;
+			else if (strcmp(optarg, "fake") == 0)
+				opt_transport = NLBL_TRANSPORT_FAKE;
+			else if (strcmp(optarg, "daemon") == 0)
+				opt_transport = NLBL_TRANSPORT_DAEMON;
+			else {
+				nlctl_usage_print(stderr);
+				return RET_USAGE;
+			}
+			break;
+		case 'w':
+			/* capture */
+			opt_capture = optarg;
+			opt_ordered = 1;
+			break;
+		case 'r':
+			/* replay */
+			opt_replay = optarg;
+			opt_ordered = 1;
+			break;
+		case 'D':
+			/* daemon socket */
+			opt_daemon = optarg;
+			break;
 		}
 	} while (arg_iter > 0);
 	module_name = argv[optind];
-	if (!module_name) {
+	if ((opt_file == NULL && !module_name) ||
+	    (opt_file != NULL && module_name)) {
 		nlctl_usage_print(stderr);
 		return RET_USAGE;
 	}
 
 	/* perform any setup we have to do */
+	if (opt_replay != NULL)
+		rc = nlbl_comm_replay(opt_replay);
+	else if (opt_daemon != NULL)
+		rc = nlbl_comm_daemon(opt_daemon);
+	else
+		rc = nlbl_comm_transport(opt_transport);
+	if (rc < 0) {
+		fprintf(stderr,
+			MSG_ERR("failed to select the NetLabel transport\n"));
+		goto exit;
+	}
+	/* the family ID cache is only an optimization, ignore any failure */
+	nlbl_comm_fid_cache(NULL);
+	if (opt_stats)
+		nlbl_stats_enable(1);
+	if (opt_capture != NULL) {
+		rc = nlbl_comm_capture(opt_capture);
+		if (rc < 0) {
+			fprintf(stderr,
+				MSG_ERR("failed to start the capture: %s\n"),
+				nlctl_strerror(-rc));
+			goto exit;
+		}
+	}
 	rc = nlbl_init();
 	if (rc < 0) {
 		fprintf(stderr,
@@ -370,16 +765,16 @@ int main(int argc, char *argv[])
 	}
 	nlbl_comm_timeout(opt_timeout);
 
+	/* run the command file */
+	if (opt_file != NULL) {
+		rc = nlctl_file_walk(opt_file, nlctl_batch_cmd, NULL);
+		rc = (rc < 0 ? RET_ERR : RET_OK);
+		goto exit;
+	}
+
 	/* transfer control to the module */
-	if (!strcmp(module_name, "mgmt")) {
-		module_main = mgmt_main;
-	} else if (!strcmp(module_name, "map")) {
-		module_main = map_main;
-	} else if (!strcmp(module_name, "unlbl")) {
-		module_main = unlbl_main;
-	} else if (!strcmp(module_name, "cipsov4")) {
-		module_main = cipsov4_main;
-	} else {
+	module_main = nlctl_module_find(module_name);
+	if (module_main == NULL) {
 		fprintf(stderr,
 			MSG_ERR("unknown or missing module '%s'\n"),
 			module_name);
@@ -394,5 +789,12 @@ int main(int argc, char *argv[])
 		rc = RET_OK;
 exit:
 	nlbl_exit();
+	if (opt_stats) {
+		fflush(stdout);
+		nlctl_stats_print(stderr);
+		nlbl_stats_enable(0);
+	}
+	if (opt_capture != NULL && nlbl_comm_capture(NULL) < 0)
+		rc = RET_ERR;
 	return rc;
 }
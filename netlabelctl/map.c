@@ -26,6 +26,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -34,63 +36,113 @@
 
 #include "netlabelctl.h"
 
+/* maximum number of threads used for bulk lookups */
+#define MAP_LOOKUP_THREADS_MAX	64
+
+/* minimum number of lines given to each bulk lookup thread */
+#define MAP_LOOKUP_THREAD_LINES	4096
+
+/* bulk lookup work, one per thread */
+struct map_lookup_job {
+	struct nlbl_mgmt_table *tbl;
+	char **lines;
+	size_t first;
+	size_t count;
+
+	char *out;
+	size_t out_len;
+	size_t out_size;
+
+	size_t err_cnt;
+	size_t err_line;
+	int rc;
+};
+
 /**
- * Add a domain mapping to NetLabel
+ * Parse the arguments of a domain mapping add command
  * @param argc the number of arguments
  * @param argv the argument list
+ * @param def_flag the default mapping flag
+ * @param domain the domain mapping
+ * @param addr the network address
  *
- * Add the specified domain mapping to the NetLabel system.  Returns zero on
- * success, negative values on failure.
+ * Parse the "map add" arguments in @argv into @def_flag, @domain and @addr;
+ * the domain string in @domain points into @argv.  If no address is given the
+ * type of @addr is left as zero.  Returns zero on success, negative values on
+ * failure.
  *
  */
-int map_add(int argc, char *argv[])
+int map_add_parse(int argc, char *argv[],
+		  uint8_t *def_flag,
+		  struct nlbl_dommap *domain, struct nlbl_netaddr *addr)
 {
 	uint32_t iter;
-	uint8_t def_flag = 0;
-	struct nlbl_dommap domain;
-	struct nlbl_netaddr addr;
 	char *domain_proto_extra = NULL;
 
 	/* sanity checks */
 	if (argc <= 0 || argv == NULL || argv[0] == NULL)
 		return -EINVAL;
 
-	memset(&domain, 0, sizeof(domain));
-	memset(&addr, 0, sizeof(addr));
+	*def_flag = 0;
+	memset(domain, 0, sizeof(*domain));
+	memset(addr, 0, sizeof(*addr));
 
 	/* parse the arguments */
 	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
 		if (strncmp(argv[iter], "domain:", 7) == 0) {
-			domain.domain = argv[iter] + 7;
+			domain->domain = argv[iter] + 7;
 		} else if (strncmp(argv[iter], "address:", 8) == 0) {
-			if (nlctl_addr_parse(argv[iter] + 8, &addr) != 0)
+			if (nlctl_addr_parse(argv[iter] + 8, addr) != 0)
 				return -EINVAL;
 		} else if (strncmp(argv[iter], "protocol:", 9) == 0) {
 			/* protocol specifics */
 			if (strncmp(argv[iter] + 9, "cipsov4", 7) == 0)
-				domain.proto_type = NETLBL_NLTYPE_CIPSOV4;
+				domain->proto_type = NETLBL_NLTYPE_CIPSOV4;
 			else if (strncmp(argv[iter] + 9, "unlbl", 5) == 0)
-				domain.proto_type = NETLBL_NLTYPE_UNLABELED;
+				domain->proto_type = NETLBL_NLTYPE_UNLABELED;
 			else
 				return -EINVAL;
 			domain_proto_extra = strstr(argv[iter] + 9, ",");
 			if (domain_proto_extra)
 				domain_proto_extra++;
 		} else if (strncmp(argv[iter], "default", 7) == 0) {
-			def_flag = 1;
+			*def_flag = 1;
 		} else
 			return -EINVAL;
 	}
 
 	/* handle the protocol "extra" field */
-	switch (domain.proto_type) {
+	switch (domain->proto_type) {
 	case NETLBL_NLTYPE_CIPSOV4:
 		if (domain_proto_extra == NULL)
 			return -EINVAL;
-		domain.proto.cv4_doi = atoi(domain_proto_extra);
+		domain->proto.cv4_doi = atoi(domain_proto_extra);
 		break;
 	}
 
+	return 0;
+}
+
+/**
+ * Add a domain mapping to NetLabel
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Add the specified domain mapping to the NetLabel system.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+int map_add(int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	struct nlbl_dommap domain;
+	struct nlbl_netaddr addr;
+
+	rc = map_add_parse(argc, argv, &def_flag, &domain, &addr);
+	if (rc < 0)
+		return rc;
+
 	/* add the mapping */
 	if (def_flag != 0)
 		return nlbl_mgmt_adddef(NULL, &domain, &addr);
@@ -99,35 +151,61 @@ int map_add(int argc, char *argv[])
 }
 
 /**
- * Delete a domain mapping from NetLabel
+ * Parse the arguments of a domain mapping delete command
  * @param argc the number of arguments
  * @param argv the argument list
+ * @param def_flag the default mapping flag
+ * @param domain the domain
  *
- * Description:
- * Remove the specified domain mapping from the NetLabel system.  Returns zero
- * on success, negative values on failure.
+ * Parse the "map del" arguments in @argv into @def_flag and @domain, the
+ * domain string points into @argv.  Returns zero on success, negative values
+ * on failure.
  *
  */
-int map_del(int argc, char *argv[])
+int map_del_parse(int argc, char *argv[], uint8_t *def_flag, char **domain)
 {
 	uint32_t iter;
-	uint32_t def_flag = 0;
-	char *domain = NULL;
 
 	/* sanity checks */
 	if (argc <= 0 || argv == NULL || argv[0] == NULL)
 		return -EINVAL;
 
+	*def_flag = 0;
+	*domain = NULL;
+
 	/* parse the arguments */
 	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
 		if (strncmp(argv[iter], "domain:", 7) == 0) {
-			domain = argv[iter] + 7;
+			*domain = argv[iter] + 7;
 		} else if (strncmp(argv[iter], "default", 7) == 0) {
-			def_flag = 1;
+			*def_flag = 1;
 		} else
 			return -EINVAL;
 	}
 
+	return 0;
+}
+
+/**
+ * Delete a domain mapping from NetLabel
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Description:
+ * Remove the specified domain mapping from the NetLabel system.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+int map_del(int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	char *domain;
+
+	rc = map_del_parse(argc, argv, &def_flag, &domain);
+	if (rc < 0)
+		return rc;
+
 	/* remove the mapping */
 	if (def_flag != 0)
 		return nlbl_mgmt_deldef(NULL);
@@ -137,34 +215,38 @@ int map_del(int argc, char *argv[])
 
 /**
  * Output the NetLabel domain mappings
- * @param mapping the domain mappings
- * @param count the number of domain mappings
+ * @param list the domain mappings
+ * @param def the default domain mapping, NULL if there is none
  *
  * Helper function to be called by map_list().
  *
  */
-static void map_list_print(struct nlbl_dommap *mapping, size_t count)
+static void map_list_print(struct nlbl_dommap_list *list,
+			   struct nlbl_dommap *def)
 {
 	uint32_t iter_a;
+	size_t count = list->count + (def != NULL ? 1 : 0);
+	struct nlbl_dommap *map;
 	struct nlbl_dommap_addr *iter_b;
 
 	for (iter_a = 0; iter_a < count; iter_a++) {
+		map = (iter_a < list->count ? &list->domains[iter_a] : def);
 		/* domain string */
 		printf("domain:");
-		if (mapping[iter_a].domain != NULL)
-			printf("\"%s\",", mapping[iter_a].domain);
+		if (map->domain != NULL)
+			printf("\"%s\",", map->domain);
 		else
 			printf("DEFAULT,");
 		/* protocol */
-		switch (mapping[iter_a].proto_type) {
+		switch (map->proto_type) {
 		case NETLBL_NLTYPE_UNLABELED:
 			printf("UNLABELED");
 			break;
 		case NETLBL_NLTYPE_CIPSOV4:
-			printf("CIPSOv4,%u", mapping[iter_a].proto.cv4_doi);
+			printf("CIPSOv4,%u", map->proto.cv4_doi);
 			break;
 		case NETLBL_NLTYPE_ADDRSELECT:
-			iter_b = mapping[iter_a].proto.addrsel;
+			iter_b = map->proto.addrsel;
 			while (iter_b) {
 				printf("address:");
 				nlctl_addr_print(&iter_b->addr);
@@ -188,7 +270,7 @@ static void map_list_print(struct nlbl_dommap *mapping, size_t count)
 			}
 			break;
 		default:
-			printf("UNKNOWN(%u)", mapping[iter_a].proto_type);
+			printf("UNKNOWN(%u)", map->proto_type);
 			break;
 		}
 		if (iter_a + 1 < count)
@@ -199,36 +281,40 @@ static void map_list_print(struct nlbl_dommap *mapping, size_t count)
 
 /**
  * Output the NetLabel domain mappings in human readable format
- * @param mapping the domain mappings
- * @param count the number of domain mappings
+ * @param list the domain mappings
+ * @param def the default domain mapping, NULL if there is none
  *
  * Helper function to be called by map_list().
  *
  */
-static void map_list_print_pretty(struct nlbl_dommap *mapping, size_t count)
+static void map_list_print_pretty(struct nlbl_dommap_list *list,
+				  struct nlbl_dommap *def)
 {
 	uint32_t iter_a;
+	size_t count = list->count + (def != NULL ? 1 : 0);
+	struct nlbl_dommap *map;
 	struct nlbl_dommap_addr *iter_b;
 
 	printf("Configured NetLabel domain mappings (%zu)\n", count);
 	for (iter_a = 0; iter_a < count; iter_a++) {
+		map = (iter_a < list->count ? &list->domains[iter_a] : def);
 		/* domain string */
 		printf(" domain: ");
-		if (mapping[iter_a].domain != NULL)
-			printf("\"%s\"\n", mapping[iter_a].domain);
+		if (map->domain != NULL)
+			printf("\"%s\"\n", map->domain);
 		else
 			printf("DEFAULT\n");
 		/* protocol */
-		switch (mapping[iter_a].proto_type) {
+		switch (map->proto_type) {
 		case NETLBL_NLTYPE_UNLABELED:
 			printf("   protocol: UNLABELED\n");
 			break;
 		case NETLBL_NLTYPE_CIPSOV4:
 			printf("   protocol: CIPSOv4, DOI = %u\n",
-			       mapping[iter_a].proto.cv4_doi);
+			       map->proto.cv4_doi);
 			break;
 		case NETLBL_NLTYPE_ADDRSELECT:
-			iter_b = mapping[iter_a].proto.addrsel;
+			iter_b = map->proto.addrsel;
 			while (iter_b) {
 				printf("   address: ");
 				nlctl_addr_print(&iter_b->addr);
@@ -251,7 +337,7 @@ static void map_list_print_pretty(struct nlbl_dommap *mapping, size_t count)
 			}
 			break;
 		default:
-			printf("UNKNOWN(%u)\n", mapping[iter_a].proto_type);
+			printf("UNKNOWN(%u)\n", map->proto_type);
 			break;
 		}
 	}
@@ -269,43 +355,523 @@ static void map_list_print_pretty(struct nlbl_dommap *mapping, size_t count)
 int map_list(int argc, char *argv[])
 {
 	int rc;
-	struct nlbl_dommap *mapping, *mapping_new;
-	size_t count;
-	uint32_t iter;
+	struct nlbl_dommap_list *list;
+	struct nlbl_dommap def;
+	struct nlbl_dommap_addr *addr;
+	uint8_t def_flag = 0;
 
 	/* get the list of mappings */
-	rc = nlbl_mgmt_listall(NULL, &mapping);
+	rc = nlbl_mgmt_listall_list(NULL, &list);
 	if (rc < 0)
 		return rc;
-	count = rc;
 
 	/* get the default mapping */
-	mapping_new = realloc(mapping, sizeof(*mapping) * (count + 1));
-	if (mapping_new == NULL)
-		goto list_return;
-	mapping = mapping_new;
-	memset(&mapping[count], 0, sizeof(*mapping));
-	rc = nlbl_mgmt_listdef(NULL, &mapping[count]);
+	memset(&def, 0, sizeof(def));
+	rc = nlbl_mgmt_listdef(NULL, &def);
 	if (rc < 0 && rc != -ENOENT)
 		goto list_return;
 	else if (rc == 0)
-		count += 1;
+		def_flag = 1;
 	else
 		rc = 0;
 
 	/* display the results */
 	if (opt_pretty != 0)
-		map_list_print_pretty(mapping, count);
+		map_list_print_pretty(list, (def_flag ? &def : NULL));
 	else
-		map_list_print(mapping, count);
+		map_list_print(list, (def_flag ? &def : NULL));
 
 list_return:
-	if (mapping != NULL) {
-		for (iter = 0; iter < count; iter++)
-			if (mapping[iter].domain != NULL)
-				free(mapping[iter].domain);
-		free(mapping);
+	nlbl_dommap_list_free(list);
+	while (def.proto_type == NETLBL_NLTYPE_ADDRSELECT &&
+	       (addr = def.proto.addrsel) != NULL) {
+		def.proto.addrsel = addr->next;
+		free(addr);
+	}
+	return rc;
+}
+
+/**
+ * Format a mapping protocol
+ * @param sel the protocol configuration
+ * @param buf the output buffer
+ * @param len the size of @buf
+ *
+ * Write the protocol in @sel to @buf in the same format as map_list().
+ * Returns @buf.
+ *
+ */
+static char *map_lookup_fmt(const struct nlbl_dommap_addr *sel,
+			    char *buf, size_t len)
+{
+	switch (sel->proto_type) {
+	case NETLBL_NLTYPE_UNLABELED:
+		snprintf(buf, len, "UNLABELED");
+		break;
+	case NETLBL_NLTYPE_CIPSOV4:
+		snprintf(buf, len, "CIPSOv4,%u", sel->proto.cv4_doi);
+		break;
+	default:
+		snprintf(buf, len, "UNKNOWN(%u)", sel->proto_type);
+		break;
+	}
+
+	return buf;
+}
+
+/**
+ * Add a line to a bulk lookup job's output
+ * @param job the bulk lookup job
+ * @param domain the domain
+ * @param addr the address
+ * @param proto the protocol
+ *
+ * Append a "<domain> <addr> <proto>" line to the output buffer of @job.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int map_lookup_out(struct map_lookup_job *job,
+			  const char *domain, const char *addr,
+			  const char *proto)
+{
+	size_t len;
+	size_t size_new;
+	char *out_new;
+
+	len = strlen(domain) + strlen(addr) + strlen(proto) + 3;
+	if (job->out_len + len + 1 > job->out_size) {
+		size_new = (job->out_size > 0 ? job->out_size * 2 : 65536);
+		while (job->out_len + len + 1 > size_new)
+			size_new *= 2;
+		out_new = realloc(job->out, size_new);
+		if (out_new == NULL)
+			return -ENOMEM;
+		job->out = out_new;
+		job->out_size = size_new;
 	}
+	job->out_len += sprintf(job->out + job->out_len, "%s %s %s\n",
+				domain, addr, proto);
+
+	return 0;
+}
+
+/**
+ * Bulk lookup thread
+ * @param arg the bulk lookup job
+ *
+ * Resolve each "<domain> <addr>" line of the job, writing the results to the
+ * job's output buffer.  Returns @arg.
+ *
+ */
+static void *map_lookup_worker(void *arg)
+{
+	struct map_lookup_job *job = arg;
+	size_t iter;
+	char *tok[3];
+	char *tok_save;
+	char addr_str[NLCTL_ADDR_LEN];
+	char proto[32];
+	struct nlbl_netaddr addr;
+	struct nlbl_dommap_addr *sel;
+
+	for (iter = job->first; iter < job->first + job->count; iter++) {
+		tok[0] = strtok_r(job->lines[iter], " \t\r", &tok_save);
+		if (tok[0] == NULL || tok[0][0] == '#')
+			continue;
+		tok[1] = strtok_r(NULL, " \t\r", &tok_save);
+		tok[2] = strtok_r(NULL, " \t\r", &tok_save);
+
+		memset(&addr, 0, sizeof(addr));
+		if (tok[1] == NULL || tok[2] != NULL ||
+		    strlen(tok[1]) >= sizeof(addr_str) ||
+		    nlctl_addr_parse(strcpy(addr_str, tok[1]), &addr) < 0) {
+			if (job->err_cnt++ == 0)
+				job->err_line = iter + 1;
+			continue;
+		}
+
+		sel = nlbl_mgmt_table_lookup(job->tbl,
+					     (strcmp(tok[0], "default") ?
+					      tok[0] : NULL),
+					     &addr, NULL);
+		job->rc = map_lookup_out(job, tok[0], tok[1],
+					 (sel != NULL ?
+					  map_lookup_fmt(sel,
+							 proto, sizeof(proto)) :
+					  "-"));
+		if (job->rc < 0)
+			break;
+	}
+
+	return job;
+}
+
+/**
+ * Read a file into memory
+ * @param file the file, "-" for stdin
+ * @param len the length of the file
+ *
+ * Returns a NUL terminated buffer holding the contents of @file which the
+ * caller must free, or NULL on failure with errno set.
+ *
+ */
+static char *map_lookup_read(const char *file, size_t *len)
+{
+	FILE *fp;
+	char *buf = NULL;
+	char *buf_new;
+	size_t size = 0;
+	size_t rd;
+	int err = 0;
+
+	fp = (strcmp(file, "-") ? fopen(file, "r") : stdin);
+	if (fp == NULL)
+		return NULL;
+
+	*len = 0;
+	do {
+		if (*len + 1 >= size) {
+			size = (size > 0 ? size * 2 : 1048576);
+			buf_new = realloc(buf, size);
+			if (buf_new == NULL) {
+				err = ENOMEM;
+				break;
+			}
+			buf = buf_new;
+		}
+		rd = fread(buf + *len, 1, size - *len - 1, fp);
+		*len += rd;
+	} while (rd > 0);
+	if (err == 0 && ferror(fp))
+		err = EIO;
+
+	if (fp != stdin)
+		fclose(fp);
+	if (err != 0) {
+		free(buf);
+		errno = err;
+		return NULL;
+	}
+	buf[*len] = '\0';
+	return buf;
+}
+
+/**
+ * Look up the mappings for a file of domains and addresses
+ * @param tbl the domain mapping table
+ * @param file the lookup file, "-" for stdin
+ * @param threads the number of threads, zero for one per CPU
+ *
+ * Read one "<domain> <addr>" entry per line from @file, the domain "default"
+ * meaning the default mapping, and print each entry followed by the protocol
+ * the kernel would use, or "-" if there is none.  The lines are split between
+ * @threads threads and the results printed in the order of the file.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int map_lookup_file(struct nlbl_mgmt_table *tbl,
+			   const char *file, unsigned int threads)
+{
+	int rc = 0;
+	char *buf;
+	size_t buf_len;
+	char **lines = NULL;
+	size_t line_cnt = 0;
+	size_t iter;
+	char *pos;
+	struct map_lookup_job *jobs = NULL;
+	pthread_t *tids = NULL;
+	unsigned int started = 0;
+	unsigned int job;
+	size_t per_job;
+
+	buf = map_lookup_read(file, &buf_len);
+	if (buf == NULL)
+		return -errno;
+
+	/* split the file into lines */
+	for (iter = 0; iter < buf_len; iter++)
+		if (buf[iter] == '\n')
+			line_cnt++;
+	if (buf_len > 0 && buf[buf_len - 1] != '\n')
+		line_cnt++;
+	lines = malloc((line_cnt > 0 ? line_cnt : 1) * sizeof(*lines));
+	if (lines == NULL) {
+		rc = -ENOMEM;
+		goto file_return;
+	}
+	for (iter = 0, pos = buf; iter < line_cnt; iter++) {
+		lines[iter] = pos;
+		pos = strchr(pos, '\n');
+		if (pos == NULL)
+			break;
+		*pos++ = '\0';
+	}
+
+	/* split the lines between the threads */
+	if (threads == 0) {
+		rc = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (rc > 0 ? rc : 1);
+		rc = 0;
+	}
+	if (threads > MAP_LOOKUP_THREADS_MAX)
+		threads = MAP_LOOKUP_THREADS_MAX;
+	if (threads > line_cnt / MAP_LOOKUP_THREAD_LINES)
+		threads = line_cnt / MAP_LOOKUP_THREAD_LINES;
+	if (threads == 0)
+		threads = 1;
+	jobs = calloc(threads, sizeof(*jobs));
+	tids = calloc(threads, sizeof(*tids));
+	if (jobs == NULL || tids == NULL) {
+		rc = -ENOMEM;
+		goto file_return;
+	}
+	per_job = line_cnt / threads;
+	for (job = 0; job < threads; job++) {
+		jobs[job].tbl = tbl;
+		jobs[job].lines = lines;
+		jobs[job].first = job * per_job;
+		jobs[job].count = (job + 1 < threads ?
+				   per_job : line_cnt - job * per_job);
+	}
+
+	/* do the lookups, the first job runs in this thread */
+	for (job = 1; job < threads; job++) {
+		if (pthread_create(&tids[job], NULL,
+				   map_lookup_worker, &jobs[job]) != 0)
+			break;
+		started++;
+	}
+	map_lookup_worker(&jobs[0]);
+	for (job = 1; job <= started; job++)
+		pthread_join(tids[job], NULL);
+	for (job = started + 1; job < threads; job++)
+		map_lookup_worker(&jobs[job]);
+
+	/* print the results in order */
+	for (job = 0; job < threads; job++) {
+		if (jobs[job].rc < 0 && rc == 0)
+			rc = jobs[job].rc;
+		if (jobs[job].err_cnt > 0) {
+			fprintf(stderr,
+				MSG_ERR("%s:%zu: %s (%zu line(s))\n"),
+				(strcmp(file, "-") ? file : "<stdin>"),
+				jobs[job].err_line, nlctl_strerror(EINVAL),
+				jobs[job].err_cnt);
+			if (rc == 0)
+				rc = -EINVAL;
+		}
+		if (jobs[job].out_len > 0)
+			fwrite(jobs[job].out, 1, jobs[job].out_len, stdout);
+	}
+
+file_return:
+	if (jobs != NULL)
+		for (job = 0; job < threads; job++)
+			free(jobs[job].out);
+	free(jobs);
+	free(tids);
+	free(lines);
+	free(buf);
+	return rc;
+}
+
+/**
+ * Look up the mapping for outbound traffic
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Find the labeling protocol the kernel would use for traffic from the given
+ * domain to the given address, or for each of the domain and address pairs in
+ * a file.  Returns zero on success, negative values on failure.
+ *
+ */
+static int map_lookup(int argc, char *argv[])
+{
+	int rc;
+	uint32_t iter;
+	uint32_t threads = 0;
+	uint8_t def_flag;
+	char *domain = NULL;
+	char *addr_str = NULL;
+	char *file = NULL;
+	char proto[32];
+	struct nlbl_netaddr addr;
+	struct nlbl_mgmt_table *tbl;
+	struct nlbl_dommap_addr *sel;
+
+	/* parse the arguments */
+	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
+		if (strncmp(argv[iter], "domain:", 7) == 0)
+			domain = argv[iter] + 7;
+		else if (strcmp(argv[iter], "default") == 0)
+			domain = NULL;
+		else if (strncmp(argv[iter], "address:", 8) == 0)
+			addr_str = argv[iter] + 8;
+		else if (strncmp(argv[iter], "file:", 5) == 0)
+			file = argv[iter] + 5;
+		else if (strncmp(argv[iter], "threads:", 8) == 0)
+			threads = atoi(argv[iter] + 8);
+		else
+			return -EINVAL;
+	}
+	if ((addr_str == NULL) == (file == NULL))
+		return -EINVAL;
+	memset(&addr, 0, sizeof(addr));
+	if (addr_str != NULL && nlctl_addr_parse(addr_str, &addr) != 0)
+		return -EINVAL;
+
+	/* load the domain mappings and do the lookup */
+	tbl = nlbl_mgmt_table_new();
+	if (tbl == NULL)
+		return -ENOMEM;
+	rc = nlbl_mgmt_table_load(NULL, tbl);
+	if (rc < 0)
+		goto lookup_return;
+	if (file != NULL) {
+		rc = map_lookup_file(tbl, file, threads);
+		goto lookup_return;
+	}
+	sel = nlbl_mgmt_table_lookup(tbl, domain, &addr, &def_flag);
+	if (sel == NULL) {
+		rc = -ENOENT;
+		goto lookup_return;
+	}
+	map_lookup_fmt(sel, proto, sizeof(proto));
+	if (opt_pretty != 0) {
+		if (def_flag)
+			printf(" domain: DEFAULT\n");
+		else
+			printf(" domain: \"%s\"\n", domain);
+		if (sel->addr.type != 0) {
+			printf("   address: ");
+			nlctl_addr_print(&sel->addr);
+			printf("\n");
+		}
+		if (sel->proto_type == NETLBL_NLTYPE_CIPSOV4)
+			printf("   protocol: CIPSOv4, DOI = %u\n",
+			       sel->proto.cv4_doi);
+		else
+			printf("   protocol: %s\n", proto);
+	} else {
+		if (def_flag)
+			printf("domain:DEFAULT,");
+		else
+			printf("domain:\"%s\",", domain);
+		if (sel->addr.type != 0) {
+			printf("address:");
+			nlctl_addr_print(&sel->addr);
+			printf(",protocol:");
+		}
+		printf("%s\n", proto);
+	}
+
+lookup_return:
+	nlbl_mgmt_table_free(tbl);
+	return rc;
+}
+
+/* address selector optimizer entries */
+static const struct nlctl_opt_type map_opt_type = {
+	.cmd = "map add",
+	.name = "domain",
+	.value = "protocol",
+	.desc = "address selectors",
+};
+
+/**
+ * Record a command from the domain mapping file
+ * @param argc the number of arguments
+ * @param argv the argument list
+ * @param arg the optimizer
+ *
+ * nlctl_file_walk() callback for map_optimize().  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int map_optimize_cmd(int argc, char *argv[], void *arg)
+{
+	int rc;
+	uint8_t def_flag;
+	struct nlbl_dommap domain;
+	struct nlbl_netaddr addr;
+	char proto[32];
+	struct nlctl_opt *opt = arg;
+
+	if (argc < 2 || strcmp(argv[0], "map") != 0)
+		return nlctl_opt_line(opt, argc, argv);
+	/* a delete after the first selector may remove selectors which are
+	 * merged away */
+	if (strcmp(argv[1], "del") == 0 && opt->lines_add != (size_t)-1)
+		return -EINVAL;
+	if (strcmp(argv[1], "add") != 0)
+		return nlctl_opt_line(opt, argc, argv);
+
+	rc = map_add_parse(argc - 2, argv + 2, &def_flag, &domain, &addr);
+	if (rc < 0)
+		return rc;
+	if (def_flag == 0 && domain.domain == NULL)
+		return -EINVAL;
+	/* mappings without an address selector are left alone */
+	if (addr.type == 0)
+		return nlctl_opt_line(opt, argc, argv);
+
+	switch (domain.proto_type) {
+	case NETLBL_NLTYPE_UNLABELED:
+		snprintf(proto, sizeof(proto), "unlbl");
+		break;
+	case NETLBL_NLTYPE_CIPSOV4:
+		/* the kernel refuses CIPSOv4 selectors for IPv6 addresses */
+		if (addr.type != AF_INET)
+			return -EINVAL;
+		snprintf(proto, sizeof(proto), "cipsov4,%u",
+			 domain.proto.cv4_doi);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return nlctl_opt_add(opt, (def_flag ? NULL : domain.domain),
+			     &addr, proto);
+}
+
+/**
+ * Optimize a file of domain mappings
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Read the commands in a command or rules file and write them to stdout with
+ * the "map add" commands which add address selectors replaced by the smallest
+ * set of selectors this tool can find which map every address the same way,
+ * see nlctl_opt_run().  Returns zero on success, negative values on failure.
+ *
+ */
+static int map_optimize(int argc, char *argv[])
+{
+	int rc;
+	uint32_t iter;
+	unsigned int verify = 0;
+	const char *file = "-";
+	struct nlctl_opt opt;
+
+	/* parse the arguments */
+	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
+		if (strncmp(argv[iter], "file:", 5) == 0)
+			file = argv[iter] + 5;
+		else if (strcmp(argv[iter], "verify") == 0)
+			verify = 1;
+		else
+			return -EINVAL;
+	}
+
+	rc = nlctl_opt_init(&opt, &map_opt_type);
+	if (rc < 0)
+		return rc;
+	rc = nlctl_file_walk(file, map_optimize_cmd, &opt);
+	if (rc == 0)
+		rc = nlctl_opt_run(&opt, verify);
+	nlctl_opt_free(&opt);
+
 	return rc;
 }
 
@@ -336,6 +902,12 @@ int map_main(int argc, char *argv[])
 	} else if (strcmp(argv[0], "list") == 0) {
 		/* list the domain mappings */
 		rc = map_list(argc - 1, argv + 1);
+	} else if (strcmp(argv[0], "lookup") == 0) {
+		/* look up a domain mapping */
+		rc = map_lookup(argc - 1, argv + 1);
+	} else if (strcmp(argv[0], "optimize") == 0) {
+		/* optimize the address selectors in a file */
+		rc = map_optimize(argc - 1, argv + 1);
 	} else {
 		/* unknown request */
 		rc = -EINVAL;
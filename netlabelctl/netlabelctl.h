@@ -32,6 +32,8 @@ extern char *nlctl_name;
 extern uint32_t opt_verbose;
 extern uint32_t opt_timeout;
 extern uint32_t opt_pretty;
+extern uint32_t opt_stop;
+extern uint32_t opt_ordered;
 
 /* warning/error reporting */
 #define MSG_WARN(_x) "%s: warning, "_x,nlctl_name
@@ -45,15 +47,96 @@ extern uint32_t opt_pretty;
 #define MSG(_x) (opt_pretty?_x:"")
 #define MSG_V(_x) (opt_verbose?_x"")
 
+/* error reporting helper functions */
+char *nlctl_strerror(int rc);
+
 /* network address helper functions */
+#define NLCTL_ADDR_LEN 96
+char *nlctl_addr_fmt(const struct nlbl_netaddr *addr, char *buf, size_t len);
 void nlctl_addr_print(const struct nlbl_netaddr *addr);
 int nlctl_addr_parse(char *addr_str, struct nlbl_netaddr *addr);
 
+/* command file helper functions */
+typedef int nlctl_cmd_cb(int argc, char *argv[], void *arg);
+int nlctl_file_walk(const char *file, nlctl_cmd_cb *cb, void *arg);
+
+/* address prefix optimizer */
+struct nlctl_prefix {
+	uint32_t key[4];
+	uint32_t group;
+	uint32_t seq;
+	uint16_t family;
+	uint8_t len;
+	uint8_t dead;
+	const void *value;
+};
+int nlctl_prefix_set(const struct nlbl_netaddr *addr, struct nlctl_prefix *pfx);
+void nlctl_prefix_get(const struct nlctl_prefix *pfx,
+		      struct nlbl_netaddr *addr);
+void nlctl_prefix_sort(struct nlctl_prefix *pfx, size_t count);
+int nlctl_prefix_eq(const struct nlctl_prefix *a, const struct nlctl_prefix *b);
+size_t nlctl_prefix_optimize(struct nlctl_prefix *pfx, size_t count);
+int nlctl_prefix_verify(const struct nlctl_prefix *a, size_t a_cnt,
+			const struct nlctl_prefix *b, size_t b_cnt,
+			size_t *points, struct nlctl_prefix diff[2]);
+
+/* command file optimizer */
+struct nlctl_opt_type {
+	const char *cmd;
+	const char *name;
+	const char *value;
+	const char *desc;
+};
+struct nlctl_opt {
+	const struct nlctl_opt_type *type;
+	struct nlbl_strtab *tab;
+	const char **names;
+	uint32_t names_cnt;
+	uint32_t names_last;
+	struct nlctl_prefix *pfx;
+	size_t pfx_cnt;
+	size_t pfx_max;
+	char **lines;
+	size_t lines_cnt;
+	size_t lines_max;
+	size_t lines_add;
+};
+int nlctl_opt_init(struct nlctl_opt *opt, const struct nlctl_opt_type *type);
+void nlctl_opt_free(struct nlctl_opt *opt);
+int nlctl_opt_add(struct nlctl_opt *opt, const char *name,
+		  const struct nlbl_netaddr *addr, const char *value);
+int nlctl_opt_line(struct nlctl_opt *opt, int argc, char *argv[]);
+int nlctl_opt_run(struct nlctl_opt *opt, unsigned int verify);
+
+/* CIPSOv4 mapping range display */
+void cipsov4_range_print(FILE *fp, const struct nlbl_cv4_range *range,
+			 const char *eq);
+
+/* module argument parsing */
+int map_add_parse(int argc, char *argv[],
+		  uint8_t *def_flag,
+		  struct nlbl_dommap *domain, struct nlbl_netaddr *addr);
+int map_del_parse(int argc, char *argv[], uint8_t *def_flag, char **domain);
+int unlbl_accept_parse(int argc, char *argv[], uint8_t *flag);
+int unlbl_static_parse(int argc, char *argv[],
+		       uint8_t *def_flag,
+		       nlbl_netdev *dev, struct nlbl_netaddr *addr,
+		       nlbl_secctx *label);
+int cipsov4_add_parse(int argc, char *argv[],
+		      nlbl_cv4_doi *doi, nlbl_cv4_mtype *mtype,
+		      struct nlbl_cv4_tag_a *tags,
+		      struct nlbl_cv4_range_a *lvls,
+		      struct nlbl_cv4_range_a *cats);
+int cipsov4_del_parse(int argc, char *argv[], nlbl_cv4_doi *doi);
+
 /* module entry points */
 typedef int main_function_t(int argc, char *argv[]);
 int mgmt_main(int argc, char *argv[]);
 int map_main(int argc, char *argv[]);
 int unlbl_main(int argc, char *argv[]);
 int cipsov4_main(int argc, char *argv[]);
+int apply_main(int argc, char *argv[]);
+int reset_main(int argc, char *argv[]);
+int save_main(int argc, char *argv[]);
 
 #endif
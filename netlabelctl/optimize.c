@@ -0,0 +1,1063 @@
+/*
+ * Address Prefix Optimizer
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The kernel picks the most specific matching entry of a prefix table, so a
+ * table can often be written with fewer entries without changing the value
+ * any address maps to.  Two sibling prefixes with the same value are replaced
+ * by their parent prefix, and a prefix is dropped when the most specific
+ * prefix covering it has the same value or when the prefixes inside it leave
+ * no address for it to match.  None of these steps change the set of
+ * addresses the table matches, so tables which are only searched when they
+ * have a matching entry behave the same way too.
+ *
+ * The prefixes are kept in a sorted array rather than a trie, which keeps the
+ * memory use down to one small entry per prefix.  In (address, length) order a
+ * prefix sorts directly after its parent, if the parent is in the array, and
+ * merging the two children of a prefix into it is done by shortening the
+ * first child in place without upsetting the order.  Walking the array
+ * backwards visits every prefix after all of the prefixes inside it, so
+ * merges cascade all the way up in a single pass.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include <libnetlabel.h>
+
+#include "netlabelctl.h"
+
+/*
+ * Helper Functions
+ */
+
+/**
+ * Return the bit of a prefix key
+ * @param key the prefix key
+ * @param bit the bit number, starting with the most significant bit
+ *
+ */
+static inline uint32_t prefix_bit(const uint32_t *key, unsigned int bit)
+{
+	return key[bit / 32] & (0x80000000 >> (bit % 32));
+}
+
+/**
+ * Return a network mask
+ * @param bits the number of bits in the mask, at most 32
+ *
+ */
+static inline uint32_t prefix_mask(unsigned int bits)
+{
+	return (bits > 0 ? 0xffffffff << (32 - bits) : 0);
+}
+
+/**
+ * Compare the keys of two prefixes
+ * @param a the first prefix
+ * @param b the second prefix
+ *
+ * Compare the group, family, address and length of @a and @b.  Returns a
+ * negative value, zero or a positive value if @a sorts before, the same as or
+ * after @b.
+ *
+ */
+static int prefix_key_cmp(const struct nlctl_prefix *a,
+			  const struct nlctl_prefix *b)
+{
+	unsigned int iter;
+
+	if (a->group != b->group)
+		return (a->group < b->group ? -1 : 1);
+	if (a->family != b->family)
+		return (a->family < b->family ? -1 : 1);
+	for (iter = 0; iter < 4; iter++)
+		if (a->key[iter] != b->key[iter])
+			return (a->key[iter] < b->key[iter] ? -1 : 1);
+	if (a->len != b->len)
+		return (a->len < b->len ? -1 : 1);
+
+	return 0;
+}
+
+/**
+ * Compare two prefixes
+ * @param a the first prefix
+ * @param b the second prefix
+ *
+ * qsort() comparison function which sorts the prefixes by key and then by the
+ * order they were added in.
+ *
+ */
+static int prefix_cmp(const void *a, const void *b)
+{
+	int rc;
+	const struct nlctl_prefix *pfx_a = a;
+	const struct nlctl_prefix *pfx_b = b;
+
+	rc = prefix_key_cmp(pfx_a, pfx_b);
+	if (rc != 0)
+		return rc;
+	if (pfx_a->seq != pfx_b->seq)
+		return (pfx_a->seq < pfx_b->seq ? -1 : 1);
+
+	return 0;
+}
+
+/**
+ * Test if one prefix is inside another
+ * @param outer the covering prefix
+ * @param inner the covered prefix
+ *
+ * Returns true if every address of @inner is also an address of @outer, both
+ * prefixes must be in the same group and family.
+ *
+ */
+static int prefix_contains(const struct nlctl_prefix *outer,
+			   const struct nlctl_prefix *inner)
+{
+	unsigned int iter;
+	unsigned int bits = outer->len;
+
+	if (outer->len > inner->len)
+		return 0;
+	for (iter = 0; bits >= 32; iter++, bits -= 32)
+		if (outer->key[iter] != inner->key[iter])
+			return 0;
+	if (bits > 0 &&
+	    ((outer->key[iter] ^ inner->key[iter]) & prefix_mask(bits)))
+		return 0;
+
+	return 1;
+}
+
+/**
+ * Find a prefix
+ * @param pfx the prefix array
+ * @param lo the first entry to search
+ * @param hi the entry after the last entry to search
+ * @param key the prefix to find
+ *
+ * Binary search the sorted entries [@lo, @hi) of @pfx for the prefix with the
+ * same key as @key.  Returns the entry on success, NULL if there is none.
+ *
+ */
+static struct nlctl_prefix *prefix_find(struct nlctl_prefix *pfx,
+					size_t lo, size_t hi,
+					const struct nlctl_prefix *key)
+{
+	int rc;
+	size_t mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		rc = prefix_key_cmp(&pfx[mid], key);
+		if (rc == 0)
+			return &pfx[mid];
+		else if (rc < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/**
+ * Remove the dead prefixes
+ * @param pfx the prefix array
+ * @param count the number of prefixes
+ *
+ * Returns the number of prefixes left in @pfx.
+ *
+ */
+static size_t prefix_compact(struct nlctl_prefix *pfx, size_t count)
+{
+	size_t iter;
+	size_t live = 0;
+
+	for (iter = 0; iter < count; iter++) {
+		if (pfx[iter].dead)
+			continue;
+		if (live != iter)
+			pfx[live] = pfx[iter];
+		live++;
+	}
+
+	return live;
+}
+
+/**
+ * Merge sibling prefixes
+ * @param pfx the prefix array
+ * @param lo the first entry of the table
+ * @param hi the entry after the last entry of the table
+ *
+ * Replace each pair of sibling prefixes with the same value in the table
+ * [@lo, @hi) of @pfx with their parent prefix, unless the parent prefix is
+ * already in the table with a different value.  Replaced prefixes are marked
+ * as dead.  Returns the number of prefixes removed.
+ *
+ */
+static size_t prefix_merge(struct nlctl_prefix *pfx, size_t lo, size_t hi)
+{
+	size_t iter;
+	size_t removed = 0;
+	unsigned int bit;
+	struct nlctl_prefix *child;
+	struct nlctl_prefix *parent;
+	struct nlctl_prefix sibling;
+	struct nlctl_prefix *sib;
+
+	for (iter = hi; iter-- > lo; ) {
+		child = &pfx[iter];
+		if (child->dead)
+			continue;
+
+		/* only the first child of a pair does the merge, its sibling
+		 * sorts after it and has already been merged as far as it
+		 * can go */
+		while (child->len > 0) {
+			bit = child->len - 1;
+			if (prefix_bit(child->key, bit))
+				break;
+			sibling = *child;
+			sibling.key[bit / 32] |= 0x80000000 >> (bit % 32);
+			sib = prefix_find(pfx, iter + 1, hi, &sibling);
+			if (sib == NULL || sib->dead ||
+			    sib->value != child->value)
+				break;
+
+			/* the parent prefix sorts directly before the first
+			 * child, if it exists */
+			parent = (iter > lo ? &pfx[iter - 1] : NULL);
+			if (parent != NULL && parent->len == bit &&
+			    memcmp(parent->key, child->key,
+				   sizeof(child->key)) == 0) {
+				if (parent->value == child->value) {
+					child->dead = 1;
+					sib->dead = 1;
+					removed += 2;
+				}
+				break;
+			}
+
+			child->len = bit;
+			sib->dead = 1;
+			removed++;
+		}
+	}
+
+	return removed;
+}
+
+/**
+ * Compare two prefix keys
+ * @param a the first key
+ * @param b the second key
+ *
+ * Returns a negative value, zero or a positive value if @a is less than, equal
+ * to or greater than @b.
+ *
+ */
+static int prefix_point_cmp(const uint32_t *a, const uint32_t *b)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < 4; iter++)
+		if (a[iter] != b[iter])
+			return (a[iter] < b[iter] ? -1 : 1);
+
+	return 0;
+}
+
+/**
+ * Compare two prefix keys
+ * @param a the first key
+ * @param b the second key
+ *
+ * qsort() comparison function for the address arrays used by
+ * nlctl_prefix_verify().
+ *
+ */
+static int prefix_point_qsort(const void *a, const void *b)
+{
+	return prefix_point_cmp(a, b);
+}
+
+/**
+ * Find the address after a prefix
+ * @param pfx the prefix
+ * @param point the address
+ *
+ * Set @point to the first address after the last address of @pfx.  Returns
+ * zero on success, negative values if there is no such address.
+ *
+ */
+static int prefix_point_end(const struct nlctl_prefix *pfx, uint32_t *point)
+{
+	unsigned int iter;
+	unsigned int words = (pfx->family == AF_INET ? 1 : 4);
+	unsigned int bits = pfx->len;
+
+	memset(point, 0, 4 * sizeof(*point));
+	for (iter = 0; iter < words; iter++) {
+		point[iter] = pfx->key[iter] |
+			      ~prefix_mask(bits < 32 ? bits : 32);
+		bits -= (bits < 32 ? bits : 32);
+	}
+
+	/* add one, the carry out of the top word means we wrapped */
+	for (iter = words; iter-- > 0; )
+		if (++point[iter] != 0)
+			return 0;
+
+	return -ERANGE;
+}
+
+/* covering prefix, see prefix_shadow() */
+struct prefix_cover {
+	struct nlctl_prefix *pfx;
+	uint32_t next[4];
+	unsigned int gap;
+	unsigned int wrap;
+};
+
+/**
+ * Test if a prefix is hidden by the prefixes inside it
+ * @param cover the covering prefix
+ *
+ * Returns true if the prefixes directly inside @cover fill all of it, so that
+ * @cover is never the most specific match for an address.
+ *
+ */
+static int prefix_cover_hidden(const struct prefix_cover *cover)
+{
+	uint32_t end[4];
+
+	if (cover->gap)
+		return 0;
+	if (prefix_point_end(cover->pfx, end) < 0)
+		return cover->wrap;
+	return (!cover->wrap && prefix_point_cmp(cover->next, end) == 0);
+}
+
+/**
+ * Drop shadowed and hidden prefixes
+ * @param pfx the prefix array
+ * @param lo the first entry of the table
+ * @param hi the entry after the last entry of the table
+ *
+ * Mark each prefix in the table [@lo, @hi) of @pfx whose most specific
+ * covering prefix has the same value as dead, as well as each prefix which is
+ * completely filled by the prefixes inside it.  Returns the number of prefixes
+ * removed.
+ *
+ */
+static size_t prefix_shadow(struct nlctl_prefix *pfx, size_t lo, size_t hi)
+{
+	size_t iter;
+	size_t removed = 0;
+	unsigned int depth = 0;
+	struct prefix_cover stack[129];
+	struct prefix_cover *top;
+	struct nlctl_prefix *cur;
+
+	/* the stack holds the live prefixes covering the current one, most
+	 * specific last, and how far the prefixes directly inside each of
+	 * them reach without a gap */
+	for (iter = lo; iter <= hi; iter++) {
+		cur = (iter < hi ? &pfx[iter] : NULL);
+		if (cur != NULL && cur->dead)
+			continue;
+		while (depth > 0 &&
+		       (cur == NULL || !prefix_contains(stack[depth - 1].pfx,
+							cur))) {
+			top = &stack[--depth];
+			if (prefix_cover_hidden(top)) {
+				top->pfx->dead = 1;
+				removed++;
+			}
+		}
+		if (cur == NULL)
+			break;
+
+		top = (depth > 0 ? &stack[depth - 1] : NULL);
+		if (top != NULL && top->pfx->value == cur->value) {
+			cur->dead = 1;
+			removed++;
+			continue;
+		}
+		if (top != NULL && !top->gap) {
+			if (top->wrap || prefix_point_cmp(top->next, cur->key))
+				top->gap = 1;
+			else
+				top->wrap = (prefix_point_end(cur,
+							      top->next) < 0);
+		}
+
+		top = &stack[depth++];
+		top->pfx = cur;
+		memcpy(top->next, cur->key, sizeof(top->next));
+		top->gap = 0;
+		top->wrap = 0;
+	}
+
+	return removed;
+}
+
+/* prefix table walk, see prefix_walk_value() */
+struct prefix_walk {
+	const struct nlctl_prefix *pfx;
+	size_t iter;
+	size_t end;
+	unsigned int depth;
+	const struct nlctl_prefix *stack[129];
+};
+
+/**
+ * Find the value of an address
+ * @param walk the prefix table walk
+ * @param point the address, as a full length prefix
+ *
+ * Return the value of the most specific prefix of the walk's table which
+ * matches @point, or NULL if there is none.  The addresses must be given in
+ * ascending order.
+ *
+ */
+static const void *prefix_walk_value(struct prefix_walk *walk,
+				     const struct nlctl_prefix *point)
+{
+	const struct nlctl_prefix *cur;
+
+	/* the stack holds the prefixes starting at or before @point which
+	 * might still cover it, most specific last */
+	while (walk->iter < walk->end &&
+	       prefix_point_cmp(walk->pfx[walk->iter].key, point->key) <= 0) {
+		cur = &walk->pfx[walk->iter++];
+		while (walk->depth > 0 &&
+		       !prefix_contains(walk->stack[walk->depth - 1], cur))
+			walk->depth--;
+		walk->stack[walk->depth++] = cur;
+	}
+	while (walk->depth > 0 &&
+	       !prefix_contains(walk->stack[walk->depth - 1], point))
+		walk->depth--;
+
+	return (walk->depth > 0 ? walk->stack[walk->depth - 1]->value : NULL);
+}
+
+/**
+ * Find the end of a prefix table
+ * @param pfx the prefix array
+ * @param iter the first entry to check
+ * @param count the number of prefixes
+ * @param head a prefix of the table
+ *
+ * Returns the index of the first entry of @pfx at or after @iter which is not
+ * in the same group and family as @head.
+ *
+ */
+static size_t prefix_table_end(const struct nlctl_prefix *pfx,
+			       size_t iter, size_t count,
+			       const struct nlctl_prefix *head)
+{
+	while (iter < count && pfx[iter].group == head->group &&
+	       pfx[iter].family == head->family)
+		iter++;
+
+	return iter;
+}
+
+/*
+ * Prefix Functions
+ */
+
+/**
+ * Convert a network address into a prefix
+ * @param addr the network address
+ * @param pfx the prefix
+ *
+ * Set the family, key and length of @pfx from @addr, clearing the address bits
+ * outside of the mask.  Returns zero on success, negative values on failure.
+ *
+ */
+int nlctl_prefix_set(const struct nlbl_netaddr *addr, struct nlctl_prefix *pfx)
+{
+	unsigned int iter;
+	uint32_t mask;
+
+	memset(pfx->key, 0, sizeof(pfx->key));
+	pfx->len = 0;
+	switch (addr->type) {
+	case AF_INET:
+		mask = ntohl(addr->mask.v4.s_addr);
+		pfx->key[0] = ntohl(addr->addr.v4.s_addr) & mask;
+		while (mask & 0x80000000) {
+			pfx->len++;
+			mask <<= 1;
+		}
+		break;
+	case AF_INET6:
+		for (iter = 0; iter < 4; iter++) {
+			mask = ntohl(addr->mask.v6.s6_addr32[iter]);
+			pfx->key[iter] =
+				ntohl(addr->addr.v6.s6_addr32[iter]) & mask;
+			while (mask & 0x80000000) {
+				pfx->len++;
+				mask <<= 1;
+			}
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+	pfx->family = addr->type;
+
+	return 0;
+}
+
+/**
+ * Convert a prefix into a network address
+ * @param pfx the prefix
+ * @param addr the network address
+ *
+ * Set @addr to the address and mask of @pfx.
+ *
+ */
+void nlctl_prefix_get(const struct nlctl_prefix *pfx,
+		      struct nlbl_netaddr *addr)
+{
+	unsigned int iter;
+	unsigned int bits = pfx->len;
+	uint32_t mask;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->type = pfx->family;
+	switch (pfx->family) {
+	case AF_INET:
+		mask = prefix_mask(bits);
+		addr->addr.v4.s_addr = htonl(pfx->key[0]);
+		addr->mask.v4.s_addr = htonl(mask);
+		break;
+	case AF_INET6:
+		for (iter = 0; iter < 4; iter++) {
+			mask = prefix_mask(bits < 32 ? bits : 32);
+			bits -= (bits < 32 ? bits : 32);
+			addr->addr.v6.s6_addr32[iter] = htonl(pfx->key[iter]);
+			addr->mask.v6.s6_addr32[iter] = htonl(mask);
+		}
+		break;
+	}
+}
+
+/**
+ * Sort a prefix array
+ * @param pfx the prefix array
+ * @param count the number of prefixes
+ *
+ * Sort @pfx by group, family, address and length; prefixes with the same key
+ * stay in the order they were added in, which is the order of their sequence
+ * numbers.
+ *
+ */
+void nlctl_prefix_sort(struct nlctl_prefix *pfx, size_t count)
+{
+	qsort(pfx, count, sizeof(*pfx), prefix_cmp);
+}
+
+/**
+ * Test if two prefixes have the same key
+ * @param a the first prefix
+ * @param b the second prefix
+ *
+ * Returns true if @a and @b have the same group, family, address and length.
+ *
+ */
+int nlctl_prefix_eq(const struct nlctl_prefix *a, const struct nlctl_prefix *b)
+{
+	return (prefix_key_cmp(a, b) == 0);
+}
+
+/**
+ * Optimize a prefix array
+ * @param pfx the prefix array
+ * @param count the number of prefixes
+ *
+ * Each group and family of @pfx is a prefix table where an address takes the
+ * value of the most specific prefix which matches it, values are compared by
+ * pointer.  Rewrite each table with as few prefixes as merging siblings and
+ * dropping shadowed and hidden prefixes allows, without changing the value of
+ * any address or the set of addresses which match.  The array must be sorted
+ * with nlctl_prefix_sort() and must not hold two prefixes with the same key;
+ * it is still sorted afterwards.  Returns the number of prefixes left in @pfx.
+ *
+ */
+size_t nlctl_prefix_optimize(struct nlctl_prefix *pfx, size_t count)
+{
+	size_t lo;
+	size_t hi;
+	size_t removed;
+
+	for (lo = 0; lo < count; lo++)
+		pfx[lo].dead = 0;
+
+	/* dropping a prefix can let its children merge into its place and a
+	 * merge can shadow the new prefix, so repeat until nothing helps */
+	do {
+		removed = 0;
+		for (lo = 0; lo < count; lo = hi) {
+			for (hi = lo + 1;
+			     hi < count && pfx[hi].group == pfx[lo].group &&
+			     pfx[hi].family == pfx[lo].family; hi++);
+			removed += prefix_merge(pfx, lo, hi);
+			removed += prefix_shadow(pfx, lo, hi);
+		}
+		count = prefix_compact(pfx, count);
+	} while (removed > 0);
+
+	return count;
+}
+
+/**
+ * Verify that two prefix arrays are equivalent
+ * @param a the first prefix array
+ * @param a_cnt the number of prefixes in @a
+ * @param b the second prefix array
+ * @param b_cnt the number of prefixes in @b
+ * @param points the number of addresses checked
+ * @param diff the first address which differs, from @a and from @b
+ *
+ * Check that every address has the same value in @a and @b, taking the value
+ * of an address from the most specific prefix which matches it as in
+ * nlctl_prefix_optimize().  The value can only change where a prefix of
+ * either array starts or ends, so it is enough to compare the values of the
+ * first address of every prefix and of the address after every prefix.  Both
+ * arrays must be sorted with nlctl_prefix_sort() and must not hold two
+ * prefixes with the same key.  Returns zero if the arrays are equivalent, one
+ * if they are not and @diff is set, and negative values on failure.
+ *
+ */
+int nlctl_prefix_verify(const struct nlctl_prefix *a, size_t a_cnt,
+			const struct nlctl_prefix *b, size_t b_cnt,
+			size_t *points, struct nlctl_prefix diff[2])
+{
+	int rc = 0;
+	size_t iter;
+	size_t pnt_cnt;
+	size_t pnt_iter;
+	uint32_t (*pnt)[4];
+	const struct nlctl_prefix *head;
+	const struct nlctl_prefix *pfx;
+	struct prefix_walk *walk;
+	struct nlctl_prefix point;
+
+	*points = 0;
+	pnt = malloc((a_cnt + b_cnt) * 2 * sizeof(*pnt) + 1);
+	walk = calloc(2, sizeof(*walk));
+	if (pnt == NULL || walk == NULL) {
+		rc = -ENOMEM;
+		goto verify_return;
+	}
+
+	walk[0].pfx = a;
+	walk[1].pfx = b;
+	while (walk[0].end < a_cnt || walk[1].end < b_cnt) {
+		/* the next table in either array */
+		if (walk[1].end >= b_cnt ||
+		    (walk[0].end < a_cnt &&
+		     (a[walk[0].end].group < b[walk[1].end].group ||
+		      (a[walk[0].end].group == b[walk[1].end].group &&
+		       a[walk[0].end].family <= b[walk[1].end].family))))
+			head = &a[walk[0].end];
+		else
+			head = &b[walk[1].end];
+		walk[0].iter = walk[0].end;
+		walk[0].end = prefix_table_end(a, walk[0].iter, a_cnt, head);
+		walk[1].iter = walk[1].end;
+		walk[1].end = prefix_table_end(b, walk[1].iter, b_cnt, head);
+		walk[0].depth = 0;
+		walk[1].depth = 0;
+
+		/* the addresses where the value can change */
+		pnt_cnt = 0;
+		for (iter = 0; iter < 2; iter++) {
+			for (pfx = &walk[iter].pfx[walk[iter].iter];
+			     pfx < &walk[iter].pfx[walk[iter].end]; pfx++) {
+				memcpy(pnt[pnt_cnt++], pfx->key, sizeof(*pnt));
+				if (prefix_point_end(pfx, pnt[pnt_cnt]) == 0)
+					pnt_cnt++;
+			}
+		}
+		qsort(pnt, pnt_cnt, sizeof(*pnt), prefix_point_qsort);
+
+		memset(&point, 0, sizeof(point));
+		point.group = head->group;
+		point.family = head->family;
+		point.len = (head->family == AF_INET ? 32 : 128);
+		for (pnt_iter = 0; pnt_iter < pnt_cnt; pnt_iter++) {
+			if (pnt_iter > 0 &&
+			    !prefix_point_cmp(pnt[pnt_iter - 1], pnt[pnt_iter]))
+				continue;
+			memcpy(point.key, pnt[pnt_iter], sizeof(point.key));
+			diff[0] = point;
+			diff[0].value = prefix_walk_value(&walk[0], &point);
+			diff[1] = point;
+			diff[1].value = prefix_walk_value(&walk[1], &point);
+			(*points)++;
+			if (diff[0].value != diff[1].value) {
+				rc = 1;
+				goto verify_return;
+			}
+		}
+	}
+
+verify_return:
+	free(pnt);
+	free(walk);
+	return rc;
+}
+
+/*
+ * Optimizer Functions
+ */
+
+/**
+ * Find the group of a name
+ * @param opt the optimizer
+ * @param name the interned name, NULL for the default entry
+ *
+ * Returns the index of @name in the name list on success, negative values on
+ * failure.
+ *
+ */
+static int opt_group(struct nlctl_opt *opt, const char *name)
+{
+	uint32_t iter;
+	const char **names;
+
+	/* entries with the same name tend to come together */
+	if (opt->names_cnt > 0 && opt->names[opt->names_last] == name)
+		return opt->names_last;
+	for (iter = 0; iter < opt->names_cnt; iter++)
+		if (opt->names[iter] == name)
+			goto group_return;
+
+	names = realloc(opt->names, (iter + 1) * sizeof(*names));
+	if (names == NULL)
+		return -ENOMEM;
+	names[iter] = name;
+	opt->names = names;
+	opt->names_cnt++;
+
+group_return:
+	opt->names_last = iter;
+	return iter;
+}
+
+/**
+ * Compare two names
+ * @param a the first name
+ * @param b the second name
+ *
+ * qsort() comparison function for the name list, the default entry sorts
+ * first.
+ *
+ */
+static int opt_name_cmp(const void *a, const void *b)
+{
+	const char *name_a = *(const char * const *)a;
+	const char *name_b = *(const char * const *)b;
+
+	if (name_a == NULL || name_b == NULL)
+		return (name_a == NULL ? (name_b == NULL ? 0 : -1) : 1);
+	return strcmp(name_a, name_b);
+}
+
+/**
+ * Write an entry
+ * @param opt the optimizer
+ * @param fp the output file
+ * @param pfx the entry
+ * @param value the value, NULL for none
+ *
+ * Write the entry @pfx with the value @value in the form of the command which
+ * adds it, without the command and the trailing newline.
+ *
+ */
+static void opt_print(const struct nlctl_opt *opt, FILE *fp,
+		      const struct nlctl_prefix *pfx, const char *value)
+{
+	const char *name = opt->names[pfx->group];
+	struct nlbl_netaddr addr;
+	char buf[NLCTL_ADDR_LEN];
+
+	nlctl_prefix_get(pfx, &addr);
+	if (name == NULL)
+		fprintf(fp, "default");
+	else
+		fprintf(fp, "%s:%s", opt->type->name, name);
+	fprintf(fp, " address:%s %s:%s",
+		nlctl_addr_fmt(&addr, buf, sizeof(buf)),
+		opt->type->value, (value != NULL ? value : "-"));
+}
+
+/**
+ * Initialize an optimizer
+ * @param opt the optimizer
+ * @param type the type of the entries
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlctl_opt_init(struct nlctl_opt *opt, const struct nlctl_opt_type *type)
+{
+	memset(opt, 0, sizeof(*opt));
+	opt->type = type;
+	opt->lines_add = (size_t)-1;
+	opt->tab = nlbl_strtab_new();
+	if (opt->tab == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * Free an optimizer
+ * @param opt the optimizer
+ *
+ */
+void nlctl_opt_free(struct nlctl_opt *opt)
+{
+	size_t iter;
+
+	for (iter = 0; iter < opt->lines_cnt; iter++)
+		free(opt->lines[iter]);
+	free(opt->lines);
+	free(opt->pfx);
+	free(opt->names);
+	nlbl_strtab_free(opt->tab);
+}
+
+/**
+ * Add an entry to an optimizer
+ * @param opt the optimizer
+ * @param name the name of the entry's table, NULL for the default table
+ * @param addr the network address
+ * @param value the value
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlctl_opt_add(struct nlctl_opt *opt, const char *name,
+		  const struct nlbl_netaddr *addr, const char *value)
+{
+	int rc;
+	struct nlctl_prefix *pfx;
+	size_t max;
+
+	if (opt->pfx_cnt == opt->pfx_max) {
+		max = (opt->pfx_max > 0 ? opt->pfx_max * 2 : 1024);
+		pfx = realloc(opt->pfx, max * sizeof(*pfx));
+		if (pfx == NULL)
+			return -ENOMEM;
+		opt->pfx = pfx;
+		opt->pfx_max = max;
+	}
+	pfx = &opt->pfx[opt->pfx_cnt];
+
+	if (name != NULL) {
+		name = nlbl_strtab_intern(opt->tab, name);
+		if (name == NULL)
+			return -ENOMEM;
+	}
+	rc = opt_group(opt, name);
+	if (rc < 0)
+		return rc;
+	pfx->group = rc;
+	pfx->value = nlbl_strtab_intern(opt->tab, value);
+	if (pfx->value == NULL)
+		return -ENOMEM;
+	rc = nlctl_prefix_set(addr, pfx);
+	if (rc < 0)
+		return rc;
+	pfx->seq = opt->pfx_cnt++;
+
+	if (opt->lines_add == (size_t)-1)
+		opt->lines_add = opt->lines_cnt;
+	return 0;
+}
+
+/**
+ * Add a command which is not optimized
+ * @param opt the optimizer
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlctl_opt_line(struct nlctl_opt *opt, int argc, char *argv[])
+{
+	int iter;
+	size_t len = 1;
+	char *line;
+	char **lines;
+
+	if (opt->lines_cnt == opt->lines_max) {
+		lines = realloc(opt->lines,
+				(opt->lines_max + 16) * sizeof(*lines));
+		if (lines == NULL)
+			return -ENOMEM;
+		opt->lines = lines;
+		opt->lines_max += 16;
+	}
+
+	for (iter = 0; iter < argc; iter++)
+		len += strlen(argv[iter]) + 1;
+	line = malloc(len);
+	if (line == NULL)
+		return -ENOMEM;
+	line[0] = '\0';
+	for (iter = 0; iter < argc; iter++) {
+		if (iter > 0)
+			strcat(line, " ");
+		strcat(line, argv[iter]);
+	}
+	opt->lines[opt->lines_cnt++] = line;
+
+	return 0;
+}
+
+/**
+ * Optimize the entries and write the commands
+ * @param opt the optimizer
+ * @param verify verify the optimized entries if true
+ *
+ * Drop the repeated entries, keeping the first one as the kernel does, and
+ * optimize each table with nlctl_prefix_optimize().  If @verify is true the
+ * optimized tables are checked against the original tables with
+ * nlctl_prefix_verify() and nothing is written if they differ.  The commands
+ * are written to stdout, with the optimized entries in the place of the first
+ * entry, and the number of entries before and after is written to stderr.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int nlctl_opt_run(struct nlctl_opt *opt, unsigned int verify)
+{
+	int rc = 0;
+	uint32_t iter;
+	uint32_t *rank;
+	const char **names;
+	size_t pfx_iter;
+	size_t pfx_cnt;
+	size_t opt_cnt;
+	size_t points;
+	struct nlctl_prefix *pfx;
+	struct nlctl_prefix *last;
+	struct nlctl_prefix *orig = NULL;
+	struct nlctl_prefix diff[2];
+
+	/* number the tables in name order so the output is sorted */
+	names = malloc(opt->names_cnt * sizeof(*names) + 1);
+	rank = malloc(opt->names_cnt * sizeof(*rank) + 1);
+	if (names == NULL || rank == NULL) {
+		free(names);
+		free(rank);
+		return -ENOMEM;
+	}
+	memcpy(names, opt->names, opt->names_cnt * sizeof(*names));
+	qsort(names, opt->names_cnt, sizeof(*names), opt_name_cmp);
+	for (iter = 0; iter < opt->names_cnt; iter++)
+		rank[opt_group(opt, names[iter])] = iter;
+	for (pfx_iter = 0; pfx_iter < opt->pfx_cnt; pfx_iter++)
+		opt->pfx[pfx_iter].group = rank[opt->pfx[pfx_iter].group];
+	free(opt->names);
+	opt->names = names;
+	free(rank);
+
+	nlctl_prefix_sort(opt->pfx, opt->pfx_cnt);
+	for (pfx_iter = 0, pfx_cnt = 0; pfx_iter < opt->pfx_cnt; pfx_iter++) {
+		pfx = &opt->pfx[pfx_iter];
+		last = (pfx_cnt > 0 ? &opt->pfx[pfx_cnt - 1] : NULL);
+		if (last != NULL && nlctl_prefix_eq(last, pfx)) {
+			if (last->value == pfx->value)
+				continue;
+			fprintf(stderr,
+				MSG_WARN("ignoring conflicting entry "));
+			opt_print(opt, stderr, pfx, pfx->value);
+			fprintf(stderr, "\n");
+			continue;
+		}
+		opt->pfx[pfx_cnt++] = *pfx;
+	}
+
+	if (verify) {
+		orig = malloc(pfx_cnt * sizeof(*orig) + 1);
+		if (orig == NULL)
+			return -ENOMEM;
+		memcpy(orig, opt->pfx, pfx_cnt * sizeof(*orig));
+	}
+	opt_cnt = nlctl_prefix_optimize(opt->pfx, pfx_cnt);
+	if (verify) {
+		rc = nlctl_prefix_verify(orig, pfx_cnt, opt->pfx, opt_cnt,
+					 &points, diff);
+		if (rc > 0) {
+			fprintf(stderr,
+				MSG_ERR("optimized %s differ at "),
+				opt->type->desc);
+			opt_print(opt, stderr, &diff[1], diff[1].value);
+			fprintf(stderr, ", originally %s:%s\n",
+				opt->type->value,
+				(diff[0].value != NULL ?
+				 (const char *)diff[0].value : "-"));
+			rc = -ECANCELED;
+		}
+		free(orig);
+		if (rc < 0)
+			return rc;
+	}
+
+	if (opt->lines_add == (size_t)-1)
+		opt->lines_add = opt->lines_cnt;
+	for (pfx_iter = 0; pfx_iter < opt->lines_add; pfx_iter++)
+		printf("%s\n", opt->lines[pfx_iter]);
+	for (pfx_iter = 0; pfx_iter < opt_cnt; pfx_iter++) {
+		printf("%s ", opt->type->cmd);
+		opt_print(opt, stdout, &opt->pfx[pfx_iter],
+			  opt->pfx[pfx_iter].value);
+		printf("\n");
+	}
+	for (pfx_iter = opt->lines_add; pfx_iter < opt->lines_cnt; pfx_iter++)
+		printf("%s\n", opt->lines[pfx_iter]);
+
+	fprintf(stderr, "%s: %zu %s optimized to %zu\n",
+		nlctl_name, opt->pfx_cnt, opt->type->desc, opt_cnt);
+	if (verify)
+		fprintf(stderr, "%s: %s verified at %zu addresses\n",
+			nlctl_name, opt->type->desc, points);
+
+	return 0;
+}
@@ -35,32 +35,54 @@
 
 #include "netlabelctl.h"
 
+/* number of imported static labels sent to the kernel at once */
+#define UNLBL_IMPORT_BATCH	4096
+
 /**
- * Set the NetLabel accept flag
+ * Parse the arguments of an accept flag command
  * @param argc the number of arguments
  * @param argv the argument list
+ * @param flag the accept flag
  *
- * Set the kernel's unlabeled packet allow flag.  Returns zero on success,
- * negative values on failure.
+ * Parse the "unlbl accept" arguments in @argv into @flag.  Returns zero on
+ * success, negative values on failure.
  *
  */
-int unlbl_accept(int argc, char *argv[])
+int unlbl_accept_parse(int argc, char *argv[], uint8_t *flag)
 {
-	int rc;
-	uint8_t flag;
-
 	/* sanity check */
 	if (argc != 1 || argv == NULL || argv[0] == NULL)
 		return -EINVAL;
 
 	/* set or reset the flag? */
 	if (strcasecmp(argv[0], "on") == 0 || strcmp(argv[0], "1") == 0)
-		flag = 1;
+		*flag = 1;
 	else if (strcasecmp(argv[0], "off") == 0 || strcmp(argv[0], "0") == 0)
-		flag = 0;
+		*flag = 0;
 	else
 		return -EINVAL;
 
+	return 0;
+}
+
+/**
+ * Set the NetLabel accept flag
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Set the kernel's unlabeled packet allow flag.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int unlbl_accept(int argc, char *argv[])
+{
+	int rc;
+	uint8_t flag;
+
+	rc = unlbl_accept_parse(argc, argv, &flag);
+	if (rc < 0)
+		return rc;
+
 	rc = nlbl_unlbl_accept(NULL, flag);
 	if (rc < 0)
 		return rc;
@@ -79,10 +101,11 @@ int unlbl_list(void)
 {
 	int rc;
 	uint8_t flag;
+	struct nlbl_strtab *tab;
 	struct nlbl_addrmap *addr_p = NULL, *addr_p_new;
 	struct nlbl_addrmap *addrdef_p = NULL;
 	struct nlbl_addrmap *iter_p;
-	size_t count;
+	size_t count = 0;
 	uint32_t iter;
 
 	/* display the accept flag */
@@ -95,12 +118,16 @@ int unlbl_list(void)
 	else
 		printf("accept:%s", (flag ? "on" : "off"));
 
-	/* get the static label mappings */
-	rc = nlbl_unlbl_staticlist(NULL, &addr_p);
+	/* get the static label mappings, the interned interface names let us
+	 * group the mappings by comparing pointers */
+	tab = nlbl_strtab_new();
+	if (tab == NULL)
+		return -ENOMEM;
+	rc = nlbl_unlbl_staticlist_strtab(NULL, tab, &addr_p);
 	if (rc < 0)
-		return rc;
+		goto list_return;
 	count = rc;
-	rc = nlbl_unlbl_staticlistdef(NULL, &addrdef_p);
+	rc = nlbl_unlbl_staticlistdef_strtab(NULL, tab, &addrdef_p);
 	if (rc > 0) {
 		addr_p_new = realloc(addr_p, sizeof(*addr_p) * (count + rc));
 		if (addr_p_new == NULL)
@@ -118,7 +145,7 @@ int unlbl_list(void)
 			/* interface */
 			if (iter == 0 ||
 			    iter_p->dev == NULL ||
-			    strcmp(addr_p[iter - 1].dev, iter_p->dev) != 0) {
+			    addr_p[iter - 1].dev != iter_p->dev) {
 				printf(" interface: ");
 				if (iter_p->dev != NULL)
 					printf("%s\n", iter_p->dev);
@@ -156,55 +183,84 @@ int unlbl_list(void)
 	}
 
 list_return:
-	if (addr_p != NULL) {
-		for (iter = 0; iter < count; iter++) {
-			if (addr_p[iter].dev != NULL)
-				free(addr_p[iter].dev);
-			if (addr_p[iter].label != NULL)
-				free(addr_p[iter].label);
-		}
+	if (addr_p != NULL)
 		free(addr_p);
-	}
+	if (addrdef_p != NULL)
+		free(addrdef_p);
+	nlbl_strtab_free(tab);
 	return rc;
 }
 
 /**
- * Add a static/fallback label configuration
+ * Parse the arguments of a static/fallback label command
  * @param argc the number of arguments
  * @param argv the argument list
+ * @param def_flag the default interface flag
+ * @param dev the network interface
+ * @param addr the network address
+ * @param label the security label, NULL if not wanted
  *
- * Add a fallback label configuration to the kernel.  Returns zero on success,
- * negative values on failure.
+ * Parse the "unlbl add" or "unlbl del" arguments in @argv into @def_flag,
+ * @dev, @addr and @label; the strings returned point into @argv.  Returns zero
+ * on success, negative values on failure.
  *
  */
-int unlbl_add(int argc, char *argv[])
+int unlbl_static_parse(int argc, char *argv[],
+		       uint8_t *def_flag,
+		       nlbl_netdev *dev, struct nlbl_netaddr *addr,
+		       nlbl_secctx *label)
 {
 	uint32_t iter;
-	uint8_t def_flag = 0;
-	nlbl_netdev dev = NULL;
-	struct nlbl_netaddr addr;
-	nlbl_secctx label = NULL;
 
 	/* sanity checks */
 	if (argc <= 0 || argv == NULL || argv[0] == NULL)
 		return -EINVAL;
 
-	memset(&addr, 0, sizeof(addr));
+	*def_flag = 0;
+	*dev = NULL;
+	memset(addr, 0, sizeof(*addr));
+	if (label != NULL)
+		*label = NULL;
 
 	/* parse the arguments */
 	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
 		if (strncmp(argv[iter], "interface:", 10) == 0) {
-			dev = argv[iter] + 10;
+			*dev = argv[iter] + 10;
 		} else if (strncmp(argv[iter], "default", 7) == 0) {
-			def_flag = 1;
-		} else if (strncmp(argv[iter], "label:", 6) == 0) {
-			label = argv[iter] + 6;
+			*def_flag = 1;
+		} else if (label != NULL &&
+			   strncmp(argv[iter], "label:", 6) == 0) {
+			*label = argv[iter] + 6;
 		} else if (strncmp(argv[iter], "address:", 8) == 0) {
-			if (nlctl_addr_parse(argv[iter] + 8, &addr) != 0)
+			if (nlctl_addr_parse(argv[iter] + 8, addr) != 0)
 				return -EINVAL;
 		}
 	}
 
+	return 0;
+}
+
+/**
+ * Add a static/fallback label configuration
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Add a fallback label configuration to the kernel.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int unlbl_add(int argc, char *argv[])
+{
+	int rc;
+	uint8_t def_flag;
+	nlbl_netdev dev;
+	struct nlbl_netaddr addr;
+	nlbl_secctx label;
+
+	rc = unlbl_static_parse(argc, argv, &def_flag, &dev, &addr, &label);
+	if (rc < 0)
+		return rc;
+
 	/* add the mapping */
 	if (def_flag != 0)
 		return nlbl_unlbl_staticadddef(NULL, &addr, label);
@@ -223,34 +279,498 @@ int unlbl_add(int argc, char *argv[])
  */
 int unlbl_del(int argc, char *argv[])
 {
+	int rc;
+	uint8_t def_flag;
+	nlbl_netdev dev;
+	struct nlbl_netaddr addr;
+
+	rc = unlbl_static_parse(argc, argv, &def_flag, &dev, &addr, NULL);
+	if (rc < 0)
+		return rc;
+
+	/* add the mapping */
+	if (def_flag != 0)
+		return nlbl_unlbl_staticdeldef(NULL, &addr);
+	else
+		return nlbl_unlbl_staticdel(NULL, dev, &addr);
+}
+
+/**
+ * Display a static label lookup result
+ * @param addr the matching static label mapping
+ *
+ * Print the static label mapping @addr in the same format as unlbl_list().
+ *
+ */
+static void unlbl_lookup_print(const struct nlbl_addrmap *addr)
+{
+	if (opt_pretty != 0) {
+		printf(" interface: %s\n",
+		       (addr->dev != NULL ? addr->dev : "DEFAULT"));
+		printf("   address: ");
+		nlctl_addr_print(&addr->addr);
+		printf("\n");
+		printf("    label: \"%s\"\n", addr->label);
+	} else {
+		printf("interface:%s,address:",
+		       (addr->dev != NULL ? addr->dev : "DEFAULT"));
+		nlctl_addr_print(&addr->addr);
+		printf(",label:\"%s\"\n", addr->label);
+	}
+}
+
+/**
+ * Look up the static labels for a file of addresses
+ * @param tbl the static label table
+ * @param dev the network interface, NULL for the default interface
+ * @param file the address file, "-" for stdin
+ *
+ * Read one "[<DEV>|default] <ADDR>" entry per line from @file and print the
+ * entry followed by the static label the kernel would assign, or "-" if there
+ * is none; the interface defaults to @dev.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int unlbl_lookup_file(struct nlbl_unlbl_table *tbl,
+			     nlbl_netdev dev, const char *file)
+{
+	int rc;
+	int rc_file = 0;
+	FILE *fp;
+	char *line = NULL;
+	size_t line_len = 0;
+	unsigned int line_num = 0;
+	char *tok[3];
+	char *tok_save;
+	char *addr_str;
+	unsigned int tok_cnt;
+	nlbl_netdev line_dev;
+	struct nlbl_netaddr addr;
+	struct nlbl_addrmap *entry;
+
+	if (!strcmp(file, "-"))
+		fp = stdin;
+	else {
+		fp = fopen(file, "r");
+		if (fp == NULL)
+			return -errno;
+	}
+
+	while (getline(&line, &line_len, fp) >= 0) {
+		line_num++;
+
+		for (tok_cnt = 0; tok_cnt < 3; tok_cnt++) {
+			tok[tok_cnt] = strtok_r((tok_cnt == 0 ? line : NULL),
+						" \t\r\n", &tok_save);
+			if (tok[tok_cnt] == NULL)
+				break;
+		}
+		if (tok_cnt == 0 || tok[0][0] == '#')
+			continue;
+		if (tok_cnt == 1) {
+			line_dev = dev;
+			addr_str = tok[0];
+		} else {
+			line_dev = (strcmp(tok[0], "default") ? tok[0] : NULL);
+			addr_str = tok[1];
+		}
+
+		/* nlctl_addr_parse() modifies the string, print it first */
+		memset(&addr, 0, sizeof(addr));
+		if (tok_cnt == 3)
+			rc = -EINVAL;
+		else {
+			if (tok_cnt == 2)
+				printf("%s ", tok[0]);
+			printf("%s ", addr_str);
+			rc = nlctl_addr_parse(addr_str, &addr);
+		}
+		if (rc < 0) {
+			if (tok_cnt < 3)
+				printf("-\n");
+			fprintf(stderr, MSG_ERR("%s:%u: %s\n"),
+				(fp == stdin ? "<stdin>" : file), line_num,
+				nlctl_strerror(-rc));
+			rc_file = rc;
+			continue;
+		}
+
+		entry = nlbl_unlbl_table_lookup(tbl, line_dev, &addr);
+		printf("%s\n", (entry != NULL ? entry->label : "-"));
+	}
+
+	if (fp != stdin)
+		fclose(fp);
+	free(line);
+	return rc_file;
+}
+
+/**
+ * Look up the static label for a packet
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Find the static label the kernel would assign to unlabeled packets from the
+ * given address arriving on the given interface, or to each of the addresses
+ * in a file.  Returns zero on success, negative values on failure.
+ *
+ */
+static int unlbl_lookup(int argc, char *argv[])
+{
+	int rc;
 	uint32_t iter;
-	uint8_t def_flag = 0;
 	nlbl_netdev dev = NULL;
+	char *addr_str = NULL;
+	char *file = NULL;
 	struct nlbl_netaddr addr;
+	struct nlbl_unlbl_table *tbl;
+	struct nlbl_addrmap *entry;
 
-	/* sanity checks */
-	if (argc <= 0 || argv == NULL || argv[0] == NULL)
+	/* parse the arguments */
+	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
+		if (strncmp(argv[iter], "interface:", 10) == 0)
+			dev = argv[iter] + 10;
+		else if (strcmp(argv[iter], "default") == 0)
+			dev = NULL;
+		else if (strncmp(argv[iter], "address:", 8) == 0)
+			addr_str = argv[iter] + 8;
+		else if (strncmp(argv[iter], "file:", 5) == 0)
+			file = argv[iter] + 5;
+		else
+			return -EINVAL;
+	}
+	if ((addr_str == NULL) == (file == NULL))
 		return -EINVAL;
-
 	memset(&addr, 0, sizeof(addr));
+	if (addr_str != NULL && nlctl_addr_parse(addr_str, &addr) != 0)
+		return -EINVAL;
+
+	/* load the static labels and do the lookup */
+	tbl = nlbl_unlbl_table_new();
+	if (tbl == NULL)
+		return -ENOMEM;
+	rc = nlbl_unlbl_table_load(NULL, tbl);
+	if (rc < 0)
+		goto lookup_return;
+	if (file != NULL)
+		rc = unlbl_lookup_file(tbl, dev, file);
+	else {
+		entry = nlbl_unlbl_table_lookup(tbl, dev, &addr);
+		if (entry != NULL)
+			unlbl_lookup_print(entry);
+		else
+			rc = -ENOENT;
+	}
+
+lookup_return:
+	nlbl_unlbl_table_free(tbl);
+	return rc;
+}
+
+/* static label optimizer entries */
+static const struct nlctl_opt_type unlbl_opt_type = {
+	.cmd = "unlbl add",
+	.name = "interface",
+	.value = "label",
+	.desc = "static labels",
+};
+
+/**
+ * Record a command from the static label file
+ * @param argc the number of arguments
+ * @param argv the argument list
+ * @param arg the optimizer
+ *
+ * nlctl_file_walk() callback for unlbl_optimize().  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int unlbl_optimize_cmd(int argc, char *argv[], void *arg)
+{
+	int rc;
+	uint8_t def_flag;
+	nlbl_netdev dev;
+	struct nlbl_netaddr addr;
+	nlbl_secctx label;
+	struct nlctl_opt *opt = arg;
+
+	if (argc < 2 || strcmp(argv[0], "unlbl") != 0)
+		return nlctl_opt_line(opt, argc, argv);
+	/* a delete after the first entry may name an entry which is merged
+	 * away */
+	if (strcmp(argv[1], "del") == 0 && opt->lines_add != (size_t)-1)
+		return -EINVAL;
+	if (strcmp(argv[1], "add") != 0)
+		return nlctl_opt_line(opt, argc, argv);
+
+	rc = unlbl_static_parse(argc - 2, argv + 2,
+				&def_flag, &dev, &addr, &label);
+	if (rc < 0)
+		return rc;
+	if ((def_flag == 0 && dev == NULL) || addr.type == 0 || label == NULL)
+		return -EINVAL;
+
+	return nlctl_opt_add(opt, (def_flag ? NULL : dev), &addr, label);
+}
+
+/**
+ * Optimize a file of static labels
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Read the commands in a command or rules file and write them to stdout with
+ * the "unlbl add" commands replaced by the smallest set of static labels this
+ * tool can find which labels every packet the same way, see nlctl_opt_run().
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int unlbl_optimize(int argc, char *argv[])
+{
+	int rc;
+	uint32_t iter;
+	unsigned int verify = 0;
+	const char *file = "-";
+	struct nlctl_opt opt;
 
 	/* parse the arguments */
 	for (iter = 0; iter < argc && argv[iter] != NULL; iter++) {
-		if (strncmp(argv[iter], "interface:", 10) == 0) {
-			dev = argv[iter] + 10;
-		} else if (strncmp(argv[iter], "default", 7) == 0) {
-			def_flag = 1;
-		} else if (strncmp(argv[iter], "address:", 8) == 0) {
-			if (nlctl_addr_parse(argv[iter] + 8, &addr) != 0)
-				return -EINVAL;
+		if (strncmp(argv[iter], "file:", 5) == 0)
+			file = argv[iter] + 5;
+		else if (strcmp(argv[iter], "verify") == 0)
+			verify = 1;
+		else
+			return -EINVAL;
+	}
+
+	rc = nlctl_opt_init(&opt, &unlbl_opt_type);
+	if (rc < 0)
+		return rc;
+	rc = nlctl_file_walk(file, unlbl_optimize_cmd, &opt);
+	if (rc == 0)
+		rc = nlctl_opt_run(&opt, verify);
+	nlctl_opt_free(&opt);
+
+	return rc;
+}
+
+/**
+ * Split the next field from a static label import line
+ * @param line the current position in the line
+ *
+ * Skip any separators at *@line, then terminate the field which follows it
+ * and advance *@line past the field and its separator.  Fields are separated
+ * by commas and/or whitespace.  Returns the field, or NULL if the line is
+ * empty.
+ *
+ */
+static char *unlbl_import_field(char **line)
+{
+	char *field;
+	char *iter = *line;
+
+	while (*iter == ',' || *iter == ' ' || *iter == '\t')
+		iter++;
+	if (*iter == '\0' || *iter == '\r' || *iter == '\n')
+		return NULL;
+
+	field = iter;
+	while (*iter != '\0' && *iter != ',' && *iter != ' ' &&
+	       *iter != '\t' && *iter != '\r' && *iter != '\n')
+		iter++;
+	if (*iter != '\0')
+		*iter++ = '\0';
+	*line = iter;
+
+	return field;
+}
+
+/**
+ * Send a batch of imported static labels to the kernel
+ * @param file the import file name
+ * @param batch the NetLabel batch
+ * @param lines the line number of each request in @batch
+ * @param status the per-request status array
+ * @param failed the number of failed entries
+ *
+ * Send the requests in @batch, report the entries the kernel rejected along
+ * with their line numbers and empty @batch for the next set of entries.
+ * Returns zero if every entry was added, negative values on failure.
+ *
+ */
+static int unlbl_import_flush(const char *file, struct nlbl_batch **batch,
+			      const unsigned int *lines, int *status,
+			      size_t *failed)
+{
+	int rc;
+	int rc_flush = 0;
+	size_t iter;
+	size_t count = nlbl_batch_count(*batch);
+
+	if (count == 0)
+		return 0;
+
+	rc = nlbl_batch_exec(NULL, *batch, status);
+	if (rc < 0) {
+		*failed += count;
+		fprintf(stderr, MSG_ERR("%s:%u-%u: %s\n"),
+			file, lines[0], lines[count - 1], nlctl_strerror(-rc));
+		rc_flush = rc;
+		goto flush_return;
+	}
+	for (iter = 0; iter < count; iter++) {
+		if (status[iter] >= 0)
+			continue;
+		(*failed)++;
+		fprintf(stderr, MSG_ERR("%s:%u: %s\n"),
+			file, lines[iter], nlctl_strerror(-status[iter]));
+		rc_flush = status[iter];
+	}
+
+flush_return:
+	nlbl_batch_free(*batch);
+	*batch = nlbl_batch_new();
+	if (*batch == NULL)
+		return -ENOMEM;
+	return rc_flush;
+}
+
+/**
+ * Import a file of static labels
+ * @param argc the number of arguments
+ * @param argv the argument list
+ *
+ * Add the static labels listed in a file, "-" for stdin, to the kernel.  Each
+ * line holds an interface name, or "default", an address with an optional
+ * mask and a label, separated by commas and/or whitespace; the label is the
+ * rest of the line so it may contain commas.  The entries are streamed to the
+ * kernel in batches of pipelined requests and any entries which can not be
+ * parsed or are rejected by the kernel are reported, in order, with their line
+ * numbers.
+ * Unless the stop-on-error flag is set the remaining entries are still added.
+ * Returns zero if every entry was added, negative values on failure.
+ *
+ */
+static int unlbl_import(int argc, char *argv[])
+{
+	int rc;
+	int rc_line;
+	int rc_import = 0;
+	FILE *fp;
+	const char *file_name;
+	char *line = NULL;
+	size_t line_len = 0;
+	unsigned int line_num = 0;
+	char *iter;
+	char *end;
+	char *dev;
+	char *addr_str;
+	struct nlbl_netaddr addr;
+	struct nlbl_batch *batch = NULL;
+	unsigned int *lines = NULL;
+	int *status = NULL;
+	size_t total = 0;
+	size_t failed = 0;
+
+	/* sanity checks */
+	if (argc != 1 || argv == NULL || argv[0] == NULL)
+		return -EINVAL;
+
+	/* open the import file */
+	if (!strcmp(argv[0], "-")) {
+		fp = stdin;
+		file_name = "<stdin>";
+	} else {
+		fp = fopen(argv[0], "r");
+		if (fp == NULL)
+			return -errno;
+		file_name = argv[0];
+	}
+
+	batch = nlbl_batch_new();
+	lines = malloc(sizeof(*lines) * UNLBL_IMPORT_BATCH);
+	status = malloc(sizeof(*status) * UNLBL_IMPORT_BATCH);
+	if (batch == NULL || lines == NULL || status == NULL) {
+		rc_import = -ENOMEM;
+		goto import_return;
+	}
+
+	while (getline(&line, &line_len, fp) >= 0) {
+		line_num++;
+
+		/* split the line into the interface, address and label */
+		iter = line;
+		dev = unlbl_import_field(&iter);
+		if (dev == NULL || dev[0] == '#')
+			continue;
+		total++;
+		addr_str = unlbl_import_field(&iter);
+		while (*iter == ',' || *iter == ' ' || *iter == '\t')
+			iter++;
+		end = iter + strlen(iter);
+		while (end > iter && (end[-1] == ' ' || end[-1] == '\t' ||
+				      end[-1] == '\r' || end[-1] == '\n'))
+			end--;
+		*end = '\0';
+
+		/* queue the entry */
+		memset(&addr, 0, sizeof(addr));
+		if (addr_str == NULL || iter[0] == '\0' ||
+		    nlctl_addr_parse(addr_str, &addr) < 0)
+			rc = -EINVAL;
+		else if (strcmp(dev, "default") == 0)
+			rc = nlbl_batch_unlbl_staticadddef(batch, &addr, iter);
+		else
+			rc = nlbl_batch_unlbl_staticadd(batch,
+							dev, &addr, iter);
+		if (rc < 0) {
+			/* report the queued entries first to keep line order */
+			rc_line = rc;
+			rc = unlbl_import_flush(file_name, &batch,
+						lines, status, &failed);
+			if (rc < 0) {
+				rc_import = rc;
+				if (opt_stop || batch == NULL)
+					break;
+			}
+			failed++;
+			fprintf(stderr, MSG_ERR("%s:%u: %s\n"),
+				file_name, line_num, nlctl_strerror(-rc_line));
+			rc_import = rc_line;
+			if (opt_stop)
+				break;
+			continue;
+		}
+		lines[rc] = line_num;
+
+		/* send the entries once the batch is full */
+		if (nlbl_batch_count(batch) < UNLBL_IMPORT_BATCH)
+			continue;
+		rc = unlbl_import_flush(file_name, &batch,
+					lines, status, &failed);
+		if (rc < 0) {
+			rc_import = rc;
+			if (opt_stop || batch == NULL)
+				break;
 		}
 	}
+	if (batch != NULL) {
+		rc = unlbl_import_flush(file_name, &batch,
+					lines, status, &failed);
+		if (rc < 0)
+			rc_import = rc;
+	}
 
-	/* add the mapping */
-	if (def_flag != 0)
-		return nlbl_unlbl_staticdeldef(NULL, &addr);
-	else
-		return nlbl_unlbl_staticdel(NULL, dev, &addr);
+	fprintf(stderr, "%s: %zu of %zu static labels imported\n",
+		nlctl_name, total - failed, total);
+
+import_return:
+	if (fp != stdin)
+		fclose(fp);
+	nlbl_batch_free(batch);
+	free(status);
+	free(lines);
+	free(line);
+	return rc_import;
 }
 
 /**
@@ -283,6 +803,15 @@ int unlbl_main(int argc, char *argv[])
 	} else if (strcmp(argv[0], "del") == 0) {
 		/* del */
 		rc = unlbl_del(argc - 1, argv + 1);
+	} else if (strcmp(argv[0], "lookup") == 0) {
+		/* lookup */
+		rc = unlbl_lookup(argc - 1, argv + 1);
+	} else if (strcmp(argv[0], "optimize") == 0) {
+		/* optimize */
+		rc = unlbl_optimize(argc - 1, argv + 1);
+	} else if (strcmp(argv[0], "import") == 0) {
+		/* import */
+		rc = unlbl_import(argc - 1, argv + 1);
 	} else {
 		/* unknown request */
 		rc = -EINVAL;
@@ -0,0 +1,692 @@
+/*
+ * NetLabel Daemon, netlabeld
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * netlabeld holds a single NetLabel handle to the kernel and answers NetLabel
+ * requests from local clients on a Unix domain socket using the library's
+ * request cache: queries are answered from a mirror of the kernel's replies,
+ * configuration changes are passed through to the kernel.  Clients talk to the
+ * daemon with the same generic netlink messages they would send the kernel,
+ * see the daemon transport in libnetlabel.
+ */
+
+#define _GNU_SOURCE
+
+#include <configure.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <syslog.h>
+#include <grp.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <linux/capability.h>
+
+#include <libnetlabel.h>
+
+#include "netlabel_internal.h"
+
+/* return values */
+#define RET_OK		0
+#define RET_ERR		1
+#define RET_USAGE	2
+
+/* maximum number of connected clients */
+#define NLD_CLIENT_MAX	256
+
+/* queued reply packet */
+struct nld_pkt {
+	struct nld_pkt *next;
+	size_t len;
+	unsigned char data[];
+};
+
+/* client connection */
+struct nld_client {
+	int fd;
+	unsigned int admin;
+	struct nld_pkt *out_head;
+	struct nld_pkt **out_tail;
+};
+
+/* option variables */
+static uint32_t opt_verbose = 0;
+static uint32_t opt_foreground = 0;
+static uint32_t opt_timeout = 10;
+static uint32_t opt_max_age = 30;
+static char *opt_socket = NLBL_DAEMON_PATH;
+static char *opt_group = NULL;
+static nlbl_transport opt_transport = NLBL_TRANSPORT_NETLINK;
+
+/* signal state */
+static volatile sig_atomic_t nld_flush = 0;
+static volatile sig_atomic_t nld_stop = 0;
+
+/* connected clients */
+static struct nld_client *nld_clients[NLD_CLIENT_MAX];
+static unsigned int nld_client_cnt = 0;
+
+/* program name */
+static char *nld_name = NULL;
+
+/**
+ * Display usage information
+ * @param fp the output file pointer
+ *
+ * Display brief usage information.
+ *
+ */
+static void nld_usage_print(FILE *fp)
+{
+	fprintf(fp, "usage: %s [<flags>]\n", nld_name);
+}
+
+/**
+ * Display version information
+ * @param fp the output file pointer
+ *
+ * Display the version string.
+ *
+ */
+static void nld_ver_print(FILE *fp)
+{
+	fprintf(fp, "NetLabel Daemon, version %s\n", VERSION);
+}
+
+/**
+ * Display help information
+ * @param fp the output file pointer
+ *
+ * Display help and usage information.
+ *
+ */
+static void nld_help_print(FILE *fp)
+{
+	nld_ver_print(fp);
+	fprintf(fp,
+		" Usage: %s [<flags>]\n"
+		"\n"
+		" Flags:\n"
+		"   -f        : stay in the foreground, log to stderr\n"
+		"   -g <name> : let members of group <name> use the socket\n"
+		"   -h        : help/usage message\n"
+		"   -i <secs> : keep cached replies for <secs>, 0 for ever\n"
+		"   -s <path> : listen on the socket <path>\n"
+		"   -t <secs> : timeout\n"
+		"   -T <name> : transport, \"netlink\" or \"fake\"\n"
+		"   -v        : verbose mode\n"
+		"\n",
+		nld_name);
+}
+
+/**
+ * Log a message
+ * @param priority the syslog priority
+ * @param fmt the format string
+ *
+ * Log a message to stderr when running in the foreground and to syslog
+ * otherwise.  LOG_DEBUG messages are only logged in verbose mode.
+ *
+ */
+static void nld_log(int priority, const char *fmt, ...)
+{
+	va_list args;
+
+	if (priority == LOG_DEBUG && !opt_verbose)
+		return;
+
+	va_start(args, fmt);
+	if (opt_foreground) {
+		fprintf(stderr, "%s: ", nld_name);
+		vfprintf(stderr, fmt, args);
+		fprintf(stderr, "\n");
+	} else
+		vsyslog(priority, fmt, args);
+	va_end(args);
+}
+
+/**
+ * Handle a signal
+ * @param sig the signal
+ *
+ * SIGHUP flushes the cache, SIGINT and SIGTERM stop the daemon.
+ *
+ */
+static void nld_signal(int sig)
+{
+	if (sig == SIGHUP)
+		nld_flush = 1;
+	else
+		nld_stop = 1;
+}
+
+/*
+ * Client Functions
+ */
+
+/**
+ * Free a client connection
+ * @param client the client
+ *
+ */
+static void nld_client_free(struct nld_client *client)
+{
+	struct nld_pkt *pkt;
+
+	while (client->out_head != NULL) {
+		pkt = client->out_head;
+		client->out_head = pkt->next;
+		free(pkt);
+	}
+	close(client->fd);
+	free(client);
+}
+
+/**
+ * Check if a client may change the NetLabel configuration
+ * @param cred the client's credentials when it connected
+ *
+ * The kernel only accepts configuration changes from processes with
+ * CAP_NET_ADMIN in the initial user namespace.  The client must have been
+ * root when it connected, which can not change afterwards, and must also hold
+ * CAP_NET_ADMIN in the daemon's user namespace according to /proc.  The /proc
+ * check alone is not enough as by the time it is made the process may have
+ * exec'd a setuid program, or exited and had its pid reused.  Returns true if
+ * the client may change the configuration, false otherwise.
+ *
+ */
+static unsigned int nld_client_capable(const struct ucred *cred)
+{
+	unsigned int capable = 0;
+	char path[64];
+	char line[128];
+	unsigned long long caps;
+	struct stat st_self;
+	struct stat st_peer;
+	FILE *fp;
+	pid_t pid = cred->pid;
+
+	if (cred->uid != 0 || pid <= 0)
+		return 0;
+
+	/* capabilities held in a child user namespace do not count */
+	if (stat("/proc/self/ns/user", &st_self) == 0) {
+		snprintf(path, sizeof(path), "/proc/%d/ns/user", pid);
+		if (stat(path, &st_peer) < 0 ||
+		    st_peer.st_dev != st_self.st_dev ||
+		    st_peer.st_ino != st_self.st_ino)
+			return 0;
+	}
+
+	snprintf(path, sizeof(path), "/proc/%d/status", pid);
+	fp = fopen(path, "re");
+	if (fp == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (sscanf(line, "CapEff: %llx", &caps) == 1) {
+			capable = ((caps >> CAP_NET_ADMIN) & 1 ? 1 : 0);
+			break;
+		}
+	}
+	fclose(fp);
+
+	return capable;
+}
+
+/**
+ * Accept a client connection
+ * @param sock the listening socket
+ *
+ * Accept a new client connection on @sock, root clients which hold
+ * CAP_NET_ADMIN may change the NetLabel configuration.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int nld_client_accept(int sock)
+{
+	int fd;
+	struct nld_client *client;
+	struct ucred cred;
+	socklen_t cred_len = sizeof(cred);
+
+	fd = accept4(sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+		return (errno == EAGAIN || errno == EINTR ? 0 : -errno);
+	if (nld_client_cnt == NLD_CLIENT_MAX) {
+		nld_log(LOG_WARNING, "too many clients, connection refused");
+		close(fd);
+		return 0;
+	}
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0) {
+		close(fd);
+		return 0;
+	}
+
+	client = calloc(1, sizeof(*client));
+	if (client == NULL) {
+		close(fd);
+		return -ENOMEM;
+	}
+	client->fd = fd;
+	client->admin = nld_client_capable(&cred);
+	client->out_tail = &client->out_head;
+	nld_clients[nld_client_cnt++] = client;
+	nld_log(LOG_DEBUG, "client pid %d uid %d connected%s",
+		cred.pid, cred.uid, (client->admin ? ", may change" : ""));
+
+	return 0;
+}
+
+/**
+ * Send a client's queued replies
+ * @param client the client
+ *
+ * Send as many of the queued replies as the client's socket will take.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nld_client_flush(struct nld_client *client)
+{
+	ssize_t rc;
+	struct nld_pkt *pkt;
+
+	while (client->out_head != NULL) {
+		pkt = client->out_head;
+		rc = send(client->fd, pkt->data, pkt->len,
+			  MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (rc < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK ||
+			    errno == EINTR)
+				return 0;
+			return -errno;
+		}
+		client->out_head = pkt->next;
+		if (client->out_head == NULL)
+			client->out_tail = &client->out_head;
+		free(pkt);
+	}
+
+	return 0;
+}
+
+/**
+ * Send a buffer of replies to a client
+ * @param buf the reply buffer
+ * @param len the length of the reply buffer
+ * @param arg the client
+ *
+ * Send @buf to the client as a single packet, queuing it if the client's
+ * socket is full.  Returns zero on success, negative values on failure.
+ *
+ */
+static int nld_client_reply(const void *buf, size_t len, void *arg)
+{
+	ssize_t rc;
+	struct nld_client *client = arg;
+	struct nld_pkt *pkt;
+
+	/* keep the replies in order behind any which are already queued */
+	if (client->out_head == NULL) {
+		rc = send(client->fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (rc >= 0)
+			return 0;
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			return -errno;
+	}
+
+	pkt = malloc(sizeof(*pkt) + len);
+	if (pkt == NULL)
+		return -ENOMEM;
+	pkt->next = NULL;
+	pkt->len = len;
+	memcpy(pkt->data, buf, len);
+	*client->out_tail = pkt;
+	client->out_tail = &pkt->next;
+
+	return 0;
+}
+
+/**
+ * Read and answer a packet of requests from a client
+ * @param cache the request cache
+ * @param client the client
+ *
+ * Returns a positive value on success, zero if the client disconnected, and
+ * negative values on failure.
+ *
+ */
+static int nld_client_read(struct nlbl_cache *cache, struct nld_client *client)
+{
+	int rc;
+	ssize_t len;
+	unsigned char *buf;
+
+	len = recv(client->fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+	if (len < 0)
+		return (errno == EAGAIN || errno == EINTR ? 1 : -errno);
+	else if (len == 0)
+		return 0;
+
+	buf = malloc(len);
+	if (buf == NULL)
+		return -ENOMEM;
+	len = recv(client->fd, buf, len, 0);
+	if (len <= 0) {
+		free(buf);
+		return (len < 0 ? -errno : 0);
+	}
+
+	rc = nlbl_cache_request(cache, buf, len, client->admin,
+				nld_client_reply, client);
+	free(buf);
+	if (rc < 0)
+		return rc;
+
+	return 1;
+}
+
+/*
+ * Daemon Functions
+ */
+
+/**
+ * Create the listening socket
+ * @param path the socket path
+ * @param gid the group allowed to connect, or -1 for the daemon's own group
+ *
+ * Create a Unix domain socket bound to @path, replacing any stale socket left
+ * behind by an earlier daemon.  Only the daemon's user and the members of
+ * @gid may connect, and of those only privileged clients may change the
+ * NetLabel configuration.  Returns the socket on success, negative values on
+ * failure.
+ *
+ */
+static int nld_listen(const char *path, gid_t gid)
+{
+	int rc;
+	int sock;
+	struct sockaddr_un addr;
+	struct stat st;
+	mode_t mask;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return -ENAMETOOLONG;
+	strcpy(addr.sun_path, path);
+
+	sock = socket(AF_UNIX,
+		      SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (sock < 0)
+		return -errno;
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path);
+	/* never let the socket be reachable by others, even briefly */
+	mask = umask(0117);
+	rc = bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+	umask(mask);
+	if (rc < 0 ||
+	    chown(path, -1, gid) < 0 ||
+	    chmod(path, 0660) < 0 ||
+	    listen(sock, SOMAXCONN) < 0) {
+		rc = -errno;
+		close(sock);
+		return rc;
+	}
+
+	return sock;
+}
+
+/**
+ * Serve clients until asked to stop
+ * @param cache the request cache
+ * @param sock the listening socket
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int nld_serve(struct nlbl_cache *cache, int sock)
+{
+	int rc;
+	unsigned int iter;
+	unsigned int cnt;
+	struct pollfd pfds[NLD_CLIENT_MAX + 1];
+	struct nld_client *client;
+
+	while (!nld_stop) {
+		if (nld_flush) {
+			nld_flush = 0;
+			nlbl_cache_flush(cache);
+			nld_log(LOG_INFO, "cache flushed");
+		}
+
+		/* clients with replies waiting to be sent are not read from
+		 * until the replies are gone */
+		pfds[0].fd = sock;
+		pfds[0].events = POLLIN;
+		for (iter = 0; iter < nld_client_cnt; iter++) {
+			pfds[iter + 1].fd = nld_clients[iter]->fd;
+			pfds[iter + 1].events =
+				(nld_clients[iter]->out_head != NULL ?
+				 POLLOUT : POLLIN);
+		}
+		cnt = nld_client_cnt;
+		rc = poll(pfds, cnt + 1, -1);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		for (iter = cnt; iter > 0; iter--) {
+			client = nld_clients[iter - 1];
+			if (pfds[iter].revents & POLLOUT) {
+				rc = nld_client_flush(client);
+				if (rc == 0)
+					rc = 1;
+			} else if (pfds[iter].revents & POLLIN)
+				rc = nld_client_read(cache, client);
+			else if (pfds[iter].revents & (POLLHUP | POLLERR))
+				rc = 0;
+			else
+				continue;
+			if (rc > 0)
+				continue;
+			if (rc < 0 && rc != -EPIPE && rc != -ECONNRESET)
+				nld_log(LOG_WARNING, "client dropped: %s",
+					strerror(-rc));
+			else
+				nld_log(LOG_DEBUG, "client disconnected");
+			nld_client_free(client);
+			nld_clients[iter - 1] = nld_clients[--nld_client_cnt];
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			rc = nld_client_accept(sock);
+			if (rc < 0)
+				nld_log(LOG_WARNING, "accept failed: %s",
+					strerror(-rc));
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * main
+ */
+int main(int argc, char *argv[])
+{
+	int rc = RET_ERR;
+	int arg_iter;
+	int sock = -1;
+	gid_t gid = -1;
+	struct group *grp;
+	struct nlbl_cache *cache = NULL;
+	struct sigaction sa;
+
+	/* save the invoked program name for use in user notifications */
+	nld_name = strrchr(argv[0], '/');
+	if (nld_name == NULL)
+		nld_name = argv[0];
+	else
+		nld_name += 1;
+
+	/* get the command line arguments */
+	do {
+		arg_iter = getopt(argc, argv, "fg:hi:s:t:T:vV");
+		switch (arg_iter) {
+		case 'f':
+			/* foreground */
+			opt_foreground = 1;
+			break;
+		case 'g':
+			/* socket group */
+			opt_group = optarg;
+			break;
+		case 'h':
+			/* help */
+			nld_help_print(stdout);
+			return RET_OK;
+		case 'i':
+			/* cache lifetime */
+			if (atoi(optarg) < 0) {
+				nld_usage_print(stderr);
+				return RET_USAGE;
+			}
+			opt_max_age = atoi(optarg);
+			break;
+		case 's':
+			/* socket */
+			opt_socket = optarg;
+			break;
+		case 't':
+			/* timeout */
+			if (atoi(optarg) < 0) {
+				nld_usage_print(stderr);
+				return RET_USAGE;
+			}
+			opt_timeout = atoi(optarg);
+			break;
+		case 'T':
+			/* transport */
+			if (strcmp(optarg, "netlink") == 0)
+				opt_transport = NLBL_TRANSPORT_NETLINK;
+			else if (strcmp(optarg, "fake") == 0)
+				opt_transport = NLBL_TRANSPORT_FAKE;
+			else {
+				nld_usage_print(stderr);
+				return RET_USAGE;
+			}
+			break;
+		case 'v':
+			/* verbose */
+			opt_verbose = 1;
+			break;
+		case 'V':
+			/* version */
+			nld_ver_print(stdout);
+			return RET_OK;
+		case '?':
+			nld_usage_print(stderr);
+			return RET_USAGE;
+		}
+	} while (arg_iter > 0);
+	if (optind < argc) {
+		nld_usage_print(stderr);
+		return RET_USAGE;
+	}
+
+	if (opt_group != NULL) {
+		grp = getgrnam(opt_group);
+		if (grp == NULL) {
+			fprintf(stderr, "%s: error, unknown group %s\n",
+				nld_name, opt_group);
+			goto exit;
+		}
+		gid = grp->gr_gid;
+	}
+
+	/* connect to the kernel */
+	if (!opt_foreground)
+		openlog(nld_name, LOG_PID, LOG_DAEMON);
+	if (nlbl_comm_transport(opt_transport) < 0) {
+		fprintf(stderr, "%s: error, failed to select the transport\n",
+			nld_name);
+		goto exit;
+	}
+	nlbl_comm_timeout(opt_timeout);
+	cache = nlbl_cache_new(opt_max_age);
+	if (cache == NULL) {
+		fprintf(stderr,
+			"%s: error, failed to connect to the NetLabel "
+			"subsystem\n", nld_name);
+		goto exit;
+	}
+
+	/* start listening */
+	sock = nld_listen(opt_socket, gid);
+	if (sock < 0) {
+		fprintf(stderr, "%s: error, unable to listen on %s: %s\n",
+			nld_name, opt_socket, strerror(-sock));
+		goto exit;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = nld_signal;
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+
+	if (!opt_foreground && daemon(0, 0) < 0) {
+		fprintf(stderr, "%s: error, unable to daemonize: %s\n",
+			nld_name, strerror(errno));
+		goto exit;
+	}
+	nld_log(LOG_INFO, "listening on %s", opt_socket);
+
+	rc = nld_serve(cache, sock);
+	if (rc < 0) {
+		nld_log(LOG_ERR, "error, %s", strerror(-rc));
+		rc = RET_ERR;
+	} else
+		rc = RET_OK;
+
+exit:
+	while (nld_client_cnt > 0)
+		nld_client_free(nld_clients[--nld_client_cnt]);
+	if (sock >= 0) {
+		close(sock);
+		unlink(opt_socket);
+	}
+	nlbl_cache_free(cache);
+	return rc;
+}
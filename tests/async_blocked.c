@@ -0,0 +1,146 @@
+/*
+ * Asynchronous Request Test
+ *
+ */
+
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <libnetlabel.h>
+
+/* more requests than will fit in the smallest socket send buffer */
+#define ASYNC_REQUESTS		48
+
+static unsigned int done;
+static unsigned int failed;
+
+/**
+ * Count a completed request
+ * @param rc the request's return value
+ * @param res the request results
+ * @param arg unused
+ *
+ */
+static void async_cb(int rc, struct nlbl_async_result *res, void *arg)
+{
+	done++;
+	if (rc < 0 || res == NULL || res->data.version == 0)
+		failed++;
+}
+
+/**
+ * Entry point
+ * @param argc the number of arguments
+ * @param argv the arguments
+ *
+ * Submit more requests to a stopped NetLabel daemon than its socket can
+ * hold, check that the requests which could not be sent stay queued, then
+ * resume the daemon and check that every request completes.  Finally kill
+ * the daemon with requests outstanding and check that they all fail rather
+ * than wait forever.  Expects the daemon's socket path and process ID as
+ * arguments.  Returns zero on success,
+ * one on failure.
+ *
+ */
+int main(int argc, char *argv[])
+{
+	int rc;
+	unsigned int iter;
+	int fd;
+	int sndbuf = 1;
+	uint32_t version;
+	pid_t pid;
+	struct nlbl_async *async = NULL;
+	struct pollfd pfd;
+
+	if (argc != 3)
+		return 1;
+	pid = atoi(argv[2]);
+
+	if (nlbl_comm_daemon(argv[1]) < 0 || nlbl_init() < 0)
+		return 1;
+	async = nlbl_async_new(NULL);
+	if (async == NULL)
+		return 1;
+	fd = nlbl_async_fd(async);
+	if (fd < 0 ||
+	    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0)
+		goto main_failure;
+
+	/* resolve the family before the daemon stops answering */
+	if (nlbl_mgmt_version(NULL, &version) < 0)
+		goto main_failure;
+
+	/* nothing is read while the daemon is stopped */
+	if (kill(pid, SIGSTOP) < 0)
+		goto main_failure;
+	for (iter = 0; iter < ASYNC_REQUESTS; iter++)
+		if (nlbl_async_mgmt_version(async, async_cb, NULL) < 0)
+			goto main_failure;
+	rc = nlbl_async_process(async);
+	if (rc < 0 || done != 0 || !nlbl_async_blocked(async) ||
+	    nlbl_async_pending(async) != ASYNC_REQUESTS)
+		goto main_failure;
+	if (kill(pid, SIGCONT) < 0)
+		goto main_failure;
+
+	while (nlbl_async_pending(async) > 0) {
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if (nlbl_async_blocked(async))
+			pfd.events |= POLLOUT;
+		if (poll(&pfd, 1, 5000) <= 0)
+			goto main_failure;
+		if (nlbl_async_process(async) < 0)
+			goto main_failure;
+	}
+	if (done != ASYNC_REQUESTS || failed != 0)
+		goto main_failure;
+
+	/* losing the daemon must fail every request */
+	done = 0;
+	if (kill(pid, SIGSTOP) < 0)
+		goto main_failure;
+	for (iter = 0; iter < ASYNC_REQUESTS; iter++)
+		if (nlbl_async_mgmt_version(async, async_cb, NULL) < 0)
+			goto main_failure;
+	if (kill(pid, SIGKILL) < 0)
+		goto main_failure;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, 5000) <= 0 ||
+	    nlbl_async_process(async) != -ECONNRESET ||
+	    nlbl_async_pending(async) != 0 || done != ASYNC_REQUESTS ||
+	    failed != ASYNC_REQUESTS)
+		goto main_failure;
+
+	nlbl_async_free(async);
+	nlbl_exit();
+	return 0;
+
+main_failure:
+	kill(pid, SIGCONT);
+	nlbl_async_free(async);
+	nlbl_exit();
+	return 1;
+}